@@ -485,11 +485,27 @@ public:
 
 ////////////////////////////////////////////////////////////////////
 
-	SIMD_FORCE_INLINE bool isQuantized()
+	SIMD_FORCE_INLINE bool isQuantized() const
 	{
 		return m_useQuantization;
 	}
 
+	// Read only access to the tree for the batched raycasts in STK
+	SIMD_FORCE_INLINE const NodeArray&	getContiguousNodeArray() const
+	{
+		return m_contiguousNodes;
+	}
+
+	SIMD_FORCE_INLINE const QuantizedNodeArray&	getQuantizedNodeArray() const
+	{
+		return m_quantizedContiguousNodes;
+	}
+
+	SIMD_FORCE_INLINE int getNumNodes() const
+	{
+		return m_curNodeIndex;
+	}
+
 private:
 	// Special "copy" constructor that allows for in-place deserialization
 	// Prevents btVector3's default constructor from being called, but doesn't inialize much else
@@ -96,6 +96,13 @@ enet_host_create (const ENetAddress * address, size_t peerCount, size_t channelL
     host -> totalSentPackets = 0;
     host -> totalReceivedData = 0;
     host -> totalReceivedPackets = 0;
+    host -> totalSendCalls = 0;
+    host -> totalReceiveCalls = 0;
+
+    host -> receiveBatch.count = 0;
+    host -> receiveBatch.next = 0;
+    host -> sendBatch.count = 0;
+    host -> sendBatch.dataLength = 0;
 
     host -> connectedPeers = 0;
     host -> bandwidthLimitedPeers = 0;
@@ -110,6 +117,9 @@ enet_host_create (const ENetAddress * address, size_t peerCount, size_t channelL
 
     host -> intercept = NULL;
 
+    host -> wakeupSocket [0] = ENET_SOCKET_NULL;
+    host -> wakeupSocket [1] = ENET_SOCKET_NULL;
+
     enet_list_clear (& host -> dispatchQueue);
 
     for (currentPeer = host -> peers;
@@ -146,6 +156,7 @@ enet_host_destroy (ENetHost * host)
       return;
 
     enet_socket_destroy (host -> socket);
+    enet_host_wakeup_destroy (host);
 
     for (currentPeer = host -> peers;
          currentPeer < & host -> peers [host -> peerCount];
@@ -49,7 +49,8 @@ typedef enum _ENetSocketWait
    ENET_SOCKET_WAIT_NONE      = 0,
    ENET_SOCKET_WAIT_SEND      = (1 << 0),
    ENET_SOCKET_WAIT_RECEIVE   = (1 << 1),
-   ENET_SOCKET_WAIT_INTERRUPT = (1 << 2)
+   ENET_SOCKET_WAIT_INTERRUPT = (1 << 2),
+   ENET_SOCKET_WAIT_WAKEUP    = (1 << 3)
 } ENetSocketWait;
 
 typedef enum _ENetSocketOption
@@ -228,6 +229,7 @@ enum
    ENET_HOST_DEFAULT_MTU                  = 1400,
    ENET_HOST_DEFAULT_MAXIMUM_PACKET_SIZE  = 32 * 1024 * 1024,
    ENET_HOST_DEFAULT_MAXIMUM_WAITING_DATA = 32 * 1024 * 1024,
+   ENET_HOST_DATAGRAM_BATCH               = 16,
 
    ENET_PEER_DEFAULT_ROUND_TRIP_TIME      = 500,
    ENET_PEER_DEFAULT_PACKET_THROTTLE      = 32,
@@ -368,6 +370,20 @@ typedef int (ENET_CALLBACK * ENetInterceptCallback) (struct _ENetHost * host, st
     @sa enet_host_bandwidth_limit()
     @sa enet_host_bandwidth_throttle()
   */
+/** Datagrams received or sent by a host with one system call where the
+    platform allows it, see enet_socket_receive_batch and
+    enet_socket_send_batch.
+*/
+typedef struct _ENetDatagramBatch
+{
+   size_t               count;                       /**< number of datagrams in the batch */
+   size_t               next;                        /**< next received datagram to be handled */
+   size_t               dataLength;                  /**< bytes of data used by the datagrams to send */
+   ENetAddress          addresses [ENET_HOST_DATAGRAM_BATCH];
+   ENetBuffer           buffers [ENET_HOST_DATAGRAM_BATCH];
+   enet_uint8           data [ENET_HOST_DATAGRAM_BATCH * ENET_PROTOCOL_MAXIMUM_MTU];
+} ENetDatagramBatch;
+
 typedef struct _ENetHost
 {
    ENetSocket           socket;
@@ -400,12 +416,17 @@ typedef struct _ENetHost
    enet_uint32          totalSentPackets;            /**< total UDP packets sent, user should reset to 0 as needed to prevent overflow */
    enet_uint32          totalReceivedData;           /**< total data received, user should reset to 0 as needed to prevent overflow */
    enet_uint32          totalReceivedPackets;        /**< total UDP packets received, user should reset to 0 as needed to prevent overflow */
+   enet_uint32          totalSendCalls;              /**< total system calls sending UDP packets, user should reset to 0 as needed to prevent overflow */
+   enet_uint32          totalReceiveCalls;           /**< total system calls receiving UDP packets (including those finding none), user should reset to 0 as needed to prevent overflow */
+   ENetDatagramBatch    receiveBatch;
+   ENetDatagramBatch    sendBatch;
    ENetInterceptCallback intercept;                  /**< callback the user can set to intercept received raw UDP packets */
    size_t               connectedPeers;
    size_t               bandwidthLimitedPeers;
    size_t               duplicatePeers;              /**< optional number of allowed peers from duplicate IPs, defaults to ENET_PROTOCOL_MAXIMUM_PEER_ID */
    size_t               maximumPacketSize;           /**< the maximum allowable packet size that may be sent or received on a peer */
    size_t               maximumWaitingData;          /**< the maximum aggregate amount of buffer space a peer may use waiting for packets to be delivered */
+   ENetSocket           wakeupSocket [2];            /**< optional read and write ends used by enet_host_wakeup to interrupt enet_host_service */
 } ENetHost;
 
 /**
@@ -510,6 +531,8 @@ ENET_API ENetSocket enet_socket_accept (ENetSocket, ENetAddress *);
 ENET_API int        enet_socket_connect (ENetSocket, const ENetAddress *);
 ENET_API int        enet_socket_send (ENetSocket, const ENetAddress *, const ENetBuffer *, size_t);
 ENET_API int        enet_socket_receive (ENetSocket, ENetAddress *, ENetBuffer *, size_t);
+ENET_API int        enet_socket_send_batch (ENetSocket, const ENetAddress *, const ENetBuffer *, size_t, enet_uint32 *);
+ENET_API int        enet_socket_receive_batch (ENetSocket, ENetAddress *, ENetBuffer *, size_t, enet_uint32 *);
 ENET_API int        enet_socket_wait (ENetSocket, enet_uint32 *, enet_uint32);
 ENET_API int        enet_socket_set_option (ENetSocket, ENetSocketOption, int);
 ENET_API int        enet_socket_get_option (ENetSocket, ENetSocketOption, int *);
@@ -581,6 +604,10 @@ ENET_API void       enet_host_compress (ENetHost *, const ENetCompressor *);
 ENET_API int        enet_host_compress_with_range_coder (ENetHost * host);
 ENET_API void       enet_host_channel_limit (ENetHost *, size_t);
 ENET_API void       enet_host_bandwidth_limit (ENetHost *, enet_uint32, enet_uint32);
+ENET_API int        enet_host_wakeup_create (ENetHost *);
+ENET_API void       enet_host_wakeup (ENetHost *);
+ENET_API void       enet_host_wakeup_destroy (ENetHost *);
+extern   int        enet_host_wait (ENetHost *, enet_uint32 *, enet_uint32);
 extern   void       enet_host_bandwidth_throttle (ENetHost *);
 extern  enet_uint32 enet_host_random_seed (void);
 
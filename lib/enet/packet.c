@@ -19,23 +19,31 @@
 ENetPacket *
 enet_packet_create (const void * data, size_t dataLength, enet_uint32 flags)
 {
-    ENetPacket * packet = (ENetPacket *) enet_malloc (sizeof (ENetPacket));
-    if (packet == NULL)
-      return NULL;
+    ENetPacket * packet;
 
+    /* The data is allocated in the same block as the packet (see
+       enet_packet_data_is_inline), which halves allocations per packet */
     if (flags & ENET_PACKET_FLAG_NO_ALLOCATE)
-      packet -> data = (enet_uint8 *) data;
+    {
+       packet = (ENetPacket *) enet_malloc (sizeof (ENetPacket));
+       if (packet == NULL)
+         return NULL;
+       packet -> data = (enet_uint8 *) data;
+    }
     else
     if (dataLength <= 0)
-      packet -> data = NULL;
+    {
+       packet = (ENetPacket *) enet_malloc (sizeof (ENetPacket));
+       if (packet == NULL)
+         return NULL;
+       packet -> data = NULL;
+    }
     else
     {
-       packet -> data = (enet_uint8 *) enet_malloc (dataLength);
-       if (packet -> data == NULL)
-       {
-          enet_free (packet);
-          return NULL;
-       }
+       packet = (ENetPacket *) enet_malloc (sizeof (ENetPacket) + dataLength);
+       if (packet == NULL)
+         return NULL;
+       packet -> data = (enet_uint8 *) (packet + 1);
 
        if (data != NULL)
          memcpy (packet -> data, data, dataLength);
@@ -50,6 +58,14 @@ enet_packet_create (const void * data, size_t dataLength, enet_uint32 flags)
     return packet;
 }
 
+/** Returns true if the data of the packet was allocated together with it.
+*/
+static int
+enet_packet_data_is_inline (ENetPacket * packet)
+{
+    return packet -> data == (enet_uint8 *) (packet + 1);
+}
+
 /** Destroys the packet and deallocates its data.
     @param packet packet to be destroyed
 */
@@ -62,7 +78,7 @@ enet_packet_destroy (ENetPacket * packet)
     if (packet -> freeCallback != NULL)
       (* packet -> freeCallback) (packet);
     if (! (packet -> flags & ENET_PACKET_FLAG_NO_ALLOCATE) &&
-        packet -> data != NULL)
+        packet -> data != NULL && ! enet_packet_data_is_inline (packet))
       enet_free (packet -> data);
     enet_free (packet);
 }
@@ -90,7 +106,8 @@ enet_packet_resize (ENetPacket * packet, size_t dataLength)
       return -1;
 
     memcpy (newData, packet -> data, packet -> dataLength);
-    enet_free (packet -> data);
+    if (! enet_packet_data_is_inline (packet))
+      enet_free (packet -> data);
     
     packet -> data = newData;
     packet -> dataLength = dataLength;
@@ -1204,28 +1204,53 @@ commandError:
 static int
 enet_protocol_receive_incoming_commands (ENetHost * host, ENetEvent * event)
 {
+    ENetDatagramBatch * batch = & host -> receiveBatch;
     int packets;
 
     for (packets = 0; packets < 256; ++ packets)
     {
-       int receivedLength;
-       ENetBuffer buffer;
+       size_t receivedLength;
 
-       buffer.data = host -> packetData [0];
-       buffer.dataLength = sizeof (host -> packetData [0]);
+       /* Datagrams left in the batch by a previous call, which returned
+          an event, are handled before receiving new ones */
+       if (batch -> next >= batch -> count)
+       {
+          int received;
+          size_t i;
 
-       receivedLength = enet_socket_receive (host -> socket,
-                                             & host -> receivedAddress,
-                                             & buffer,
-                                             1);
+          for (i = 0; i < ENET_HOST_DATAGRAM_BATCH; ++ i)
+          {
+             batch -> buffers [i].data = & batch -> data [i * ENET_PROTOCOL_MAXIMUM_MTU];
+             batch -> buffers [i].dataLength = ENET_PROTOCOL_MAXIMUM_MTU;
+          }
 
-       if (receivedLength < 0)
-         return -1;
+          batch -> count = 0;
+          batch -> next = 0;
+
+          received = enet_socket_receive_batch (host -> socket,
+                                                batch -> addresses,
+                                                batch -> buffers,
+                                                ENET_HOST_DATAGRAM_BATCH,
+                                                & host -> totalReceiveCalls);
+
+          if (received < 0)
+            return -1;
+
+          if (received == 0)
+            return 0;
 
+          batch -> count = received;
+       }
+
+       host -> receivedAddress = batch -> addresses [batch -> next];
+       host -> receivedData = (enet_uint8 *) batch -> buffers [batch -> next].data;
+       receivedLength = batch -> buffers [batch -> next].dataLength;
+       ++ batch -> next;
+
+       /* Truncated or from an address of the wrong family */
        if (receivedLength == 0)
-         return 0;
+         continue;
 
-       host -> receivedData = host -> packetData [0];
        host -> receivedDataLength = receivedLength;
       
        host -> totalReceivedData += receivedLength;
@@ -1598,12 +1623,91 @@ enet_protocol_send_reliable_outgoing_commands (ENetHost * host, ENetPeer * peer)
 }
 
 static int
-enet_protocol_send_outgoing_commands (ENetHost * host, ENetEvent * event, int checkForTimeouts)
+enet_protocol_flush_datagrams (ENetHost * host)
+{
+    ENetDatagramBatch * batch = & host -> sendBatch;
+    int sentLength;
+
+    if (batch -> count == 0)
+      return 0;
+
+    sentLength = enet_socket_send_batch (host -> socket, batch -> addresses, batch -> buffers, batch -> count, & host -> totalSendCalls);
+
+    host -> totalSentPackets += batch -> count;
+
+    batch -> count = 0;
+    batch -> dataLength = 0;
+
+    if (sentLength < 0)
+      return -1;
+
+    host -> totalSentData += sentLength;
+
+    return 0;
+}
+
+/** Copies the datagram in the buffers of the host to the send batch, so
+    that the datagrams for all peers are sent together. */
+static int
+enet_protocol_queue_datagram (ENetHost * host, const ENetAddress * address)
+{
+    ENetDatagramBatch * batch = & host -> sendBatch;
+    ENetBuffer * buffer;
+    enet_uint8 * data;
+    size_t i, length = 0;
+
+    for (i = 0; i < host -> bufferCount; ++ i)
+      length += host -> buffers [i].dataLength;
+
+    if (batch -> count >= ENET_HOST_DATAGRAM_BATCH ||
+        batch -> dataLength + length > sizeof (batch -> data) ||
+        length > ENET_PROTOCOL_MAXIMUM_MTU)
+    {
+       if (enet_protocol_flush_datagrams (host) < 0)
+         return -1;
+    }
+
+    /* Doesn't fit into a slot of the batch, sent alone */
+    if (length > ENET_PROTOCOL_MAXIMUM_MTU)
+    {
+       int sentLength = enet_socket_send (host -> socket, address, host -> buffers, host -> bufferCount);
+
+       host -> totalSendCalls ++;
+       host -> totalSentPackets ++;
+
+       if (sentLength < 0)
+         return -1;
+
+       host -> totalSentData += sentLength;
+
+       return 0;
+    }
+
+    data = & batch -> data [batch -> dataLength];
+    buffer = & batch -> buffers [batch -> count];
+    buffer -> data = data;
+    buffer -> dataLength = length;
+
+    for (i = 0; i < host -> bufferCount; ++ i)
+    {
+       memcpy (data, host -> buffers [i].data, host -> buffers [i].dataLength);
+       data += host -> buffers [i].dataLength;
+    }
+
+    batch -> addresses [batch -> count] = * address;
+    batch -> dataLength += length;
+    ++ batch -> count;
+
+    return 0;
+}
+
+static int
+enet_protocol_queue_outgoing_commands (ENetHost * host, ENetEvent * event, int checkForTimeouts)
 {
     enet_uint8 headerData [sizeof (ENetProtocolHeader) + sizeof (enet_uint32)];
     ENetProtocolHeader * header = (ENetProtocolHeader *) headerData;
     ENetPeer * currentPeer;
-    int sentLength;
+    int queueResult;
     size_t shouldCompress = 0;
  
     host -> continueSending = 1;
@@ -1732,20 +1836,30 @@ enet_protocol_send_outgoing_commands (ENetHost * host, ENetEvent * event, int ch
 
         currentPeer -> lastSendTime = host -> serviceTime;
 
-        sentLength = enet_socket_send (host -> socket, & currentPeer -> address, host -> buffers, host -> bufferCount);
+        queueResult = enet_protocol_queue_datagram (host, & currentPeer -> address);
 
         enet_protocol_remove_sent_unreliable_commands (currentPeer);
 
-        if (sentLength < 0)
+        if (queueResult < 0)
           return -1;
-
-        host -> totalSentData += sentLength;
-        host -> totalSentPackets ++;
     }
    
     return 0;
 }
 
+static int
+enet_protocol_send_outgoing_commands (ENetHost * host, ENetEvent * event, int checkForTimeouts)
+{
+    int result = enet_protocol_queue_outgoing_commands (host, event, checkForTimeouts);
+
+    /* Also when returning early with an event, as the datagrams already
+       queued for other peers have to go out now */
+    if (enet_protocol_flush_datagrams (host) < 0)
+      return -1;
+
+    return result;
+}
+
 /** Sends any queued packets on the host specified to its designated peers.
 
     @param host   host to flush
@@ -1789,7 +1903,7 @@ enet_host_check_events (ENetHost * host, ENetEvent * event)
                    if event == NULL then no events will be delivered
     @param timeout number of milliseconds that ENet should wait for events
     @retval > 0 if an event occurred within the specified time limit
-    @retval 0 if no event occurred
+    @retval 0 if no event occurred, or if enet_host_wakeup was called
     @retval < 0 on failure
     @remarks enet_host_service should be called fairly regularly for adequate performance
     @ingroup host
@@ -1910,11 +2024,14 @@ enet_host_service (ENetHost * host, ENetEvent * event, enet_uint32 timeout)
 
           waitCondition = ENET_SOCKET_WAIT_RECEIVE | ENET_SOCKET_WAIT_INTERRUPT;
 
-          if (enet_socket_wait (host -> socket, & waitCondition, ENET_TIME_DIFFERENCE (timeout, host -> serviceTime)) != 0)
+          if (enet_host_wait (host, & waitCondition, ENET_TIME_DIFFERENCE (timeout, host -> serviceTime)) != 0)
             return -1;
        }
        while (waitCondition & ENET_SOCKET_WAIT_INTERRUPT);
 
+       if (waitCondition & ENET_SOCKET_WAIT_WAKEUP)
+         return 0;
+
        host -> serviceTime = enet_time_get ();
     } while (waitCondition & ENET_SOCKET_WAIT_RECEIVE);
 
@@ -4,6 +4,12 @@
 */
 #ifndef _WIN32
 
+#if defined(HAS_SENDMMSG) || defined(HAS_RECVMMSG)
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE 1
+#endif
+#endif
+
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/ioctl.h>
@@ -53,6 +59,10 @@
 #include <poll.h>
 #endif
 
+#ifdef __linux__
+#include <sys/eventfd.h>
+#endif
+
 #ifndef HAS_SOCKLEN_T
 typedef int socklen_t;
 #endif
@@ -63,6 +73,11 @@ typedef int socklen_t;
 
 static enet_uint32 timeBase = 0;
 
+#if defined(HAS_SENDMMSG) || defined(HAS_RECVMMSG)
+/* Set if the kernel doesn't implement sendmmsg and recvmmsg after all */
+static int mmsgUnsupported = 0;
+#endif
+
 // Global variable handled by STK
 extern int isIPv6Socket(void);
 
@@ -481,6 +496,60 @@ enet_socket_destroy (ENetSocket socket)
       close (socket);
 }
 
+static socklen_t
+enet_address_to_sockaddr (const ENetAddress * address, struct sockaddr_storage * sin)
+{
+    memset (sin, 0, sizeof (struct sockaddr_storage));
+
+    if (isIPv6Socket() == 1)
+    {
+        struct sockaddr_in6 * v6 = (struct sockaddr_in6 *) sin;
+        v6 -> sin6_family = AF_INET6;
+        v6 -> sin6_port = ENET_HOST_TO_NET_16 (address -> port);
+        memcpy (v6 -> sin6_addr.s6_addr, & address -> host.p0, 16);
+        v6 -> sin6_scope_id = address -> host.p4;
+
+        return sizeof (struct sockaddr_in6);
+    }
+    else
+    {
+        struct sockaddr_in * v4 = (struct sockaddr_in *) sin;
+        v4 -> sin_family = AF_INET;
+        v4 -> sin_port = ENET_HOST_TO_NET_16 (address -> port);
+        v4 -> sin_addr.s_addr = address -> host.p0;
+
+        return sizeof (struct sockaddr_in);
+    }
+}
+
+static int
+enet_address_from_sockaddr (ENetAddress * address, const struct sockaddr_storage * sin)
+{
+    switch (sin -> ss_family)
+    {
+    case AF_INET:
+        // Should not happen if dual stack is working
+        if (isIPv6Socket() == 1)
+            return -1;
+        const struct sockaddr_in * v4 = (const struct sockaddr_in *) sin;
+        address -> host.p0 = (enet_uint32) v4 -> sin_addr.s_addr;
+        address -> port = ENET_NET_TO_HOST_16 (v4->sin_port);
+        break;
+    case AF_INET6:
+        if (isIPv6Socket() != 1)
+        return -1;
+        const struct sockaddr_in6 * v6 = (const struct sockaddr_in6 *) sin;
+        memcpy (& address -> host.p0, v6 -> sin6_addr.s6_addr, 16);
+        address -> host.p4 = v6 -> sin6_scope_id;
+        address -> port = ENET_NET_TO_HOST_16 (v6 -> sin6_port);
+        break;
+    default:
+        return -1;
+    }
+
+    return 0;
+}
+
 int
 enet_socket_send (ENetSocket socket,
                   const ENetAddress * address,
@@ -489,34 +558,14 @@ enet_socket_send (ENetSocket socket,
 {
     struct msghdr msgHdr;
     struct sockaddr_storage sin;
-    memset (& sin, 0, sizeof (sin));
     int sentLength;
 
     memset (& msgHdr, 0, sizeof (struct msghdr));
 
     if (address != NULL)
     {
-        if (isIPv6Socket() == 1)
-        {
-            struct sockaddr_in6 * v6 = (struct sockaddr_in6 *) & sin;
-            v6 -> sin6_family = AF_INET6;
-            v6 -> sin6_port = ENET_HOST_TO_NET_16 (address -> port);
-            memcpy (v6 -> sin6_addr.s6_addr, & address -> host.p0, 16);
-            v6 -> sin6_scope_id = address -> host.p4;
-
-            msgHdr.msg_name = & sin;
-            msgHdr.msg_namelen = sizeof (struct sockaddr_in6);
-        }
-        else
-        {
-            struct sockaddr_in * v4 = (struct sockaddr_in *) & sin;
-            v4 -> sin_family = AF_INET;
-            v4 -> sin_port = ENET_HOST_TO_NET_16 (address -> port);
-            v4 -> sin_addr.s_addr = address -> host.p0;
-
-            msgHdr.msg_name = & sin;
-            msgHdr.msg_namelen = sizeof (struct sockaddr_in);
-        }
+        msgHdr.msg_name = & sin;
+        msgHdr.msg_namelen = enet_address_to_sockaddr (address, & sin);
     }
 
     msgHdr.msg_iov = (struct iovec *) buffers;
@@ -535,11 +584,14 @@ enet_socket_send (ENetSocket socket,
     return sentLength;
 }
 
-int
-enet_socket_receive (ENetSocket socket,
-                     ENetAddress * address,
-                     ENetBuffer * buffers,
-                     size_t bufferCount)
+/** Receives a datagram like enet_socket_receive, but sets discarded instead
+    of failing if it was truncated or has an address of the wrong family. */
+static int
+enet_socket_receive_datagram (ENetSocket socket,
+                              ENetAddress * address,
+                              ENetBuffer * buffers,
+                              size_t bufferCount,
+                              int * discarded)
 {
     struct msghdr msgHdr;
     struct sockaddr_storage sin;
@@ -567,37 +619,208 @@ enet_socket_receive (ENetSocket socket,
        return -1;
     }
 
+    * discarded = 0;
+
 #ifdef HAS_MSGHDR_FLAGS
     if (msgHdr.msg_flags & MSG_TRUNC)
+      * discarded = 1;
+#endif
+
+    if (address != NULL && enet_address_from_sockaddr (address, & sin) < 0)
+      * discarded = 1;
+
+    return recvLength;
+}
+
+int
+enet_socket_receive (ENetSocket socket,
+                     ENetAddress * address,
+                     ENetBuffer * buffers,
+                     size_t bufferCount)
+{
+    int discarded = 0;
+    int recvLength = enet_socket_receive_datagram (socket, address, buffers, bufferCount, & discarded);
+
+    if (discarded)
       return -1;
+
+    return recvLength;
+}
+
+/** Sends datagrams to possibly different addresses, with one sendmmsg call
+    where it is available.
+    @param socket socket to send with
+    @param addresses destination of each datagram
+    @param buffers data of each datagram
+    @param count number of datagrams, at most ENET_HOST_DATAGRAM_BATCH
+    @param systemCalls incremented by the number of system calls made
+    @returns the number of bytes sent, datagrams which would block are
+    dropped like in enet_socket_send, or < 0 if any datagram failed; the
+    datagrams after a failed one are still sent
+*/
+int
+enet_socket_send_batch (ENetSocket socket,
+                        const ENetAddress * addresses,
+                        const ENetBuffer * buffers,
+                        size_t count,
+                        enet_uint32 * systemCalls)
+{
+    int totalLength = 0, failed = 0;
+    size_t i, first = 0;
+
+#ifdef HAS_SENDMMSG
+    if (! mmsgUnsupported)
+    {
+        struct mmsghdr msgs [ENET_HOST_DATAGRAM_BATCH];
+        struct sockaddr_storage sins [ENET_HOST_DATAGRAM_BATCH];
+        size_t sent = 0;
+
+        memset (msgs, 0, sizeof (struct mmsghdr) * count);
+
+        for (i = 0; i < count; ++ i)
+        {
+            msgs [i].msg_hdr.msg_name = & sins [i];
+            msgs [i].msg_hdr.msg_namelen = enet_address_to_sockaddr (& addresses [i], & sins [i]);
+            msgs [i].msg_hdr.msg_iov = (struct iovec *) & buffers [i];
+            msgs [i].msg_hdr.msg_iovlen = 1;
+        }
+
+        while (sent < count)
+        {
+            int result = sendmmsg (socket, & msgs [sent], count - sent, MSG_NOSIGNAL);
+
+            ++ * systemCalls;
+
+            if (result < 0)
+            {
+                if (errno == ENOSYS && sent == 0)
+                {
+                    mmsgUnsupported = 1;
+                    break;
+                }
+
+                /* The remaining datagrams are sent one by one below, so
+                   an error for one peer doesn't drop those of others */
+                if (errno != EWOULDBLOCK)
+                  break;
+
+                /* The datagram which would block is dropped */
+                ++ sent;
+                continue;
+            }
+
+            for (i = sent; i < sent + result; ++ i)
+              totalLength += msgs [i].msg_len;
+            sent += result;
+        }
+
+        if (! mmsgUnsupported && sent == count)
+          return totalLength;
+
+        first = sent;
+    }
 #endif
 
-    if (address != NULL)
+    for (i = first; i < count; ++ i)
     {
-        switch (sin.ss_family)
+        int sentLength = enet_socket_send (socket, & addresses [i], & buffers [i], 1);
+
+        ++ * systemCalls;
+
+        if (sentLength < 0)
         {
-        case AF_INET:
-            // Should not happen if dual stack is working
-            if (isIPv6Socket() == 1)
-                return -1;
-            struct sockaddr_in * v4 = (struct sockaddr_in *) & sin;
-            address -> host.p0 = (enet_uint32) v4 -> sin_addr.s_addr;
-            address -> port = ENET_NET_TO_HOST_16 (v4->sin_port);
-            break;
-        case AF_INET6:
-            if (isIPv6Socket() != 1)
-            return -1;
-            struct sockaddr_in6 * v6 = (struct sockaddr_in6 *) & sin;
-            memcpy (& address -> host.p0, v6 -> sin6_addr.s6_addr, 16);
-            address -> host.p4 = v6 -> sin6_scope_id;
-            address -> port = ENET_NET_TO_HOST_16 (v6 -> sin6_port);
-            break;
-        default:
-            return -1;
+            failed = 1;
+            continue;
         }
+
+        totalLength += sentLength;
     }
 
-    return recvLength;
+    return failed ? -1 : totalLength;
+}
+
+/** Receives as many datagrams as are waiting, up to count, with one
+    recvmmsg call where it is available.
+    @param socket socket to receive from
+    @param addresses set to the sender of each datagram
+    @param buffers one buffer for each datagram, their length is set to the
+    length of the datagram received in it, or 0 if it was truncated or
+    has an address of the wrong family
+    @param count number of buffers, at most ENET_HOST_DATAGRAM_BATCH
+    @param systemCalls incremented by the number of system calls made
+    @returns the number of datagrams received, 0 if none is waiting, or
+    < 0 on failure
+*/
+int
+enet_socket_receive_batch (ENetSocket socket,
+                           ENetAddress * addresses,
+                           ENetBuffer * buffers,
+                           size_t count,
+                           enet_uint32 * systemCalls)
+{
+    int recvLength, discarded = 0;
+
+#ifdef HAS_RECVMMSG
+    if (! mmsgUnsupported)
+    {
+        struct mmsghdr msgs [ENET_HOST_DATAGRAM_BATCH];
+        struct sockaddr_storage sins [ENET_HOST_DATAGRAM_BATCH];
+        int received, i;
+
+        memset (msgs, 0, sizeof (struct mmsghdr) * count);
+
+        for (i = 0; i < (int) count; ++ i)
+        {
+            msgs [i].msg_hdr.msg_name = & sins [i];
+            msgs [i].msg_hdr.msg_namelen = sizeof (struct sockaddr_storage);
+            msgs [i].msg_hdr.msg_iov = (struct iovec *) & buffers [i];
+            msgs [i].msg_hdr.msg_iovlen = 1;
+        }
+
+        received = recvmmsg (socket, msgs, count, 0, NULL);
+
+        ++ * systemCalls;
+
+        if (received >= 0)
+        {
+            for (i = 0; i < received; ++ i)
+            {
+                buffers [i].dataLength = msgs [i].msg_len;
+
+#ifdef HAS_MSGHDR_FLAGS
+                if (msgs [i].msg_hdr.msg_flags & MSG_TRUNC)
+                  buffers [i].dataLength = 0;
+#endif
+
+                if (enet_address_from_sockaddr (& addresses [i], & sins [i]) < 0)
+                  buffers [i].dataLength = 0;
+            }
+
+            return received;
+        }
+
+        if (errno == EWOULDBLOCK)
+          return 0;
+
+        if (errno != ENOSYS)
+          return -1;
+
+        mmsgUnsupported = 1;
+    }
+#endif
+
+    (void) count;
+
+    recvLength = enet_socket_receive_datagram (socket, & addresses [0], & buffers [0], 1, & discarded);
+
+    ++ * systemCalls;
+
+    if (recvLength < 0 || (recvLength == 0 && ! discarded))
+      return recvLength;
+
+    buffers [0].dataLength = discarded ? 0 : recvLength;
+
+    return 1;
 }
 
 int
@@ -699,5 +922,203 @@ enet_socket_wait (ENetSocket socket, enet_uint32 * condition, enet_uint32 timeou
 #endif
 }
 
+/** Creates the pipe (an eventfd on Linux) used by enet_host_wakeup.
+    @param host host which enet_host_service can be interrupted
+    @retval 0 on success
+    @retval < 0 on failure
+*/
+int
+enet_host_wakeup_create (ENetHost * host)
+{
+    int nonBlock = 1;
+
+    if (host -> wakeupSocket [0] != ENET_SOCKET_NULL)
+      return 0;
+
+#ifdef __linux__
+    host -> wakeupSocket [0] = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (host -> wakeupSocket [0] < 0)
+    {
+        host -> wakeupSocket [0] = ENET_SOCKET_NULL;
+        return -1;
+    }
+    host -> wakeupSocket [1] = host -> wakeupSocket [0];
+    (void) nonBlock;
+#else
+    if (pipe (host -> wakeupSocket) != 0)
+    {
+        host -> wakeupSocket [0] = ENET_SOCKET_NULL;
+        host -> wakeupSocket [1] = ENET_SOCKET_NULL;
+        return -1;
+    }
+    ioctl (host -> wakeupSocket [0], FIONBIO, & nonBlock);
+    ioctl (host -> wakeupSocket [1], FIONBIO, & nonBlock);
+#endif
+    return 0;
+}
+
+/** Makes the current or next enet_host_service of a host return at once,
+    can be called from any thread.
+    @param host host to wake up, enet_host_wakeup_create must have succeeded
+*/
+void
+enet_host_wakeup (ENetHost * host)
+{
+#ifdef __linux__
+    unsigned long long value = 1;
+#else
+    enet_uint8 value = 1;
+#endif
+    ssize_t result;
+
+    if (host -> wakeupSocket [1] == ENET_SOCKET_NULL)
+      return;
+
+    /* A full pipe means a wakeup is already pending */
+    result = write (host -> wakeupSocket [1], & value, sizeof (value));
+    (void) result;
+}
+
+/** Closes the pipe created by enet_host_wakeup_create, done by
+    enet_host_destroy too.
+*/
+void
+enet_host_wakeup_destroy (ENetHost * host)
+{
+    if (host -> wakeupSocket [0] != ENET_SOCKET_NULL)
+      close (host -> wakeupSocket [0]);
+    if (host -> wakeupSocket [1] != ENET_SOCKET_NULL &&
+        host -> wakeupSocket [1] != host -> wakeupSocket [0])
+      close (host -> wakeupSocket [1]);
+    host -> wakeupSocket [0] = ENET_SOCKET_NULL;
+    host -> wakeupSocket [1] = ENET_SOCKET_NULL;
+}
+
+static void
+enet_host_wakeup_drain (ENetHost * host)
+{
+    enet_uint8 buffer [64];
+
+    while (read (host -> wakeupSocket [0], buffer, sizeof (buffer)) > 0)
+      ;
+}
+
+/** Waits on the socket of a host like enet_socket_wait, and if the host has
+    a wakeup pipe, until enet_host_wakeup is called too, in which case
+    ENET_SOCKET_WAIT_WAKEUP is set in the condition.
+*/
+int
+enet_host_wait (ENetHost * host, enet_uint32 * condition, enet_uint32 timeout)
+{
+    ENetSocket socket = host -> socket;
+    ENetSocket wakeup = host -> wakeupSocket [0];
+#ifdef HAS_POLL
+    struct pollfd pollSockets [2];
+    int pollCount;
+
+    if (wakeup == ENET_SOCKET_NULL)
+      return enet_socket_wait (socket, condition, timeout);
+
+    pollSockets [0].fd = socket;
+    pollSockets [0].events = 0;
+    pollSockets [1].fd = wakeup;
+    pollSockets [1].events = POLLIN;
+
+    if (* condition & ENET_SOCKET_WAIT_SEND)
+      pollSockets [0].events |= POLLOUT;
+
+    if (* condition & ENET_SOCKET_WAIT_RECEIVE)
+      pollSockets [0].events |= POLLIN;
+
+    pollCount = poll (pollSockets, 2, timeout);
+
+    if (pollCount < 0)
+    {
+        if (errno == EINTR && * condition & ENET_SOCKET_WAIT_INTERRUPT)
+        {
+            * condition = ENET_SOCKET_WAIT_INTERRUPT;
+
+            return 0;
+        }
+
+        return -1;
+    }
+
+    * condition = ENET_SOCKET_WAIT_NONE;
+
+    if (pollCount == 0)
+      return 0;
+
+    if (pollSockets [0].revents & POLLOUT)
+      * condition |= ENET_SOCKET_WAIT_SEND;
+
+    if (pollSockets [0].revents & POLLIN)
+      * condition |= ENET_SOCKET_WAIT_RECEIVE;
+
+    if (pollSockets [1].revents & POLLIN)
+    {
+        enet_host_wakeup_drain (host);
+        * condition |= ENET_SOCKET_WAIT_WAKEUP;
+    }
+
+    return 0;
+#else
+    fd_set readSet, writeSet;
+    struct timeval timeVal;
+    int selectCount;
+
+    if (wakeup == ENET_SOCKET_NULL)
+      return enet_socket_wait (socket, condition, timeout);
+
+    timeVal.tv_sec = timeout / 1000;
+    timeVal.tv_usec = (timeout % 1000) * 1000;
+
+    FD_ZERO (& readSet);
+    FD_ZERO (& writeSet);
+
+    if (* condition & ENET_SOCKET_WAIT_SEND)
+      FD_SET (socket, & writeSet);
+
+    if (* condition & ENET_SOCKET_WAIT_RECEIVE)
+      FD_SET (socket, & readSet);
+
+    FD_SET (wakeup, & readSet);
+
+    selectCount = select ((socket > wakeup ? socket : wakeup) + 1,
+                          & readSet, & writeSet, NULL, & timeVal);
+
+    if (selectCount < 0)
+    {
+        if (errno == EINTR && * condition & ENET_SOCKET_WAIT_INTERRUPT)
+        {
+            * condition = ENET_SOCKET_WAIT_INTERRUPT;
+
+            return 0;
+        }
+
+        return -1;
+    }
+
+    * condition = ENET_SOCKET_WAIT_NONE;
+
+    if (selectCount == 0)
+      return 0;
+
+    if (FD_ISSET (socket, & writeSet))
+      * condition |= ENET_SOCKET_WAIT_SEND;
+
+    if (FD_ISSET (socket, & readSet))
+      * condition |= ENET_SOCKET_WAIT_RECEIVE;
+
+    if (FD_ISSET (wakeup, & readSet))
+    {
+        enet_host_wakeup_drain (host);
+        * condition |= ENET_SOCKET_WAIT_WAKEUP;
+    }
+
+    return 0;
+#endif
+}
+
 #endif
 
@@ -418,11 +418,14 @@ enet_socket_send (ENetSocket socket,
     return (int) sentLength;
 }
 
-int
-enet_socket_receive (ENetSocket socket,
-                     ENetAddress * address,
-                     ENetBuffer * buffers,
-                     size_t bufferCount)
+/** Receives a datagram like enet_socket_receive, but sets discarded instead
+    of failing if it was truncated or has an address of the wrong family. */
+static int
+enet_socket_receive_datagram (ENetSocket socket,
+                              ENetAddress * address,
+                              ENetBuffer * buffers,
+                              size_t bufferCount,
+                              int * discarded)
 {
     INT sinLength = sizeof (struct sockaddr_storage);
     DWORD flags = 0,
@@ -450,37 +453,124 @@ enet_socket_receive (ENetSocket socket,
        return -1;
     }
 
+    * discarded = 0;
+
     if (flags & MSG_PARTIAL)
-      return -1;
+      * discarded = 1;
 
-    if (address != NULL)
+    if (address != NULL && ! * discarded)
     {
         switch (sin.ss_family)
         {
         case AF_INET:
             // Should not happen if dual stack is working
             if (isIPv6Socket() == 1)
-                return -1;
+            {
+                * discarded = 1;
+                break;
+            }
             struct sockaddr_in * v4 = (struct sockaddr_in *) & sin;
             address -> host.p0 = (enet_uint32) v4 -> sin_addr.s_addr;
             address -> port = ENET_NET_TO_HOST_16 (v4->sin_port);
             break;
         case AF_INET6:
             if (isIPv6Socket() != 1)
-            return -1;
+            {
+                * discarded = 1;
+                break;
+            }
             struct sockaddr_in6 * v6 = (struct sockaddr_in6 *) & sin;
             memcpy (& address -> host.p0, v6 -> sin6_addr.s6_addr, 16);
             address -> host.p4 = v6 -> sin6_scope_id;
             address -> port = ENET_NET_TO_HOST_16 (v6 -> sin6_port);
             break;
         default:
-            return -1;
+            * discarded = 1;
+            break;
         }
     }
 
     return (int) recvLength;
 }
 
+int
+enet_socket_receive (ENetSocket socket,
+                     ENetAddress * address,
+                     ENetBuffer * buffers,
+                     size_t bufferCount)
+{
+    int discarded = 0;
+    int recvLength = enet_socket_receive_datagram (socket, address, buffers, bufferCount, & discarded);
+
+    if (discarded)
+      return -1;
+
+    return recvLength;
+}
+
+/** Sends datagrams to possibly different addresses. Windows has no
+    sendmmsg, so they are sent one by one.
+    @param systemCalls incremented by the number of system calls made
+    @returns the number of bytes sent, or < 0 if any datagram failed; the
+    datagrams after a failed one are still sent
+*/
+int
+enet_socket_send_batch (ENetSocket socket,
+                        const ENetAddress * addresses,
+                        const ENetBuffer * buffers,
+                        size_t count,
+                        enet_uint32 * systemCalls)
+{
+    int totalLength = 0, failed = 0;
+    size_t i;
+
+    for (i = 0; i < count; ++ i)
+    {
+        int sentLength = enet_socket_send (socket, & addresses [i], & buffers [i], 1);
+
+        ++ * systemCalls;
+
+        if (sentLength < 0)
+        {
+            failed = 1;
+            continue;
+        }
+
+        totalLength += sentLength;
+    }
+
+    return failed ? -1 : totalLength;
+}
+
+/** Receives one datagram into the first buffer, as Windows has no
+    recvmmsg, and sets the length of the buffer to its length, or to 0 if
+    it was truncated or has an address of the wrong family.
+    @param systemCalls incremented by the number of system calls made
+    @returns 1 if a datagram was received, 0 if none is waiting, or < 0 on
+    failure
+*/
+int
+enet_socket_receive_batch (ENetSocket socket,
+                           ENetAddress * addresses,
+                           ENetBuffer * buffers,
+                           size_t count,
+                           enet_uint32 * systemCalls)
+{
+    int discarded = 0;
+    int recvLength = enet_socket_receive_datagram (socket, & addresses [0], & buffers [0], 1, & discarded);
+
+    (void) count;
+
+    ++ * systemCalls;
+
+    if (recvLength < 0 || (recvLength == 0 && ! discarded))
+      return recvLength;
+
+    buffers [0].dataLength = discarded ? 0 : recvLength;
+
+    return 1;
+}
+
 int
 enet_socketset_select (ENetSocket maxSocket, ENetSocketSet * readSet, ENetSocketSet * writeSet, enet_uint32 timeout)
 {
@@ -530,5 +620,29 @@ enet_socket_wait (ENetSocket socket, enet_uint32 * condition, enet_uint32 timeou
     return 0;
 } 
 
+/* Waking up enet_host_service from another thread is not implemented on
+   Windows, enet_host_service then only returns at its timeout. */
+int
+enet_host_wakeup_create (ENetHost * host)
+{
+    return -1;
+}
+
+void
+enet_host_wakeup (ENetHost * host)
+{
+}
+
+void
+enet_host_wakeup_destroy (ENetHost * host)
+{
+}
+
+int
+enet_host_wait (ENetHost * host, enet_uint32 * condition, enet_uint32 timeout)
+{
+    return enet_socket_wait (host -> socket, condition, timeout);
+}
+
 #endif
 
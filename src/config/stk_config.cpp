@@ -180,6 +180,7 @@ void STKConfig::load(const std::string &filename)
     CHECK_NEG(m_replay_delta_steering,     "replay delta-steering"      );
     CHECK_NEG(m_replay_delta_speed,        "replay delta-speed     "    );
     CHECK_NEG(m_replay_dt,                 "replay delta-t"             );
+    CHECK_NEG(m_replay_compression,        "replay compression"         );
     CHECK_NEG(m_smooth_angle_limit,        "physics smooth-angle-limit" );
     CHECK_NEG(m_default_track_friction,    "physics default-track-friction");
     CHECK_NEG(m_physics_fps,               "physics fps"                );
@@ -234,6 +235,7 @@ void STKConfig::init_defaults()
     m_replay_delta_steering      = -100;
     m_replay_delta_speed         = -100;
     m_replay_dt                  = -100;
+    m_replay_compression         = -100;
     m_donate_url                 = "";
     m_password_reset_url         = "";
     m_no_explosive_items_timeout = -100.0f;
@@ -555,6 +557,7 @@ void STKConfig::getAllData(const XMLNode * root)
         replay_node->get("delta-speed", &m_replay_delta_speed      );
         replay_node->get("delta-t",     &m_replay_dt               );
         replay_node->get("max-frames",    &m_replay_max_frames     );
+        replay_node->get("compression",   &m_replay_compression    );
 
     }
 
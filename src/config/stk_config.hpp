@@ -207,6 +207,9 @@ public:
      *  be generated. */
     float m_replay_delta_steering;
 
+    /** zlib compression level of replay chunks, 0 to disable compression. */
+    int m_replay_compression;
+
     /** The minimap size */
     float m_minimap_size;
 
@@ -1091,8 +1091,8 @@ namespace GUIEngine
 #ifdef ANDROID
         m_gui_functions.clear();
 #endif
-        g_is_no_graphics[PT_MAIN] = false;
-        g_is_no_graphics[PT_CHILD] = false;
+        for (unsigned i = 0; i < PT_COUNT; i++)
+            g_is_no_graphics[i] = false;
     }   // resetGlobalVariables
 
 
@@ -43,6 +43,7 @@
 #include <FindDirectory.h>
 #endif
 
+#include <cctype>
 #include <stdio.h>
 #include <stdexcept>
 #include <sstream>
@@ -266,6 +267,8 @@ FileManager::FileManager()
     checkAndCreateScreenshotDir();
     checkAndCreateReplayDir();
     checkAndCreateCachedTexturesDir();
+    m_cached_collision_dir = checkAndCreateCacheSubdir("collision");
+    m_cached_navmesh_dir = checkAndCreateCacheSubdir("navmesh");
     checkAndCreateGPDir();
 
     redirectOutput();
@@ -841,6 +844,24 @@ std::string FileManager::getCachedTexturesDir() const
     return m_cached_textures_dir;
 }   // getCachedTexturesDir
 
+//-----------------------------------------------------------------------------
+/** Returns the directory in which serialized collision meshes of tracks are
+ *  cached.
+ */
+std::string FileManager::getCachedCollisionDir() const
+{
+    return m_cached_collision_dir;
+}   // getCachedCollisionDir
+
+//-----------------------------------------------------------------------------
+/** Returns the directory in which the shortest paths of arena navmeshes are
+ *  cached.
+ */
+std::string FileManager::getCachedNavmeshDir() const
+{
+    return m_cached_navmesh_dir;
+}   // getCachedNavmeshDir
+
 //-----------------------------------------------------------------------------
 /** Returns the directory in which user-defined grand prix should be stored.
  */
@@ -1219,6 +1240,35 @@ void FileManager::checkAndCreateCachedTexturesDir()
 
 }   // checkAndCreateCachedTexturesDir
 
+// ----------------------------------------------------------------------------
+/** Creates a directory for cached data next to the cached textures, e.g.
+ *  cached-collision for the name "collision".
+ *  \param name Name of the cached data.
+ *  \return The path of the directory, or "./" if it cannot be created.
+ */
+std::string FileManager::checkAndCreateCacheSubdir(const std::string& name)
+{
+    std::string dir;
+#if defined(WIN_BUILD) || defined(__HAIKU__)
+    dir = m_user_config_dir + "cached-" + name + "/";
+#elif defined(__APPLE__)
+    dir = getenv("HOME");
+    dir += "/Library/Application Support/SuperTuxKart/Cached";
+    dir += (char)toupper(name[0]) + name.substr(1) + "/";
+#else
+    dir = checkAndCreateLinuxDir("XDG_CACHE_HOME", "supertuxkart", ".cache/", ".");
+    dir += "cached-" + name + "/";
+#endif
+
+    if (!checkAndCreateDirectory(dir))
+    {
+        Log::error("FileManager", "Can not create cached %s directory "
+            "'%s', falling back to '.'.", name.c_str(), dir.c_str());
+        dir = "./";
+    }
+    return dir;
+}   // checkAndCreateCacheSubdir
+
 // ----------------------------------------------------------------------------
 /** Creates the directories for user-defined grand prix. This will set m_gp_dir
  *  with the appropriate path.
@@ -20,6 +20,7 @@
 #define HEADER_ABSTRACT_KART_HPP
 
 #include <memory>
+#include <vector>
 
 #include "items/powerup_manager.hpp"
 #include "karts/moveable.hpp"
@@ -485,6 +486,11 @@ public:
     /** Returns the terrain info oject. */
     virtual const TerrainInfo *getTerrainInfo() const = 0;
     // ------------------------------------------------------------------------
+    /** Prepares the raycast of the next update() which detects the terrain,
+     *  so that the rays of all karts can be cast together.
+     *  \param infos The terrain info of this kart is added to it. */
+    virtual void prepareTerrainRay(std::vector<TerrainInfo*> *infos) = 0;
+    // ------------------------------------------------------------------------
     /** Called when the kart crashes against another kart.
      *  \param k The kart that was hit.
      *  \param update_attachments If true the attachment of this kart and the
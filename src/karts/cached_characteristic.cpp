@@ -18,186 +18,776 @@
 
 #include "karts/cached_characteristic.hpp"
 
+#include "karts/combined_characteristic.hpp"
+#include "karts/kart_properties_manager.hpp"
 #include "utils/interpolation_array.hpp"
+#include "utils/log.hpp"
+
+#include <chrono>
 
 CachedCharacteristic::CachedCharacteristic(const AbstractCharacteristic *origin) :
-    m_values(CHARACTERISTIC_COUNT),
+    m_values(),
     m_origin(origin)
 {
     updateSource();
 }
 
-// ----------------------------------------------------------------------------
-/** Deletes all allocated values. */
-CachedCharacteristic::~CachedCharacteristic()
-{
-    // Delete all not-null values
-    for (int i = 0; i < CHARACTERISTIC_COUNT; i++)
-    {
-        SaveValue &v = m_values[i];
-        if (v.content)
-        {
-            switch (getType(static_cast<CharacteristicType>(i)))
-            {
-            case TYPE_FLOAT:
-                delete static_cast<float*>(v.content);
-                break;
-            case TYPE_FLOAT_VECTOR:
-                delete static_cast<std::vector<float>*>(v.content);
-                break;
-            case TYPE_INTERPOLATION_ARRAY:
-                delete static_cast<InterpolationArray*>(v.content);
-                break;
-            case TYPE_BOOL:
-                delete static_cast<bool*>(v.content);
-                break;
-            }
-            v.content = nullptr;
-        }
-    }
-}   // ~CachedCharacteristic
-
 // ----------------------------------------------------------------------------
 /** Recompute the values of all characteristics based on the list of
  *  source-characteristics.
  */
 void CachedCharacteristic::updateSource()
+{
+    // Script-generated content generated by tools/create_kart_properties.py cvupdate
+    // Please don't change the following tag. It will be automatically detected
+    // by the script and replace the contained content.
+    // To update the code, use tools/update_characteristics.py
+    /* <characteristics-start cvupdate> */
+    m_is_set[SUSPENSION_STIFFNESS] = false;
+    m_origin->process(SUSPENSION_STIFFNESS, &m_values.m_suspension_stiffness,
+        &m_is_set[SUSPENSION_STIFFNESS]);
+    m_is_set[SUSPENSION_REST] = false;
+    m_origin->process(SUSPENSION_REST, &m_values.m_suspension_rest,
+        &m_is_set[SUSPENSION_REST]);
+    m_is_set[SUSPENSION_TRAVEL] = false;
+    m_origin->process(SUSPENSION_TRAVEL, &m_values.m_suspension_travel,
+        &m_is_set[SUSPENSION_TRAVEL]);
+    m_is_set[SUSPENSION_EXP_SPRING_RESPONSE] = false;
+    m_origin->process(SUSPENSION_EXP_SPRING_RESPONSE, &m_values.m_suspension_exp_spring_response,
+        &m_is_set[SUSPENSION_EXP_SPRING_RESPONSE]);
+    m_is_set[SUSPENSION_MAX_FORCE] = false;
+    m_origin->process(SUSPENSION_MAX_FORCE, &m_values.m_suspension_max_force,
+        &m_is_set[SUSPENSION_MAX_FORCE]);
+    m_is_set[STABILITY_ROLL_INFLUENCE] = false;
+    m_origin->process(STABILITY_ROLL_INFLUENCE, &m_values.m_stability_roll_influence,
+        &m_is_set[STABILITY_ROLL_INFLUENCE]);
+    m_is_set[STABILITY_CHASSIS_LINEAR_DAMPING] = false;
+    m_origin->process(STABILITY_CHASSIS_LINEAR_DAMPING, &m_values.m_stability_chassis_linear_damping,
+        &m_is_set[STABILITY_CHASSIS_LINEAR_DAMPING]);
+    m_is_set[STABILITY_CHASSIS_ANGULAR_DAMPING] = false;
+    m_origin->process(STABILITY_CHASSIS_ANGULAR_DAMPING, &m_values.m_stability_chassis_angular_damping,
+        &m_is_set[STABILITY_CHASSIS_ANGULAR_DAMPING]);
+    m_is_set[STABILITY_DOWNWARD_IMPULSE_FACTOR] = false;
+    m_origin->process(STABILITY_DOWNWARD_IMPULSE_FACTOR, &m_values.m_stability_downward_impulse_factor,
+        &m_is_set[STABILITY_DOWNWARD_IMPULSE_FACTOR]);
+    m_is_set[STABILITY_TRACK_CONNECTION_ACCEL] = false;
+    m_origin->process(STABILITY_TRACK_CONNECTION_ACCEL, &m_values.m_stability_track_connection_accel,
+        &m_is_set[STABILITY_TRACK_CONNECTION_ACCEL]);
+    m_is_set[STABILITY_ANGULAR_FACTOR] = false;
+    m_origin->process(STABILITY_ANGULAR_FACTOR, &m_values.m_stability_angular_factor,
+        &m_is_set[STABILITY_ANGULAR_FACTOR]);
+    m_is_set[STABILITY_SMOOTH_FLYING_IMPULSE] = false;
+    m_origin->process(STABILITY_SMOOTH_FLYING_IMPULSE, &m_values.m_stability_smooth_flying_impulse,
+        &m_is_set[STABILITY_SMOOTH_FLYING_IMPULSE]);
+    m_is_set[TURN_RADIUS] = false;
+    m_origin->process(TURN_RADIUS, &m_values.m_turn_radius,
+        &m_is_set[TURN_RADIUS]);
+    m_is_set[TURN_TIME_RESET_STEER] = false;
+    m_origin->process(TURN_TIME_RESET_STEER, &m_values.m_turn_time_reset_steer,
+        &m_is_set[TURN_TIME_RESET_STEER]);
+    m_is_set[TURN_TIME_FULL_STEER] = false;
+    m_origin->process(TURN_TIME_FULL_STEER, &m_values.m_turn_time_full_steer,
+        &m_is_set[TURN_TIME_FULL_STEER]);
+    m_is_set[ENGINE_POWER] = false;
+    m_origin->process(ENGINE_POWER, &m_values.m_engine_power,
+        &m_is_set[ENGINE_POWER]);
+    m_is_set[ENGINE_MAX_SPEED] = false;
+    m_origin->process(ENGINE_MAX_SPEED, &m_values.m_engine_max_speed,
+        &m_is_set[ENGINE_MAX_SPEED]);
+    m_is_set[ENGINE_GENERIC_MAX_SPEED] = false;
+    m_origin->process(ENGINE_GENERIC_MAX_SPEED, &m_values.m_engine_generic_max_speed,
+        &m_is_set[ENGINE_GENERIC_MAX_SPEED]);
+    m_is_set[ENGINE_BRAKE_FACTOR] = false;
+    m_origin->process(ENGINE_BRAKE_FACTOR, &m_values.m_engine_brake_factor,
+        &m_is_set[ENGINE_BRAKE_FACTOR]);
+    m_is_set[ENGINE_BRAKE_TIME_INCREASE] = false;
+    m_origin->process(ENGINE_BRAKE_TIME_INCREASE, &m_values.m_engine_brake_time_increase,
+        &m_is_set[ENGINE_BRAKE_TIME_INCREASE]);
+    m_is_set[ENGINE_MAX_SPEED_REVERSE_RATIO] = false;
+    m_origin->process(ENGINE_MAX_SPEED_REVERSE_RATIO, &m_values.m_engine_max_speed_reverse_ratio,
+        &m_is_set[ENGINE_MAX_SPEED_REVERSE_RATIO]);
+    m_is_set[GEAR_SWITCH_RATIO] = false;
+    m_origin->process(GEAR_SWITCH_RATIO, &m_values.m_gear_switch_ratio,
+        &m_is_set[GEAR_SWITCH_RATIO]);
+    m_is_set[GEAR_POWER_INCREASE] = false;
+    m_origin->process(GEAR_POWER_INCREASE, &m_values.m_gear_power_increase,
+        &m_is_set[GEAR_POWER_INCREASE]);
+    m_is_set[MASS] = false;
+    m_origin->process(MASS, &m_values.m_mass,
+        &m_is_set[MASS]);
+    m_is_set[WHEELS_DAMPING_RELAXATION] = false;
+    m_origin->process(WHEELS_DAMPING_RELAXATION, &m_values.m_wheels_damping_relaxation,
+        &m_is_set[WHEELS_DAMPING_RELAXATION]);
+    m_is_set[WHEELS_DAMPING_COMPRESSION] = false;
+    m_origin->process(WHEELS_DAMPING_COMPRESSION, &m_values.m_wheels_damping_compression,
+        &m_is_set[WHEELS_DAMPING_COMPRESSION]);
+    m_is_set[JUMP_ANIMATION_TIME] = false;
+    m_origin->process(JUMP_ANIMATION_TIME, &m_values.m_jump_animation_time,
+        &m_is_set[JUMP_ANIMATION_TIME]);
+    m_is_set[LEAN_MAX] = false;
+    m_origin->process(LEAN_MAX, &m_values.m_lean_max,
+        &m_is_set[LEAN_MAX]);
+    m_is_set[LEAN_SPEED] = false;
+    m_origin->process(LEAN_SPEED, &m_values.m_lean_speed,
+        &m_is_set[LEAN_SPEED]);
+    m_is_set[ANVIL_DURATION] = false;
+    m_origin->process(ANVIL_DURATION, &m_values.m_anvil_duration,
+        &m_is_set[ANVIL_DURATION]);
+    m_is_set[ANVIL_WEIGHT] = false;
+    m_origin->process(ANVIL_WEIGHT, &m_values.m_anvil_weight,
+        &m_is_set[ANVIL_WEIGHT]);
+    m_is_set[ANVIL_SPEED_FACTOR] = false;
+    m_origin->process(ANVIL_SPEED_FACTOR, &m_values.m_anvil_speed_factor,
+        &m_is_set[ANVIL_SPEED_FACTOR]);
+    m_is_set[PARACHUTE_FRICTION] = false;
+    m_origin->process(PARACHUTE_FRICTION, &m_values.m_parachute_friction,
+        &m_is_set[PARACHUTE_FRICTION]);
+    m_is_set[PARACHUTE_DURATION] = false;
+    m_origin->process(PARACHUTE_DURATION, &m_values.m_parachute_duration,
+        &m_is_set[PARACHUTE_DURATION]);
+    m_is_set[PARACHUTE_DURATION_OTHER] = false;
+    m_origin->process(PARACHUTE_DURATION_OTHER, &m_values.m_parachute_duration_other,
+        &m_is_set[PARACHUTE_DURATION_OTHER]);
+    m_is_set[PARACHUTE_DURATION_RANK_MULT] = false;
+    m_origin->process(PARACHUTE_DURATION_RANK_MULT, &m_values.m_parachute_duration_rank_mult,
+        &m_is_set[PARACHUTE_DURATION_RANK_MULT]);
+    m_is_set[PARACHUTE_DURATION_SPEED_MULT] = false;
+    m_origin->process(PARACHUTE_DURATION_SPEED_MULT, &m_values.m_parachute_duration_speed_mult,
+        &m_is_set[PARACHUTE_DURATION_SPEED_MULT]);
+    m_is_set[PARACHUTE_LBOUND_FRACTION] = false;
+    m_origin->process(PARACHUTE_LBOUND_FRACTION, &m_values.m_parachute_lbound_fraction,
+        &m_is_set[PARACHUTE_LBOUND_FRACTION]);
+    m_is_set[PARACHUTE_UBOUND_FRACTION] = false;
+    m_origin->process(PARACHUTE_UBOUND_FRACTION, &m_values.m_parachute_ubound_fraction,
+        &m_is_set[PARACHUTE_UBOUND_FRACTION]);
+    m_is_set[PARACHUTE_MAX_SPEED] = false;
+    m_origin->process(PARACHUTE_MAX_SPEED, &m_values.m_parachute_max_speed,
+        &m_is_set[PARACHUTE_MAX_SPEED]);
+    m_is_set[FRICTION_KART_FRICTION] = false;
+    m_origin->process(FRICTION_KART_FRICTION, &m_values.m_friction_kart_friction,
+        &m_is_set[FRICTION_KART_FRICTION]);
+    m_is_set[BUBBLEGUM_DURATION] = false;
+    m_origin->process(BUBBLEGUM_DURATION, &m_values.m_bubblegum_duration,
+        &m_is_set[BUBBLEGUM_DURATION]);
+    m_is_set[BUBBLEGUM_SPEED_FRACTION] = false;
+    m_origin->process(BUBBLEGUM_SPEED_FRACTION, &m_values.m_bubblegum_speed_fraction,
+        &m_is_set[BUBBLEGUM_SPEED_FRACTION]);
+    m_is_set[BUBBLEGUM_TORQUE] = false;
+    m_origin->process(BUBBLEGUM_TORQUE, &m_values.m_bubblegum_torque,
+        &m_is_set[BUBBLEGUM_TORQUE]);
+    m_is_set[BUBBLEGUM_FADE_IN_TIME] = false;
+    m_origin->process(BUBBLEGUM_FADE_IN_TIME, &m_values.m_bubblegum_fade_in_time,
+        &m_is_set[BUBBLEGUM_FADE_IN_TIME]);
+    m_is_set[BUBBLEGUM_SHIELD_DURATION] = false;
+    m_origin->process(BUBBLEGUM_SHIELD_DURATION, &m_values.m_bubblegum_shield_duration,
+        &m_is_set[BUBBLEGUM_SHIELD_DURATION]);
+    m_is_set[ZIPPER_DURATION] = false;
+    m_origin->process(ZIPPER_DURATION, &m_values.m_zipper_duration,
+        &m_is_set[ZIPPER_DURATION]);
+    m_is_set[ZIPPER_FORCE] = false;
+    m_origin->process(ZIPPER_FORCE, &m_values.m_zipper_force,
+        &m_is_set[ZIPPER_FORCE]);
+    m_is_set[ZIPPER_SPEED_GAIN] = false;
+    m_origin->process(ZIPPER_SPEED_GAIN, &m_values.m_zipper_speed_gain,
+        &m_is_set[ZIPPER_SPEED_GAIN]);
+    m_is_set[ZIPPER_MAX_SPEED_INCREASE] = false;
+    m_origin->process(ZIPPER_MAX_SPEED_INCREASE, &m_values.m_zipper_max_speed_increase,
+        &m_is_set[ZIPPER_MAX_SPEED_INCREASE]);
+    m_is_set[ZIPPER_FADE_OUT_TIME] = false;
+    m_origin->process(ZIPPER_FADE_OUT_TIME, &m_values.m_zipper_fade_out_time,
+        &m_is_set[ZIPPER_FADE_OUT_TIME]);
+    m_is_set[SWATTER_DURATION] = false;
+    m_origin->process(SWATTER_DURATION, &m_values.m_swatter_duration,
+        &m_is_set[SWATTER_DURATION]);
+    m_is_set[SWATTER_DISTANCE] = false;
+    m_origin->process(SWATTER_DISTANCE, &m_values.m_swatter_distance,
+        &m_is_set[SWATTER_DISTANCE]);
+    m_is_set[SWATTER_SQUASH_DURATION] = false;
+    m_origin->process(SWATTER_SQUASH_DURATION, &m_values.m_swatter_squash_duration,
+        &m_is_set[SWATTER_SQUASH_DURATION]);
+    m_is_set[SWATTER_SQUASH_SLOWDOWN] = false;
+    m_origin->process(SWATTER_SQUASH_SLOWDOWN, &m_values.m_swatter_squash_slowdown,
+        &m_is_set[SWATTER_SQUASH_SLOWDOWN]);
+    m_is_set[PLUNGER_BAND_MAX_LENGTH] = false;
+    m_origin->process(PLUNGER_BAND_MAX_LENGTH, &m_values.m_plunger_band_max_length,
+        &m_is_set[PLUNGER_BAND_MAX_LENGTH]);
+    m_is_set[PLUNGER_BAND_FORCE] = false;
+    m_origin->process(PLUNGER_BAND_FORCE, &m_values.m_plunger_band_force,
+        &m_is_set[PLUNGER_BAND_FORCE]);
+    m_is_set[PLUNGER_BAND_DURATION] = false;
+    m_origin->process(PLUNGER_BAND_DURATION, &m_values.m_plunger_band_duration,
+        &m_is_set[PLUNGER_BAND_DURATION]);
+    m_is_set[PLUNGER_BAND_SPEED_INCREASE] = false;
+    m_origin->process(PLUNGER_BAND_SPEED_INCREASE, &m_values.m_plunger_band_speed_increase,
+        &m_is_set[PLUNGER_BAND_SPEED_INCREASE]);
+    m_is_set[PLUNGER_BAND_FADE_OUT_TIME] = false;
+    m_origin->process(PLUNGER_BAND_FADE_OUT_TIME, &m_values.m_plunger_band_fade_out_time,
+        &m_is_set[PLUNGER_BAND_FADE_OUT_TIME]);
+    m_is_set[PLUNGER_IN_FACE_TIME] = false;
+    m_origin->process(PLUNGER_IN_FACE_TIME, &m_values.m_plunger_in_face_time,
+        &m_is_set[PLUNGER_IN_FACE_TIME]);
+    m_is_set[STARTUP_TIME] = false;
+    m_origin->process(STARTUP_TIME, &m_values.m_startup_time,
+        &m_is_set[STARTUP_TIME]);
+    m_is_set[STARTUP_BOOST] = false;
+    m_origin->process(STARTUP_BOOST, &m_values.m_startup_boost,
+        &m_is_set[STARTUP_BOOST]);
+    m_is_set[RESCUE_DURATION] = false;
+    m_origin->process(RESCUE_DURATION, &m_values.m_rescue_duration,
+        &m_is_set[RESCUE_DURATION]);
+    m_is_set[RESCUE_VERT_OFFSET] = false;
+    m_origin->process(RESCUE_VERT_OFFSET, &m_values.m_rescue_vert_offset,
+        &m_is_set[RESCUE_VERT_OFFSET]);
+    m_is_set[RESCUE_HEIGHT] = false;
+    m_origin->process(RESCUE_HEIGHT, &m_values.m_rescue_height,
+        &m_is_set[RESCUE_HEIGHT]);
+    m_is_set[EXPLOSION_DURATION] = false;
+    m_origin->process(EXPLOSION_DURATION, &m_values.m_explosion_duration,
+        &m_is_set[EXPLOSION_DURATION]);
+    m_is_set[EXPLOSION_RADIUS] = false;
+    m_origin->process(EXPLOSION_RADIUS, &m_values.m_explosion_radius,
+        &m_is_set[EXPLOSION_RADIUS]);
+    m_is_set[EXPLOSION_INVULNERABILITY_TIME] = false;
+    m_origin->process(EXPLOSION_INVULNERABILITY_TIME, &m_values.m_explosion_invulnerability_time,
+        &m_is_set[EXPLOSION_INVULNERABILITY_TIME]);
+    m_is_set[NITRO_DURATION] = false;
+    m_origin->process(NITRO_DURATION, &m_values.m_nitro_duration,
+        &m_is_set[NITRO_DURATION]);
+    m_is_set[NITRO_ENGINE_FORCE] = false;
+    m_origin->process(NITRO_ENGINE_FORCE, &m_values.m_nitro_engine_force,
+        &m_is_set[NITRO_ENGINE_FORCE]);
+    m_is_set[NITRO_ENGINE_MULT] = false;
+    m_origin->process(NITRO_ENGINE_MULT, &m_values.m_nitro_engine_mult,
+        &m_is_set[NITRO_ENGINE_MULT]);
+    m_is_set[NITRO_CONSUMPTION] = false;
+    m_origin->process(NITRO_CONSUMPTION, &m_values.m_nitro_consumption,
+        &m_is_set[NITRO_CONSUMPTION]);
+    m_is_set[NITRO_SMALL_CONTAINER] = false;
+    m_origin->process(NITRO_SMALL_CONTAINER, &m_values.m_nitro_small_container,
+        &m_is_set[NITRO_SMALL_CONTAINER]);
+    m_is_set[NITRO_BIG_CONTAINER] = false;
+    m_origin->process(NITRO_BIG_CONTAINER, &m_values.m_nitro_big_container,
+        &m_is_set[NITRO_BIG_CONTAINER]);
+    m_is_set[NITRO_MAX_SPEED_INCREASE] = false;
+    m_origin->process(NITRO_MAX_SPEED_INCREASE, &m_values.m_nitro_max_speed_increase,
+        &m_is_set[NITRO_MAX_SPEED_INCREASE]);
+    m_is_set[NITRO_FADE_OUT_TIME] = false;
+    m_origin->process(NITRO_FADE_OUT_TIME, &m_values.m_nitro_fade_out_time,
+        &m_is_set[NITRO_FADE_OUT_TIME]);
+    m_is_set[NITRO_MAX] = false;
+    m_origin->process(NITRO_MAX, &m_values.m_nitro_max,
+        &m_is_set[NITRO_MAX]);
+    m_is_set[SLIPSTREAM_DURATION_FACTOR] = false;
+    m_origin->process(SLIPSTREAM_DURATION_FACTOR, &m_values.m_slipstream_duration_factor,
+        &m_is_set[SLIPSTREAM_DURATION_FACTOR]);
+    m_is_set[SLIPSTREAM_BASE_SPEED] = false;
+    m_origin->process(SLIPSTREAM_BASE_SPEED, &m_values.m_slipstream_base_speed,
+        &m_is_set[SLIPSTREAM_BASE_SPEED]);
+    m_is_set[SLIPSTREAM_LENGTH] = false;
+    m_origin->process(SLIPSTREAM_LENGTH, &m_values.m_slipstream_length,
+        &m_is_set[SLIPSTREAM_LENGTH]);
+    m_is_set[SLIPSTREAM_WIDTH] = false;
+    m_origin->process(SLIPSTREAM_WIDTH, &m_values.m_slipstream_width,
+        &m_is_set[SLIPSTREAM_WIDTH]);
+    m_is_set[SLIPSTREAM_INNER_FACTOR] = false;
+    m_origin->process(SLIPSTREAM_INNER_FACTOR, &m_values.m_slipstream_inner_factor,
+        &m_is_set[SLIPSTREAM_INNER_FACTOR]);
+    m_is_set[SLIPSTREAM_MIN_COLLECT_TIME] = false;
+    m_origin->process(SLIPSTREAM_MIN_COLLECT_TIME, &m_values.m_slipstream_min_collect_time,
+        &m_is_set[SLIPSTREAM_MIN_COLLECT_TIME]);
+    m_is_set[SLIPSTREAM_MAX_COLLECT_TIME] = false;
+    m_origin->process(SLIPSTREAM_MAX_COLLECT_TIME, &m_values.m_slipstream_max_collect_time,
+        &m_is_set[SLIPSTREAM_MAX_COLLECT_TIME]);
+    m_is_set[SLIPSTREAM_ADD_POWER] = false;
+    m_origin->process(SLIPSTREAM_ADD_POWER, &m_values.m_slipstream_add_power,
+        &m_is_set[SLIPSTREAM_ADD_POWER]);
+    m_is_set[SLIPSTREAM_MIN_SPEED] = false;
+    m_origin->process(SLIPSTREAM_MIN_SPEED, &m_values.m_slipstream_min_speed,
+        &m_is_set[SLIPSTREAM_MIN_SPEED]);
+    m_is_set[SLIPSTREAM_MAX_SPEED_INCREASE] = false;
+    m_origin->process(SLIPSTREAM_MAX_SPEED_INCREASE, &m_values.m_slipstream_max_speed_increase,
+        &m_is_set[SLIPSTREAM_MAX_SPEED_INCREASE]);
+    m_is_set[SLIPSTREAM_FADE_OUT_TIME] = false;
+    m_origin->process(SLIPSTREAM_FADE_OUT_TIME, &m_values.m_slipstream_fade_out_time,
+        &m_is_set[SLIPSTREAM_FADE_OUT_TIME]);
+    m_is_set[SKID_INCREASE] = false;
+    m_origin->process(SKID_INCREASE, &m_values.m_skid_increase,
+        &m_is_set[SKID_INCREASE]);
+    m_is_set[SKID_DECREASE] = false;
+    m_origin->process(SKID_DECREASE, &m_values.m_skid_decrease,
+        &m_is_set[SKID_DECREASE]);
+    m_is_set[SKID_MAX] = false;
+    m_origin->process(SKID_MAX, &m_values.m_skid_max,
+        &m_is_set[SKID_MAX]);
+    m_is_set[SKID_TIME_TILL_MAX] = false;
+    m_origin->process(SKID_TIME_TILL_MAX, &m_values.m_skid_time_till_max,
+        &m_is_set[SKID_TIME_TILL_MAX]);
+    m_is_set[SKID_VISUAL] = false;
+    m_origin->process(SKID_VISUAL, &m_values.m_skid_visual,
+        &m_is_set[SKID_VISUAL]);
+    m_is_set[SKID_VISUAL_TIME] = false;
+    m_origin->process(SKID_VISUAL_TIME, &m_values.m_skid_visual_time,
+        &m_is_set[SKID_VISUAL_TIME]);
+    m_is_set[SKID_REVERT_VISUAL_TIME] = false;
+    m_origin->process(SKID_REVERT_VISUAL_TIME, &m_values.m_skid_revert_visual_time,
+        &m_is_set[SKID_REVERT_VISUAL_TIME]);
+    m_is_set[SKID_MIN_SPEED] = false;
+    m_origin->process(SKID_MIN_SPEED, &m_values.m_skid_min_speed,
+        &m_is_set[SKID_MIN_SPEED]);
+    m_is_set[SKID_TIME_TILL_BONUS] = false;
+    m_origin->process(SKID_TIME_TILL_BONUS, &m_values.m_skid_time_till_bonus,
+        &m_is_set[SKID_TIME_TILL_BONUS]);
+    m_is_set[SKID_BONUS_SPEED] = false;
+    m_origin->process(SKID_BONUS_SPEED, &m_values.m_skid_bonus_speed,
+        &m_is_set[SKID_BONUS_SPEED]);
+    m_is_set[SKID_BONUS_TIME] = false;
+    m_origin->process(SKID_BONUS_TIME, &m_values.m_skid_bonus_time,
+        &m_is_set[SKID_BONUS_TIME]);
+    m_is_set[SKID_BONUS_FORCE] = false;
+    m_origin->process(SKID_BONUS_FORCE, &m_values.m_skid_bonus_force,
+        &m_is_set[SKID_BONUS_FORCE]);
+    m_is_set[SKID_PHYSICAL_JUMP_TIME] = false;
+    m_origin->process(SKID_PHYSICAL_JUMP_TIME, &m_values.m_skid_physical_jump_time,
+        &m_is_set[SKID_PHYSICAL_JUMP_TIME]);
+    m_is_set[SKID_GRAPHICAL_JUMP_TIME] = false;
+    m_origin->process(SKID_GRAPHICAL_JUMP_TIME, &m_values.m_skid_graphical_jump_time,
+        &m_is_set[SKID_GRAPHICAL_JUMP_TIME]);
+    m_is_set[SKID_POST_SKID_ROTATE_FACTOR] = false;
+    m_origin->process(SKID_POST_SKID_ROTATE_FACTOR, &m_values.m_skid_post_skid_rotate_factor,
+        &m_is_set[SKID_POST_SKID_ROTATE_FACTOR]);
+    m_is_set[SKID_REDUCE_TURN_MIN] = false;
+    m_origin->process(SKID_REDUCE_TURN_MIN, &m_values.m_skid_reduce_turn_min,
+        &m_is_set[SKID_REDUCE_TURN_MIN]);
+    m_is_set[SKID_REDUCE_TURN_MAX] = false;
+    m_origin->process(SKID_REDUCE_TURN_MAX, &m_values.m_skid_reduce_turn_max,
+        &m_is_set[SKID_REDUCE_TURN_MAX]);
+    m_is_set[SKID_ENABLED] = false;
+    m_origin->process(SKID_ENABLED, &m_values.m_skid_enabled,
+        &m_is_set[SKID_ENABLED]);
+
+    /* <characteristics-end cvupdate> */
+}   // updateSource
+
+// ----------------------------------------------------------------------------
+/** Checks if all characteristics are set, so that getValues() can be used.
+ *  \param missing Is set to the first characteristic that is not set.
+ */
+bool CachedCharacteristic::isComplete(CharacteristicType *missing) const
 {
     for (int i = 0; i < CHARACTERISTIC_COUNT; i++)
     {
-        SaveValue &v = m_values[i];
-        
-        bool is_set = false;
-        switch (getType(static_cast<CharacteristicType>(i)))
-        {
-        case TYPE_FLOAT:
-        {
-            float value;
-            float *ptr = static_cast<float*>(v.content);
-            m_origin->process(static_cast<CharacteristicType>(i), &value, &is_set);
-            if (is_set)
-            {
-                if (!ptr)
-                {
-                    float *newPtr = new float();
-                    v.content = newPtr;
-                    ptr = newPtr;
-                }
-                *ptr = value;
-            }
-            else
-            {
-                if (ptr)
-                {
-                    delete ptr;
-                    v.content = nullptr;
-                }
-            }
-            break;
-        }
-        case TYPE_FLOAT_VECTOR:
-        {
-            std::vector<float> value;
-            std::vector<float> *ptr = static_cast<std::vector<float>*>(v.content);
-            m_origin->process(static_cast<CharacteristicType>(i), &value, &is_set);
-            if (is_set)
-            {
-                if (!ptr)
-                {
-                    std::vector<float> *newPtr = new std::vector<float>();
-                    v.content = newPtr;
-                    ptr = newPtr;
-                }
-                *ptr = value;
-            }
-            else
-            {
-                if (ptr)
-                {
-                    delete ptr;
-                    v.content = nullptr;
-                }
-            }
-            break;
-        }
-        case TYPE_INTERPOLATION_ARRAY:
-        {
-            InterpolationArray value;
-            InterpolationArray *ptr = static_cast<InterpolationArray*>(v.content);
-            m_origin->process(static_cast<CharacteristicType>(i), &value, &is_set);
-            if (is_set)
-            {
-                if (!ptr)
-                {
-                    InterpolationArray *newPtr = new InterpolationArray();
-                    v.content = newPtr;
-                    ptr = newPtr;
-                }
-                *ptr = value;
-            }
-            else
-            {
-                if (ptr)
-                {
-                    delete ptr;
-                    v.content = nullptr;
-                }
-            }
-            break;
-        }
-        case TYPE_BOOL:
+        if (!m_is_set[i])
         {
-            bool value;
-            bool *ptr = static_cast<bool*>(v.content);
-            m_origin->process(static_cast<CharacteristicType>(i), &value, &is_set);
-            if (is_set)
-            {
-                if (!ptr)
-                {
-                    bool *newPtr = new bool();
-                    v.content = newPtr;
-                    ptr = newPtr;
-                }
-                *ptr = value;
-            }
-            else
-            {
-                if (ptr)
-                {
-                    delete ptr;
-                    v.content = nullptr;
-                }
-            }
-            break;
+            *missing = static_cast<CharacteristicType>(i);
+            return false;
         }
-        }   // switch (type)
-    }   // foreach characteristic
-}   // updateSource
+    }
+    return true;
+}   // isComplete
 
 // ----------------------------------------------------------------------------
 /** Returns the stored value. */
 void CachedCharacteristic::process(CharacteristicType type, Value value,
                                    bool *is_set) const
 {
-    void *v = m_values[type].content;
-    if (v)
+    if (!m_is_set[type])
+        return;
+    switch (type)
     {
-        switch (getType(type))
-        {
-        case TYPE_FLOAT:
-            *value.f = *static_cast<float*>(v);
-            break;
-        case TYPE_FLOAT_VECTOR:
-            *value.fv = *static_cast<std::vector<float>*>(v);
-            break;
-        case TYPE_INTERPOLATION_ARRAY:
-            *value.ia = *static_cast<InterpolationArray*>(v);
-            break;
-        case TYPE_BOOL:
-            *value.b = *static_cast<bool*>(v);
-            break;
-        }
-        *is_set = true;
+    // Script-generated content generated by tools/create_kart_properties.py cvprocess
+    // Please don't change the following tag. It will be automatically detected
+    // by the script and replace the contained content.
+    // To update the code, use tools/update_characteristics.py
+    /* <characteristics-start cvprocess> */
+    case SUSPENSION_STIFFNESS:
+        *value.f = m_values.m_suspension_stiffness;
+        break;
+    case SUSPENSION_REST:
+        *value.f = m_values.m_suspension_rest;
+        break;
+    case SUSPENSION_TRAVEL:
+        *value.f = m_values.m_suspension_travel;
+        break;
+    case SUSPENSION_EXP_SPRING_RESPONSE:
+        *value.b = m_values.m_suspension_exp_spring_response;
+        break;
+    case SUSPENSION_MAX_FORCE:
+        *value.f = m_values.m_suspension_max_force;
+        break;
+    case STABILITY_ROLL_INFLUENCE:
+        *value.f = m_values.m_stability_roll_influence;
+        break;
+    case STABILITY_CHASSIS_LINEAR_DAMPING:
+        *value.f = m_values.m_stability_chassis_linear_damping;
+        break;
+    case STABILITY_CHASSIS_ANGULAR_DAMPING:
+        *value.f = m_values.m_stability_chassis_angular_damping;
+        break;
+    case STABILITY_DOWNWARD_IMPULSE_FACTOR:
+        *value.f = m_values.m_stability_downward_impulse_factor;
+        break;
+    case STABILITY_TRACK_CONNECTION_ACCEL:
+        *value.f = m_values.m_stability_track_connection_accel;
+        break;
+    case STABILITY_ANGULAR_FACTOR:
+        *value.fv = m_values.m_stability_angular_factor;
+        break;
+    case STABILITY_SMOOTH_FLYING_IMPULSE:
+        *value.f = m_values.m_stability_smooth_flying_impulse;
+        break;
+    case TURN_RADIUS:
+        *value.ia = m_values.m_turn_radius;
+        break;
+    case TURN_TIME_RESET_STEER:
+        *value.f = m_values.m_turn_time_reset_steer;
+        break;
+    case TURN_TIME_FULL_STEER:
+        *value.ia = m_values.m_turn_time_full_steer;
+        break;
+    case ENGINE_POWER:
+        *value.f = m_values.m_engine_power;
+        break;
+    case ENGINE_MAX_SPEED:
+        *value.f = m_values.m_engine_max_speed;
+        break;
+    case ENGINE_GENERIC_MAX_SPEED:
+        *value.f = m_values.m_engine_generic_max_speed;
+        break;
+    case ENGINE_BRAKE_FACTOR:
+        *value.f = m_values.m_engine_brake_factor;
+        break;
+    case ENGINE_BRAKE_TIME_INCREASE:
+        *value.f = m_values.m_engine_brake_time_increase;
+        break;
+    case ENGINE_MAX_SPEED_REVERSE_RATIO:
+        *value.f = m_values.m_engine_max_speed_reverse_ratio;
+        break;
+    case GEAR_SWITCH_RATIO:
+        *value.fv = m_values.m_gear_switch_ratio;
+        break;
+    case GEAR_POWER_INCREASE:
+        *value.fv = m_values.m_gear_power_increase;
+        break;
+    case MASS:
+        *value.f = m_values.m_mass;
+        break;
+    case WHEELS_DAMPING_RELAXATION:
+        *value.f = m_values.m_wheels_damping_relaxation;
+        break;
+    case WHEELS_DAMPING_COMPRESSION:
+        *value.f = m_values.m_wheels_damping_compression;
+        break;
+    case JUMP_ANIMATION_TIME:
+        *value.f = m_values.m_jump_animation_time;
+        break;
+    case LEAN_MAX:
+        *value.f = m_values.m_lean_max;
+        break;
+    case LEAN_SPEED:
+        *value.f = m_values.m_lean_speed;
+        break;
+    case ANVIL_DURATION:
+        *value.f = m_values.m_anvil_duration;
+        break;
+    case ANVIL_WEIGHT:
+        *value.f = m_values.m_anvil_weight;
+        break;
+    case ANVIL_SPEED_FACTOR:
+        *value.f = m_values.m_anvil_speed_factor;
+        break;
+    case PARACHUTE_FRICTION:
+        *value.f = m_values.m_parachute_friction;
+        break;
+    case PARACHUTE_DURATION:
+        *value.f = m_values.m_parachute_duration;
+        break;
+    case PARACHUTE_DURATION_OTHER:
+        *value.f = m_values.m_parachute_duration_other;
+        break;
+    case PARACHUTE_DURATION_RANK_MULT:
+        *value.f = m_values.m_parachute_duration_rank_mult;
+        break;
+    case PARACHUTE_DURATION_SPEED_MULT:
+        *value.f = m_values.m_parachute_duration_speed_mult;
+        break;
+    case PARACHUTE_LBOUND_FRACTION:
+        *value.f = m_values.m_parachute_lbound_fraction;
+        break;
+    case PARACHUTE_UBOUND_FRACTION:
+        *value.f = m_values.m_parachute_ubound_fraction;
+        break;
+    case PARACHUTE_MAX_SPEED:
+        *value.f = m_values.m_parachute_max_speed;
+        break;
+    case FRICTION_KART_FRICTION:
+        *value.f = m_values.m_friction_kart_friction;
+        break;
+    case BUBBLEGUM_DURATION:
+        *value.f = m_values.m_bubblegum_duration;
+        break;
+    case BUBBLEGUM_SPEED_FRACTION:
+        *value.f = m_values.m_bubblegum_speed_fraction;
+        break;
+    case BUBBLEGUM_TORQUE:
+        *value.f = m_values.m_bubblegum_torque;
+        break;
+    case BUBBLEGUM_FADE_IN_TIME:
+        *value.f = m_values.m_bubblegum_fade_in_time;
+        break;
+    case BUBBLEGUM_SHIELD_DURATION:
+        *value.f = m_values.m_bubblegum_shield_duration;
+        break;
+    case ZIPPER_DURATION:
+        *value.f = m_values.m_zipper_duration;
+        break;
+    case ZIPPER_FORCE:
+        *value.f = m_values.m_zipper_force;
+        break;
+    case ZIPPER_SPEED_GAIN:
+        *value.f = m_values.m_zipper_speed_gain;
+        break;
+    case ZIPPER_MAX_SPEED_INCREASE:
+        *value.f = m_values.m_zipper_max_speed_increase;
+        break;
+    case ZIPPER_FADE_OUT_TIME:
+        *value.f = m_values.m_zipper_fade_out_time;
+        break;
+    case SWATTER_DURATION:
+        *value.f = m_values.m_swatter_duration;
+        break;
+    case SWATTER_DISTANCE:
+        *value.f = m_values.m_swatter_distance;
+        break;
+    case SWATTER_SQUASH_DURATION:
+        *value.f = m_values.m_swatter_squash_duration;
+        break;
+    case SWATTER_SQUASH_SLOWDOWN:
+        *value.f = m_values.m_swatter_squash_slowdown;
+        break;
+    case PLUNGER_BAND_MAX_LENGTH:
+        *value.f = m_values.m_plunger_band_max_length;
+        break;
+    case PLUNGER_BAND_FORCE:
+        *value.f = m_values.m_plunger_band_force;
+        break;
+    case PLUNGER_BAND_DURATION:
+        *value.f = m_values.m_plunger_band_duration;
+        break;
+    case PLUNGER_BAND_SPEED_INCREASE:
+        *value.f = m_values.m_plunger_band_speed_increase;
+        break;
+    case PLUNGER_BAND_FADE_OUT_TIME:
+        *value.f = m_values.m_plunger_band_fade_out_time;
+        break;
+    case PLUNGER_IN_FACE_TIME:
+        *value.f = m_values.m_plunger_in_face_time;
+        break;
+    case STARTUP_TIME:
+        *value.fv = m_values.m_startup_time;
+        break;
+    case STARTUP_BOOST:
+        *value.fv = m_values.m_startup_boost;
+        break;
+    case RESCUE_DURATION:
+        *value.f = m_values.m_rescue_duration;
+        break;
+    case RESCUE_VERT_OFFSET:
+        *value.f = m_values.m_rescue_vert_offset;
+        break;
+    case RESCUE_HEIGHT:
+        *value.f = m_values.m_rescue_height;
+        break;
+    case EXPLOSION_DURATION:
+        *value.f = m_values.m_explosion_duration;
+        break;
+    case EXPLOSION_RADIUS:
+        *value.f = m_values.m_explosion_radius;
+        break;
+    case EXPLOSION_INVULNERABILITY_TIME:
+        *value.f = m_values.m_explosion_invulnerability_time;
+        break;
+    case NITRO_DURATION:
+        *value.f = m_values.m_nitro_duration;
+        break;
+    case NITRO_ENGINE_FORCE:
+        *value.f = m_values.m_nitro_engine_force;
+        break;
+    case NITRO_ENGINE_MULT:
+        *value.f = m_values.m_nitro_engine_mult;
+        break;
+    case NITRO_CONSUMPTION:
+        *value.f = m_values.m_nitro_consumption;
+        break;
+    case NITRO_SMALL_CONTAINER:
+        *value.f = m_values.m_nitro_small_container;
+        break;
+    case NITRO_BIG_CONTAINER:
+        *value.f = m_values.m_nitro_big_container;
+        break;
+    case NITRO_MAX_SPEED_INCREASE:
+        *value.f = m_values.m_nitro_max_speed_increase;
+        break;
+    case NITRO_FADE_OUT_TIME:
+        *value.f = m_values.m_nitro_fade_out_time;
+        break;
+    case NITRO_MAX:
+        *value.f = m_values.m_nitro_max;
+        break;
+    case SLIPSTREAM_DURATION_FACTOR:
+        *value.f = m_values.m_slipstream_duration_factor;
+        break;
+    case SLIPSTREAM_BASE_SPEED:
+        *value.f = m_values.m_slipstream_base_speed;
+        break;
+    case SLIPSTREAM_LENGTH:
+        *value.f = m_values.m_slipstream_length;
+        break;
+    case SLIPSTREAM_WIDTH:
+        *value.f = m_values.m_slipstream_width;
+        break;
+    case SLIPSTREAM_INNER_FACTOR:
+        *value.f = m_values.m_slipstream_inner_factor;
+        break;
+    case SLIPSTREAM_MIN_COLLECT_TIME:
+        *value.f = m_values.m_slipstream_min_collect_time;
+        break;
+    case SLIPSTREAM_MAX_COLLECT_TIME:
+        *value.f = m_values.m_slipstream_max_collect_time;
+        break;
+    case SLIPSTREAM_ADD_POWER:
+        *value.f = m_values.m_slipstream_add_power;
+        break;
+    case SLIPSTREAM_MIN_SPEED:
+        *value.f = m_values.m_slipstream_min_speed;
+        break;
+    case SLIPSTREAM_MAX_SPEED_INCREASE:
+        *value.f = m_values.m_slipstream_max_speed_increase;
+        break;
+    case SLIPSTREAM_FADE_OUT_TIME:
+        *value.f = m_values.m_slipstream_fade_out_time;
+        break;
+    case SKID_INCREASE:
+        *value.f = m_values.m_skid_increase;
+        break;
+    case SKID_DECREASE:
+        *value.f = m_values.m_skid_decrease;
+        break;
+    case SKID_MAX:
+        *value.f = m_values.m_skid_max;
+        break;
+    case SKID_TIME_TILL_MAX:
+        *value.f = m_values.m_skid_time_till_max;
+        break;
+    case SKID_VISUAL:
+        *value.f = m_values.m_skid_visual;
+        break;
+    case SKID_VISUAL_TIME:
+        *value.f = m_values.m_skid_visual_time;
+        break;
+    case SKID_REVERT_VISUAL_TIME:
+        *value.f = m_values.m_skid_revert_visual_time;
+        break;
+    case SKID_MIN_SPEED:
+        *value.f = m_values.m_skid_min_speed;
+        break;
+    case SKID_TIME_TILL_BONUS:
+        *value.fv = m_values.m_skid_time_till_bonus;
+        break;
+    case SKID_BONUS_SPEED:
+        *value.fv = m_values.m_skid_bonus_speed;
+        break;
+    case SKID_BONUS_TIME:
+        *value.fv = m_values.m_skid_bonus_time;
+        break;
+    case SKID_BONUS_FORCE:
+        *value.fv = m_values.m_skid_bonus_force;
+        break;
+    case SKID_PHYSICAL_JUMP_TIME:
+        *value.f = m_values.m_skid_physical_jump_time;
+        break;
+    case SKID_GRAPHICAL_JUMP_TIME:
+        *value.f = m_values.m_skid_graphical_jump_time;
+        break;
+    case SKID_POST_SKID_ROTATE_FACTOR:
+        *value.f = m_values.m_skid_post_skid_rotate_factor;
+        break;
+    case SKID_REDUCE_TURN_MIN:
+        *value.f = m_values.m_skid_reduce_turn_min;
+        break;
+    case SKID_REDUCE_TURN_MAX:
+        *value.f = m_values.m_skid_reduce_turn_max;
+        break;
+    case SKID_ENABLED:
+        *value.b = m_values.m_skid_enabled;
+        break;
+
+    /* <characteristics-end cvprocess> */
+    case CHARACTERISTIC_COUNT:
+        assert(false);
+        return;
     }
+    *is_set = true;
 }   // process
 
+// ============================================================================
+/** Checks that the resolved values match the combined characteristics, and
+ *  compares the time needed to read the characteristics used in each
+ *  physics step by the getters of a characteristic with reading the
+ *  resolved fields.
+ */
+void CachedCharacteristic::unitTesting()
+{
+    CombinedCharacteristic combined;
+    combined.addCharacteristic(kart_properties_manager->getBaseCharacteristic());
+    combined.addCharacteristic(kart_properties_manager
+        ->getKartTypeCharacteristic(kart_properties_manager
+        ->getDefaultKartType(), ""));
+    CachedCharacteristic cached(&combined);
+    CharacteristicType missing;
+    // The base characteristic sets all values
+    if (!cached.isComplete(&missing))
+    {
+        Log::fatal("CachedCharacteristic", "Can't get characteristic %s",
+            getName(missing).c_str());
+    }
+    const CharacteristicValues& values = cached.getValues();
+    assert(values.m_engine_max_speed == combined.getEngineMaxSpeed());
+    assert(values.m_skid_enabled == combined.getSkidEnabled());
+    assert(values.m_gear_switch_ratio == combined.getGearSwitchRatio());
+    assert(values.m_turn_radius.size() == combined.getTurnRadius().size());
+    assert(cached.getNitroMaxSpeedIncrease() ==
+           values.m_nitro_max_speed_increase);
+
+    const int iterations = 100000;
+    float sum_process = 0.0f;
+    auto process_start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        sum_process += cached.getEngineMaxSpeed() + cached.getEnginePower() +
+            cached.getSkidMax() + cached.getSkidReduceTurnMax() +
+            cached.getFrictionKartFriction() + cached.getMass() +
+            cached.getGearSwitchRatio()[0] +
+            cached.getTurnTimeFullSteer().get(0.5f);
+    }
+    auto process_end = std::chrono::steady_clock::now();
+
+    float sum_fields = 0.0f;
+    auto fields_start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        sum_fields += values.m_engine_max_speed + values.m_engine_power +
+            values.m_skid_max + values.m_skid_reduce_turn_max +
+            values.m_friction_kart_friction + values.m_mass +
+            values.m_gear_switch_ratio[0] +
+            values.m_turn_time_full_steer.get(0.5f);
+    }
+    auto fields_end = std::chrono::steady_clock::now();
+    assert(sum_process == sum_fields);
+
+    Log::info("CachedCharacteristic", "%d reads of 8 characteristics: "
+        "process %dus, fields %dus (checksum %f).", iterations,
+        (int)std::chrono::duration_cast<std::chrono::microseconds>
+        (process_end - process_start).count(),
+        (int)std::chrono::duration_cast<std::chrono::microseconds>
+        (fields_end - fields_start).count(), sum_fields);
+}   // unitTesting
@@ -20,23 +20,18 @@
 #define HEADER_CACHED_CHARACTERISTICS_HPP
 
 #include "karts/abstract_characteristic.hpp"
+#include "karts/characteristic_values.hpp"
 
 #include <assert.h>
 
 class CachedCharacteristic : public AbstractCharacteristic
 {
 private:
-    /** Used to store a value. */
-    struct SaveValue
-    {
-        void *content;
+    /** All values for a characteristic. */
+    CharacteristicValues m_values;
 
-        SaveValue() : content(nullptr) {}
-        SaveValue(void *content) : content(content) {}
-    };
-
-    /** All values for a characteristic. A nullptr means it is not set. */
-    std::vector<SaveValue> m_values;
+    /** If a characteristic is set, its value is invalid otherwise. */
+    bool m_is_set[CHARACTERISTIC_COUNT];
 
     /** The characteristics that hold the original values. */
     const AbstractCharacteristic *m_origin;
@@ -44,12 +39,17 @@ private:
 public:
     CachedCharacteristic(const AbstractCharacteristic *origin);
     CachedCharacteristic(const CachedCharacteristic &characteristics) = delete;
-    virtual ~CachedCharacteristic();
 
     /** Fetches all cached values from the original source. */
     void updateSource();
+    bool isComplete(CharacteristicType *missing) const;
     virtual void copyFrom(const AbstractCharacteristic *other) { assert(false); }
     virtual void process(CharacteristicType type, Value value, bool *is_set) const;
+    // ------------------------------------------------------------------------
+    /** Returns the resolved values, only valid if isComplete(). */
+    const CharacteristicValues& getValues() const { return m_values; }
+    // ------------------------------------------------------------------------
+    static void unitTesting();
 };
 
 #endif
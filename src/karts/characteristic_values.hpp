@@ -0,0 +1,195 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2026 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_CHARACTERISTIC_VALUES_HPP
+#define HEADER_CHARACTERISTIC_VALUES_HPP
+
+#include "utils/interpolation_array.hpp"
+
+#include <vector>
+
+/** The values of all characteristics of a kart, resolved once after
+ *  combining the base, difficulty, kart type, handicap and kart
+ *  characteristics. The fields are read directly by the getters of
+ *  KartProperties, so the physics doesn't need to evaluate the
+ *  characteristics every time a value is used.
+ *  The fields are generated by tools/create_kart_properties.py.
+ */
+struct CharacteristicValues
+{
+    // Script-generated content generated by tools/create_kart_properties.py cvdefs
+    // Please don't change the following tag. It will be automatically detected
+    // by the script and replace the contained content.
+    // To update the code, use tools/update_characteristics.py
+    /* <characteristics-start cvdefs> */
+
+    // Suspension
+    float m_suspension_stiffness;
+    float m_suspension_rest;
+    float m_suspension_travel;
+    bool m_suspension_exp_spring_response;
+    float m_suspension_max_force;
+
+    // Stability
+    float m_stability_roll_influence;
+    float m_stability_chassis_linear_damping;
+    float m_stability_chassis_angular_damping;
+    float m_stability_downward_impulse_factor;
+    float m_stability_track_connection_accel;
+    std::vector<float> m_stability_angular_factor;
+    float m_stability_smooth_flying_impulse;
+
+    // Turn
+    InterpolationArray m_turn_radius;
+    float m_turn_time_reset_steer;
+    InterpolationArray m_turn_time_full_steer;
+
+    // Engine
+    float m_engine_power;
+    float m_engine_max_speed;
+    float m_engine_generic_max_speed;
+    float m_engine_brake_factor;
+    float m_engine_brake_time_increase;
+    float m_engine_max_speed_reverse_ratio;
+
+    // Gear
+    std::vector<float> m_gear_switch_ratio;
+    std::vector<float> m_gear_power_increase;
+
+    // Mass
+    float m_mass;
+
+    // Wheels
+    float m_wheels_damping_relaxation;
+    float m_wheels_damping_compression;
+
+    // Jump
+    float m_jump_animation_time;
+
+    // Lean
+    float m_lean_max;
+    float m_lean_speed;
+
+    // Anvil
+    float m_anvil_duration;
+    float m_anvil_weight;
+    float m_anvil_speed_factor;
+
+    // Parachute
+    float m_parachute_friction;
+    float m_parachute_duration;
+    float m_parachute_duration_other;
+    float m_parachute_duration_rank_mult;
+    float m_parachute_duration_speed_mult;
+    float m_parachute_lbound_fraction;
+    float m_parachute_ubound_fraction;
+    float m_parachute_max_speed;
+
+    // Friction
+    float m_friction_kart_friction;
+
+    // Bubblegum
+    float m_bubblegum_duration;
+    float m_bubblegum_speed_fraction;
+    float m_bubblegum_torque;
+    float m_bubblegum_fade_in_time;
+    float m_bubblegum_shield_duration;
+
+    // Zipper
+    float m_zipper_duration;
+    float m_zipper_force;
+    float m_zipper_speed_gain;
+    float m_zipper_max_speed_increase;
+    float m_zipper_fade_out_time;
+
+    // Swatter
+    float m_swatter_duration;
+    float m_swatter_distance;
+    float m_swatter_squash_duration;
+    float m_swatter_squash_slowdown;
+
+    // Plunger
+    float m_plunger_band_max_length;
+    float m_plunger_band_force;
+    float m_plunger_band_duration;
+    float m_plunger_band_speed_increase;
+    float m_plunger_band_fade_out_time;
+    float m_plunger_in_face_time;
+
+    // Startup
+    std::vector<float> m_startup_time;
+    std::vector<float> m_startup_boost;
+
+    // Rescue
+    float m_rescue_duration;
+    float m_rescue_vert_offset;
+    float m_rescue_height;
+
+    // Explosion
+    float m_explosion_duration;
+    float m_explosion_radius;
+    float m_explosion_invulnerability_time;
+
+    // Nitro
+    float m_nitro_duration;
+    float m_nitro_engine_force;
+    float m_nitro_engine_mult;
+    float m_nitro_consumption;
+    float m_nitro_small_container;
+    float m_nitro_big_container;
+    float m_nitro_max_speed_increase;
+    float m_nitro_fade_out_time;
+    float m_nitro_max;
+
+    // Slipstream
+    float m_slipstream_duration_factor;
+    float m_slipstream_base_speed;
+    float m_slipstream_length;
+    float m_slipstream_width;
+    float m_slipstream_inner_factor;
+    float m_slipstream_min_collect_time;
+    float m_slipstream_max_collect_time;
+    float m_slipstream_add_power;
+    float m_slipstream_min_speed;
+    float m_slipstream_max_speed_increase;
+    float m_slipstream_fade_out_time;
+
+    // Skid
+    float m_skid_increase;
+    float m_skid_decrease;
+    float m_skid_max;
+    float m_skid_time_till_max;
+    float m_skid_visual;
+    float m_skid_visual_time;
+    float m_skid_revert_visual_time;
+    float m_skid_min_speed;
+    std::vector<float> m_skid_time_till_bonus;
+    std::vector<float> m_skid_bonus_speed;
+    std::vector<float> m_skid_bonus_time;
+    std::vector<float> m_skid_bonus_force;
+    float m_skid_physical_jump_time;
+    float m_skid_graphical_jump_time;
+    float m_skid_post_skid_rotate_factor;
+    float m_skid_reduce_turn_min;
+    float m_skid_reduce_turn_max;
+    bool m_skid_enabled;
+
+    /* <characteristics-end cvdefs> */
+};   // CharacteristicValues
+
+#endif
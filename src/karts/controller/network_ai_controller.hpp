@@ -42,6 +42,8 @@ public:
     virtual bool isLocalPlayerController() const OVERRIDE;
     // ------------------------------------------------------------------------
     static void setAIFrequency(int freq) { m_ai_frequency = freq; }
+    // ------------------------------------------------------------------------
+    static int getAIFrequency()                   { return m_ai_frequency; }
 };   // class NetworkAIController
 
 #endif // HEADER_PLAYER_CONTROLLER_HPP
@@ -73,6 +73,11 @@ public:
     // Not needed to create any physics for a ghost kart.
     virtual void  createPhysics() OVERRIDE {};
     // ------------------------------------------------------------------------
+    /** The transform of a ghost kart is only set in update(), so its ray
+     *  can not be known in advance. */
+    virtual void  prepareTerrainRay(std::vector<TerrainInfo*> *infos)
+                                                               OVERRIDE {};
+    // ------------------------------------------------------------------------
     const float   getSuspensionLength(int index, int wheel) const
                { return m_all_physic_info[index].m_suspension_length[wheel]; }
     // ------------------------------------------------------------------------
@@ -741,7 +741,8 @@ void Kart::createPhysics()
     trans.setIdentity();
     createBody(mass, trans, m_kart_chassis.get(),
                m_kart_properties->getRestitution(0.0f));
-    std::vector<float> ang_fact = m_kart_properties->getStabilityAngularFactor();
+    const std::vector<float>& ang_fact =
+        m_kart_properties->getStabilityAngularFactor();
     // The angular factor (with X and Z values <1) helps to keep the kart
     // upright, especially in case of a collision.
     m_body->setAngularFactor(Vec3(ang_fact[0], ang_fact[1], ang_fact[2]));
@@ -1206,7 +1207,8 @@ float Kart::getStartupBoostFromStartTicks(int ticks) const
     if (ticks_since_ready < 0)
         return 0.0f;
     float t = STKConfig::get()->ticks2Time(ticks_since_ready);
-    std::vector<float> startup_times = m_kart_properties->getStartupTime();
+    const std::vector<float>& startup_times =
+        m_kart_properties->getStartupTime();
     for (unsigned int i = 0; i < startup_times.size(); i++)
     {
         if (t <= startup_times[i])
@@ -1363,6 +1365,60 @@ void Kart::eliminate()
         m_node->setVisible(false);
 }   // eliminate
 
+// ----------------------------------------------------------------------------
+/** Returns the start of the raycast which detects the terrain under the
+ *  kart.
+ *  \param has_animation If the kart had an animation at the start of
+ *         update().
+ */
+Vec3 Kart::getTerrainRayOrigin(bool has_animation) const
+{
+    // After the physics step was done, the position of the wheels (as stored
+    // in wheelInfo) is actually outdated, since the chassis was moved
+    // according to the force acting from the wheels. So the center of the
+    // chassis is not at the center of the wheels anymore, it is somewhat
+    // moved forward (depending on speed and fps). In very extreme cases
+    // (see bug 2246) the center of the chassis can actually be ahead of the
+    // front wheels. So if we do a raycast to detect the terrain from the
+    // current chassis, that raycast might be ahead of the wheels - which
+    // results in incorrect rescues (the wheels are still on the ground,
+    // but the raycast happens ahead of the front wheels and are over
+    // a rescue texture).
+    // To avoid this problem, we do the raycast for terrain detection from
+    // the center of the 4 wheel positions (in world coordinates).
+    if (has_animation)
+    {
+        // Use kart transform directly as wheel info is not updated when
+        // there is an animation
+        return getXYZ() + getTrans().getBasis().getColumn(1) * 0.1f;
+    }
+
+    Vec3 from(0.0f, 0.0f, 0.0f);
+    for (unsigned int i = 0; i < 4; i++)
+        from += m_vehicle->getWheelInfo(i).m_raycastInfo.m_hardPointWS;
+
+    // Add a certain epsilon (0.3) to the height of the kart. This avoids
+    // problems of the ray being cast from under the track (which happened
+    // e.g. on tux tollway when jumping down from the ramp, when the chassis
+    // partly tunnels through the track). While tunneling should not be
+    // happening (since Z velocity is clamped), the epsilon is left in place
+    // just to be on the safe side (it will not hit the chassis itself).
+    return from/4 + (getTrans().getBasis() * Vec3(0.0f, 0.3f, 0.0f));
+}   // getTerrainRayOrigin
+
+// ----------------------------------------------------------------------------
+/** Prepares the raycast which detects the terrain in the next update(), so
+ *  that the rays of all karts can be cast against the track together. The
+ *  result is only used if the kart has not moved in the meantime.
+ *  \param infos The terrain info of this kart is added to it.
+ */
+void Kart::prepareTerrainRay(std::vector<TerrainInfo*> *infos)
+{
+    m_terrain_info->prepareRay(getTrans().getBasis(),
+                               getTerrainRayOrigin(m_kart_animation != NULL));
+    infos->push_back(m_terrain_info);
+}   // prepareTerrainRay
+
 //-----------------------------------------------------------------------------
 /** Updates the kart in each time step. It updates the physics setting,
  *  particle effects, camera position, etc.
@@ -1550,43 +1606,8 @@ void Kart::update(int ticks)
         m_body->getBroadphaseHandle()->m_collisionFilterGroup = 0;
     }
 
-    // After the physics step was done, the position of the wheels (as stored
-    // in wheelInfo) is actually outdated, since the chassis was moved
-    // according to the force acting from the wheels. So the center of the
-    // chassis is not at the center of the wheels anymore, it is somewhat
-    // moved forward (depending on speed and fps). In very extreme cases
-    // (see bug 2246) the center of the chassis can actually be ahead of the
-    // front wheels. So if we do a raycast to detect the terrain from the
-    // current chassis, that raycast might be ahead of the wheels - which
-    // results in incorrect rescues (the wheels are still on the ground,
-    // but the raycast happens ahead of the front wheels and are over
-    // a rescue texture).
-    // To avoid this problem, we do the raycast for terrain detection from
-    // the center of the 4 wheel positions (in world coordinates).
-
-    if (!has_animation_before)
-    {
-        Vec3 from(0.0f, 0.0f, 0.0f);
-        for (unsigned int i = 0; i < 4; i++)
-            from += m_vehicle->getWheelInfo(i).m_raycastInfo.m_hardPointWS;
-
-        // Add a certain epsilon (0.3) to the height of the kart. This avoids
-        // problems of the ray being cast from under the track (which happened
-        // e.g. on tux tollway when jumping down from the ramp, when the chassis
-        // partly tunnels through the track). While tunneling should not be
-        // happening (since Z velocity is clamped), the epsilon is left in place
-        // just to be on the safe side (it will not hit the chassis itself).
-        from = from/4 + (getTrans().getBasis() * Vec3(0.0f, 0.3f, 0.0f));
-
-        m_terrain_info->update(getTrans().getBasis(), from);
-    }
-    else
-    {
-        // Use kart transform directly as wheel info is not updated when
-        // there is an animation
-        m_terrain_info->update(getTrans().getBasis(),
-            getXYZ() + getTrans().getBasis().getColumn(1) * 0.1f);
-    }
+    m_terrain_info->update(getTrans().getBasis(),
+                           getTerrainRayOrigin(has_animation_before));
 
     if (m_body->getBroadphaseHandle())
         m_body->getBroadphaseHandle()->m_collisionFilterGroup = old_group;
@@ -281,6 +281,7 @@ protected:
     RaceManager::KartType m_type;
 
     void          updatePhysics(int ticks);
+    Vec3          getTerrainRayOrigin(bool has_animation) const;
     void          handleMaterialSFX();
     void          handleMaterialGFX(float dt);
     void          updateFlying();
@@ -531,6 +532,8 @@ public:
     // ----------------------------------------------------------------------------------------
     /** Returns the terrain info oject. */
     virtual const TerrainInfo *getTerrainInfo() const OVERRIDE { return m_terrain_info; }
+    // ----------------------------------------------------------------------------------------
+    virtual void prepareTerrainRay(std::vector<TerrainInfo*> *infos) OVERRIDE;
 
     // ========================================================================================
     // ----------------------------------------------------------------------------------------
@@ -39,6 +39,7 @@
 #include <stdio.h>
 #include <stdexcept>
 #include <iostream>
+#include <unordered_set>
 
 #ifndef SERVER_ONLY
 #include <ge_main.hpp>
@@ -89,6 +90,7 @@ void KartPropertiesManager::addKartSearchDir(const std::string &s)
 void KartPropertiesManager::unloadAllKarts()
 {
     m_karts_properties.clearAndDeleteAll();
+    m_kart_indices.clear();
     m_selected_karts.clear();
     m_kart_available.clear();
     m_groups_2_indices.clear();
@@ -108,6 +110,7 @@ void KartPropertiesManager::removeKart(const std::string &ident)
     m_karts_properties.remove(index);
     m_all_kart_dirs.erase(m_all_kart_dirs.begin()+index);
     m_kart_available.erase(m_kart_available.begin()+index);
+    updateKartIndices();
 
     // Remove the just removed kart from the 'group-name to kart property
     // index' mapping. If a group is now empty (i.e. the removed kart was
@@ -321,6 +324,9 @@ bool KartPropertiesManager::loadKart(const std::string &dir)
 
     m_karts_properties.push_back(kart_properties);
     m_kart_available.push_back(true);
+    // If two karts have the same identifier, the first one is used
+    m_kart_indices.emplace(kart_properties->getIdent(),
+        (int)m_karts_properties.size() - 1);
 
     std::vector<std::string> groups=kart_properties->getGroups();
 
@@ -399,11 +405,9 @@ const AbstractCharacteristic* KartPropertiesManager::getPlayerCharacteristic(con
  */
 const int KartPropertiesManager::getKartId(const std::string &ident) const
 {
-    for (unsigned int i=0; i<m_karts_properties.size(); i++)
-    {
-        if (m_karts_properties[i].getIdent() == ident)
-            return i;
-    }
+    auto it = m_kart_indices.find(ident);
+    if (it != m_kart_indices.end())
+        return it->second;
 
     std::ostringstream msg;
     msg << "KartPropertiesManager: Couldn't find kart: '" << ident << "'";
@@ -414,15 +418,23 @@ const int KartPropertiesManager::getKartId(const std::string &ident) const
 const KartProperties* KartPropertiesManager::getKart(
                                                 const std::string &ident) const
 {
-    for (const KartProperties* kp : m_karts_properties)
-    {
-        if (kp->getIdent() == ident)
-            return kp;
-    }
-
-    return NULL;
+    auto it = m_kart_indices.find(ident);
+    if (it == m_kart_indices.end())
+        return NULL;
+    return m_karts_properties.get(it->second);
 }   // getKart
 
+//-----------------------------------------------------------------------------
+/** Recreates the mapping of kart identifiers to indices, after the indices
+ *  of karts have changed.
+ */
+void KartPropertiesManager::updateKartIndices()
+{
+    m_kart_indices.clear();
+    for (unsigned int i = 0; i < m_karts_properties.size(); i++)
+        m_kart_indices.emplace(m_karts_properties[i].getIdent(), i);
+}   // updateKartIndices
+
 //-----------------------------------------------------------------------------
 const KartProperties* KartPropertiesManager::getKartById(int i) const
 {
@@ -453,13 +465,13 @@ std::vector<std::string> KartPropertiesManager::getAllAvailableKarts() const
  */
 void KartPropertiesManager::setUnavailableKarts(std::vector<std::string> karts)
 {
+    std::unordered_set<std::string> available(karts.begin(), karts.end());
     for (unsigned int i=0; i<m_karts_properties.size(); i++)
     {
         if (!m_kart_available[i]) continue;
 
-        if (std::find(karts.begin(), karts.end(),
-                      m_karts_properties[i].getIdent())
-            == karts.end())
+        if (available.find(m_karts_properties[i].getIdent()) ==
+            available.end())
         {
             m_kart_available[i] = false;
 
@@ -24,6 +24,7 @@
 #include <map>
 #include <memory>
 #include <set>
+#include <unordered_map>
 
 #include "config/favorite_status.hpp"
 #include "network/remote_kart_info.hpp"
@@ -85,6 +86,11 @@ protected:
     /** All available kart configurations */
     KartPropertiesVector m_karts_properties;
 
+    /** Index in m_karts_properties for each kart identifier. */
+    std::unordered_map<std::string, int> m_kart_indices;
+
+    void updateKartIndices();
+
 public:
                              KartPropertiesManager();
                             ~KartPropertiesManager();
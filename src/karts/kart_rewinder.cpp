@@ -32,6 +32,7 @@
 #include "karts/skidding.hpp"
 #include "modes/world.hpp"
 #include "network/compress_network_body.hpp"
+#include "network/network_config.hpp"
 #include "network/protocols/client_lobby.hpp"
 #include "network/rewind_manager.hpp"
 #include "network/network_string.hpp"
@@ -156,21 +157,14 @@ void KartRewinder::computeError()
 }   // computeError
 
 // ----------------------------------------------------------------------------
-/** Saves all state information for a kart in a memory buffer. The memory
- *  is allocated here and the address returned. It will then be managed
- *  by the RewindManager.
- *  \param[out] ru The unique identity of rewinder writing to.
- *  \return The address of the memory buffer with the state.
+/** Saves all state information for a kart at the end of the state buffer.
+ *  \param buffer The state buffer of the RewindManager.
+ *  \return False if the kart is eliminated and has no state.
  */
-BareNetworkString* KartRewinder::saveState(std::vector<std::string>* ru)
+bool KartRewinder::saveState(BareNetworkString* buffer)
 {
     if (m_eliminated)
-        return nullptr;
-
-    ru->push_back(getUniqueIdentity());
-    const int MEMSIZE = 17*sizeof(float) + 9+3;
-
-    BareNetworkString *buffer = new BareNetworkString(MEMSIZE);
+        return false;
 
     // 1) Steering and other player controls
     // -------------------------------------
@@ -263,18 +257,21 @@ BareNetworkString* KartRewinder::saveState(std::vector<std::string>* ru)
     // -----------
     m_skidding->saveState(buffer);
 
-    return buffer;
+    return true;
 }   // saveState
 
 // ----------------------------------------------------------------------------
 /** Actually rewind to the specified state. 
  *  \param buffer The buffer with the state info.
- *  \param count Number of bytes that must be used up in this function (not
- *         used).
+ *  \param count Number of bytes that must be used up in this function, 0
+ *         if the server skipped this kart in the state, then the local
+ *         state saved at the same time is kept.
  */
 void KartRewinder::restoreState(BareNetworkString *buffer, int count)
 {
     m_has_server_state = true;
+    if (count == 0)
+        return;
 
     // 1) Steering and other controls
     // ------------------------------
@@ -479,10 +476,32 @@ std::function<void()> KartRewinder::getLocalStateRestoreFunction()
     // Skidding local state
     float remaining_jump_time = m_skidding->m_remaining_jump_time;
 
+    // The server can skip karts far away from the local players in states,
+    // so the whole state of other karts is needed to rewind them
+    std::shared_ptr<BareNetworkString> full_state;
+    const std::set<std::string>& caps =
+        NetworkConfig::get()->getServerCapabilities();
+    if (!getController()->isLocalPlayerController() &&
+        caps.find("state_interest") != caps.end())
+    {
+        full_state = std::make_shared<BareNetworkString>();
+        if (!saveState(full_state.get()))
+            full_state = nullptr;
+    }
+
     return [brake_ticks, min_nitro_ticks,
         steer_val_l, steer_val_r, current_fraction,
-        max_speed_fraction, remaining_jump_time, this]()
+        max_speed_fraction, remaining_jump_time, full_state, this]()
     {
+        if (full_state)
+        {
+            // Only a state from the server counts for the kart being
+            // connected, see computeError
+            const bool has_server_state = m_has_server_state;
+            full_state->reset();
+            restoreState(full_state.get(), full_state->size());
+            m_has_server_state = has_server_state;
+        }
         m_brake_ticks = brake_ticks;
         m_min_nitro_ticks = min_nitro_ticks;
         PlayerController* pc = dynamic_cast<PlayerController*>(m_controller);
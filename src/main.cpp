@@ -235,6 +235,7 @@ extern "C" {
 #include "items/network_item_manager.hpp"
 #include "items/powerup_manager.hpp"
 #include "items/projectile_manager.hpp"
+#include "karts/cached_characteristic.hpp"
 #include "karts/combined_characteristic.hpp"
 #include "karts/controller/ai_base_controller.hpp"
 #include "karts/controller/network_ai_controller.hpp"
@@ -247,6 +248,9 @@ extern "C" {
 #include "network/protocols/connect_to_server.hpp"
 #include "network/protocols/client_lobby.hpp"
 #include "network/protocols/server_lobby.hpp"
+#include "network/load_generator.hpp"
+#include "network/packet_compressor.hpp"
+#include "network/lobby_pool.hpp"
 #include "network/network.hpp"
 #include "network/network_config.hpp"
 #include "network/network_string.hpp"
@@ -260,14 +264,17 @@ extern "C" {
 #include "network/server_config.hpp"
 #include "network/servers_manager.hpp"
 #include "network/socket_address.hpp"
+#include "network/state_history.hpp"
 #include "network/stk_host.hpp"
 #include "network/stk_peer.hpp"
 #include "online/profile_manager.hpp"
 #include "online/request_manager.hpp"
+#include "physics/triangle_mesh.hpp"
 #include "race/grand_prix_manager.hpp"
 #include "race/highscore_manager.hpp"
 #include "race/history.hpp"
 #include "race/race_manager.hpp"
+#include "replay/replay_format.hpp"
 #include "replay/replay_play.hpp"
 #include "replay/replay_recorder.hpp"
 #include "states_screens/main_menu_screen.hpp"
@@ -281,13 +288,17 @@ extern "C" {
 #include "tracks/arena_graph.hpp"
 #include "tracks/track.hpp"
 #include "tracks/track_manager.hpp"
+#include "utils/asset_bitset.hpp"
 #include "utils/command_line.hpp"
 #include "utils/constants.hpp"
 #include "utils/crash_reporting.hpp"
+#include "utils/interval_index.hpp"
 #include "utils/leak_check.hpp"
 #include "utils/log.hpp"
+#include "utils/loop_stats.hpp"
 #include "mini_glm.hpp"
 #include "utils/profiler.hpp"
+#include "utils/set_typo_fixer.hpp"
 #include "utils/stk_process.hpp"
 #include "utils/string_utils.hpp"
 #include "utils/translation.hpp"
@@ -649,6 +660,9 @@ void cmdLineHelp()
     "       --server-id=n      Server id in stk addons for --connect-now.\n"
     "       --network-ai=n     Numbers of AI for connecting to linear race server, used\n"
     "                          together with --connect-now.\n"
+    "       --load-test=n      Connect n simulated clients to a LAN server started by this\n"
+    "                          process, and log server step time, bandwidth, rewinds and\n"
+    "                          controller action latency (single lobby server only).\n"
     "       --login=s          Automatically log in (set the login).\n"
     "       --password=s       Automatically log in (set the password).\n"
     "       --init-user        Save the above login and password (if set) in config.\n"
@@ -680,7 +694,11 @@ void cmdLineHelp()
     "       --help-debug       Show help for debugging options.\n"
     "       --log=N            Set the verbosity to a value between\n"
     "                          0 (Debug) and 5 (Only Fatal messages)\n"
-    "       --logbuffer=N      Buffers up to N lines log lines before writing.\n"
+    "       --logbuffer=N      Buffers up to N lines log lines before writing\n"
+    "                          (only used with --log-sync).\n"
+    "       --log-sync         Write log lines from the logging thread instead\n"
+    "                          of a separate log writer thread.\n"
+    "       --log-json         Write log lines as JSON objects, one per line.\n"
     "       --root=DIR         Path to add to the list of STK root directories.\n"
     "                          You can specify more than one by separating them\n"
     "                          with colons (:).\n"
@@ -720,6 +738,8 @@ void cmdLineHelp()
     "       --disable-addon-karts Disable loading of addon karts.\n"
     "       --disable-addon-tracks Disable loading of addon tracks.\n"
     "       --dump-official-karts Dump official karts for current stk-assets.\n"
+    "       --convert-replay=file Convert a text replay to a binary one or\n"
+    "                           the other way round.\n"
     "       --apitrace          This will disable buffer storage and\n"
     "                           writing gpu query strings to opengl, which\n"
     "                           can be seen later in apitrace.\n"
@@ -829,6 +849,10 @@ int handleCmdLineOutputModifier()
     }
     if(CommandLine::has("--no-console-log"))
         Log::toggleConsoleLog(false);
+    if (CommandLine::has("--log-json"))
+        Log::setJsonLines(true);
+    if (!CommandLine::has("--log-sync"))
+        Log::startWriterThread();
 
     return 0;
 }
@@ -1041,6 +1065,19 @@ int handleCmdLinePreliminary()
     return 0;
 }   // handleCmdLinePreliminary
 
+// ============================================================================
+/** Starts the server lobby, or all lobbies of a multi-lobby dedicated server.
+ *  \param has_parent_process True if this server is started by a game client.
+ */
+static void startServerLobbies(bool has_parent_process)
+{
+    if (ServerConfig::m_server_lobbies > 1 && GUIEngine::isNoGraphics() &&
+        !has_parent_process)
+        LobbyPool::create(ServerConfig::m_server_lobbies);
+    else
+        ServerConfig::loadServerLobbyFromConfig();
+}   // startServerLobbies
+
 // ============================================================================
 /** Handles command line options.
  *  \param argc Number of command line options
@@ -1523,7 +1560,7 @@ int handleCmdLine(bool has_server_config, bool has_parent_process)
                 NetworkConfig::get()->getIPDetectionResult(4000);
                 NetworkConfig::get()->setIsWAN();
                 NetworkConfig::get()->setIsPublicServer();
-                ServerConfig::loadServerLobbyFromConfig();
+                startServerLobbies(has_parent_process);
                 Log::info("main", "Creating a WAN server '%s'.",
                     server_name.c_str());
             }
@@ -1531,12 +1568,23 @@ int handleCmdLine(bool has_server_config, bool has_parent_process)
         else
         {
             NetworkConfig::get()->setIsLAN();
-            ServerConfig::loadServerLobbyFromConfig();
+            startServerLobbies(has_parent_process);
             Log::info("main", "Creating a LAN server '%s'.",
                 server_name.c_str());
         }
     }
 
+    if (CommandLine::has("--load-test", &n) && n > 0)
+    {
+        if (NetworkConfig::get()->isServer() && STKHost::existHost())
+            LoadGenerator::create(n, STKHost::get()->getPrivatePort());
+        else
+        {
+            Log::warn("main", "--load-test needs a server with a single "
+                "lobby, ignored.");
+        }
+    }
+
     if (CommandLine::has("--auto-connect"))
     {
         NetworkConfig::get()->setAutoConnect(true);
@@ -1828,6 +1876,17 @@ int handleCmdLine(bool has_server_config, bool has_parent_process)
         return 0;
     }
 
+    if (CommandLine::has("--convert-replay", &s))
+    {
+        // Look in the replay directory if no path is given
+        if (!file_manager->fileExists(s))
+            s = file_manager->getReplayDir() + s;
+        std::string to = StringUtils::removeExtension(s) +
+            (ReplayFormat::isBinaryFile(s) ? "_text" : "_binary") + ".replay";
+        ReplayFormat::convert(s, to);
+        return 0;
+    }
+
     CommandLine::reportInvalidParameters();
 
     if (ProfileWorld::isProfileMode() || GUIEngine::isNoGraphics())
@@ -2658,8 +2717,10 @@ int main(int argc, char *argv[])
         input_manager = NULL;
     }
 
+    LoadGenerator::destroy();
     if (STKHost::existHost())
         STKHost::get()->shutdown();
+    LobbyPool::destroy();
     ClientLobby::destroyBackgroundDownload();
 
     cleanSuperTuxKart();
@@ -2671,6 +2732,7 @@ int main(int argc, char *argv[])
     MemoryLeaks::checkForLeaks();
 #endif
 
+    Log::stopWriterThread();
     Log::flushBuffers();
 
 #ifndef WIN32
@@ -2892,16 +2954,47 @@ void runUnitTests()
 
     Log::info("UnitTest", "Kart characteristics");
     CombinedCharacteristic::unitTesting();
+    CachedCharacteristic::unitTesting();
 
     Log::info("UnitTest", "Arena Graph");
     ArenaGraph::unitTesting();
 
+    Log::info("UnitTest", "Graph node grid");
+    Graph::unitTesting();
+
+    Log::info("UnitTest", "Replay format");
+    ReplayFormat::unitTesting();
+
     Log::info("UnitTest", "Fonts for translation");
     font_manager->unitTesting();
 
     Log::info("UnitTest", "RewindQueue");
     RewindQueue::unitTesting();
 
+    Log::info("UnitTest", "StateHistory");
+    StateHistory::unitTesting();
+
+    Log::info("UnitTest", "IntervalIndex");
+    IntervalIndexTesting::unitTesting();
+
+    Log::info("UnitTest", "LatencyHistogram");
+    LatencyHistogram::unitTesting();
+
+    Log::info("UnitTest", "AssetBitset");
+    AssetBitset::unitTesting();
+
+    Log::info("UnitTest", "SetTypoFixer");
+    SetTypoFixer::unitTesting();
+
+    Log::info("UnitTest", "Log");
+    Log::unitTesting();
+
+    Log::info("UnitTest", "PacketCompressor");
+    PacketCompressor::unitTesting();
+
+    Log::info("UnitTest", "TriangleMesh::castRays");
+    TriangleMesh::unitTesting();
+
     Log::info("UnitTest", "=====================");
     Log::info("UnitTest", "Testing successful   ");
     Log::info("UnitTest", "=====================");
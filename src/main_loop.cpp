@@ -37,6 +37,7 @@
 #include "input/input_manager.hpp"
 #include "modes/world.hpp"
 #include "modes/profile_world.hpp"
+#include "network/lobby_pool.hpp"
 #include "network/network_config.hpp"
 #include "network/network_timer_synchronizer.hpp"
 #include "network/protocols/client_lobby.hpp"
@@ -400,6 +401,7 @@ void MainLoop::updateRace(int ticks, bool fast_forward)
 void MainLoop::run()
 {
     m_curr_time = std::chrono::steady_clock::now();
+    m_server_idle.reset();
     // DT keeps track of the leftover time, since the race update
     // happens in fixed timesteps
     double left_over_time = 0;
@@ -558,7 +560,9 @@ void MainLoop::run()
             }
         }
 
-        if (was_server && !STKHost::existHost())
+        if (was_server && !STKHost::existHost() && !LobbyPool::get())
+            m_abort = true;
+        if (LobbyPool::get() && LobbyPool::get()->isFinished())
             m_abort = true;
 
         if (!m_abort)
@@ -641,8 +645,14 @@ void MainLoop::run()
             bool fast_forward = NetworkConfig::get()->isNetworking() &&
                 NetworkConfig::get()->isClient() &&
                 num_steps > stk_config->time2Ticks(1.0f);
+            const bool measure_steps = World::getWorld() &&
+                NetworkConfig::get()->isNetworking() &&
+                NetworkConfig::get()->isServer();
             for (int i = 0; i < num_steps; i++)
             {
+                TimePoint step_start;
+                if (measure_steps)
+                    step_start = std::chrono::steady_clock::now();
                 if (World::getWorld() && history->replayHistory())
                 {
                     history->updateReplay(
@@ -663,6 +673,8 @@ void MainLoop::run()
                     updateRace(1, fast_forward);
                 }
                 PROFILER_POP_CPU_MARKER();
+                if (measure_steps)
+                    m_server_step_time.addSince(step_start);
 
                 // We need to check again because update_race may have requested
                 // the main loop to abort; and it's not a good idea to continue
@@ -726,7 +738,26 @@ void MainLoop::run()
             }
         }
 
-        if (!UserConfigParams::m_benchmark)
+        if (!UserConfigParams::m_benchmark && GUIEngine::isNoGraphics() &&
+            NetworkConfig::get()->isNetworking() &&
+            NetworkConfig::get()->isServer() && m_throttle_fps)
+        {
+            // A dedicated server has nothing to do until the next physics
+            // step is due (network events are handled by other threads)
+            const double wait_time =
+                stk_config->ticks2Time(1) - left_over_time;
+            if (wait_time > 0.0)
+            {
+                PROFILER_PUSH_CPU_MARKER("Wait for next step", 0, 0, 0);
+                TimePoint wait_start = std::chrono::steady_clock::now();
+                std::this_thread::sleep_until(m_curr_time +
+                    std::chrono::duration_cast<TimePoint::duration>(
+                    std::chrono::duration<double>(wait_time)));
+                m_server_idle.addIdleSince(wait_start);
+                PROFILER_POP_CPU_MARKER();
+            }
+        }
+        else if (!UserConfigParams::m_benchmark)
         {
             TimePoint frame_end = std::chrono::steady_clock::now();
             double frame_time = convertToTime(frame_end, frame_start) * 0.001;
@@ -757,6 +788,17 @@ void MainLoop::run()
         PROFILER_SYNC_FRAME();
     }  // while !m_abort
 
+    if (m_server_idle.hasWaited())
+    {
+        Log::info("MainLoop", "Server was idle %.1f%% of the time.",
+            m_server_idle.getIdlePercentage());
+    }
+    if (m_server_step_time.getCount() > 0)
+    {
+        Log::info("MainLoop", "Server physics steps took: %s.",
+            m_server_step_time.toString().c_str());
+    }
+
 #ifdef WIN32
     if (parent != 0 && parent != INVALID_HANDLE_VALUE)
         CloseHandle(parent);
@@ -20,6 +20,7 @@
 #ifndef HEADER_MAIN_LOOP_HPP
 #define HEADER_MAIN_LOOP_HPP
 
+#include "utils/loop_stats.hpp"
 #include "utils/synchronised.hpp"
 #include "utils/types.hpp"
 #include <atomic>
@@ -52,6 +53,14 @@ private:
 
     TimePoint m_curr_time;
     TimePoint m_prev_time;
+
+    /** How long a dedicated server waited for the next physics step. */
+    IdleMeter m_server_idle;
+
+    /** How long a server needed for each physics step while a world
+     *  exists. */
+    LatencyHistogram m_server_step_time;
+
     unsigned m_parent_pid;
     double   getLimitedDt();
     void     updateRace(int ticks, bool fast_forward);
@@ -88,6 +97,9 @@ public:
     void setPaused(bool val)                           { m_paused.store(val); }
     // ------------------------------------------------------------------------
     bool isPaused() const                           { return m_paused.load(); }
+    // ------------------------------------------------------------------------
+    const LatencyHistogram& getServerStepTime() const
+                                                { return m_server_step_time; }
 };   // MainLoop
 
 extern MainLoop* main_loop;
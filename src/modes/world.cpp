@@ -75,6 +75,7 @@
 #include "states_screens/race_result_gui.hpp"
 #include "states_screens/state_manager.hpp"
 #include "tracks/check_manager.hpp"
+#include "tracks/terrain_info.hpp"
 #include "tracks/track.hpp"
 #include "tracks/track_manager.hpp"
 #include "tracks/track_object.hpp"
@@ -146,6 +147,22 @@ World::World() : WorldStatus()
 
 }   // World
 
+// ----------------------------------------------------------------------------
+/** Returns a lock which serializes loading and deleting worlds between the
+ *  lobbies of a multi-lobby server, because they share the mesh cache, the
+ *  materials and the file search paths. The lock is not taken for other
+ *  types, the child process waits in init() for the main process to load
+ *  the track.
+ */
+std::unique_lock<std::mutex> World::lockLobbyLoading()
+{
+    static std::mutex loading_mutex;
+    std::unique_lock<std::mutex> ul(loading_mutex, std::defer_lock);
+    if (STKProcess::isLobby(STKProcess::getType()))
+        ul.lock();
+    return ul;
+}   // lockLobbyLoading
+
 // ----------------------------------------------------------------------------
 /** This function is called after instanciating. The code here can't be moved
  *  to the contructor as child classes must be instanciated, otherwise
@@ -177,9 +194,10 @@ void World::init()
     main_loop->renderGUI(1100);
     // Grab the track file
     Track *track = TrackManager::get()->getTrack(RaceManager::get()->getTrackName());
-    if (m_process_type == PT_MAIN)
+    if (m_process_type != PT_CHILD)
     {
-        Scripting::ScriptEngine::getInstance<Scripting::ScriptEngine>();
+        if (m_process_type == PT_MAIN)
+            Scripting::ScriptEngine::getInstance<Scripting::ScriptEngine>();
         if(!track)
         {
             std::ostringstream msg;
@@ -188,8 +206,12 @@ void World::init()
             throw std::runtime_error(msg.str());
         }
 
-        std::string script_path = track->getTrackFile("scripting.as");
-        Scripting::ScriptEngine::getInstance()->loadScript(script_path, true);
+        if (m_process_type == PT_MAIN)
+        {
+            std::string script_path = track->getTrackFile("scripting.as");
+            Scripting::ScriptEngine::getInstance()
+                ->loadScript(script_path, true);
+        }
     }
     main_loop->renderGUI(1200);
     // Create the physics
@@ -203,6 +225,12 @@ void World::init()
     // This also defines the static Track::getCurrentTrack function.
     if (m_process_type == PT_MAIN)
         track->loadTrackModel(RaceManager::get()->getReverseTrack());
+    else if (STKProcess::isLobby(m_process_type))
+    {
+        // Each lobby races on its own copy, deleted in the destructor
+        track = track->cloneForLobby();
+        track->loadTrackModel(RaceManager::get()->getReverseTrack());
+    }
     else
     {
         Track* child_track = Track::getCurrentTrack();
@@ -271,7 +299,8 @@ void World::init()
     if (m_race_gui)
         m_race_gui->init();
 
-    if (m_process_type == PT_MAIN)
+    // The child process uses the weights computed by the main process
+    if (m_process_type != PT_CHILD)
         powerup_manager->computeWeightsForRace(RaceManager::get()->getNumberOfKarts());
     main_loop->renderGUI(7200);
     if (m_process_type == PT_MAIN && UserConfigParams::m_particles_effects > 1)
@@ -631,6 +660,15 @@ World::~World()
         if(Track::getCurrentTrack())
             Track::getCurrentTrack()->cleanup();
     }
+    else if (STKProcess::isLobby(m_process_type))
+    {
+        Track* lobby_track = Track::getCurrentTrack();
+        if (lobby_track)
+        {
+            lobby_track->cleanup();
+            delete lobby_track;
+        }
+    }
     else
         Track::cleanChildTrack();
 
@@ -1188,16 +1226,29 @@ void World::update(int ticks)
 
     PROFILER_PUSH_CPU_MARKER("World::update (Kart::upate)", 0x40, 0x7F, 0x00);
 
-    // Update all the karts. This in turn will also update the controller,
-    // which causes all AI steering commands set. So in the following
-    // physics update the new steering is taken into account.
+    // Update all karts that are not eliminated. This in turn will also
+    // update the controller, which causes all AI steering commands set. So
+    // in the following physics update the new steering is taken into account.
+    auto needs_update = [](AbstractKart* kart)
+    {
+        SpareTireAI* sta = dynamic_cast<SpareTireAI*>(kart->getController());
+        return !kart->isEliminated() || (sta && sta->isMoving());
+    };
+
+    // Cast the terrain rays of all karts against the track together, each
+    // kart uses the result in update() if its ray did not change.
     const int kart_amount = (int)m_karts.size();
+    std::vector<TerrainInfo*> terrain_infos;
+    for (int i = 0 ; i < kart_amount; ++i)
+    {
+        if (needs_update(m_karts[i].get()))
+            m_karts[i]->prepareTerrainRay(&terrain_infos);
+    }
+    TerrainInfo::castPreparedRays(terrain_infos);
+
     for (int i = 0 ; i < kart_amount; ++i)
     {
-        SpareTireAI* sta =
-            dynamic_cast<SpareTireAI*>(m_karts[i]->getController());
-        // Update all karts that are not eliminated
-        if(!m_karts[i]->isEliminated() || (sta && sta->isMoving()))
+        if (needs_update(m_karts[i].get()))
             m_karts[i]->update(ticks);
         if (isStartPhase())
             m_karts[i]->makeKartRest();
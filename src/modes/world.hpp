@@ -29,6 +29,7 @@
 #include <limits>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <vector>
 #include <stdexcept>
 
@@ -232,6 +233,7 @@ public:
     static void     deleteWorld()
     {
         ProcessType type = STKProcess::getType();
+        std::unique_lock<std::mutex> ul = lockLobbyLoading();
         delete m_world[type];
         m_world[type] = NULL;
     }
@@ -246,6 +248,8 @@ public:
     // ------------------------------------------------------------------------
     static void     clear() { memset(m_world, 0, sizeof(m_world)); }
     // ------------------------------------------------------------------------
+    static std::unique_lock<std::mutex> lockLobbyLoading();
+    // ------------------------------------------------------------------------
 
     // Pure virtual functions
     // ======================
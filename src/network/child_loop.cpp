@@ -16,9 +16,11 @@
 //  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "network/child_loop.hpp"
+#include "config/stk_config.hpp"
 #include "config/user_config.hpp"
 #include "guiengine/engine.hpp"
 #include "items/projectile_manager.hpp"
+#include "modes/linear_world.hpp"
 #include "modes/world.hpp"
 #include "network/network_config.hpp"
 #include "network/protocol_manager.hpp"
@@ -27,77 +29,81 @@
 #include "network/server_config.hpp"
 #include "network/stk_host.hpp"
 #include "race/race_manager.hpp"
+#include "replay/replay_recorder.hpp"
 #include "states_screens/state_manager.hpp"
 #include "utils/log.hpp"
 #include "utils/stk_process.hpp"
+#include "utils/string_utils.hpp"
 #include "utils/time.hpp"
 #include "utils/vs.hpp"
 
+#include <thread>
+
 // ----------------------------------------------------------------------------
+/** Returns the time since the last frame in seconds. */
 float ChildLoop::getLimitedDt()
 {
     m_prev_time = m_curr_time;
-
-    float dt = 0;
-    while (1)
-    {
-        m_curr_time = StkTime::getMonoTimeMs();
-        if (m_prev_time > m_curr_time)
-        {
-            m_prev_time = m_curr_time;
-        }
-        dt = (float)(m_curr_time - m_prev_time);
-        while (dt == 0)
-        {
-            StkTime::sleep(1);
-            m_curr_time = StkTime::getMonoTimeMs();
-            if (m_prev_time > m_curr_time)
-            {
-                Log::error("MainLopp", "System clock keeps backwards!");
-                m_prev_time = m_curr_time;
-            }
-            dt = (float)(m_curr_time - m_prev_time);
-        }
-        if (UserConfigParams::m_benchmark)
-            break;
-
-        const int current_fps = (int)(1000.0f / dt);
-        const int max_fps = UserConfigParams::m_max_fps;
-        if (current_fps <= max_fps)
-            break;
-
-        int wait_time = 1000 / max_fps - 1000 / current_fps;
-        if (wait_time < 1) wait_time = 1;
-
-        StkTime::sleep(wait_time);
-    }   // while(1)
-    dt *= 0.001f;
-    return dt;
+    m_curr_time = std::chrono::steady_clock::now();
+    return std::chrono::duration<float>(m_curr_time - m_prev_time).count();
 }   // getLimitedDt
 
+// ----------------------------------------------------------------------------
+/** Sleeps until the next physics step is due, the server has nothing to do
+ *  before (network events are handled by other threads).
+ *  \param left_over_time Time since the last physics step in seconds.
+ */
+void ChildLoop::waitForNextStep(float left_over_time)
+{
+    if (UserConfigParams::m_benchmark)
+        return;
+    const float wait_time = STKConfig::get()->ticks2Time(1) - left_over_time;
+    if (wait_time <= 0.0f)
+        return;
+    auto start = std::chrono::steady_clock::now();
+    std::this_thread::sleep_until(m_curr_time +
+        std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<float>(wait_time)));
+    m_idle.addIdleSince(start);
+}   // waitForNextStep
+
 // ----------------------------------------------------------------------------
 void ChildLoop::run()
 {
-    VS::setThreadName("ChildLoop");
-    STKProcess::init(PT_CHILD);
+    const ProcessType pt = m_cl_config->m_process_type;
+    std::string thread_name = pt == PT_CHILD ? "ChildLoop" :
+        "Lobby" + StringUtils::toString(pt - PT_LOBBY + 1);
+    VS::setThreadName(thread_name.c_str());
+    STKProcess::init(pt);
 
     GUIEngine::disableGraphics();
     RaceManager::create();
     ProjectileManager::create();
+    if (pt != PT_CHILD)
+        ReplayRecorder::create();
     NetworkConfig::get()->setIsServer(true);
     if (m_cl_config->m_lan_server)
         NetworkConfig::get()->setIsLAN();
     else
     {
-        if (UserConfigParams::m_default_ip_type == NetworkConfig::IP_NONE)
+        if (pt != PT_CHILD)
+        {
+            // The main process of a multi-lobby server detected it already
+            NetworkConfig::get()->setIPType(
+                NetworkConfig::getByType(PT_MAIN)->getIPType());
+        }
+        else
         {
-            NetworkConfig::get()->setIPType(NetworkConfig::IP_V4);
-            NetworkConfig::get()->queueIPDetection();
+            if (UserConfigParams::m_default_ip_type == NetworkConfig::IP_NONE)
+            {
+                NetworkConfig::get()->setIPType(NetworkConfig::IP_V4);
+                NetworkConfig::get()->queueIPDetection();
+            }
+            // Longer timeout for server creation
+            NetworkConfig::get()->getIPDetectionResult(4000);
+            NetworkConfig::getByType(PT_MAIN)->setIPType(
+                NetworkConfig::get()->getIPType());
         }
-        // Longer timeout for server creation
-        NetworkConfig::get()->getIPDetectionResult(4000);
-        NetworkConfig::getByType(PT_MAIN)->setIPType(
-            NetworkConfig::get()->getIPType());
         NetworkConfig::get()->setIsWAN();
         NetworkConfig::get()->setIsPublicServer();
     }
@@ -111,7 +117,8 @@ void ChildLoop::run()
     ServerConfig::loadServerLobbyFromConfig();
     StateManager::get()->enterMenuState();
 
-    m_curr_time = StkTime::getMonoTimeMs();
+    m_curr_time = std::chrono::steady_clock::now();
+    m_idle.reset();
     float left_over_time = 0;
 
     auto& stk_config = STKConfig::get();
@@ -163,13 +170,28 @@ void ChildLoop::run()
             if (m_abort)
                 break;
         }
+
+        // Lobbies of a multi-lobby server do what the main loop does for a
+        // dedicated server
+        LinearWorld* lin_world = dynamic_cast<LinearWorld*>(World::getWorld());
+        if (pt != PT_CHILD && lin_world && lin_world->getTicksSinceStart() > 0)
+        {
+            const float frame_duration = num_steps * dt;
+            for (unsigned int i = 0; i < lin_world->getNumKarts(); i++)
+                lin_world->serverCheckForWrongDirection(i, frame_duration);
+        }
+        waitForNextStep(left_over_time);
     }
+    Log::info("ChildLoop", "Idle %.1f%% of the time.",
+        m_idle.getIdlePercentage());
 
     if (STKHost::existHost())
         STKHost::get()->shutdown();
     if (World::getWorld())
         RaceManager::get()->exitRace();
 
+    if (pt != PT_CHILD)
+        ReplayRecorder::destroy();
     RaceManager::destroy();
     ProjectileManager::destroy();
     NetworkConfig::destroy();
@@ -18,8 +18,11 @@
 #ifndef HEADER_SERVER_LOOP_HPP
 #define HEADER_SERVER_LOOP_HPP
 
+#include "utils/loop_stats.hpp"
+#include "utils/stk_process.hpp"
 #include "utils/types.hpp"
 #include <atomic>
+#include <chrono>
 #include <string>
 
 struct ChildLoopConfig
@@ -28,6 +31,9 @@ struct ChildLoopConfig
     uint32_t m_login_id;
     std::string m_token;
     unsigned m_server_ai;
+    /** PT_CHILD for the server of a game client, or the type of a lobby
+     *  of a multi-lobby server. */
+    ProcessType m_process_type;
 };
 
 class ChildLoop
@@ -41,15 +47,19 @@ private:
 
     std::atomic<uint32_t> m_server_online_id;
 
-    uint64_t m_curr_time;
-    uint64_t m_prev_time;
+    std::chrono::steady_clock::time_point m_curr_time;
+    std::chrono::steady_clock::time_point m_prev_time;
+
+    /** How long the loop waited for the next physics step. */
+    IdleMeter m_idle;
+
     float getLimitedDt();
+    void waitForNextStep(float left_over_time);
 public:
     ChildLoop(const ChildLoopConfig& clc)
         : m_cl_config(new ChildLoopConfig(clc))
     {
         m_abort = false;
-        m_prev_time = m_curr_time = 0;
         m_port = 0;
         m_server_online_id = 0;
     }
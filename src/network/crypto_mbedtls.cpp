@@ -168,10 +168,16 @@ ENetPacket* Crypto::encryptSend(BareNetworkString& ns, PacketReliabilityMode rel
 }   // encryptSend
 
 // ----------------------------------------------------------------------------
-NetworkString* Crypto::decryptRecieve(ENetPacket* p)
+/** Decrypts a received packet into the given string, whose allocated memory
+ *  is reused. Throws if the packet can't be decrypted.
+ */
+void Crypto::decryptRecieve(ENetPacket* p, NetworkString* ns)
 {
+    if (p->dataLength < 8)
+        throw std::runtime_error("Packet too short.");
     int clen = (int)(p->dataLength - 8);
-    auto ns = std::unique_ptr<NetworkString>(new NetworkString(p->data, clen));
+    ns->m_buffer.resize(clen);
+    ns->m_current_offset = 1;
 
     std::array<uint8_t, 12> iv = {};
     if (NetworkConfig::get()->isClient())
@@ -186,10 +192,6 @@ NetworkString* Crypto::decryptRecieve(ENetPacket* p)
     {
         throw std::runtime_error("Failed authentication.");
     }
-
-    NetworkString* result = ns.get();
-    ns.release();
-    return result;
 }   // decryptRecieve
 
 #endif
@@ -243,10 +243,16 @@ ENetPacket* Crypto::encryptSend(BareNetworkString& ns, PacketReliabilityMode rel
 }   // encryptSend
 
 // ----------------------------------------------------------------------------
-NetworkString* Crypto::decryptRecieve(ENetPacket* p)
+/** Decrypts a received packet into the given string, whose allocated memory
+ *  is reused. Throws if the packet can't be decrypted.
+ */
+void Crypto::decryptRecieve(ENetPacket* p, NetworkString* ns)
 {
+    if (p->dataLength < 8)
+        throw std::runtime_error("Packet too short.");
     int clen = (int)(p->dataLength - 8);
-    auto ns = std::unique_ptr<NetworkString>(new NetworkString(p->data, clen));
+    ns->m_buffer.resize(clen);
+    ns->m_current_offset = 1;
 
     std::array<uint8_t, 12> iv = {};
     if (NetworkConfig::get()->isClient())
@@ -274,9 +280,7 @@ NetworkString* Crypto::decryptRecieve(ENetPacket* p)
     if (EVP_DecryptFinal_ex(m_decrypt, unused_16_blocks.data(), &dlen) > 0)
     {
         assert(dlen == 0);
-        NetworkString* result = ns.get();
-        ns.release();
-        return result;
+        return;
     }
     throw std::runtime_error("Failed to finalize decryption.");
 }   // decryptRecieve
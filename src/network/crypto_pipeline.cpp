@@ -0,0 +1,258 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2026 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "network/crypto_pipeline.hpp"
+
+#include "network/crypto.hpp"
+#include "network/event.hpp"
+#include "network/network.hpp"
+#include "network/network_string.hpp"
+#include "network/socket_address.hpp"
+#include "network/stk_peer.hpp"
+#include "utils/log.hpp"
+#include "utils/time.hpp"
+#include "utils/vs.hpp"
+
+#include <string>
+
+// ----------------------------------------------------------------------------
+/** Starts the worker threads.
+ *  \param host The host whose packets are handled.
+ *  \param threads Number of worker threads.
+ */
+CryptoPipeline::CryptoPipeline(STKHost* host, unsigned threads)
+              : m_host(host)
+{
+    m_packets_encrypted.store(0);
+    m_packets_decrypted.store(0);
+    m_batches.store(0);
+    const ProcessType pt = STKProcess::getType();
+    for (unsigned i = 0; i < threads; i++)
+    {
+        m_workers.emplace_back(new Worker());
+        Worker* worker = m_workers.back().get();
+        worker->m_thread = std::thread(&CryptoPipeline::mainLoop, this,
+            worker, pt);
+    }
+}   // CryptoPipeline
+
+// ----------------------------------------------------------------------------
+CryptoPipeline::~CryptoPipeline()
+{
+    stop();
+}   // ~CryptoPipeline
+
+// ----------------------------------------------------------------------------
+/** Finishes all queued jobs and stops the worker threads, later jobs are
+ *  done in the calling thread.
+ */
+void CryptoPipeline::stop()
+{
+    for (auto& worker : m_workers)
+    {
+        std::lock_guard<std::mutex> lock(worker->m_mutex);
+        worker->m_exit = true;
+        worker->m_cv.notify_one();
+    }
+    bool joined = false;
+    for (auto& worker : m_workers)
+    {
+        if (worker->m_thread.joinable())
+        {
+            worker->m_thread.join();
+            joined = true;
+        }
+    }
+    if (joined)
+    {
+        Log::info("CryptoPipeline", "%lu packets encrypted and %lu packets "
+            "decrypted in %lu batches.",
+            (unsigned long)m_packets_encrypted.load(),
+            (unsigned long)m_packets_decrypted.load(),
+            (unsigned long)m_batches.load());
+    }
+}   // stop
+
+// ----------------------------------------------------------------------------
+/** Thread function of a worker, handles all queued jobs together and hands
+ *  the resulting ENet commands to the network thread at once.
+ */
+void CryptoPipeline::mainLoop(Worker* worker, ProcessType pt)
+{
+    std::string thread_name = "CryptoPipeline" +
+        STKProcess::getThreadSuffix(pt);
+    VS::setThreadName(thread_name.c_str());
+    STKProcess::init(pt);
+
+    std::vector<Job> jobs;
+    std::vector<STKHost::ENetCommand> commands;
+    while (true)
+    {
+        std::unique_lock<std::mutex> lock(worker->m_mutex);
+        worker->m_cv.wait(lock, [worker]()
+            {
+                return worker->m_exit || !worker->m_jobs.empty();
+            });
+        if (worker->m_jobs.empty())
+            break;
+        std::swap(jobs, worker->m_jobs);
+        lock.unlock();
+
+        for (Job& job : jobs)
+            process(job, &commands);
+        jobs.clear();
+        if (!commands.empty())
+            m_host->addEnetCommands(&commands);
+        m_batches.fetch_add(1, std::memory_order_relaxed);
+    }
+}   // mainLoop
+
+// ----------------------------------------------------------------------------
+/** Queues a job to the worker of its peer, or does it now if the pipeline
+ *  has been stopped. */
+void CryptoPipeline::addJob(Job&& job)
+{
+    if (!m_workers.empty())
+    {
+        Worker* worker =
+            m_workers[job.m_peer->getHostId() % m_workers.size()].get();
+        std::lock_guard<std::mutex> lock(worker->m_mutex);
+        if (!worker->m_exit)
+        {
+            worker->m_jobs.push_back(std::move(job));
+            worker->m_cv.notify_one();
+            return;
+        }
+    }
+    std::vector<STKHost::ENetCommand> commands;
+    process(job, &commands);
+    if (!commands.empty())
+        m_host->addEnetCommands(&commands);
+}   // addJob
+
+// ----------------------------------------------------------------------------
+/** Does a job.
+ *  \param commands The ENet commands created are added to it.
+ */
+void CryptoPipeline::process(Job& job, std::vector<STKHost::ENetCommand>*
+                             commands)
+{
+    STKPeer* peer = job.m_peer.get();
+    switch (job.m_type)
+    {
+    case JT_SEND:
+    {
+        ENetPacket* packet =
+            peer->getCrypto()->encryptSend(*job.m_data, job.m_reliable);
+        if (!packet)
+            break;
+        m_packets_encrypted.fetch_add(1, std::memory_order_relaxed);
+        if (Network::m_connection_debug)
+        {
+            Log::verbose("STKPeer", "sending packet of size %d to %s at %lf",
+                packet->dataLength, peer->getAddress().toString().c_str(),
+                StkTime::getRealTime());
+        }
+        commands->emplace_back(peer->getENetPeer(), packet,
+            EVENT_CHANNEL_NORMAL, ECT_SEND_PACKET, peer->getENetAddress());
+        break;
+    }
+    case JT_COMMAND:
+        commands->emplace_back(peer->getENetPeer(), job.m_packet,
+            job.m_value, job.m_command, peer->getENetAddress());
+        break;
+    case JT_RECEIVE:
+    {
+        Event* event = NULL;
+        try
+        {
+            event = new Event(&job.m_event, job.m_peer);
+        }
+        catch (std::exception& e)
+        {
+            Log::warn("STKHost", "%s", e.what());
+            enet_packet_destroy(job.m_event.packet);
+            break;
+        }
+        m_packets_decrypted.fetch_add(1, std::memory_order_relaxed);
+        m_host->propagateEvent(event);
+        break;
+    }
+    case JT_EVENT:
+        m_host->propagateEvent(job.m_stk_event);
+        break;
+    }
+}   // process
+
+// ----------------------------------------------------------------------------
+/** Encrypts a copy of a packet and sends it to a peer.
+ */
+void CryptoPipeline::sendPacket(std::shared_ptr<STKPeer> peer,
+                                NetworkString* data,
+                                PacketReliabilityMode reliable)
+{
+    Job job;
+    job.m_type = JT_SEND;
+    job.m_peer = peer;
+    job.m_data.reset(new BareNetworkString(data->getData(),
+        data->getTotalSize()));
+    job.m_reliable = reliable;
+    addJob(std::move(job));
+}   // sendPacket
+
+// ----------------------------------------------------------------------------
+/** Adds an ENet command for a peer after its previously queued packets.
+ *  \param value The channel to send a packet or the disconnect reason.
+ */
+void CryptoPipeline::addCommand(std::shared_ptr<STKPeer> peer,
+                                ENetPacket* packet, uint32_t value,
+                                ENetCommandType ect)
+{
+    Job job;
+    job.m_type = JT_COMMAND;
+    job.m_peer = peer;
+    job.m_packet = packet;
+    job.m_value = value;
+    job.m_command = ect;
+    addJob(std::move(job));
+}   // addCommand
+
+// ----------------------------------------------------------------------------
+/** Creates the event (which decrypts the packet) of a received packet and
+ *  propagates it.
+ */
+void CryptoPipeline::receive(std::shared_ptr<STKPeer> peer,
+                             const ENetEvent& event)
+{
+    Job job;
+    job.m_type = JT_RECEIVE;
+    job.m_peer = peer;
+    job.m_event = event;
+    addJob(std::move(job));
+}   // receive
+
+// ----------------------------------------------------------------------------
+/** Propagates an event after the previously received packets of its peer.
+ */
+void CryptoPipeline::propagateEvent(Event* event)
+{
+    Job job;
+    job.m_type = JT_EVENT;
+    job.m_peer = event->getPeerSP();
+    job.m_stk_event = event;
+    addJob(std::move(job));
+}   // propagateEvent
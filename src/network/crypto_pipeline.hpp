@@ -0,0 +1,117 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2026 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_CRYPTO_PIPELINE_HPP
+#define HEADER_CRYPTO_PIPELINE_HPP
+
+#include "network/stk_host.hpp"
+#include "utils/constants.hpp"
+#include "utils/no_copy.hpp"
+#include "utils/stk_process.hpp"
+#include "utils/types.hpp"
+
+#include <enet/enet.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class BareNetworkString;
+class Event;
+class NetworkString;
+class STKPeer;
+
+/** \brief Encrypts and decrypts the packets of a server in worker threads.
+ *  Each peer is handled by one worker (chosen by its host id), which
+ *  processes everything of that peer in order: packets to be sent are
+ *  encrypted and handed to the network thread as ready ENet commands, the
+ *  received packets are decrypted and propagated to the ProtocolManager.
+ *  Unencrypted packets, disconnections and events of a peer go through its
+ *  worker too, so they are never reordered against its encrypted packets.
+ *  Since only one worker uses the Crypto of a peer, the packet counters
+ *  used as nonces still increase in the order the packets are sent.
+ *  After stop() all jobs are done in the calling thread.
+ * \ingroup network
+ */
+class CryptoPipeline : public NoCopy
+{
+private:
+    enum JobType : uint8_t
+    {
+        JT_SEND,
+        JT_COMMAND,
+        JT_RECEIVE,
+        JT_EVENT
+    };
+
+    struct Job
+    {
+        JobType m_type;
+        std::shared_ptr<STKPeer> m_peer;
+        /** JT_SEND: the packet to be encrypted. */
+        std::unique_ptr<BareNetworkString> m_data;
+        PacketReliabilityMode m_reliable;
+        /** JT_COMMAND: the ENet command to be done. */
+        ENetPacket* m_packet;
+        uint32_t m_value;
+        ENetCommandType m_command;
+        /** JT_RECEIVE: the received packet. */
+        ENetEvent m_event;
+        /** JT_EVENT: an event created by the network thread. */
+        Event* m_stk_event;
+    };
+
+    struct Worker
+    {
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+        std::vector<Job> m_jobs;
+        std::thread m_thread;
+        bool m_exit;
+        Worker() : m_exit(false) {}
+    };
+
+    STKHost* m_host;
+
+    std::vector<std::unique_ptr<Worker> > m_workers;
+
+    std::atomic<uint64_t> m_packets_encrypted;
+
+    std::atomic<uint64_t> m_packets_decrypted;
+
+    std::atomic<uint64_t> m_batches;
+
+    void mainLoop(Worker* worker, ProcessType pt);
+    void addJob(Job&& job);
+    void process(Job& job, std::vector<STKHost::ENetCommand>* commands);
+
+public:
+    CryptoPipeline(STKHost* host, unsigned threads);
+    ~CryptoPipeline();
+    void stop();
+    void sendPacket(std::shared_ptr<STKPeer> peer, NetworkString* data,
+                    PacketReliabilityMode reliable);
+    void addCommand(std::shared_ptr<STKPeer> peer, ENetPacket* packet,
+                    uint32_t value, ENetCommandType ect);
+    void receive(std::shared_ptr<STKPeer> peer, const ENetEvent& event);
+    void propagateEvent(Event* event);
+};   // CryptoPipeline
+
+#endif
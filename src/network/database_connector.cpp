@@ -29,6 +29,68 @@
 #include "utils/game_info.hpp"
 #include "utils/log.hpp"
 #include "utils/string_utils.hpp"
+#include "utils/vs.hpp"
+
+#include <cmath>
+#include <map>
+#include <set>
+
+namespace
+{
+    /** How often the geolocation index is reloaded. */
+    const uint64_t GEO_INDEX_RELOAD_MS = 3600 * 1000;
+
+    /** How often the record index is reloaded. */
+    const uint64_t RECORD_INDEX_RELOAD_MS = 600 * 1000;
+
+    // ------------------------------------------------------------------------
+    std::string columnText(sqlite3_stmt* stmt, int column)
+    {
+        const char* value = (const char*)sqlite3_column_text(stmt, column);
+        return value == nullptr ? "" : value;
+    }   // columnText
+
+    // ------------------------------------------------------------------------
+    std::pair<uint64_t, uint64_t> toIPv6Key(const uint8_t* bytes)
+    {
+        uint64_t upper = 0;
+        uint64_t lower = 0;
+        for (unsigned i = 0; i < 8; i++)
+        {
+            upper = (upper << 8) | bytes[i];
+            lower = (lower << 8) | bytes[i + 8];
+        }
+        return std::make_pair(upper, lower);
+    }   // toIPv6Key
+
+    // ------------------------------------------------------------------------
+    /** Steps the statement until it's done, copying the rows to the output
+     *  if it's not nullptr. Returns the result of the last step. */
+    int stepRows(sqlite3_stmt* stmt,
+                 std::vector<std::vector<std::string> >* output,
+                 const std::string& null_value)
+    {
+        int ret = sqlite3_step(stmt);
+        if (!output)
+            return ret;
+        output->clear();
+        while (ret == SQLITE_ROW)
+        {
+            output->emplace_back();
+            int columns = sqlite3_column_count(stmt);
+            for (int i = 0; i < columns; ++i)
+            {
+                const char* value = (char*)sqlite3_column_text(stmt, i);
+                if (value == nullptr)
+                    output->back().push_back(null_value);
+                else
+                    output->back().push_back(std::string(value));
+            }
+            ret = sqlite3_step(stmt);
+        }
+        return ret;
+    }   // stepRows
+}   // anonymous namespace
 
 //-----------------------------------------------------------------------------
 /** Prints "?" to the output stream and saves the Binder object to the
@@ -84,6 +146,19 @@ std::function<void(sqlite3_stmt* stmt)> BinderCollection::getBindFunction() cons
     };
 }   // BinderCollection::getBindFunction
 
+//-----------------------------------------------------------------------------
+DatabaseConnector::~DatabaseConnector()
+{
+    stopDatabaseThread();
+    if (m_read_db != NULL)
+        sqlite3_close(m_read_db);
+    if (m_db != NULL)
+    {
+        clearStatements();
+        sqlite3_close(m_db);
+    }
+}   // ~DatabaseConnector
+
 //-----------------------------------------------------------------------------
 
 void DatabaseConnector::setupContextUser()
@@ -95,13 +170,21 @@ void DatabaseConnector::setupContextUser()
 void DatabaseConnector::initDatabase()
 {
     m_last_poll_db_time = StkTime::getMonoTimeMs();
+    m_geo_index_time = 0;
     m_db = NULL;
+    m_read_db = NULL;
     m_ip_ban_table_exists = false;
     m_ipv6_ban_table_exists = false;
     m_online_id_ban_table_exists = false;
     m_ip_geolocation_table_exists = false;
     m_ipv6_geolocation_table_exists = false;
     m_player_reports_table_exists = false;
+    m_records_table_exists = false;
+    m_record_index_time = 0;
+    std::unique_lock<std::mutex> ul(m_record_index_mutex);
+    m_record_index.clear();
+    m_record_index_loaded = false;
+    ul.unlock();
     if (!ServerConfig::m_sql_management)
         return;
     const std::string& path = ServerConfig::getConfigDirectory() + "/" +
@@ -117,22 +200,21 @@ void DatabaseConnector::initDatabase()
         m_db = NULL;
         return;
     }
-    sqlite3_busy_handler(m_db, [](void* data, int retry)
-        {
-            int retry_count = ServerConfig::m_database_timeout / 100;
-            if (retry < retry_count)
-            {
-                sqlite3_sleep(100);
-                // Return non-zero to let caller retry again
-                return 1;
-            }
-            // Return zero to let caller return SQLITE_BUSY immediately
-            return 0;
-        }, NULL);
-    sqlite3_create_function(m_db, "insideIPv6CIDR", 2, SQLITE_UTF8, NULL,
-        &insideIPv6CIDRSQL, NULL, NULL);
-    sqlite3_create_function(m_db, "upperIPv6", 1, SQLITE_UTF8, NULL,
-        &upperIPv6SQL, NULL, NULL);
+    setupConnection(m_db);
+    // Lookups of the lobby thread use their own connection with a private
+    // cache, so they are not serialized with the database thread
+    ret = sqlite3_open_v2(path.c_str(), &m_read_db,
+        SQLITE_OPEN_PRIVATECACHE | SQLITE_OPEN_FULLMUTEX |
+        SQLITE_OPEN_READONLY, NULL);
+    if (ret != SQLITE_OK)
+    {
+        Log::warn("DatabaseConnector", "Cannot open read-only database: %s.",
+            sqlite3_errmsg(m_read_db));
+        sqlite3_close(m_read_db);
+        m_read_db = NULL;
+    }
+    else
+        setupConnection(m_read_db);
     checkTableExists(ServerConfig::m_ip_ban_table, m_ip_ban_table_exists);
     checkTableExists(ServerConfig::m_ipv6_ban_table, m_ipv6_ban_table_exists);
     checkTableExists(ServerConfig::m_online_id_ban_table,
@@ -145,22 +227,224 @@ void DatabaseConnector::initDatabase()
         m_ipv6_geolocation_table_exists);
     checkTableExists(ServerConfig::m_records_table_name,
         m_records_table_exists, true);
+
+    m_stop_db_thread = false;
+    m_db_thread = std::thread(std::bind(&DatabaseConnector::databaseThread,
+        this));
+    queueJob([this]()
+        {
+            loadBanIndex();
+            loadGeoIndex();
+            loadRecordIndex();
+            return true;
+        });
 }   // initDatabase
 
 //-----------------------------------------------------------------------------
-/** Closes the database. */
+/** Sets the busy handler and the custom functions of a connection. */
+void DatabaseConnector::setupConnection(sqlite3* db)
+{
+    sqlite3_busy_handler(db, [](void* data, int retry)
+        {
+            int retry_count = ServerConfig::m_database_timeout / 100;
+            if (retry < retry_count)
+            {
+                sqlite3_sleep(100);
+                // Return non-zero to let caller retry again
+                return 1;
+            }
+            // Return zero to let caller return SQLITE_BUSY immediately
+            return 0;
+        }, NULL);
+    sqlite3_create_function(db, "insideIPv6CIDR", 2, SQLITE_UTF8, NULL,
+        &insideIPv6CIDRSQL, NULL, NULL);
+    sqlite3_create_function(db, "upperIPv6", 1, SQLITE_UTF8, NULL,
+        &upperIPv6SQL, NULL, NULL);
+}   // setupConnection
+
+//-----------------------------------------------------------------------------
+/** Closes the database, after all queued jobs are done. */
 void DatabaseConnector::destroyDatabase()
 {
     auto peers = STKHost::get()->getPeers();
     for (auto& peer : peers)
         writeDisconnectInfoTable(peer);
+    stopDatabaseThread();
+    // Callbacks would refer to the lobby which is being destroyed
+    std::unique_lock<std::mutex> ul(m_callbacks_mutex);
+    m_callbacks.clear();
+    ul.unlock();
+    if (m_read_db != NULL)
+    {
+        sqlite3_close(m_read_db);
+        m_read_db = NULL;
+    }
     if (m_db != NULL)
+    {
+        clearStatements();
         sqlite3_close(m_db);
+        m_db = NULL;
+    }
 }   // destroyDatabase
 
+//-----------------------------------------------------------------------------
+/** Runs queued jobs until the thread is stopped and there is no job left.
+ *  Jobs which were queued while the previous batch was running are run
+ *  together inside one transaction.
+ */
+void DatabaseConnector::databaseThread()
+{
+    VS::setThreadName("DatabaseThread");
+    while (true)
+    {
+        std::deque<std::pair<Job, JobCallback> > jobs;
+        std::unique_lock<std::mutex> ul(m_jobs_mutex);
+        m_jobs_added.wait(ul, [this]()
+            { return m_stop_db_thread || !m_jobs.empty(); });
+        if (m_jobs.empty())
+            break;
+        std::swap(jobs, m_jobs);
+        ul.unlock();
+        m_jobs_taken.notify_all();
+
+        bool transaction = easySQLQuery("BEGIN;");
+        std::vector<bool> results;
+        for (auto& job : jobs)
+            results.push_back(job.first());
+        if (transaction && !easySQLQuery("COMMIT;"))
+        {
+            Log::error("DatabaseConnector", "Failed to commit %d jobs.",
+                (int)jobs.size());
+            easySQLQuery("ROLLBACK;");
+            results.assign(results.size(), false);
+        }
+
+        std::lock_guard<std::mutex> lock(m_callbacks_mutex);
+        for (unsigned i = 0; i < jobs.size(); i++)
+        {
+            if (jobs[i].second)
+            {
+                JobCallback callback = jobs[i].second;
+                bool result = results[i];
+                m_callbacks.push_back([callback, result]()
+                    { callback(result); });
+            }
+        }
+    }
+}   // databaseThread
+
+//-----------------------------------------------------------------------------
+/** Stops the database thread after it finishes all queued jobs. Jobs queued
+ *  later are run immediately in the calling thread. */
+void DatabaseConnector::stopDatabaseThread()
+{
+    if (!m_db_thread.joinable())
+        return;
+    std::unique_lock<std::mutex> ul(m_jobs_mutex);
+    m_stop_db_thread = true;
+    ul.unlock();
+    m_jobs_added.notify_one();
+    m_db_thread.join();
+}   // stopDatabaseThread
+
+//-----------------------------------------------------------------------------
+/** Queues a job for the database thread. If too many jobs are waiting, this
+ *  blocks until the database thread takes them.
+ *  \param job The job, which should use only its own copies of data (like
+ *             the query to run) and the database.
+ *  \param callback Optional function called with the result of the job
+ *                  from handleCallbacks().
+ */
+void DatabaseConnector::queueJob(Job job, JobCallback callback)
+{
+    if (!m_db_thread.joinable())
+    {
+        bool result = job();
+        if (callback)
+            callback(result);
+        return;
+    }
+    std::unique_lock<std::mutex> ul(m_jobs_mutex);
+    m_jobs_taken.wait(ul, [this]()
+        { return m_jobs.size() < MAX_PENDING_JOBS; });
+    m_jobs.emplace_back(job, callback);
+    ul.unlock();
+    m_jobs_added.notify_one();
+}   // queueJob
+
+//-----------------------------------------------------------------------------
+/** Queues a query without output for the database thread, see queueJob. */
+void DatabaseConnector::queueQuery(const std::string& query,
+                         std::function<void(sqlite3_stmt* stmt)> bind_function,
+                                   JobCallback callback)
+{
+    queueJob([this, query, bind_function]()
+        {
+            return easySQLQuery(query, nullptr, bind_function);
+        }, callback);
+}   // queueQuery
+
+//-----------------------------------------------------------------------------
+/** Calls the callbacks of finished jobs, it should be called regularly by
+ *  the thread owning the lobby. */
+void DatabaseConnector::handleCallbacks()
+{
+    std::vector<std::function<void()> > callbacks;
+    std::unique_lock<std::mutex> ul(m_callbacks_mutex);
+    std::swap(callbacks, m_callbacks);
+    ul.unlock();
+    for (auto& callback : callbacks)
+        callback();
+}   // handleCallbacks
+
+//-----------------------------------------------------------------------------
+/** Returns the prepared statement for the query, preparing it if it is not
+ *  cached. The least recently used statement is finalized if the cache is
+ *  full. \ref m_statements_mutex has to be locked by the caller.
+ *  \return The statement, or NULL if the query cannot be prepared.
+ */
+sqlite3_stmt* DatabaseConnector::getStatement(const std::string& query) const
+{
+    auto it = m_statement_index.find(query);
+    if (it != m_statement_index.end())
+    {
+        m_statements.splice(m_statements.begin(), m_statements, it->second);
+        return it->second->second;
+    }
+    sqlite3_stmt* stmt = NULL;
+    if (sqlite3_prepare_v2(m_db, query.c_str(), -1, &stmt, 0) != SQLITE_OK)
+    {
+        sqlite3_finalize(stmt);
+        return NULL;
+    }
+    m_statements.emplace_front(query, stmt);
+    m_statement_index[query] = m_statements.begin();
+    if (m_statements.size() > STATEMENT_CACHE_SIZE)
+    {
+        sqlite3_finalize(m_statements.back().second);
+        m_statement_index.erase(m_statements.back().first);
+        m_statements.pop_back();
+    }
+    return stmt;
+}   // getStatement
+
+//-----------------------------------------------------------------------------
+/** Finalizes all cached statements, which is needed before closing the
+ *  database. */
+void DatabaseConnector::clearStatements()
+{
+    std::lock_guard<std::mutex> lock(m_statements_mutex);
+    for (auto& statement : m_statements)
+        sqlite3_finalize(statement.second);
+    m_statements.clear();
+    m_statement_index.clear();
+}   // clearStatements
+
 //-----------------------------------------------------------------------------
 /** Runs simple query with optional bind function. If output vector pointer is
- *   not (default) nullptr, then the output is written there.
+ *   not (default) nullptr, then the output is written there. The prepared
+ *   statement is cached, so it's better to bind values than to insert them
+ *   into the query of a frequently used query.
  *  \param query The SQL query with '?'-placeholders for values to bind.
  *  \param output The 2D vector for output rows. If nullptr, the query output
  *                is ignored.
@@ -177,36 +461,20 @@ bool DatabaseConnector::easySQLQuery(
         Log::error("DatabaseConnector", "easySQLQuery: There is no database!");
         return false;
     }
-    sqlite3_stmt* stmt = NULL;
-    int ret = sqlite3_prepare_v2(m_db, query.c_str(), -1, &stmt, 0);
-    if (ret == SQLITE_OK)
+    std::lock_guard<std::mutex> lock(m_statements_mutex);
+    sqlite3_stmt* stmt = getStatement(query);
+    if (stmt != NULL)
     {
         if (bind_function)
             bind_function(stmt);
-        ret = sqlite3_step(stmt);
-        if (output)
-        {
-            output->clear();
-            while (ret == SQLITE_ROW)
-            {
-                output->emplace_back();
-                int columns = sqlite3_column_count(stmt);
-                for (int i = 0; i < columns; ++i)
-                {
-                    const char* value = (char*)sqlite3_column_text(stmt, i);
-                    if (value == nullptr)
-                        output->back().push_back(null_value);
-                    else
-                        output->back().push_back(std::string(value));
-                }
-                ret = sqlite3_step(stmt);
-            }
-        }
-        ret = sqlite3_finalize(stmt);
+        stepRows(stmt, output, null_value);
+        // Reset returns the error of the last step, if any
+        int ret = sqlite3_reset(stmt);
+        sqlite3_clear_bindings(stmt);
         if (ret != SQLITE_OK)
         {
             Log::error("DatabaseConnector",
-                "Error finalize database for easy query %s: %s",
+                "Error running database easy query %s: %s",
                 query.c_str(), sqlite3_errmsg(m_db));
             return false;
         }
@@ -221,6 +489,288 @@ bool DatabaseConnector::easySQLQuery(
     return true;
 }   // easySQLQuery
 
+//-----------------------------------------------------------------------------
+/** Runs a query which only reads the database, like easySQLQuery but on
+ *  the separate read-only connection. Lookups done in the lobby thread use
+ *  it, so they don't wait for the transaction of the database thread and
+ *  its statements. The statement is not cached.
+ *  \param query The SQL query with '?'-placeholders for values to bind.
+ *  \param output The 2D vector for output rows.
+ *  \param bind_function The function for binding missing values.
+ *  \return True if no error occurs.
+ */
+bool DatabaseConnector::readSQLQuery(const std::string& query,
+                                 std::vector<std::vector<std::string>>* output,
+                   std::function<void(sqlite3_stmt* stmt)> bind_function) const
+{
+    if (!m_read_db)
+        return easySQLQuery(query, output, bind_function);
+    sqlite3_stmt* stmt = NULL;
+    if (sqlite3_prepare_v2(m_read_db, query.c_str(), -1, &stmt, 0) != SQLITE_OK)
+    {
+        Log::error("DatabaseConnector",
+            "Error preparing database for read query %s: %s",
+            query.c_str(), sqlite3_errmsg(m_read_db));
+        sqlite3_finalize(stmt);
+        return false;
+    }
+    if (bind_function)
+        bind_function(stmt);
+    stepRows(stmt, output, "");
+    if (sqlite3_finalize(stmt) != SQLITE_OK)
+    {
+        Log::error("DatabaseConnector", "Error running read query %s: %s",
+            query.c_str(), sqlite3_errmsg(m_read_db));
+        return false;
+    }
+    return true;
+}   // readSQLQuery
+
+//-----------------------------------------------------------------------------
+/** Runs a query without caching its statement and calls a function for each
+ *  row of the output. Used for reading whole tables, as it doesn't copy the
+ *  output. \ref m_statements_mutex is held while the rows are read, like
+ *  in easySQLQuery, so the row function must not run other queries.
+ *  \param query The SQL query.
+ *  \param row_function The function reading the current row of the
+ *                      statement.
+ *  \return True if no error occurs.
+ */
+bool DatabaseConnector::forEachRow(const std::string& query,
+                 std::function<void(sqlite3_stmt* stmt)> row_function) const
+{
+    if (!m_db)
+        return false;
+    std::lock_guard<std::mutex> lock(m_statements_mutex);
+    sqlite3_stmt* stmt = NULL;
+    if (sqlite3_prepare_v2(m_db, query.c_str(), -1, &stmt, 0) != SQLITE_OK)
+    {
+        Log::error("DatabaseConnector",
+            "Error preparing database for query %s: %s",
+            query.c_str(), sqlite3_errmsg(m_db));
+        sqlite3_finalize(stmt);
+        return false;
+    }
+    while (sqlite3_step(stmt) == SQLITE_ROW)
+        row_function(stmt);
+    if (sqlite3_finalize(stmt) != SQLITE_OK)
+    {
+        Log::error("DatabaseConnector", "Error running query %s: %s",
+            query.c_str(), sqlite3_errmsg(m_db));
+        return false;
+    }
+    return true;
+}   // forEachRow
+
+//-----------------------------------------------------------------------------
+/** Builds a new index of IPv4 and IPv6 bans which are not expired and
+ *  replaces the current one. Called in the database thread.
+ */
+void DatabaseConnector::loadBanIndex()
+{
+    std::shared_ptr<BanIndex> index = std::make_shared<BanIndex>();
+    // Bans which start later are included, isActive() checks the time
+    const std::string times = "strftime('%s', starting_time), "
+        "CASE WHEN expired_days IS NULL THEN -1 ELSE "
+        "strftime('%s', starting_time, '+'||expired_days||' days') END";
+    const std::string not_expired = "WHERE expired_days IS NULL OR "
+        "datetime(starting_time, '+'||expired_days||' days') > "
+        "datetime('now');";
+
+    if (m_ip_ban_table_exists)
+    {
+        std::string query = "SELECT rowid, ip_start, ip_end, reason, "
+            "description, " + times + " FROM " +
+            (std::string)ServerConfig::m_ip_ban_table + " " + not_expired;
+        bool ok = forEachRow(query, [&index](sqlite3_stmt* stmt)
+            {
+                if (sqlite3_column_type(stmt, 5) == SQLITE_NULL ||
+                    sqlite3_column_type(stmt, 6) == SQLITE_NULL)
+                    return;
+                IndexedBan<IpBanTableData> ban;
+                ban.m_data.row_id = sqlite3_column_int(stmt, 0);
+                ban.m_data.ip_start = (uint32_t)sqlite3_column_int64(stmt, 1);
+                ban.m_data.ip_end = (uint32_t)sqlite3_column_int64(stmt, 2);
+                ban.m_data.reason = columnText(stmt, 3);
+                ban.m_data.description = columnText(stmt, 4);
+                ban.m_starting_time = sqlite3_column_int64(stmt, 5);
+                ban.m_expiration_time = sqlite3_column_int64(stmt, 6);
+                index->m_ip.add(ban.m_data.ip_start, ban.m_data.ip_end, ban);
+            });
+        if (!ok)
+            return;
+    }
+    if (m_ipv6_ban_table_exists)
+    {
+        std::string query = "SELECT rowid, ipv6_cidr, reason, description, " +
+            times + " FROM " + (std::string)ServerConfig::m_ipv6_ban_table +
+            " " + not_expired;
+        bool ok = forEachRow(query, [&index](sqlite3_stmt* stmt)
+            {
+                if (sqlite3_column_type(stmt, 4) == SQLITE_NULL ||
+                    sqlite3_column_type(stmt, 5) == SQLITE_NULL)
+                    return;
+                IndexedBan<Ipv6BanTableData> ban;
+                ban.m_data.row_id = sqlite3_column_int(stmt, 0);
+                ban.m_data.ipv6_cidr = columnText(stmt, 1);
+                ban.m_data.reason = columnText(stmt, 2);
+                ban.m_data.description = columnText(stmt, 3);
+                ban.m_starting_time = sqlite3_column_int64(stmt, 4);
+                ban.m_expiration_time = sqlite3_column_int64(stmt, 5);
+                uint8_t first[16], last[16];
+                if (!getIPv6CIDRRange(ban.m_data.ipv6_cidr.c_str(), first,
+                    last))
+                    return;
+                index->m_ipv6.add(toIPv6Key(first), toIPv6Key(last), ban);
+            });
+        if (!ok)
+            return;
+    }
+    index->m_ip.build();
+    index->m_ipv6.build();
+    std::atomic_store(&m_ban_index, std::shared_ptr<const BanIndex>(index));
+}   // loadBanIndex
+
+//-----------------------------------------------------------------------------
+/** Builds a new index of the IPv4 and IPv6 geolocation tables and replaces
+ *  the current one. Called in the database thread.
+ */
+void DatabaseConnector::loadGeoIndex()
+{
+    m_geo_index_time = StkTime::getMonoTimeMs();
+    std::shared_ptr<GeoIndex> index = std::make_shared<GeoIndex>();
+    std::map<std::string, uint16_t> codes;
+    auto get_code = [&index, &codes](const std::string& code)
+    {
+        auto it = codes.find(code);
+        if (it != codes.end())
+            return it->second;
+        uint16_t id = (uint16_t)index->m_country_codes.size();
+        index->m_country_codes.push_back(code);
+        codes[code] = id;
+        return id;
+    };
+
+    if (m_ip_geolocation_table_exists)
+    {
+        std::string query = "SELECT ip_start, ip_end, country_code FROM " +
+            (std::string)ServerConfig::m_ip_geolocation_table + ";";
+        bool ok = forEachRow(query, [&index, &get_code](sqlite3_stmt* stmt)
+            {
+                index->m_ip.add((uint32_t)sqlite3_column_int64(stmt, 0),
+                    (uint32_t)sqlite3_column_int64(stmt, 1),
+                    get_code(columnText(stmt, 2)));
+            });
+        if (!ok)
+            return;
+    }
+    if (m_ipv6_geolocation_table_exists)
+    {
+        std::string query = "SELECT ip_start, ip_end, country_code FROM " +
+            (std::string)ServerConfig::m_ipv6_geolocation_table + ";";
+        bool ok = forEachRow(query, [&index, &get_code](sqlite3_stmt* stmt)
+            {
+                index->m_ipv6.add(sqlite3_column_int64(stmt, 0),
+                    sqlite3_column_int64(stmt, 1),
+                    get_code(columnText(stmt, 2)));
+            });
+        if (!ok)
+            return;
+    }
+    index->m_ip.build();
+    index->m_ipv6.build();
+    if (m_ip_geolocation_table_exists || m_ipv6_geolocation_table_exists)
+    {
+        Log::info("DatabaseConnector", "Loaded %u IPv4 and %u IPv6 "
+            "geolocation ranges in %dms.", index->m_ip.size(),
+            index->m_ipv6.size(),
+            (int)(StkTime::getMonoTimeMs() - m_geo_index_time));
+    }
+    std::atomic_store(&m_geo_index, std::shared_ptr<const GeoIndex>(index));
+}   // loadGeoIndex
+
+//-----------------------------------------------------------------------------
+/** Loads the best result of the records table for each game setting and
+ *  replaces the current record index. Called in the database thread.
+ */
+void DatabaseConnector::loadRecordIndex()
+{
+    m_record_index_time = StkTime::getMonoTimeMs();
+    if (!m_records_table_exists)
+        return;
+    std::map<RecordKey, BestRecord> index;
+    // Only the best row of each setting is returned, the earlier one if
+    // results are equal. Without window functions (since sqlite 3.25),
+    // the bare columns of MIN come from a best row, but ties are arbitrary.
+    // Rows with NULL settings are skipped as they can't be equal to
+    // anything in SQL
+    std::string query;
+    if (sqlite3_libversion_number() < 3025000)
+    {
+        query = StringUtils::insertValues("SELECT venue, reverse, mode, "
+            "value_limit, time_limit, config, items, username, MIN(result) "
+            "FROM \"%s\" WHERE is_not_full = 0 AND game_event = 0 "
+            "GROUP BY venue, reverse, mode, value_limit, time_limit, config, "
+            "items;", ServerConfig::m_records_table_name.c_str());
+    }
+    else
+    {
+        query = StringUtils::insertValues("SELECT venue, reverse, mode, "
+            "value_limit, time_limit, config, items, username, result FROM "
+            "(SELECT *, ROW_NUMBER() OVER (PARTITION BY venue, reverse, "
+            "mode, value_limit, time_limit, config, items "
+            "ORDER BY result ASC, time ASC) AS row_num "
+            "FROM \"%s\" WHERE is_not_full = 0 AND game_event = 0) "
+            "WHERE row_num = 1;",
+            ServerConfig::m_records_table_name.c_str());
+    }
+    bool ok = forEachRow(query, [&index](sqlite3_stmt* stmt)
+        {
+            for (int i = 0; i < 7; i++)
+            {
+                if (sqlite3_column_type(stmt, i) == SQLITE_NULL)
+                    return;
+            }
+            RecordKey key;
+            key.m_venue = columnText(stmt, 0);
+            key.m_reverse = columnText(stmt, 1);
+            key.m_mode = columnText(stmt, 2);
+            key.m_value_limit = sqlite3_column_int64(stmt, 3);
+            key.m_time_limit =
+                std::llround(sqlite3_column_double(stmt, 4) * 1000000.0);
+            key.m_config = columnText(stmt, 5);
+            key.m_items = columnText(stmt, 6);
+            BestRecord record;
+            record.m_username = columnText(stmt, 7);
+            record.m_result = sqlite3_column_double(stmt, 8);
+            index.emplace(key, record);
+        });
+    if (!ok)
+        return;
+    Log::info("DatabaseConnector", "Loaded records of %u game settings "
+        "in %dms.", (unsigned)index.size(),
+        (int)(StkTime::getMonoTimeMs() - m_record_index_time));
+    std::lock_guard<std::mutex> lock(m_record_index_mutex);
+    m_record_index.swap(index);
+    m_record_index_loaded = true;
+}   // loadRecordIndex
+
+//-----------------------------------------------------------------------------
+/** Returns the key of the record index for the settings of a game. */
+DatabaseConnector::RecordKey DatabaseConnector::getRecordKey(
+                                                    const GameInfo& game_info)
+{
+    RecordKey key;
+    key.m_venue = game_info.m_venue;
+    key.m_reverse = game_info.m_reverse;
+    key.m_mode = game_info.m_mode;
+    key.m_value_limit = game_info.m_value_limit;
+    key.m_time_limit = std::llround(game_info.m_time_limit * 1000000.0);
+    key.m_config = game_info.m_kart_char_string;
+    key.m_items = game_info.m_powerup_string;
+    return key;
+}   // getRecordKey
+
 //-----------------------------------------------------------------------------
 /** Performs a query to determine if a certain table exists.
  *  \param table The searched name.
@@ -272,6 +822,13 @@ std::string DatabaseConnector::ip2Country(const SocketAddress& addr) const
     if (!m_db || !m_ip_geolocation_table_exists || addr.isLAN())
         return "";
 
+    std::shared_ptr<const GeoIndex> index = std::atomic_load(&m_geo_index);
+    if (index)
+    {
+        const uint16_t* code = index->m_ip.find(addr.getIP());
+        return code ? index->m_country_codes[*code] : "";
+    }
+
     std::string cc_code;
     std::string query = StringUtils::insertValues(
         "SELECT country_code FROM %s "
@@ -281,7 +838,7 @@ std::string DatabaseConnector::ip2Country(const SocketAddress& addr) const
         addr.getIP());
 
     std::vector<std::vector<std::string>> output;
-    if (easySQLQuery(query, &output) && !output.empty())
+    if (readSQLQuery(query, &output) && !output.empty())
     {
         cc_code = output[0][0];
     }
@@ -300,8 +857,15 @@ std::string DatabaseConnector::ipv62Country(const SocketAddress& addr) const
     if (!m_db || !m_ipv6_geolocation_table_exists)
         return "";
 
-    std::string cc_code;
     const std::string& ipv6 = addr.toString(false/*show_port*/);
+    std::shared_ptr<const GeoIndex> index = std::atomic_load(&m_geo_index);
+    if (index)
+    {
+        const uint16_t* code = index->m_ipv6.find(upperIPv6(ipv6.c_str()));
+        return code ? index->m_country_codes[*code] : "";
+    }
+
+    std::string cc_code;
     std::string query = StringUtils::insertValues(
         "SELECT country_code FROM %s "
         "WHERE `ip_start` <= upperIPv6(\"%s\") AND `ip_end` >= upperIPv6(\"%s\") "
@@ -310,7 +874,7 @@ std::string DatabaseConnector::ipv62Country(const SocketAddress& addr) const
         ipv6.c_str());
 
     std::vector<std::vector<std::string>> output;
-    if (easySQLQuery(query, &output) && !output.empty())
+    if (readSQLQuery(query, &output) && !output.empty())
     {
         cc_code = output[0][0];
     }
@@ -395,7 +959,7 @@ void DatabaseConnector::writeDisconnectInfoTable(std::shared_ptr<STKPeer> peer)
         "WHERE host_id = %u;", m_server_stats_table.c_str(),
         peer->getAveragePing(), peer->getPacketLoss(),
         peer->getHostId());
-    easySQLQuery(query);
+    queueQuery(query);
 }   // writeDisconnectInfoTable
 
 //-----------------------------------------------------------------------------
@@ -410,7 +974,7 @@ void DatabaseConnector::initServerStatsTable()
         return;
     std::string table_name = std::string("v") +
         StringUtils::toString(ServerConfig::m_server_db_version) + "_" +
-        ServerConfig::m_server_uid + "_stats";
+        ServerConfig::getLobbyUid() + "_stats";
 
     std::ostringstream oss;
     oss << "CREATE TABLE IF NOT EXISTS " << table_name << " (\n"
@@ -462,7 +1026,7 @@ void DatabaseConnector::initServerStatsTable()
         // Server owner need to initialise this table himself, check NETWORKING.md
         m_results_table_name = std::string("v") + StringUtils::toString(
             ServerConfig::m_server_db_version) + "_" +
-            ServerConfig::m_server_uid + "_results";
+            ServerConfig::getLobbyUid() + "_results";
         query = StringUtils::insertValues(
             "CREATE TABLE IF NOT EXISTS %s (\n"
             // Columns describing game settings
@@ -503,15 +1067,39 @@ void DatabaseConnector::initServerStatsTable()
 
         // If the results table after that query has too few columns,
         // warn about database update
-        output.clear();
-        query = "SELECT count(cid) FROM pragma_table_info('" + m_results_table_name + "');";
-        int columns = -1;
-        if (easySQLQuery(query, &output) && !output.empty() && !output[0].empty())
+        std::set<std::string> columns;
+        query = "SELECT name FROM pragma_table_info('" + m_results_table_name + "');";
+        forEachRow(query, [&columns](sqlite3_stmt* stmt)
+            {
+                columns.insert(columnText(stmt, 0));
+            });
+
+        // Index for finding the best result under certain settings (see
+        // getBestResult), which is only created if an old table has all
+        // the columns it needs
+        const char* record_columns[] = { "venue", "reverse", "mode",
+            "value_limit", "time_limit", "config", "items", "is_not_full",
+            "game_event", "result", "time" };
+        bool has_record_columns = true;
+        for (const char* column : record_columns)
+            has_record_columns &= columns.count(column) > 0;
+        if (has_record_columns)
         {
-            if (!StringUtils::fromString(output[0][0], columns))
-                columns = -1;
+            query = StringUtils::insertValues(
+                "CREATE INDEX IF NOT EXISTS %s_records ON %s (venue, "
+                "reverse, mode, value_limit, time_limit, config, items, "
+                "is_not_full, game_event, result, time);",
+                m_results_table_name.c_str(), m_results_table_name.c_str());
+            easySQLQuery(query);
         }
-        if (columns < 31) // the number of columns at the moment of big update
+        else
+        {
+            Log::warn("DatabaseConnector", "Table %s doesn't have the "
+                "columns of results, no index is created for records.",
+                m_results_table_name.c_str());
+        }
+
+        if (columns.size() < 31) // the number of columns at the moment of big update
         {
 #ifdef ENABLE_FATAL_WHEN_OLD_RECORDS
             Log::fatal("DatabaseConnector", ""
@@ -541,7 +1129,7 @@ void DatabaseConnector::initServerStatsTable()
     // players in minutes
     std::string full_stats_view_name = std::string("v") +
         StringUtils::toString(ServerConfig::m_server_db_version) + "_" +
-        ServerConfig::m_server_uid + "_full_stats";
+        ServerConfig::getLobbyUid() + "_full_stats";
     oss.str("");
     oss << "CREATE VIEW IF NOT EXISTS " << full_stats_view_name << " AS\n"
         << "    SELECT host_id, ip,\n"
@@ -563,7 +1151,7 @@ void DatabaseConnector::initServerStatsTable()
     // played of each players in minutes
     std::string current_players_view_name = std::string("v") +
         StringUtils::toString(ServerConfig::m_server_db_version) + "_" +
-        ServerConfig::m_server_uid + "_current_players";
+        ServerConfig::getLobbyUid() + "_current_players";
     oss.str("");
     oss.clear();
     oss << "CREATE VIEW IF NOT EXISTS " << current_players_view_name << " AS\n"
@@ -587,7 +1175,7 @@ void DatabaseConnector::initServerStatsTable()
     // If sqlite supports window functions (since 3.25), it will include last session player info (ip, country, ping...)
     std::string player_stats_view_name = std::string("v") +
         StringUtils::toString(ServerConfig::m_server_db_version) + "_" +
-        ServerConfig::m_server_uid + "_player_stats";
+        ServerConfig::getLobbyUid() + "_player_stats";
     oss.str("");
     oss.clear();
     if (sqlite3_libversion_number() < 3025000)
@@ -678,12 +1266,12 @@ void DatabaseConnector::initServerStatsTable()
  *  \param reporting Peer that is reported.
  *  \param reporting_npp Player profile that is reported.
  *  \param info The report message.
- *  \return True if the database query succeeded.
+ *  \param callback Optional function called with the result of the query.
  */
-bool DatabaseConnector::writeReport(
+void DatabaseConnector::writeReport(
        std::shared_ptr<STKPeer> reporter, std::shared_ptr<NetworkPlayerProfile> reporter_npp,
        std::shared_ptr<STKPeer> reporting, std::shared_ptr<NetworkPlayerProfile> reporting_npp,
-       irr::core::stringw& info)
+       irr::core::stringw& info, JobCallback callback)
 {
     std::string query;
 
@@ -726,7 +1314,7 @@ bool DatabaseConnector::writeReport(
             Binder(coll, StringUtils::wideToUtf8(reporting_npp->getName()), "reporting_name")
         );
     }
-    return easySQLQuery(query, nullptr, coll->getBindFunction());
+    queueQuery(query, coll->getBindFunction(), callback);
 }   // writeReport
 
 //-----------------------------------------------------------------------------
@@ -746,6 +1334,17 @@ DatabaseConnector::getIpBanTableData(uint32_t ip) const
         return result;
     }
     bool single_ip = (ip != 0);
+    std::shared_ptr<const BanIndex> index = std::atomic_load(&m_ban_index);
+    if (single_ip && index)
+    {
+        int64_t now = StkTime::getTimeSinceEpoch();
+        auto ban = index->m_ip.find(ip,
+            [now](const IndexedBan<IpBanTableData>& ban)
+            { return ban.isActive(now); });
+        if (ban)
+            result.push_back(ban->m_data);
+        return result;
+    }
     std::ostringstream oss;
     oss << "SELECT rowid, ip_start, ip_end, reason, description FROM ";
     oss << (std::string)ServerConfig::m_ip_ban_table << " WHERE ";
@@ -760,7 +1359,10 @@ DatabaseConnector::getIpBanTableData(uint32_t ip) const
     std::string query = oss.str();
 
     std::vector<std::vector<std::string>> output;
-    easySQLQuery(query, &output);
+    if (single_ip)
+        readSQLQuery(query, &output);
+    else
+        easySQLQuery(query, &output);
 
     for (std::vector<std::string>& row: output)
     {
@@ -778,21 +1380,59 @@ DatabaseConnector::getIpBanTableData(uint32_t ip) const
     return result;
 }   // getIpBanTableData
 
+//-----------------------------------------------------------------------------
+/** Reads all rows of the ban tables in the database thread, after updating
+ *   the in-memory ban index (and the geolocation index if it's old).
+ *  \param callback Function called with the rows of IPv4, IPv6 and online
+ *                  id ban tables from handleCallbacks().
+ */
+void DatabaseConnector::pollBanTables(std::function<void(
+    const std::vector<IpBanTableData>&,
+    const std::vector<Ipv6BanTableData>&,
+    const std::vector<OnlineIdBanTableData>&)> callback)
+{
+    struct BanTables
+    {
+        std::vector<IpBanTableData> m_ip;
+        std::vector<Ipv6BanTableData> m_ipv6;
+        std::vector<OnlineIdBanTableData> m_online_id;
+    };
+    std::shared_ptr<BanTables> tables = std::make_shared<BanTables>();
+    queueJob([this, tables]()
+        {
+            loadBanIndex();
+            if (StkTime::getMonoTimeMs() >=
+                m_geo_index_time + GEO_INDEX_RELOAD_MS)
+                loadGeoIndex();
+            if (StkTime::getMonoTimeMs() >=
+                m_record_index_time + RECORD_INDEX_RELOAD_MS)
+                loadRecordIndex();
+            tables->m_ip = getIpBanTableData();
+            tables->m_ipv6 = getIpv6BanTableData();
+            tables->m_online_id = getOnlineIdBanTableData();
+            return true;
+        },
+        [tables, callback](bool result)
+        {
+            callback(tables->m_ip, tables->m_ipv6, tables->m_online_id);
+        });
+}   // pollBanTables
+
 //-----------------------------------------------------------------------------
 /** For a peer that turned out to be banned by IPv4, this function increases
  *   the trigger count.
  *  \param ip_start Start of IP ban range corresponding to peer.
  *  \param ip_end End of IP ban range corresponding to peer.
  */
-void DatabaseConnector::increaseIpBanTriggerCount(uint32_t ip_start, uint32_t ip_end) const
+void DatabaseConnector::increaseIpBanTriggerCount(uint32_t ip_start, uint32_t ip_end)
 {
     std::string query = StringUtils::insertValues(
         "UPDATE %s SET trigger_count = trigger_count + 1, "
         "last_trigger = datetime('now') "
         "WHERE ip_start = %u AND ip_end = %u;",
         ServerConfig::m_ip_ban_table.c_str(), ip_start, ip_end);
-    easySQLQuery(query);
-}   // getIpBanTableData
+    queueQuery(query);
+}   // increaseIpBanTriggerCount
 
 //-----------------------------------------------------------------------------
 /** Gets the rows from IPv6 ban table, either all of them (for polling
@@ -811,6 +1451,20 @@ DatabaseConnector::getIpv6BanTableData(std::string ipv6) const
         return result;
     }
     bool single_ip = !ipv6.empty();
+    std::shared_ptr<const BanIndex> index = std::atomic_load(&m_ban_index);
+    if (single_ip && index)
+    {
+        uint8_t first[16], last[16];
+        if (!getIPv6CIDRRange((ipv6 + "/128").c_str(), first, last))
+            return result;
+        int64_t now = StkTime::getTimeSinceEpoch();
+        auto ban = index->m_ipv6.find(toIPv6Key(first),
+            [now](const IndexedBan<Ipv6BanTableData>& ban)
+            { return ban.isActive(now); });
+        if (ban)
+            result.push_back(ban->m_data);
+        return result;
+    }
     std::string query;
     std::shared_ptr<BinderCollection> coll = std::make_shared<BinderCollection>();
 
@@ -832,7 +1486,10 @@ DatabaseConnector::getIpv6BanTableData(std::string ipv6) const
         query += " LIMIT 1;";
 
     std::vector<std::vector<std::string>> output;
-    easySQLQuery(query, &output, coll->getBindFunction());
+    if (single_ip)
+        readSQLQuery(query, &output, coll->getBindFunction());
+    else
+        easySQLQuery(query, &output, coll->getBindFunction());
 
     for (std::vector<std::string>& row: output)
     {
@@ -852,7 +1509,7 @@ DatabaseConnector::getIpv6BanTableData(std::string ipv6) const
  *   the trigger count.
  *  \param ipv6_cidr Block of IPv6 addresses corresponding to the peer.
  */
-void DatabaseConnector::increaseIpv6BanTriggerCount(const std::string& ipv6_cidr) const
+void DatabaseConnector::increaseIpv6BanTriggerCount(const std::string& ipv6_cidr)
 {
     std::shared_ptr<BinderCollection> coll = std::make_shared<BinderCollection>();
     std::string query = StringUtils::insertValues(
@@ -862,7 +1519,7 @@ void DatabaseConnector::increaseIpv6BanTriggerCount(const std::string& ipv6_cidr
         ServerConfig::m_ipv6_ban_table.c_str(),
         Binder(coll, ipv6_cidr, "ipv6_cidr")
     );
-    easySQLQuery(query, nullptr, coll->getBindFunction());
+    queueQuery(query, coll->getBindFunction());
 }   // increaseIpv6BanTriggerCount
 
 //-----------------------------------------------------------------------------
@@ -895,7 +1552,8 @@ DatabaseConnector::getOnlineIdBanTableData(uint32_t online_id) const
         oss << " LIMIT 1";
     oss << ";";
     std::string query = oss.str();
-    sqlite3_exec(m_db, query.c_str(),
+    sqlite3* db = single_id && m_read_db ? m_read_db : m_db;
+    sqlite3_exec(db, query.c_str(),
         [](void* ptr, int count, char** data, char** columns)
         {
             std::vector<OnlineIdBanTableData>* vec = (std::vector<OnlineIdBanTableData>*)ptr;
@@ -917,14 +1575,14 @@ DatabaseConnector::getOnlineIdBanTableData(uint32_t online_id) const
  *   increases the trigger count.
  *  \param online_id Online id of the peer.
  */
-void DatabaseConnector::increaseOnlineIdBanTriggerCount(uint32_t online_id) const
+void DatabaseConnector::increaseOnlineIdBanTriggerCount(uint32_t online_id)
 {
     std::string query = StringUtils::insertValues(
         "UPDATE %s SET trigger_count = trigger_count + 1, "
         "last_trigger = datetime('now') "
         "WHERE online_id = %u;",
         ServerConfig::m_online_id_ban_table.c_str(), online_id);
-    easySQLQuery(query);
+    queueQuery(query);
 }   // increaseOnlineIdBanTriggerCount
 
 //-----------------------------------------------------------------------------
@@ -942,7 +1600,7 @@ void DatabaseConnector::clearOldReports()
             "(reported_time, '+%f days') < datetime('now');",
             ServerConfig::m_player_reports_table.c_str(),
             ServerConfig::m_player_reports_expired_days);
-        easySQLQuery(query);
+        queueQuery(query);
     }
 }   // clearOldReports
 
@@ -975,7 +1633,7 @@ void DatabaseConnector::setDisconnectionTimes(std::vector<uint32_t>& present_hos
         oss << ");";
     }
     std::string query = oss.str();
-    easySQLQuery(query);
+    queueQuery(query);
 }   // setDisconnectionTimes
 
 //-----------------------------------------------------------------------------
@@ -992,7 +1650,12 @@ void DatabaseConnector::saveAddressToIpBanTable(const SocketAddress& addr)
         "INSERT INTO %s (ip_start, ip_end) "
         "VALUES (%u, %u);",
         ServerConfig::m_ip_ban_table.c_str(), addr.getIP(), addr.getIP());
-    easySQLQuery(query);
+    queueQuery(query);
+    queueJob([this]()
+        {
+            loadBanIndex();
+            return true;
+        });
 }   // saveAddressToIpBanTable
 
 //-----------------------------------------------------------------------------
@@ -1064,7 +1727,7 @@ void DatabaseConnector::onPlayerJoinQueries(std::shared_ptr<STKPeer> peer,
             peer->addon_soccers_count
         );
     }
-    easySQLQuery(query, nullptr, coll->getBindFunction());
+    queueQuery(query, coll->getBindFunction());
 }   // onPlayerJoinQueries
 
 //-----------------------------------------------------------------------------
@@ -1073,6 +1736,8 @@ void DatabaseConnector::listBanTable()
 {
     if (!m_db)
         return;
+    // Called from the network console thread
+    sqlite3* db = m_read_db ? m_read_db : m_db;
     auto printer = [](void* data, int argc, char** argv, char** name)
     {
         for (int i = 0; i < argc; i++)
@@ -1089,7 +1754,7 @@ void DatabaseConnector::listBanTable()
         query += ServerConfig::m_ip_ban_table;
         query += ";";
         std::cout << "IP ban list:\n";
-        sqlite3_exec(m_db, query.c_str(), printer, NULL, NULL);
+        sqlite3_exec(db, query.c_str(), printer, NULL, NULL);
     }
     if (m_online_id_ban_table_exists)
     {
@@ -1097,7 +1762,7 @@ void DatabaseConnector::listBanTable()
         query += ServerConfig::m_online_id_ban_table;
         query += ";";
         std::cout << "Online Id ban list:\n";
-        sqlite3_exec(m_db, query.c_str(), printer, NULL, NULL);
+        sqlite3_exec(db, query.c_str(), printer, NULL, NULL);
     }
 }   // listBanTable
 
@@ -1125,7 +1790,7 @@ DatabaseConnector::getServerMessages(uint32_t online_id) const
         ServerConfig::m_player_reports_table.c_str(),
         online_id, ServerConfig::m_server_uid.c_str());
 
-    if (!easySQLQuery(query, &output))
+    if (!readSQLQuery(query, &output))
         return result;
     for (std::vector<std::string>& row: output)
     {
@@ -1143,16 +1808,18 @@ DatabaseConnector::getServerMessages(uint32_t online_id) const
 /** Deletes a specified server-to-player message.
  *  \param row_id Row id of the message.
  */
-void DatabaseConnector::deleteServerMessage(int row_id) const
+void DatabaseConnector::deleteServerMessage(int row_id)
 {
     std::string query = StringUtils::insertValues(
             "DELETE FROM \"%s\" WHERE rowid = %u;",
             ServerConfig::m_player_reports_table.c_str(), row_id);
-    easySQLQuery(query);
+    queueQuery(query);
 }   // deleteServerMessage
 
 //-----------------------------------------------------------------------------
-/** Queries the database for the best ever result set under certain settings.
+/** Returns the best ever result set under certain settings. It is taken
+ *   from the record index once it's loaded, otherwise the database is
+ *   queried.
  *  \param game_info (input) Settings of the game used.
  *  \param exists (output) Whether the results exist with that config.
  *  \param user (output) Name of user that set the best result.
@@ -1167,6 +1834,16 @@ bool DatabaseConnector::getBestResult(const GameInfo& game_info,
         Log::error("DatabaseConnector", "getBestResult: records table doesn't exist!");
         return false;
     }
+    std::unique_lock<std::mutex> ul(m_record_index_mutex);
+    if (m_record_index_loaded)
+    {
+        auto it = m_record_index.find(getRecordKey(game_info));
+        *exists = it != m_record_index.end();
+        *user = *exists ? it->second.m_username : "";
+        *result = *exists ? it->second.m_result : 0.0;
+        return true;
+    }
+    ul.unlock();
     std::shared_ptr<BinderCollection> coll = std::make_shared<BinderCollection>();
     // Note that IS is important, as the strings corresponding to value/time
     // limits can be NULL instead. SQLite manual specifies that IS can be used
@@ -1186,7 +1863,7 @@ bool DatabaseConnector::getBestResult(const GameInfo& game_info,
         Binder(coll, game_info.m_powerup_string, "powerup string")
     );
     std::vector<std::vector<std::string>> output;
-    if (easySQLQuery(query, &output, coll->getBindFunction()))
+    if (readSQLQuery(query, &output, coll->getBindFunction()))
     {
         if (output.size() >= 1)
         {
@@ -1211,64 +1888,110 @@ bool DatabaseConnector::getBestResult(const GameInfo& game_info,
 }   // getBestResult
 
 //-----------------------------------------------------------------------------
-/** Inserts all the results of a single game. The parameters will be reordered
- *   later.
+/** Inserts all the results of a single game in the database thread, in one
+ *   transaction. Once it's committed, the record index is updated with the
+ *   new results, assuming that the records table includes the results of
+ *   this server. The parameters will be reordered later.
  *  \param game_info (input) Settings of the game used. Includes the results
  *                   themselves.
  */
 void DatabaseConnector::insertManyResults(const GameInfo& game_info)
 {
+    std::vector<std::pair<std::string,
+        std::function<void(sqlite3_stmt* stmt)> > > queries;
+    std::vector<BestRecord> records;
     for (int i = 0; i < (int)game_info.m_player_info.size(); ++i)
     {
         const GameInfo::PlayerInfo& pi = game_info.m_player_info[i];
+        // Same rows as getBestResult() considers
+        if (pi.m_not_full == 0 && pi.m_game_event == 0)
+        {
+            BestRecord record;
+            record.m_username = pi.m_username;
+            // Rounded as it's stored
+            record.m_result = std::round(pi.m_result * 1000000.0) / 1000000.0;
+            records.push_back(record);
+        }
         std::shared_ptr<BinderCollection> coll = std::make_shared<BinderCollection>();
-        // Note that insertValues doesn't care about the exact letter, so we
-        // can use %f for StringUtils::Precision, for example
+        // All values are bound, so that the query is the same for all rows
+        // and its statement is prepared only once. SQLite converts the bound
+        // text to the type of the column.
+        auto integer = [&coll](int value, const char* name)
+            { return Binder(coll, StringUtils::toString(value), name); };
+        auto real = [&coll](double value, int precision, const char* name)
+        {
+            return Binder(coll, StringUtils::toString(
+                StringUtils::Precision(value, precision)), name);
+        };
         std::string query = StringUtils::insertValues(
             "INSERT INTO %s (time, venue, reverse, mode, value_limit, time_limit, "
             "difficulty, config, items, flag_return_timeout, flag_deactivated_time, "
             "username, result, kart, kart_class, kart_color, team, handicap, start_pos, fastest_lap, sog_time, "
             "online_id, country_code, is_autofinish, is_not_full, game_duration, when_joined, when_left, "
             "game_event, other_info) "
-            "VALUES (%s, %s, '%s', '%s', %d, %f, "
-            "%d, %s, %s, %d, %d, " //%s, "
-            "%s, %f, %s, %s, %f, %d, %d, %d, %f, %f, "
-            "%d, '%s', %d, %d, %f, %f, %f, "
-            "%d, %s);",
+            "VALUES (%s, %s, %s, %s, %s, %s, "
+            "%s, %s, %s, %s, %s, "
+            "%s, %s, %s, %s, %s, %s, %s, %s, %s, %s, "
+            "%s, %s, %s, %s, %s, %s, %s, "
+            "%s, %s);",
             m_results_table_name.c_str(),
             Binder(coll, game_info.m_timestamp, "time"),
             Binder(coll, game_info.m_venue, "map name"),
-            game_info.m_reverse.c_str(),
-            game_info.m_mode.c_str(),
-            game_info.m_value_limit,
-            StringUtils::Precision(game_info.m_time_limit, 6),
-            game_info.m_difficulty,
+            Binder(coll, game_info.m_reverse, "reverse"),
+            Binder(coll, game_info.m_mode, "mode"),
+            integer(game_info.m_value_limit, "value limit"),
+            real(game_info.m_time_limit, 6, "time limit"),
+            integer(game_info.m_difficulty, "difficulty"),
             Binder(coll, game_info.m_kart_char_string, "kart char string"),
             Binder(coll, game_info.m_powerup_string, "powerup string"),
-            game_info.m_flag_return_timeout,
-            game_info.m_flag_deactivated_time,
+            integer(game_info.m_flag_return_timeout, "flag return timeout"),
+            integer(game_info.m_flag_deactivated_time, "flag deactivated time"),
             Binder(coll, pi.m_username, "username"),
-            StringUtils::Precision(pi.m_result, 6),
+            real(pi.m_result, 6, "result"),
             Binder(coll, pi.m_kart.c_str(), "kart name"),
             Binder(coll, pi.m_kart_class, "kart class"),
-            StringUtils::Precision(pi.m_kart_color, 2),
-            pi.m_team,
-            pi.m_handicap,
-            pi.m_start_position,
-            StringUtils::Precision(pi.m_fastest_lap, 6),
-            StringUtils::Precision(pi.m_sog_time, 6),
-            pi.m_online_id,
-            pi.m_country_code.c_str(),
-            pi.m_autofinish,
-            pi.m_not_full,
-            StringUtils::Precision(pi.m_game_duration, 6),
-            StringUtils::Precision(pi.m_when_joined, 6),
-            StringUtils::Precision(pi.m_when_left, 6),
-            pi.m_game_event,
+            real(pi.m_kart_color, 2, "kart color"),
+            integer(pi.m_team, "team"),
+            integer(pi.m_handicap, "handicap"),
+            integer(pi.m_start_position, "start position"),
+            real(pi.m_fastest_lap, 6, "fastest lap"),
+            real(pi.m_sog_time, 6, "sog time"),
+            integer(pi.m_online_id, "online id"),
+            Binder(coll, pi.m_country_code, "country code"),
+            integer(pi.m_autofinish, "autofinish"),
+            integer(pi.m_not_full, "not full"),
+            real(pi.m_game_duration, 6, "game duration"),
+            real(pi.m_when_joined, 6, "when joined"),
+            real(pi.m_when_left, 6, "when left"),
+            integer(pi.m_game_event, "game event"),
             Binder(coll, pi.m_other_info, "other info")
         );
-        easySQLQuery(query, nullptr, coll->getBindFunction());
+        queries.emplace_back(query, coll->getBindFunction());
     }
+    RecordKey key = getRecordKey(game_info);
+    queueJob([this, queries]()
+        {
+            bool result = true;
+            for (auto& query : queries)
+                result &= easySQLQuery(query.first, nullptr, query.second);
+            return result;
+        },
+        [this, key, records](bool result)
+        {
+            if (!result || records.empty())
+                return;
+            std::lock_guard<std::mutex> lock(m_record_index_mutex);
+            if (!m_record_index_loaded)
+                return;
+            for (const BestRecord& record : records)
+            {
+                auto it = m_record_index.find(key);
+                if (it == m_record_index.end())
+                    m_record_index[key] = record;
+                else if (record.m_result < it->second.m_result)
+                    it->second = record;
+            }
+        });
 }   // insertManyResults
 
 //-----------------------------------------------------------------------------
@@ -21,15 +21,24 @@
 #ifndef DATABASE_CONNECTOR_HPP
 #define DATABASE_CONNECTOR_HPP
 
+#include "utils/interval_index.hpp"
 #include "utils/string_utils.hpp"
 #include "utils/time.hpp"
 #include "utils/lobby_context.hpp"
 
+#include <condition_variable>
+#include <deque>
 #include <functional>
 #include <iostream>
+#include <list>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <sqlite3.h>
 #include <string>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
 #include <vector>
 
 struct GameInfo;
@@ -105,11 +114,48 @@ std::ostream& operator << (std::ostream& os, const Binder& binder);
  *   The SQL queries are intended to be placed only within the implementation
  *   of this class, while the logic corresponding to those queries should not
  *   belong here.
+ *
+ *  Queries whose result is not needed immediately (all writes, and polling of
+ *   ban tables) are queued and executed in a separate database thread, with
+ *   all jobs queued at the same time grouped into one transaction. Results
+ *   are given back through callbacks, which are called in the lobby thread
+ *   by handleCallbacks(). Prepared statements are kept in a small cache so
+ *   that repeated queries are not compiled again.
+ *
+ *  The IP ban tables and the geolocation tables are also copied into
+ *   in-memory interval indices by the database thread (ban tables on every
+ *   poll, geolocation tables every hour), so that the checks done for each
+ *   connecting peer don't need to query the database.
+ *
+ *  Likewise, the best result of the records table for each game setting is
+ *   kept in memory (reloaded every 10 minutes, to see the results which
+ *   other servers or the owner add), so that getBestResult() doesn't have
+ *   to search the records at the end of each game.
  */
 class DatabaseConnector: public LobbyContextComponent
 {
+public:
+    /** A job for the database thread, returning if it succeeded. */
+    typedef std::function<bool()> Job;
+
+    /** Called in the lobby thread with the result of a job. */
+    typedef std::function<void(bool)> JobCallback;
+
 private:
+    /** Maximum number of statements kept prepared. */
+    static const unsigned STATEMENT_CACHE_SIZE = 64;
+
+    /** Maximum number of jobs waiting for the database thread. Adding more
+     *  jobs blocks until the thread catches up, as dropping writes (like
+     *  game results) is worse than waiting. */
+    static const unsigned MAX_PENDING_JOBS = 1024;
+
     sqlite3* m_db;
+
+    /** Read-only connection for lookups done in the lobby thread, or NULL
+     *  if it cannot be opened (then \ref m_db is used). */
+    sqlite3* m_read_db;
+
     std::string m_server_stats_table;
     std::string m_results_table_name;
     bool m_ip_ban_table_exists;
@@ -121,8 +167,54 @@ private:
     bool m_records_table_exists;
     uint64_t m_last_poll_db_time;
 
+    /** Prepared statements with their queries, most recently used first. */
+    mutable std::list<std::pair<std::string, sqlite3_stmt*> > m_statements;
+
+    /** Query to position in \ref m_statements. */
+    mutable std::unordered_map<std::string,
+        std::list<std::pair<std::string, sqlite3_stmt*> >::iterator>
+        m_statement_index;
+
+    /** Protects the statement cache. Also held while a statement is used,
+     *  as statements can be used by both lobby and database threads. */
+    mutable std::mutex m_statements_mutex;
+
+    std::thread m_db_thread;
+
+    /** Jobs waiting for the database thread. */
+    std::deque<std::pair<Job, JobCallback> > m_jobs;
+
+    /** Protects \ref m_jobs and \ref m_stop_db_thread. */
+    std::mutex m_jobs_mutex;
+
+    /** Notified when a job is added or the thread has to stop. */
+    std::condition_variable m_jobs_added;
+
+    /** Notified when the database thread takes jobs from the queue. */
+    std::condition_variable m_jobs_taken;
+
+    bool m_stop_db_thread;
+
+    /** Callbacks of finished jobs to be called in the lobby thread. */
+    std::vector<std::function<void()> > m_callbacks;
+
+    std::mutex m_callbacks_mutex;
+
+    sqlite3_stmt* getStatement(const std::string& query) const;
+    void clearStatements();
+    static void setupConnection(sqlite3* db);
+    bool readSQLQuery(const std::string& query,
+                      std::vector<std::vector<std::string>>* output,
+      std::function<void(sqlite3_stmt* stmt)> bind_function = nullptr) const;
+    void databaseThread();
+    void stopDatabaseThread();
+
 public:
-    DatabaseConnector(LobbyContext* context): LobbyContextComponent(context) {}
+    DatabaseConnector(LobbyContext* context): LobbyContextComponent(context),
+                        m_db(nullptr), m_read_db(nullptr),
+                        m_stop_db_thread(false) {}
+
+    ~DatabaseConnector();
 
     void setupContextUser() OVERRIDE;
 
@@ -157,6 +249,105 @@ public:
         std::string timestamp;
         std::string message;
     };
+
+private:
+    /** An IPv6 address as a 128-bit number (upper and lower half). */
+    typedef std::pair<uint64_t, uint64_t> IPv6Key;
+
+    /** A row of a ban table, with the time when it starts and expires in
+     *  seconds since epoch (-1 if it never expires). */
+    template<typename Data>
+    struct IndexedBan
+    {
+        Data m_data;
+        int64_t m_starting_time;
+        int64_t m_expiration_time;
+
+        bool isActive(int64_t now) const
+        {
+            return now > m_starting_time &&
+                (m_expiration_time == -1 || m_expiration_time > now);
+        }
+    };
+
+    /** Bans of IPv4 and IPv6 ban tables which are not expired. */
+    struct BanIndex
+    {
+        IntervalIndex<uint32_t, IndexedBan<IpBanTableData> > m_ip;
+        IntervalIndex<IPv6Key, IndexedBan<Ipv6BanTableData> > m_ipv6;
+    };
+
+    /** Geolocation tables, the values are indices in m_country_codes. */
+    struct GeoIndex
+    {
+        std::vector<std::string> m_country_codes;
+        IntervalIndex<uint32_t, uint16_t> m_ip;
+        IntervalIndex<int64_t, uint16_t> m_ipv6;
+    };
+
+    /** The current ban index, NULL until it's loaded. It's replaced as a
+     *  whole (with std::atomic_store), so the lobby thread can use it while
+     *  the database thread builds a new one. */
+    std::shared_ptr<const BanIndex> m_ban_index;
+
+    /** The current geolocation index, NULL until it's loaded. */
+    std::shared_ptr<const GeoIndex> m_geo_index;
+
+    /** When the geolocation index was loaded, only used in the database
+     *  thread. */
+    uint64_t m_geo_index_time;
+
+    /** Settings of a game which the best result is kept for, i.e. the
+     *  columns getBestResult() filters on. The time limit is rounded to
+     *  microseconds, as results are stored with 6 digits after the point. */
+    struct RecordKey
+    {
+        std::string m_venue;
+        std::string m_reverse;
+        std::string m_mode;
+        int64_t m_value_limit;
+        int64_t m_time_limit;
+        std::string m_config;
+        std::string m_items;
+
+        bool operator<(const RecordKey& other) const
+        {
+            return std::tie(m_venue, m_reverse, m_mode, m_value_limit,
+                m_time_limit, m_config, m_items) < std::tie(other.m_venue,
+                other.m_reverse, other.m_mode, other.m_value_limit,
+                other.m_time_limit, other.m_config, other.m_items);
+        }
+    };
+
+    /** The best result for some settings, earlier results win ties. */
+    struct BestRecord
+    {
+        std::string m_username;
+        double m_result;
+    };
+
+    /** Best results of the records table, loaded by the database thread and
+     *  updated by the lobby thread when results are inserted. */
+    std::map<RecordKey, BestRecord> m_record_index;
+
+    /** False until \ref m_record_index is loaded, getBestResult() queries
+     *  the database until then. */
+    bool m_record_index_loaded;
+
+    /** Protects \ref m_record_index and \ref m_record_index_loaded. */
+    std::mutex m_record_index_mutex;
+
+    /** When the record index was loaded, only used in the database thread. */
+    uint64_t m_record_index_time;
+
+    bool forEachRow(const std::string& query,
+                    std::function<void(sqlite3_stmt* stmt)> row_function) const;
+    void loadBanIndex();
+    void loadGeoIndex();
+    void loadRecordIndex();
+    static RecordKey getRecordKey(const GameInfo& game_info);
+
+public:
     void initDatabase();
     void destroyDatabase();
 
@@ -167,6 +358,14 @@ public:
 
     void checkTableExists(const std::string& table, bool& result, bool allow_views = false);
 
+    void queueJob(Job job, JobCallback callback = nullptr);
+
+    void queueQuery(const std::string& query,
+               std::function<void(sqlite3_stmt* stmt)> bind_function = nullptr,
+                    JobCallback callback = nullptr);
+
+    void handleCallbacks();
+
     std::string ip2Country(const SocketAddress& addr) const;
 
     std::string ipv62Country(const SocketAddress& addr) const;
@@ -177,10 +376,10 @@ public:
                                                          sqlite3_value** argv);
     void writeDisconnectInfoTable(std::shared_ptr<STKPeer> peer);
     void initServerStatsTable();
-    bool writeReport(
+    void writeReport(
          std::shared_ptr<STKPeer> reporter, std::shared_ptr<NetworkPlayerProfile> reporter_npp,
        std::shared_ptr<STKPeer> reporting, std::shared_ptr<NetworkPlayerProfile> reporting_npp,
-                                                     irr::core::stringw& info);
+                           irr::core::stringw& info, JobCallback callback);
     bool hasDatabase() const                        { return m_db != nullptr; }
     bool hasServerStatsTable() const  { return !m_server_stats_table.empty(); }
     bool hasPlayerReportsTable() const
@@ -194,9 +393,13 @@ public:
     std::vector<IpBanTableData> getIpBanTableData(uint32_t ip = 0) const;
     std::vector<Ipv6BanTableData> getIpv6BanTableData(std::string ipv6 = "") const;
     std::vector<OnlineIdBanTableData> getOnlineIdBanTableData(uint32_t online_id = 0) const;
-    void increaseIpBanTriggerCount(uint32_t ip_start, uint32_t ip_end) const;
-    void increaseIpv6BanTriggerCount(const std::string& ipv6_cidr) const;
-    void increaseOnlineIdBanTriggerCount(uint32_t online_id) const;
+    void pollBanTables(std::function<void(
+        const std::vector<IpBanTableData>&,
+        const std::vector<Ipv6BanTableData>&,
+        const std::vector<OnlineIdBanTableData>&)> callback);
+    void increaseIpBanTriggerCount(uint32_t ip_start, uint32_t ip_end);
+    void increaseIpv6BanTriggerCount(const std::string& ipv6_cidr);
+    void increaseOnlineIdBanTriggerCount(uint32_t online_id);
     void clearOldReports();
     void setDisconnectionTimes(std::vector<uint32_t>& present_hosts);
     void saveAddressToIpBanTable(const SocketAddress& addr);
@@ -205,7 +408,7 @@ public:
     void listBanTable();
 
     std::vector<ServerMessage> getServerMessages(uint32_t online_id) const;
-    void deleteServerMessage(int row_id) const;
+    void deleteServerMessage(int row_id);
     bool getBestResult(const GameInfo& game_info, bool* exists, std::string* user, double* result);
     void insertManyResults(const GameInfo& game_info);
 };
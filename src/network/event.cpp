@@ -19,12 +19,96 @@
 #include "network/event.hpp"
 
 #include "network/crypto.hpp"
+#include "network/packet_compressor.hpp"
 #include "network/protocols/client_lobby.hpp"
 #include "network/stk_peer.hpp"
 #include "utils/log.hpp"
 #include "utils/time.hpp"
 
+#include <cassert>
+#include <mutex>
 #include <string.h>
+#include <vector>
+
+namespace
+{
+    /** Memory of deleted events and the strings of their messages (with
+     *  their buffers), reused so that receiving doesn't allocate memory at
+     *  steady state. It is never freed, since events may still be deleted
+     *  when static objects are destroyed. */
+    struct EventPool
+    {
+        std::mutex m_mutex;
+        std::vector<void*> m_events;
+        std::vector<NetworkString*> m_strings;
+    };
+    EventPool* g_event_pool = new EventPool();
+
+    /** Maximum number of events and strings kept. */
+    const size_t MAX_POOLED = 1024;
+
+    /** Strings with a larger buffer (e.g. from a file transfer) are freed
+     *  instead of being kept. */
+    const size_t MAX_POOLED_CAPACITY = 16 * 1024;
+
+    // ------------------------------------------------------------------------
+    NetworkString* acquireString()
+    {
+        std::lock_guard<std::mutex> lock(g_event_pool->m_mutex);
+        if (g_event_pool->m_strings.empty())
+            return new NetworkString(PROTOCOL_NONE);
+        NetworkString* ns = g_event_pool->m_strings.back();
+        g_event_pool->m_strings.pop_back();
+        return ns;
+    }   // acquireString
+
+    // ------------------------------------------------------------------------
+    void releaseString(NetworkString* ns)
+    {
+        if (ns->getBuffer().capacity() <= MAX_POOLED_CAPACITY)
+        {
+            std::lock_guard<std::mutex> lock(g_event_pool->m_mutex);
+            if (g_event_pool->m_strings.size() < MAX_POOLED)
+            {
+                g_event_pool->m_strings.push_back(ns);
+                return;
+            }
+        }
+        delete ns;
+    }   // releaseString
+}   // anonymous namespace
+
+// ----------------------------------------------------------------------------
+void* Event::operator new(size_t size)
+{
+    assert(size == sizeof(Event));
+    {
+        std::lock_guard<std::mutex> lock(g_event_pool->m_mutex);
+        if (!g_event_pool->m_events.empty())
+        {
+            void* ptr = g_event_pool->m_events.back();
+            g_event_pool->m_events.pop_back();
+            return ptr;
+        }
+    }
+    return ::operator new(size);
+}   // operator new
+
+// ----------------------------------------------------------------------------
+void Event::operator delete(void* ptr)
+{
+    if (!ptr)
+        return;
+    {
+        std::lock_guard<std::mutex> lock(g_event_pool->m_mutex);
+        if (g_event_pool->m_events.size() < MAX_POOLED)
+        {
+            g_event_pool->m_events.push_back(ptr);
+            return;
+        }
+    }
+    ::operator delete(ptr);
+}   // operator delete
 
 /** \brief Constructor
  *  \param event : The event that needs to be translated.
@@ -42,7 +126,9 @@ constexpr bool isConnectionRequestPacket(unsigned char* data, size_t length)
 Event::Event(ENetEvent* event, std::shared_ptr<STKPeer> peer)
 {
     m_arrival_time = StkTime::getMonoTimeMs();
+    m_receive_time = std::chrono::steady_clock::now();
     m_pdi = PDI_TIMEOUT;
+    m_data = NULL;
     m_peer = peer;
 
     switch (event->type)
@@ -75,16 +161,31 @@ Event::Event(ENetEvent* event, std::shared_ptr<STKPeer> peer)
         {
             throw std::runtime_error("Unencrypted content at wrong state.");
         }
+        m_data = acquireString();
         if (m_peer->getCrypto() && (event->channelID == EVENT_CHANNEL_NORMAL ||
             event->channelID == EVENT_CHANNEL_DATA_TRANSFER))
         {
-            m_data = m_peer->getCrypto()->decryptRecieve(event->packet);
+            try
+            {
+                m_peer->getCrypto()->decryptRecieve(event->packet, m_data);
+            }
+            catch (std::exception&)
+            {
+                releaseString(m_data);
+                throw;
+            }
         }
         else
         {
-            m_data = new NetworkString(event->packet->data, 
+            m_data->assign(event->packet->data,
                 (int)event->packet->dataLength);
         }
+        if (PacketCompressor::isCompressed(*m_data) &&
+            !PacketCompressor::decompress(m_data))
+        {
+            releaseString(m_data);
+            throw std::runtime_error("Invalid compressed packet.");
+        }
     }
     else
         m_data = NULL;
@@ -102,6 +203,7 @@ Event::Event(ENetEvent* event, std::shared_ptr<STKPeer> peer)
  */
 Event::~Event()
 {
-    delete m_data;
+    if (m_data)
+        releaseString(m_data);
 }   // ~Event
 
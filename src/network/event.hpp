@@ -30,6 +30,7 @@
 
 #include "enet/enet.h"
 
+#include <chrono>
 #include <memory>
 
 class STKPeer;
@@ -86,12 +87,20 @@ private:
     /** Arrivial time of the event, for timeouts. */
     uint64_t m_arrival_time;
 
+    /** Precise arrival time of the event, for latency statistics. */
+    std::chrono::steady_clock::time_point m_receive_time;
+
     /** For disconnection event, a bit more info is provided. */
     PeerDisconnectInfo m_pdi;
 
 public:
          Event(ENetEvent* event, std::shared_ptr<STKPeer> peer);
         ~Event();
+    // ------------------------------------------------------------------------
+    /** Events are allocated from a pool, see event.cpp. */
+    static void* operator new(size_t size);
+    // ------------------------------------------------------------------------
+    static void operator delete(void* ptr);
 
     // ------------------------------------------------------------------------
     /** Returns the type of this event. */
@@ -125,6 +134,10 @@ public:
     /** Returns the arrival time of this event. */
     uint64_t getArrivalTime() const { return m_arrival_time; }
     // ------------------------------------------------------------------------
+    /** Returns the precise arrival time of this event. */
+    const std::chrono::steady_clock::time_point& getReceiveTime() const
+                                                    { return m_receive_time; }
+    // ------------------------------------------------------------------------
     PeerDisconnectInfo getPeerDisconnectInfo() const { return m_pdi; }
     // ------------------------------------------------------------------------
 
@@ -47,6 +47,12 @@ GameSetup::GameSetup()
     const std::string& server_name = ServerConfig::m_server_name;
     m_server_name_utf8 = StringUtils::wideToUtf8
         (StringUtils::xmlDecode(server_name));
+    // Tell apart the lobbies of a multi-lobby server in the server list
+    if (STKProcess::getLobbyNumber() > 1)
+    {
+        m_server_name_utf8 += " #" +
+            StringUtils::toString(STKProcess::getLobbyNumber());
+    }
     m_extra_server_info = -1;
     m_extra_seconds = 0.0f;
     m_is_grand_prix.store(false);
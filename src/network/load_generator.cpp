@@ -0,0 +1,623 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2026 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "network/load_generator.hpp"
+
+#include "config/stk_config.hpp"
+#include "karts/controller/network_ai_controller.hpp"
+#include "network/event.hpp"
+#include "network/network.hpp"
+#include "network/network_player_profile.hpp"
+#include "network/network_string.hpp"
+#include "network/packet_compressor.hpp"
+#include "network/packet_types.hpp"
+#include "network/peer_vote.hpp"
+#include "network/protocol_manager.hpp"
+#include "network/protocols/client_lobby.hpp"
+#include "network/protocols/game_protocol.hpp"
+#include "network/remote_kart_info.hpp"
+#include "network/server_config.hpp"
+#include "network/socket_address.hpp"
+#include "network/stk_host.hpp"
+#include "network/stk_peer.hpp"
+#include "utils/log.hpp"
+#include "utils/string_utils.hpp"
+#include "utils/time.hpp"
+#include "utils/vs.hpp"
+#include "main_loop.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+LoadGenerator* LoadGenerator::m_load_generator = NULL;
+std::mutex LoadGenerator::m_calls_mutex;
+
+// ----------------------------------------------------------------------------
+/** Starts the simulated clients.
+ *  \param count Number of clients.
+ *  \param port Port of the server on this machine.
+ */
+void LoadGenerator::create(unsigned count, uint16_t port)
+{
+    assert(!m_load_generator);
+    m_load_generator = new LoadGenerator(count, port);
+}   // create
+
+// ----------------------------------------------------------------------------
+/** Disconnects the clients and logs the last report. */
+void LoadGenerator::destroy()
+{
+    LoadGenerator* load_generator;
+    {
+        std::lock_guard<std::mutex> lock(m_calls_mutex);
+        load_generator = m_load_generator;
+        m_load_generator = NULL;
+    }
+    delete load_generator;
+}   // destroy
+
+// ----------------------------------------------------------------------------
+/** Runs the calls posted by the clients, called in the protocol thread by
+ *  the server lobby.
+ */
+void LoadGenerator::handleCalls()
+{
+    std::lock_guard<std::mutex> lock(m_calls_mutex);
+    if (!m_load_generator)
+        return;
+    std::vector<std::function<void()> > calls;
+    std::swap(calls, m_load_generator->m_calls);
+    for (auto& call : calls)
+        call();
+}   // handleCalls
+
+// ----------------------------------------------------------------------------
+/** Makes the protocol thread run a function, which usually gives its result
+ *  back with postReply().
+ */
+void LoadGenerator::postCall(std::function<void()> call)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_calls_mutex);
+        m_calls.push_back(call);
+    }
+    auto pm = ProtocolManager::lock();
+    if (pm)
+        pm->wakeUpAsynchronousUpdate();
+}   // postCall
+
+// ----------------------------------------------------------------------------
+/** Makes the thread of the clients run a function with the result of a
+ *  posted call.
+ */
+void LoadGenerator::postReply(std::function<void()> result)
+{
+    std::lock_guard<std::mutex> lock(m_replies_mutex);
+    m_replies.push_back(result);
+}   // postReply
+
+// ----------------------------------------------------------------------------
+void LoadGenerator::handleReplies()
+{
+    std::vector<std::function<void()> > replies;
+    {
+        std::lock_guard<std::mutex> lock(m_replies_mutex);
+        std::swap(replies, m_replies);
+    }
+    for (auto& result : replies)
+        result();
+}   // handleReplies
+
+// ----------------------------------------------------------------------------
+LoadGenerator::LoadGenerator(unsigned count, uint16_t port)
+{
+    m_clients.resize(count);
+    m_port = port;
+    m_abort = false;
+    m_actions_sent = 0;
+    m_actions_lost = 0;
+    Log::info("LoadGenerator", "Connecting %d simulated clients to port %d.",
+        count, port);
+    m_thread = std::thread(&LoadGenerator::run, this);
+}   // LoadGenerator
+
+// ----------------------------------------------------------------------------
+LoadGenerator::~LoadGenerator()
+{
+    m_abort = true;
+    if (m_thread.joinable())
+        m_thread.join();
+}   // ~LoadGenerator
+
+// ----------------------------------------------------------------------------
+/** The thread of all clients, which polls their sockets every millisecond.
+ */
+void LoadGenerator::run()
+{
+    VS::setThreadName("LoadGenerator");
+    for (Client& c : m_clients)
+        connect(&c);
+    m_last_report = std::chrono::steady_clock::now();
+
+    while (!m_abort)
+    {
+        handleReplies();
+        for (Client& c : m_clients)
+            update(&c);
+        if (std::chrono::steady_clock::now() - m_last_report >=
+            std::chrono::seconds(10))
+            report();
+        StkTime::sleep(1);
+    }
+    report();
+
+    for (Client& c : m_clients)
+    {
+        if (c.m_server)
+            enet_peer_disconnect_now(c.m_server, PDI_NORMAL);
+        delete c.m_network;
+    }
+}   // run
+
+// ----------------------------------------------------------------------------
+void LoadGenerator::connect(Client* c)
+{
+    ENetAddress any = {};
+    c->m_network = new Network(/*peer_count*/1,
+        /*channel_limit*/EVENT_CHANNEL_COUNT, /*max_in_bandwidth*/0,
+        /*max_out_bandwidth*/0, &any);
+    c->m_server = c->m_network->connectTo(
+        SocketAddress(127, 0, 0, 1, m_port).toENetAddress());
+    c->m_state = c->m_server ? LG_CONNECTING : LG_DISCONNECTED;
+    c->m_host_id = 0;
+    c->m_kart_id = -1;
+    c->m_timer_offset = 0;
+    c->m_start_time = 0;
+    c->m_sequence = 0;
+    c->m_states = 0;
+    c->m_late_actions = 0;
+}   // connect
+
+// ----------------------------------------------------------------------------
+/** Handles all packets received by a client, and sends its controller
+ *  actions when they are due.
+ */
+void LoadGenerator::update(Client* c)
+{
+    if (c->m_state == LG_DISCONNECTED)
+        return;
+
+    ENetEvent event;
+    while (enet_host_service(c->m_network->getENetHost(), &event, 0) > 0)
+    {
+        if (event.type == ENET_EVENT_TYPE_CONNECT)
+        {
+            c->m_state = LG_REQUESTING_CONNECTION;
+            const size_t index = c - m_clients.data();
+            postCall([this, index]()
+                {
+                    auto request =
+                        std::make_shared<NetworkString>(PROTOCOL_LOBBY_ROOM);
+                    // Delta states cannot be used without decoding the
+                    // states
+                    std::set<std::string> caps =
+                        STKConfig::get()->m_network_capabilities;
+                    caps.erase("state_delta");
+                    ClientLobby::encodeConnectionRequest(request.get(),
+                        "LoadGenerator", caps);
+                    postReply([this, index, request]()
+                        {
+                            Client* c = &m_clients[index];
+                            if (c->m_state != LG_REQUESTING_CONNECTION)
+                                return;
+                            // One player without online account, like a
+                            // network AI instance connecting to a LAN server
+                            const irr::core::stringw name =
+                                irr::core::stringw("Load ") +
+                                StringUtils::toWString(index + 1);
+                            request->addUInt8(1).addUInt32(0).addUInt32(0)
+                                .encodeString(
+                                ServerConfig::m_private_server_password)
+                                .addUInt8(1).encodeString(name)
+                                .addFloat(0.0f).addUInt8(HANDICAP_NONE);
+                            send(c, *request, /*reliable*/true);
+                        });
+                });
+        }
+        else if (event.type == ENET_EVENT_TYPE_DISCONNECT)
+        {
+            Log::warn("LoadGenerator", "Client %d was disconnected.",
+                (int)(c - m_clients.data() + 1));
+            c->m_state = LG_DISCONNECTED;
+            c->m_server = NULL;
+            return;
+        }
+        else if (event.type == ENET_EVENT_TYPE_RECEIVE)
+        {
+            NetworkString data(event.packet->data,
+                (int)event.packet->dataLength);
+            enet_packet_destroy(event.packet);
+            if (PacketCompressor::isCompressed(data) &&
+                !PacketCompressor::decompress(&data))
+            {
+                Log::warn("LoadGenerator", "Invalid compressed message.");
+                continue;
+            }
+            try
+            {
+                handleMessage(c, data);
+            }
+            catch (std::exception& e)
+            {
+                Log::warn("LoadGenerator", "Invalid message: %s", e.what());
+            }
+        }
+    }
+
+    if (c->m_state == LG_RACING)
+        updateActions(c, getTicks(*c));
+}   // update
+
+// ----------------------------------------------------------------------------
+void LoadGenerator::handleMessage(Client* c, NetworkString& data)
+{
+    const std::vector<uint8_t>& buffer = data.getBuffer();
+    // Ping packets of STKHost, only the network timer is used
+    if (buffer.size() > 13 && buffer[0] == 255 &&
+        memcmp(buffer.data() + 1, "ping", 4) == 0)
+    {
+        data.skip(4);
+        const uint64_t server_time = data.getUInt64();
+        c->m_timer_offset = (int64_t)server_time +
+            c->m_server->roundTripTime / 2 - (int64_t)StkTime::getMonoTimeMs();
+        return;
+    }
+    if (data.size() == 0)
+        return;
+    if (data.getProtocolType() == PROTOCOL_LOBBY_ROOM)
+        handleLobbyMessage(c, data);
+    else if (data.getProtocolType() == PROTOCOL_CONTROLLER_EVENTS)
+        handleGameMessage(c, data);
+}   // handleMessage
+
+// ----------------------------------------------------------------------------
+/** Answers the lobby messages like an auto-connecting client, which
+ *  starts the game and uses a random kart.
+ */
+void LoadGenerator::handleLobbyMessage(Client* c, NetworkString& data)
+{
+    NetworkString reply(PROTOCOL_LOBBY_ROOM);
+    switch (data.getUInt8())
+    {
+    case LE_CONNECTION_ACCEPTED:
+        c->m_host_id = data.getUInt32();
+        c->m_state = LG_LOBBY;
+        reply.addUInt8(LE_REQUEST_BEGIN);
+        send(c, reply, /*reliable*/true);
+        break;
+    case LE_CONNECTION_REFUSED:
+        Log::warn("LoadGenerator", "Client %d was refused with reason %d.",
+            (int)(c - m_clients.data() + 1), data.getUInt8());
+        enet_peer_disconnect(c->m_server, PDI_NORMAL);
+        break;
+    case LE_START_SELECTION:
+    {
+        data.getFloat();
+        data.getUInt8();
+        data.getUInt8();
+        const bool track_voting = data.getUInt8() == 1;
+        const unsigned kart_num = data.getUInt16();
+        const unsigned track_num = data.getUInt16();
+        std::string name;
+        for (unsigned i = 0; i < kart_num; i++)
+            data.decodeString(&name);
+        std::vector<std::string> tracks(track_num);
+        for (unsigned i = 0; i < track_num; i++)
+            data.decodeString(&tracks[i]);
+
+        // The server replaces an unknown kart with a random one
+        reply.addUInt8(LE_KART_SELECTION).addUInt8(1)
+            .encodeString(std::string("randomkart"));
+        send(c, reply, /*reliable*/true);
+        if (track_voting && !tracks.empty())
+        {
+            NetworkString vote(PROTOCOL_LOBBY_ROOM);
+            vote.addUInt8(LE_VOTE);
+            PeerVote(L"", tracks[rand() % tracks.size()], 1, false)
+                .encode(&vote);
+            send(c, vote, /*reliable*/true);
+        }
+        break;
+    }
+    case LE_LOAD_WORLD:
+    {
+        data.getUInt32();
+        PeerVote winner_vote(data);
+        data.getUInt8();
+        // The kart id is set when the players are decoded, no actions are
+        // sent until then
+        c->m_kart_id = -1;
+        const size_t index = c - m_clients.data();
+        const uint32_t host_id = c->m_host_id;
+        auto players_data = std::make_shared<NetworkString>(data);
+        postCall([this, index, host_id, players_data]()
+            {
+                auto players = ClientLobby::decodePlayers(*players_data);
+                int kart_id = -1;
+                for (unsigned i = 0; i < players.size(); i++)
+                {
+                    if (players[i]->getHostId() == host_id)
+                    {
+                        kart_id = i;
+                        break;
+                    }
+                }
+                postReply([this, index, kart_id]()
+                    {
+                        Client* c = &m_clients[index];
+                        if (c->m_state == LG_LOADING ||
+                            c->m_state == LG_RACING)
+                            c->m_kart_id = kart_id;
+                    });
+            });
+        c->m_state = LG_LOADING;
+        reply.addUInt8(LE_CLIENT_LOADED_WORLD);
+        send(c, reply, /*reliable*/true);
+        break;
+    }
+    case LE_START_RACE:
+        c->m_start_time = data.getUInt64();
+        c->m_state = LG_RACING;
+        c->m_next_action_ticks = 0;
+        c->m_num_updates = 0;
+        memset(c->m_values, 0, sizeof(c->m_values));
+        c->m_steer_l = 0;
+        c->m_steer_r = 0;
+        break;
+    case LE_RACE_FINISHED:
+        c->m_state = LG_LOBBY;
+        reply.setSynchronous(true);
+        reply.addUInt8(LE_RACE_FINISHED_ACK);
+        send(c, reply, /*reliable*/true);
+        break;
+    case LE_BACK_LOBBY:
+        c->m_state = LG_LOBBY;
+        reply.addUInt8(LE_REQUEST_BEGIN);
+        send(c, reply, /*reliable*/true);
+        break;
+    default:
+        break;
+    }
+}   // handleLobbyMessage
+
+// ----------------------------------------------------------------------------
+/** Measures when controller actions of other clients arrive, and confirms
+ *  item events of states like real clients.
+ */
+void LoadGenerator::handleGameMessage(Client* c, NetworkString& data)
+{
+    const uint8_t type = data.getUInt8();
+    if (type == GameProtocol::GP_CONTROLLER_ACTION)
+    {
+        std::vector<GameProtocol::Action> actions;
+        GameProtocol::decodeActions(data, &actions);
+        const int ticks = getTicks(*c);
+        for (const GameProtocol::Action& a : actions)
+        {
+            // A real client rewinds for actions in its past
+            if (a.m_ticks < ticks)
+                c->m_late_actions++;
+            if (a.m_action != PA_STEER_LEFT && a.m_action != PA_STEER_RIGHT)
+                continue;
+            // Only the first client receiving a message measures it
+            auto it = m_pending_echoes.find(std::make_pair(a.m_kart_id,
+                std::abs(a.m_value) & SEQUENCE_MASK));
+            if (it != m_pending_echoes.end())
+            {
+                m_echo_latency.addSince(it->second);
+                m_pending_echoes.erase(it);
+            }
+        }
+    }
+    else if (type == GameProtocol::GP_STATE ||
+        type == GameProtocol::GP_STATE_DELTA)
+    {
+        // A real client rewinds to each state received
+        c->m_states++;
+        const uint32_t ticks = data.getUInt32();
+        NetworkString confirmation(PROTOCOL_CONTROLLER_EVENTS);
+        confirmation.addUInt8(GameProtocol::GP_ITEM_CONFIRMATION)
+            .addUInt32(ticks);
+        send(c, confirmation, /*reliable*/false);
+    }
+}   // handleGameMessage
+
+// ----------------------------------------------------------------------------
+/** Sends the changed controls of a client every NetworkAIController update.
+ *  The controls follow a fixed pattern of steering with accelerating,
+ *  drifting, nitro and firing, which sends about as many actions as an AI.
+ *  \param ticks Current world ticks of the client.
+ */
+void LoadGenerator::updateActions(Client* c, int ticks)
+{
+    if (c->m_kart_id < 0 || ticks < c->m_next_action_ticks)
+        return;
+    c->m_next_action_ticks = ticks + NetworkAIController::getAIFrequency();
+    c->m_num_updates++;
+
+    // The low bits of the steering are the sequence number of the message,
+    // so its echo is found even if the server changes its ticks
+    c->m_sequence = (c->m_sequence + 1) & SEQUENCE_MASK;
+    const float steer = sinf(0.5f * (float)c->m_num_updates +
+        (float)c->m_host_id);
+    const std::pair<PlayerAction, int> controls[] =
+    {
+        { steer < 0.0f ? PA_STEER_LEFT : PA_STEER_RIGHT,
+          (int(fabsf(steer) * 32767) & ~SEQUENCE_MASK) | c->m_sequence },
+        { PA_ACCEL, 32768 },
+        { PA_NITRO, c->m_num_updates % 16 == 0 ? 32768 : 0 },
+        { PA_DRIFT, fabsf(steer) > 0.8f ? 32768 : 0 },
+        { PA_FIRE, c->m_num_updates % 8 == 0 ? 32768 : 0 }
+    };
+    std::vector<GameProtocol::Action> actions;
+    for (const auto& control : controls)
+    {
+        // The steering is always sent for the sequence number
+        if (c->m_values[control.first] == control.second &&
+            &control != &controls[0])
+            continue;
+        c->m_values[control.first] = control.second;
+        if (control.first == PA_STEER_LEFT)
+            c->m_steer_l = control.second;
+        else if (control.first == PA_STEER_RIGHT)
+            c->m_steer_r = -control.second;
+        GameProtocol::Action a;
+        a.m_ticks = ticks;
+        a.m_kart_id = c->m_kart_id;
+        a.m_action = control.first;
+        a.m_value = control.second;
+        a.m_value_l = c->m_steer_l;
+        a.m_value_r = c->m_steer_r;
+        actions.push_back(a);
+    }
+    NetworkString ns(PROTOCOL_CONTROLLER_EVENTS);
+    GameProtocol::encodeActions(&ns, actions);
+    send(c, ns, /*reliable*/true);
+    m_actions_sent += actions.size();
+    // A message with the same sequence number still pending was lost
+    auto result = m_pending_echoes.emplace(std::make_pair(c->m_kart_id,
+        c->m_sequence), std::chrono::steady_clock::now());
+    if (!result.second)
+    {
+        m_actions_lost++;
+        result.first->second = std::chrono::steady_clock::now();
+    }
+}   // updateActions
+
+// ----------------------------------------------------------------------------
+void LoadGenerator::send(Client* c, NetworkString& data, bool reliable)
+{
+    if (!c->m_server)
+        return;
+    ENetPacket* packet = enet_packet_create(data.getData(),
+        data.getTotalSize(), reliable ? ENET_PACKET_FLAG_RELIABLE :
+        (ENET_PACKET_FLAG_UNSEQUENCED | ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT));
+    if (enet_peer_send(c->m_server, EVENT_CHANNEL_NORMAL, packet) < 0)
+        enet_packet_destroy(packet);
+}   // send
+
+// ----------------------------------------------------------------------------
+/** Returns the world ticks of a client, estimated from the network timer of
+ *  the server, or -1 if its race has not started.
+ */
+int LoadGenerator::getTicks(const Client& c) const
+{
+    if (c.m_state != LG_RACING)
+        return -1;
+    const int64_t now = (int64_t)StkTime::getMonoTimeMs() + c.m_timer_offset;
+    if (now < (int64_t)c.m_start_time)
+        return -1;
+    return STKConfig::get()->time2Ticks(
+        (float)(now - (int64_t)c.m_start_time) / 1000.0f);
+}   // getTicks
+
+// ----------------------------------------------------------------------------
+/** Logs the statistics since the last report and resets them. */
+void LoadGenerator::report()
+{
+    const TimePoint now = std::chrono::steady_clock::now();
+    const float seconds =
+        std::chrono::duration<float>(now - m_last_report).count();
+    m_last_report = now;
+    if (seconds <= 0.0f)
+        return;
+
+    // Actions which were not forwarded after a second never will be
+    for (auto it = m_pending_echoes.begin(); it != m_pending_echoes.end();)
+    {
+        if (now - it->second > std::chrono::seconds(1))
+        {
+            m_actions_lost++;
+            it = m_pending_echoes.erase(it);
+        }
+        else
+            it++;
+    }
+
+    unsigned connected = 0, racing = 0;
+    uint64_t received = 0, sent = 0, max_received = 0;
+    uint64_t states = 0, late_actions = 0;
+    uint64_t datagrams = 0, calls = 0;
+    for (Client& c : m_clients)
+    {
+        ENetHost* host = c.m_network->getENetHost();
+        if (c.m_state != LG_CONNECTING && c.m_state != LG_DISCONNECTED)
+            connected++;
+        if (c.m_state == LG_RACING)
+            racing++;
+        received += host->totalReceivedData;
+        sent += host->totalSentData;
+        max_received = std::max(max_received,
+            (uint64_t)host->totalReceivedData);
+        datagrams += host->totalSentPackets + host->totalReceivedPackets;
+        calls += host->totalSendCalls + host->totalReceiveCalls;
+        host->totalReceivedData = 0;
+        host->totalSentData = 0;
+        host->totalSentPackets = 0;
+        host->totalReceivedPackets = 0;
+        host->totalSendCalls = 0;
+        host->totalReceiveCalls = 0;
+        states += c.m_states;
+        late_actions += c.m_late_actions;
+        c.m_states = 0;
+        c.m_late_actions = 0;
+    }
+    const float per_client = seconds * (float)std::max(connected, 1u);
+    Log::info("LoadGenerator", "%d clients connected, %d racing. Per client: "
+        "received %.1f bytes/s (max %.1f), sent %.1f bytes/s, %.1f rewinds/s "
+        "(%.1f states, %.1f late actions).", connected, racing,
+        received / per_client, max_received / seconds, sent / per_client,
+        (states + late_actions) / per_client, states / per_client,
+        late_actions / per_client);
+    Log::info("LoadGenerator", "Clients sent and received %.1f datagrams/s "
+        "with %.1f system calls/s.", datagrams / seconds, calls / seconds);
+    if (STKHost::existHost())
+    {
+        // Sampled each second by the listening thread of the server
+        unsigned sent, send_calls, received, receive_calls;
+        STKHost::get()->getDatagramStats(&sent, &send_calls, &received,
+            &receive_calls);
+        Log::info("LoadGenerator", "Server sent %u datagrams/s with %u "
+            "calls, received %u datagrams/s with %u calls.", sent,
+            send_calls, received, receive_calls);
+    }
+    Log::info("LoadGenerator", "%lu controller actions sent, %lu messages "
+        "not forwarded, forwarded after: %s.", (unsigned long)m_actions_sent,
+        (unsigned long)m_actions_lost, m_echo_latency.toString().c_str());
+    if (main_loop)
+    {
+        Log::info("LoadGenerator", "Server physics steps took: %s.",
+            main_loop->getServerStepTime().toString().c_str());
+    }
+    m_actions_sent = 0;
+    m_actions_lost = 0;
+    m_echo_latency.reset();
+}   // report
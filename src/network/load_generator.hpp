@@ -0,0 +1,165 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2026 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_LOAD_GENERATOR_HPP
+#define HEADER_LOAD_GENERATOR_HPP
+
+#include "input/input.hpp"
+#include "utils/loop_stats.hpp"
+#include "utils/no_copy.hpp"
+#include "utils/types.hpp"
+
+#include <enet/enet.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+class Network;
+class NetworkString;
+
+/** \brief Simulated clients to measure the capacity of a server.
+ *  Started with --load-test=n by a dedicated server, it connects n clients
+ *  to the server from one thread of the same process. The clients only
+ *  speak the network protocol (using the encoding of ClientLobby and
+ *  GameProtocol) without loading any world: they join the lobby, start
+ *  and vote like auto-connecting clients, and send controller actions with
+ *  the frequency of NetworkAIController during races. It regularly logs
+ *  the time of the server physics steps, the bandwidth per peer, the
+ *  number of rewinds real clients would do, how long the server needs to
+ *  forward controller actions to the other clients, and the datagrams sent
+ *  and received per system call.
+ *  The helpers of ClientLobby are only called in the protocol thread: the
+ *  clients post them with postCall(), the server lobby runs them in
+ *  handleCalls(), and their results are handled back in the thread of the
+ *  clients.
+ * \ingroup network
+ */
+class LoadGenerator : public NoCopy
+{
+private:
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+    static LoadGenerator* m_load_generator;
+
+    /** Protects \ref m_load_generator in handleCalls() and \ref m_calls. */
+    static std::mutex m_calls_mutex;
+
+    /** The low bits of the steering values sent carry the sequence number
+     *  of the controller action message. */
+    static const int SEQUENCE_MASK = 63;
+
+    enum ClientState
+    {
+        LG_CONNECTING,
+        LG_REQUESTING_CONNECTION,
+        LG_LOBBY,
+        LG_LOADING,
+        LG_RACING,
+        LG_DISCONNECTED
+    };
+
+    struct Client
+    {
+        Network* m_network;
+        ENetPeer* m_server;
+        ClientState m_state;
+        uint32_t m_host_id;
+        /** World kart id of the kart of this client in the current race. */
+        int m_kart_id;
+        /** Difference between the network timer of the server (from its
+         *  ping packets) and the local monotonic time in ms. */
+        int64_t m_timer_offset;
+        /** Network timer of the server when the race starts. */
+        uint64_t m_start_time;
+        int m_next_action_ticks;
+        unsigned m_num_updates;
+        /** Sequence number of the last controller action message. */
+        int m_sequence;
+        /** Last value sent for each game action. */
+        int m_values[PA_PAUSE_RACE];
+        int m_steer_l;
+        int m_steer_r;
+        /** Counters since the last report. */
+        unsigned m_states;
+        unsigned m_late_actions;
+    };   // Client
+
+    std::vector<Client> m_clients;
+
+    uint16_t m_port;
+
+    std::thread m_thread;
+
+    std::atomic_bool m_abort;
+
+    /** Time from sending controller actions until another client receives
+     *  them from the server. */
+    LatencyHistogram m_echo_latency;
+
+    /** Send time of the controller action messages not received by another
+     *  client yet, with their kart id and sequence number as key. */
+    std::map<std::pair<int, int>, TimePoint> m_pending_echoes;
+
+    /** Calls to run in the protocol thread. */
+    std::vector<std::function<void()> > m_calls;
+
+    /** Results of the calls, to handle in the thread of the clients. */
+    std::vector<std::function<void()> > m_replies;
+
+    std::mutex m_replies_mutex;
+
+    /** Counters since the last report. */
+    uint64_t m_actions_sent;
+
+    uint64_t m_actions_lost;
+
+    TimePoint m_last_report;
+
+    LoadGenerator(unsigned count, uint16_t port);
+    ~LoadGenerator();
+    void run();
+    void connect(Client* c);
+    void update(Client* c);
+    void handleMessage(Client* c, NetworkString& data);
+    void handleLobbyMessage(Client* c, NetworkString& data);
+    void handleGameMessage(Client* c, NetworkString& data);
+    void updateActions(Client* c, int ticks);
+    void send(Client* c, NetworkString& data, bool reliable);
+    int getTicks(const Client& c) const;
+    void report();
+    void postCall(std::function<void()> call);
+    void postReply(std::function<void()> result);
+    void handleReplies();
+
+public:
+    static void create(unsigned count, uint16_t port);
+    // ------------------------------------------------------------------------
+    static void destroy();
+    // ------------------------------------------------------------------------
+    static void handleCalls();
+    // ------------------------------------------------------------------------
+    static LoadGenerator* get()                   { return m_load_generator; }
+};   // LoadGenerator
+
+#endif
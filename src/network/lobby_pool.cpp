@@ -0,0 +1,157 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2026 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "network/lobby_pool.hpp"
+#include "network/child_loop.hpp"
+#include "network/network_config.hpp"
+#include "online/request_manager.hpp"
+#include "utils/log.hpp"
+#include "utils/time.hpp"
+
+#include <cassert>
+#include <cstdio>
+#ifndef WIN32
+#include <unistd.h>
+#endif
+
+LobbyPool* LobbyPool::m_lobby_pool = NULL;
+
+namespace
+{
+    /** Returns the resident set size of this process in bytes, or 0 if it
+     *  is not available on this platform. */
+    uint64_t getResidentMemory()
+    {
+#if defined(__linux__)
+        FILE* fp = fopen("/proc/self/statm", "r");
+        if (!fp)
+            return 0;
+        unsigned long size = 0, resident = 0;
+        int ret = fscanf(fp, "%lu %lu", &size, &resident);
+        fclose(fp);
+        if (ret != 2)
+            return 0;
+        return (uint64_t)resident * (uint64_t)sysconf(_SC_PAGESIZE);
+#else
+        return 0;
+#endif
+    }   // getResidentMemory
+}   // namespace
+
+// ----------------------------------------------------------------------------
+void LobbyPool::create(unsigned count)
+{
+    assert(m_lobby_pool == NULL);
+    const unsigned max_lobbies = PT_COUNT - PT_LOBBY;
+    if (count > max_lobbies)
+    {
+        Log::warn("LobbyPool", "At most %d lobbies are supported, "
+            "%d requested.", max_lobbies, count);
+        count = max_lobbies;
+    }
+    m_lobby_pool = new LobbyPool(count);
+}   // create
+
+// ----------------------------------------------------------------------------
+void LobbyPool::destroy()
+{
+    delete m_lobby_pool;
+    m_lobby_pool = NULL;
+}   // destroy
+
+// ----------------------------------------------------------------------------
+/** Starts all lobbies one after another, a lobby is only started after the
+ *  previous one is ready, so they don't race for ports and online
+ *  registration.
+ */
+LobbyPool::LobbyPool(unsigned count)
+{
+    m_running = 0;
+    const uint64_t base_memory = getResidentMemory();
+    uint64_t prev_memory = base_memory;
+    for (unsigned i = 0; i < count; i++)
+    {
+        startLobby((ProcessType)(PT_LOBBY + i));
+        const uint64_t memory = getResidentMemory();
+        if (memory != 0 && memory >= prev_memory)
+        {
+            Log::info("LobbyPool", "Lobby %d uses %lluKB.", i + 1,
+                (unsigned long long)((memory - prev_memory) / 1024));
+        }
+        prev_memory = memory;
+    }
+    if (base_memory != 0 && count > 0 && prev_memory >= base_memory)
+    {
+        Log::info("LobbyPool", "%d lobbies started, %lluKB shared assets, "
+            "%lluKB per lobby on average.", count,
+            (unsigned long long)(base_memory / 1024),
+            (unsigned long long)((prev_memory - base_memory) / count / 1024));
+    }
+    else
+        Log::info("LobbyPool", "%d lobbies started.", count);
+}   // LobbyPool
+
+// ----------------------------------------------------------------------------
+LobbyPool::~LobbyPool()
+{
+    for (ChildLoop* cl : m_lobbies)
+        cl->abort();
+    for (std::thread& t : m_threads)
+    {
+        if (t.joinable())
+            t.join();
+    }
+    for (ChildLoop* cl : m_lobbies)
+        delete cl;
+}   // ~LobbyPool
+
+// ----------------------------------------------------------------------------
+void LobbyPool::startLobby(ProcessType pt)
+{
+    NetworkConfig* nc = NetworkConfig::getByType(PT_MAIN);
+    ChildLoopConfig clc;
+    clc.m_lan_server = nc->isLAN();
+    clc.m_login_id = nc->getCurrentUserId();
+    clc.m_token = nc->getCurrentUserToken();
+    clc.m_server_ai = nc->getNumFixedAI();
+    clc.m_process_type = pt;
+
+    ChildLoop* cl = new ChildLoop(clc);
+    m_lobbies.push_back(cl);
+    const unsigned running = ++m_running;
+    m_threads.emplace_back([this, cl]()
+        {
+            cl->run();
+            m_running--;
+        });
+
+    // The lobby needs the online requests of the main process to register
+    // itself, so poll them until it is ready
+    const uint64_t timeout = StkTime::getMonoTimeMs() + 30000;
+    while (cl->getPort() == 0 && m_running.load() == running &&
+        StkTime::getMonoTimeMs() < timeout)
+    {
+        if (Online::RequestManager::isRunning())
+            Online::RequestManager::get()->update(0.0f);
+        StkTime::sleep(10);
+    }
+    if (cl->getPort() == 0)
+    {
+        Log::warn("LobbyPool", "Lobby %d failed to start.",
+            pt - PT_LOBBY + 1);
+    }
+}   // startLobby
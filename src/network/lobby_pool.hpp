@@ -0,0 +1,67 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2026 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_LOBBY_POOL_HPP
+#define HEADER_LOBBY_POOL_HPP
+
+#include "utils/no_copy.hpp"
+#include "utils/stk_process.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+class ChildLoop;
+
+/** \brief Runs the lobbies of a multi-lobby server.
+ *  Each lobby is a ChildLoop running in its own thread with process type
+ *  PT_LOBBY + i, so it has its own STKHost, ProtocolManager, RewindManager,
+ *  World and Physics. Karts, tracks and the server configuration are loaded
+ *  only once by the main process and shared by all lobbies, the main
+ *  process itself only polls online requests while the lobbies are running.
+ * \ingroup network
+ */
+class LobbyPool : public NoCopy
+{
+private:
+    static LobbyPool* m_lobby_pool;
+
+    std::vector<ChildLoop*> m_lobbies;
+
+    std::vector<std::thread> m_threads;
+
+    /** Number of lobbies whose thread has not finished yet. */
+    std::atomic<unsigned> m_running;
+
+    LobbyPool(unsigned count);
+    ~LobbyPool();
+    void startLobby(ProcessType pt);
+
+public:
+    static void create(unsigned count);
+    // ------------------------------------------------------------------------
+    static void destroy();
+    // ------------------------------------------------------------------------
+    static LobbyPool* get()                          { return m_lobby_pool; }
+    // ------------------------------------------------------------------------
+    /** Returns true when all lobbies have been shut down. */
+    bool isFinished() const                   { return m_running.load() == 0; }
+    // ------------------------------------------------------------------------
+    unsigned getNumLobbies() const    { return (unsigned)m_lobbies.size(); }
+};   // LobbyPool
+
+#endif
@@ -18,6 +18,7 @@
 
 #include "network/network_config.hpp"
 #include "network/network_player_profile.hpp"
+#include "network/packet_compressor.hpp"
 #include "network/server_config.hpp"
 #include "network/socket_address.hpp"
 #include "network/stk_host.hpp"
@@ -53,7 +54,11 @@ void showHelp()
     std::cout << "kickban #, kick and ban # peer of STKHost." << std::endl;
     std::cout << "listpeers, List all peers with host ID and IP." << std::endl;
     std::cout << "listban, List IP ban list of server." << std::endl;
-    std::cout << "speedstats, Show upload and download speed." << std::endl;
+    std::cout << "speedstats, Show upload and download speed, and datagrams per second." << std::endl;
+    std::cout << "peerstats, Show updates of the peer table."
+        << std::endl;
+    std::cout << "compressionstats, Show compression ratio and time per "
+        "packet type." << std::endl;
     std::cout << "msg # string, Sent a message to all peers "
         "(# is ignored)." << std::endl;
 }   // showHelp
@@ -196,6 +201,24 @@ void mainLoop(STKHost* host)
                 (float)host->getUploadSpeed() / 1024.0f <<
                 "   Download speed (KBps): " <<
                 (float)host->getDownloadSpeed() / 1024.0f  << std::endl;
+            unsigned sent, send_calls, received, receive_calls;
+            host->getDatagramStats(&sent, &send_calls, &received,
+                &receive_calls);
+            std::cout << "Datagrams sent: " << sent << " (" << send_calls <<
+                " calls)   Datagrams received: " << received << " (" <<
+                receive_calls << " calls)" << std::endl;
+        }
+        else if (str == "peerstats")
+        {
+            uint64_t updates, contended;
+            host->getPeerTableStats(&updates, &contended);
+            std::cout << "Peers: " << host->getPeerCount() <<
+                "   Updates: " << updates <<
+                "   Contended updates: " << contended << std::endl;
+        }
+        else if (str == "compressionstats")
+        {
+            std::cout << PacketCompressor::getStats();
         }
         else if (str == "msg" && number != -1 &&
             NetworkConfig::get()->isServer())
@@ -448,6 +448,14 @@ public:
         m_current_offset = 1;   // ignore type
     }   // NetworkString
 
+    // ------------------------------------------------------------------------
+    /** Replaces the content with a received message (including the type),
+     *  reusing the allocated memory. */
+    void assign(const uint8_t *data, int len)
+    {
+        m_buffer.assign(data, data + len);
+        m_current_offset = 1;   // ignore type
+    }   // assign
     // ------------------------------------------------------------------------
     /** Empties the string, but does not reset the pre-allocated size. */
     void clear()
@@ -0,0 +1,502 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2026 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "network/packet_compressor.hpp"
+
+#include "config/stk_config.hpp"
+#include "network/network_string.hpp"
+#include "network/packet_types.hpp"
+#include "network/protocol.hpp"
+#include "network/protocols/game_protocol.hpp"
+#include "utils/log.hpp"
+
+#include <enet/enet.h>
+#include <zlib.h>
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+namespace
+{
+    /** Name of the network capability of peers which can receive
+     *  compressed packets. The preset dictionary can't be changed without
+     *  changing it. */
+    const char* CAPABILITY = "compression";
+
+    /** Larger packets are refused when decompressing. */
+    const uint32_t MAX_UNCOMPRESSED_SIZE = 1024 * 1024;
+
+    /** Base 2 logarithm of the deflate window size. Packets are small, so
+     *  a small window saves memory in each context. */
+    const int DEFLATE_WINDOW_BITS = 12;
+
+    /** Preset dictionary for deflate, with strings common in lobby packets
+     *  (mostly identifiers of official karts and tracks). The most frequent
+     *  ones are at the end, since they can be referenced with shorter
+     *  distances. */
+    const char DEFLATE_DICTIONARY[] =
+        "addon_ abyss alien_signal ancient_colosseum_labyrinth battleisland "
+        "black_forest candela_city cave cocoa_temple cornfield_crossing "
+        "fortmagma gran_paradiso_island hacienda hole_drop icy_soccer_field "
+        "lasdunasarena lasdunassoccer lighthouse mines minigolf oasis "
+        "olivermath pumpkin_park ravenbridge_mansion sandtrack scotland "
+        "snowmountain snowtuxpeak soccer_field stadium stk_enterprise "
+        "temple volcano_island xr591 zengarden tutorial overworld "
+        "adiumy amanda beastie emule gavroche gnu godette hexley kiki "
+        "konqi nolok pidgin puffy sara_the_racer sara_the_wizard suzanne "
+        "tux wilber xue normal time-trial follow-the-leader soccer "
+        "free-for-all capture-the-flag battle ctf ffa "
+        "SuperTuxKart Linux Windows Android Mac iOS 1.4 1.5 Ai Bot ";
+
+    // ------------------------------------------------------------------------
+    /** Counters of a packet type. */
+    struct CompressionStats
+    {
+        std::atomic<uint64_t> m_compressed;
+        std::atomic<uint64_t> m_skipped;
+        std::atomic<uint64_t> m_raw_bytes;
+        std::atomic<uint64_t> m_compressed_bytes;
+        std::atomic<uint64_t> m_compress_ns;
+        std::atomic<uint64_t> m_decompressed;
+        std::atomic<uint64_t> m_decompress_ns;
+    };   // CompressionStats
+
+    // ------------------------------------------------------------------------
+    /** Which packet types are compressed and how. */
+    struct CompressionRule
+    {
+        const char*              m_name;
+        uint8_t                  m_protocol;
+        uint8_t                  m_event;
+        PacketCompressor::Codec  m_codec;
+        /** Smaller packets (including the type) are sent uncompressed. */
+        uint32_t                 m_min_size;
+    };   // CompressionRule
+
+    const CompressionRule RULES[] =
+    {
+        { "LE_SERVER_INFO", PROTOCOL_LOBBY_ROOM, LE_SERVER_INFO,
+          PacketCompressor::PC_DEFLATE, 128 },
+        { "LE_UPDATE_PLAYER_LIST", PROTOCOL_LOBBY_ROOM,
+          LE_UPDATE_PLAYER_LIST, PacketCompressor::PC_DEFLATE, 128 },
+        { "LE_START_SELECTION", PROTOCOL_LOBBY_ROOM, LE_START_SELECTION,
+          PacketCompressor::PC_DEFLATE, 128 },
+        { "GP_STATE", PROTOCOL_CONTROLLER_EVENTS, GameProtocol::GP_STATE,
+          PacketCompressor::PC_RANGE_CODER, 64 },
+        { "GP_STATE_DELTA", PROTOCOL_CONTROLLER_EVENTS,
+          GameProtocol::GP_STATE_DELTA, PacketCompressor::PC_RANGE_CODER,
+          64 },
+    };
+    const unsigned NUM_RULES = sizeof(RULES) / sizeof(RULES[0]);
+
+    /** Statistics of each rule, never freed like the contexts. */
+    CompressionStats* g_stats = new CompressionStats[NUM_RULES]();
+
+    // ------------------------------------------------------------------------
+    /** Returns the index of the rule of a packet, or -1 if it has none.
+     *  \param data The packet including the type.
+     *  \param size Size of the packet.
+     */
+    int findRule(const uint8_t* data, size_t size)
+    {
+        if (size < 2)
+            return -1;
+        const uint8_t protocol =
+            data[0] & ~(PROTOCOL_SYNCHRONOUS | PROTOCOL_COMPRESSED);
+        for (unsigned i = 0; i < NUM_RULES; i++)
+        {
+            if (RULES[i].m_protocol == protocol &&
+                RULES[i].m_event == data[1])
+                return i;
+        }
+        return -1;
+    }   // findRule
+
+    // ------------------------------------------------------------------------
+    /** The state of the codecs, which can only be used by one thread at a
+     *  time. They are kept in a pool, so the (de)compressor memory is only
+     *  allocated once per concurrently compressing thread. */
+    struct CompressionContext
+    {
+        void*                m_range_coder;
+        z_stream             m_deflate;
+        z_stream             m_inflate;
+        /** False if the stream couldn't be initialized, it must not be
+         *  used then. */
+        bool                 m_deflate_ready;
+        bool                 m_inflate_ready;
+        std::vector<uint8_t> m_buffer;
+    };   // CompressionContext
+
+    std::mutex g_pool_mutex;
+    std::vector<CompressionContext*> g_pool;
+
+    // ------------------------------------------------------------------------
+    CompressionContext* acquireContext()
+    {
+        {
+            std::lock_guard<std::mutex> lock(g_pool_mutex);
+            if (!g_pool.empty())
+            {
+                CompressionContext* context = g_pool.back();
+                g_pool.pop_back();
+                return context;
+            }
+        }
+        CompressionContext* context = new CompressionContext();
+        context->m_range_coder = enet_range_coder_create();
+        memset(&context->m_deflate, 0, sizeof(z_stream));
+        memset(&context->m_inflate, 0, sizeof(z_stream));
+        // Negative window bits for raw deflate data without header, the
+        // dictionary is implied by the capability
+        context->m_deflate_ready = deflateInit2(&context->m_deflate,
+            Z_DEFAULT_COMPRESSION, Z_DEFLATED, -DEFLATE_WINDOW_BITS, 8,
+            Z_DEFAULT_STRATEGY) == Z_OK;
+        context->m_inflate_ready = inflateInit2(&context->m_inflate,
+            -DEFLATE_WINDOW_BITS) == Z_OK;
+        if (!context->m_deflate_ready || !context->m_inflate_ready)
+        {
+            Log::warn("PacketCompressor", "Cannot initialize %s.",
+                context->m_deflate_ready ? "inflate" : "deflate");
+        }
+        return context;
+    }   // acquireContext
+
+    // ------------------------------------------------------------------------
+    /** Returns a context to the pool. A context whose codecs couldn't be
+     *  initialized is freed instead, so that the next one tries again. */
+    void releaseContext(CompressionContext* context)
+    {
+        if (context->m_range_coder && context->m_deflate_ready &&
+            context->m_inflate_ready)
+        {
+            std::lock_guard<std::mutex> lock(g_pool_mutex);
+            g_pool.push_back(context);
+            return;
+        }
+        if (context->m_deflate_ready)
+            deflateEnd(&context->m_deflate);
+        if (context->m_inflate_ready)
+            inflateEnd(&context->m_inflate);
+        if (context->m_range_coder)
+            enet_range_coder_destroy(context->m_range_coder);
+        delete context;
+    }   // releaseContext
+
+    // ------------------------------------------------------------------------
+    /** Compresses data, returns the compressed size or 0 if it doesn't fit
+     *  into the output. */
+    size_t compressWith(CompressionContext* context,
+                        PacketCompressor::Codec codec, const uint8_t* in,
+                        size_t in_size, uint8_t* out, size_t out_limit)
+    {
+        if (codec == PacketCompressor::PC_RANGE_CODER)
+        {
+            if (!context->m_range_coder)
+                return 0;
+            ENetBuffer buffer;
+            buffer.data = (void*)in;
+            buffer.dataLength = in_size;
+            return enet_range_coder_compress(context->m_range_coder, &buffer,
+                1, in_size, out, out_limit);
+        }
+        z_stream& stream = context->m_deflate;
+        if (!context->m_deflate_ready || deflateReset(&stream) != Z_OK ||
+            deflateSetDictionary(&stream, (const Bytef*)DEFLATE_DICTIONARY,
+            sizeof(DEFLATE_DICTIONARY) - 1) != Z_OK)
+            return 0;
+        stream.next_in = (Bytef*)in;
+        stream.avail_in = (uInt)in_size;
+        stream.next_out = out;
+        stream.avail_out = (uInt)out_limit;
+        if (deflate(&stream, Z_FINISH) != Z_STREAM_END)
+            return 0;
+        return out_limit - stream.avail_out;
+    }   // compressWith
+
+    // ------------------------------------------------------------------------
+    /** Decompresses data, returns false if it is invalid or doesn't have
+     *  exactly the expected size. */
+    bool decompressWith(CompressionContext* context, uint8_t codec,
+                        const uint8_t* in, size_t in_size, uint8_t* out,
+                        size_t out_size)
+    {
+        if (codec == PacketCompressor::PC_RANGE_CODER)
+        {
+            if (!context->m_range_coder)
+                return false;
+            return enet_range_coder_decompress(context->m_range_coder, in,
+                in_size, out, out_size) == out_size;
+        }
+        if (codec != PacketCompressor::PC_DEFLATE)
+            return false;
+        z_stream& stream = context->m_inflate;
+        if (!context->m_inflate_ready || inflateReset(&stream) != Z_OK ||
+            inflateSetDictionary(&stream, (const Bytef*)DEFLATE_DICTIONARY,
+            sizeof(DEFLATE_DICTIONARY) - 1) != Z_OK)
+            return false;
+        stream.next_in = (Bytef*)in;
+        stream.avail_in = (uInt)in_size;
+        stream.next_out = out;
+        stream.avail_out = (uInt)out_size;
+        return inflate(&stream, Z_FINISH) == Z_STREAM_END &&
+            stream.avail_out == 0 && stream.avail_in == 0;
+    }   // decompressWith
+
+    // ------------------------------------------------------------------------
+    uint64_t getNanosecondsSince(
+        const std::chrono::steady_clock::time_point& start)
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count();
+    }   // getNanosecondsSince
+
+}   // anonymous namespace
+
+// ----------------------------------------------------------------------------
+/** Returns if packets can be compressed for a peer, i.e. if both this host
+ *  and the peer have the compression capability.
+ */
+bool PacketCompressor::isSupported(const std::set<std::string>& peer_capabilities)
+{
+    const std::set<std::string>& capabilities =
+        STKConfig::get()->m_network_capabilities;
+    return peer_capabilities.find(CAPABILITY) != peer_capabilities.end() &&
+        capabilities.find(CAPABILITY) != capabilities.end();
+}   // isSupported
+
+// ----------------------------------------------------------------------------
+/** Returns if a packet is of a type which is compressed and large enough,
+ *  so that compress() should be tried.
+ */
+bool PacketCompressor::shouldCompress(const NetworkString& data)
+{
+    const int rule = findRule((const uint8_t*)data.getData(),
+        data.getTotalSize());
+    if (rule == -1)
+        return false;
+    if (data.getTotalSize() < RULES[rule].m_min_size)
+    {
+        g_stats[rule].m_skipped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}   // shouldCompress
+
+// ----------------------------------------------------------------------------
+/** Compresses a packet of a type which is compressed.
+ *  \param data The packet to compress.
+ *  \param out Where the compressed packet is written to.
+ *  \param codec_failed If not NULL, set to true if the codec of the packet
+ *         couldn't be initialized. Compression should then be turned off
+ *         for the peer.
+ *  \return False if the packet is not compressed, e.g. if it wouldn't get
+ *          smaller, in which case it should be sent uncompressed.
+ */
+bool PacketCompressor::compress(const NetworkString& data, NetworkString* out,
+                                bool* codec_failed)
+{
+    const uint8_t* in = (const uint8_t*)data.getData();
+    const size_t total_size = data.getTotalSize();
+    const int rule = findRule(in, total_size);
+    if (rule == -1 || total_size <= HEADER_SIZE ||
+        (in[0] & PROTOCOL_COMPRESSED) != 0)
+        return false;
+
+    auto start = std::chrono::steady_clock::now();
+    // Only worth it if the packet gets smaller by more than the header
+    const size_t raw_size = total_size - 1;
+    std::vector<uint8_t>& buffer = out->getBuffer();
+    buffer.resize(total_size);
+    CompressionContext* context = acquireContext();
+    const size_t size = compressWith(context, RULES[rule].m_codec, in + 1,
+        raw_size, buffer.data() + HEADER_SIZE, total_size - HEADER_SIZE - 1);
+    if (codec_failed)
+    {
+        *codec_failed = RULES[rule].m_codec == PC_RANGE_CODER ?
+            context->m_range_coder == NULL : !context->m_deflate_ready;
+    }
+    releaseContext(context);
+
+    CompressionStats& stats = g_stats[rule];
+    stats.m_compress_ns.fetch_add(getNanosecondsSince(start),
+        std::memory_order_relaxed);
+    if (size == 0)
+    {
+        stats.m_skipped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    buffer[0] = in[0] | PROTOCOL_COMPRESSED;
+    buffer[1] = RULES[rule].m_codec;
+    buffer[2] = (uint8_t)(raw_size >> 24);
+    buffer[3] = (uint8_t)(raw_size >> 16);
+    buffer[4] = (uint8_t)(raw_size >> 8);
+    buffer[5] = (uint8_t)raw_size;
+    buffer.resize(HEADER_SIZE + size);
+    out->reset();
+    out->skip(1);
+    stats.m_compressed.fetch_add(1, std::memory_order_relaxed);
+    stats.m_raw_bytes.fetch_add(total_size, std::memory_order_relaxed);
+    stats.m_compressed_bytes.fetch_add(buffer.size(),
+        std::memory_order_relaxed);
+    return true;
+}   // compress
+
+// ----------------------------------------------------------------------------
+/** Returns if a received packet is compressed. */
+bool PacketCompressor::isCompressed(const NetworkString& data)
+{
+    return data.getTotalSize() > 0 &&
+        (data.getData()[0] & PROTOCOL_COMPRESSED) != 0;
+}   // isCompressed
+
+// ----------------------------------------------------------------------------
+/** Replaces a received compressed packet by its uncompressed content.
+ *  \return False if the packet is invalid.
+ */
+bool PacketCompressor::decompress(NetworkString* data)
+{
+    const std::vector<uint8_t>& buffer = data->getBuffer();
+    if (buffer.size() < HEADER_SIZE)
+        return false;
+    const uint32_t raw_size = (uint32_t)buffer[2] << 24 |
+        (uint32_t)buffer[3] << 16 | (uint32_t)buffer[4] << 8 | buffer[5];
+    if (raw_size == 0 || raw_size > MAX_UNCOMPRESSED_SIZE)
+        return false;
+
+    auto start = std::chrono::steady_clock::now();
+    CompressionContext* context = acquireContext();
+    std::vector<uint8_t>& raw = context->m_buffer;
+    raw.resize(raw_size + 1);
+    raw[0] = buffer[0] & ~PROTOCOL_COMPRESSED;
+    const bool valid = decompressWith(context, buffer[1],
+        buffer.data() + HEADER_SIZE, buffer.size() - HEADER_SIZE,
+        raw.data() + 1, raw_size);
+    if (valid)
+        data->assign(raw.data(), (int)raw.size());
+    releaseContext(context);
+    if (!valid)
+        return false;
+
+    const int rule = findRule(data->getBuffer().data(),
+        data->getTotalSize());
+    if (rule != -1)
+    {
+        g_stats[rule].m_decompressed.fetch_add(1, std::memory_order_relaxed);
+        g_stats[rule].m_decompress_ns.fetch_add(getNanosecondsSince(start),
+            std::memory_order_relaxed);
+    }
+    return true;
+}   // decompress
+
+// ----------------------------------------------------------------------------
+/** Returns the compression ratio and time spent of each packet type, one
+ *  line per type. */
+std::string PacketCompressor::getStats()
+{
+    std::string result;
+    for (unsigned i = 0; i < NUM_RULES; i++)
+    {
+        const CompressionStats& stats = g_stats[i];
+        const uint64_t compressed = stats.m_compressed.load();
+        const uint64_t skipped = stats.m_skipped.load();
+        const uint64_t raw_bytes = stats.m_raw_bytes.load();
+        const uint64_t decompressed = stats.m_decompressed.load();
+        const uint64_t tried = compressed + skipped;
+        char line[256];
+        snprintf(line, sizeof(line), "%s: compressed %lu (%lu skipped), "
+            "%lu -> %lu bytes (%.1f%%), %.2fus per packet; decompressed %lu, "
+            "%.2fus per packet\n", RULES[i].m_name,
+            (unsigned long)compressed, (unsigned long)skipped,
+            (unsigned long)raw_bytes,
+            (unsigned long)stats.m_compressed_bytes.load(),
+            raw_bytes == 0 ? 100.0f :
+            100.0f * stats.m_compressed_bytes.load() / raw_bytes,
+            tried == 0 ? 0.0f : stats.m_compress_ns.load() / 1000.0f / tried,
+            (unsigned long)decompressed, decompressed == 0 ? 0.0f :
+            stats.m_decompress_ns.load() / 1000.0f / decompressed);
+        result += line;
+    }
+    return result;
+}   // getStats
+
+// ----------------------------------------------------------------------------
+void PacketCompressor::unitTesting()
+{
+    // A player list with repeated names compresses with deflate, and is
+    // restored exactly, including the synchronous flag
+    NetworkString list(PROTOCOL_LOBBY_ROOM);
+    list.setSynchronous(true);
+    list.addUInt8(LE_UPDATE_PLAYER_LIST).addUInt8(20);
+    for (unsigned i = 0; i < 20; i++)
+    {
+        list.addUInt32(i).encodeString(std::string("player") +
+            std::to_string(i)).encodeString(std::string("sara_the_racer"));
+    }
+    assert(shouldCompress(list));
+    NetworkString compressed(PROTOCOL_NONE);
+    bool ok = compress(list, &compressed);
+    assert(ok);
+    assert(isCompressed(compressed) && !isCompressed(list));
+    assert(compressed.getBuffer()[1] == PC_DEFLATE);
+    assert(compressed.getTotalSize() < list.getTotalSize() / 2);
+    ok = decompress(&compressed);
+    assert(ok);
+    assert(compressed.getBuffer() == list.getBuffer());
+    assert(compressed.isSynchronous() &&
+        compressed.getProtocolType() == PROTOCOL_LOBBY_ROOM);
+    assert(compressed.getUInt8() == LE_UPDATE_PLAYER_LIST);
+
+    // A game state uses the range coder
+    NetworkString state(PROTOCOL_CONTROLLER_EVENTS);
+    state.addUInt8(GameProtocol::GP_STATE);
+    for (unsigned i = 0; i < 200; i++)
+        state.addUInt8(i % 4 == 0 ? (uint8_t)i : 0);
+    ok = compress(state, &compressed);
+    assert(ok);
+    assert(compressed.getBuffer()[1] == PC_RANGE_CODER);
+    ok = decompress(&compressed);
+    assert(ok);
+    assert(compressed.getBuffer() == state.getBuffer());
+
+    // Other or small packets are not compressed
+    NetworkString chat(PROTOCOL_LOBBY_ROOM);
+    chat.addUInt8(LE_CHAT).encodeString(std::string(200, 'a'));
+    assert(!shouldCompress(chat));
+    ok = compress(chat, &compressed);
+    assert(!ok);
+    NetworkString small(PROTOCOL_LOBBY_ROOM);
+    small.addUInt8(LE_SERVER_INFO).addUInt32(0);
+    assert(!shouldCompress(small));
+
+    // Corrupted or too large packets are refused
+    compress(list, &compressed);
+    compressed.getBuffer().resize(compressed.getTotalSize() - 4);
+    ok = decompress(&compressed);
+    assert(!ok);
+    compress(list, &compressed);
+    compressed.getBuffer()[2] = 0xff;
+    ok = decompress(&compressed);
+    assert(!ok);
+    (void)ok;
+}   // unitTesting
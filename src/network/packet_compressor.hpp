@@ -0,0 +1,63 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2026 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_PACKET_COMPRESSOR_HPP
+#define HEADER_PACKET_COMPRESSOR_HPP
+
+#include "utils/types.hpp"
+
+#include <set>
+#include <string>
+
+class NetworkString;
+
+/** Compresses packets sent to peers which support the "compression" network
+ *  capability, and decompresses received packets. Only some packet types
+ *  are compressed, each with the codec suited to it and only above a
+ *  minimum size: ENet's adaptive range coder for the frequent game states,
+ *  and deflate with a preset dictionary of common identifiers for the big
+ *  lobby packets. A compressed packet has the PROTOCOL_COMPRESSED flag set
+ *  in its first byte, followed by the codec, the uncompressed size (without
+ *  the first byte) and the compressed data.
+ *  The compression ratio and the time spent are counted per packet type.
+ *  All functions are thread safe.
+ */
+class PacketCompressor
+{
+public:
+    enum Codec : uint8_t
+    {
+        PC_RANGE_CODER = 1,
+        PC_DEFLATE     = 2
+    };
+
+    /** Size of the header of a compressed packet: type, codec and
+     *  uncompressed size. */
+    static const unsigned HEADER_SIZE = 6;
+
+    static bool isSupported(const std::set<std::string>& peer_capabilities);
+    static bool shouldCompress(const NetworkString& data);
+    static bool compress(const NetworkString& data, NetworkString* out,
+                         bool* codec_failed = NULL);
+    static bool decompress(NetworkString* data);
+    static bool isCompressed(const NetworkString& data);
+    static std::string getStats();
+    static void unitTesting();
+};   // PacketCompressor
+
+#endif
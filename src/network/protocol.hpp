@@ -47,6 +47,7 @@ enum ProtocolType
     PROTOCOL_CONTROLLER_EVENTS = 0x04,  //!< Protocol to transfer controller modifications
     PROTOCOL_SILENT            = 0x05,  //!< Used for protocols that do not subscribe to any network event.
     PROTOCOL_MAX                     ,  //!< Maximum number of different protocol types
+    PROTOCOL_COMPRESSED        = 0x40,  //!< Flag, indicates a compressed packet (see PacketCompressor)
     PROTOCOL_SYNCHRONOUS       = 0x80,  //!< Flag, indicates synchronous delivery
 };   // ProtocolType
 
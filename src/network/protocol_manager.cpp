@@ -38,6 +38,10 @@
 
 // ============================================================================
 std::weak_ptr<ProtocolManager> ProtocolManager::m_protocol_manager[PT_COUNT];
+
+/** Maximum time between two asynchronous updates in milliseconds, for
+ *  protocols which check timeouts or states set by other threads. */
+const uint64_t ASYNC_UPDATE_INTERVAL = 10;
 // ============================================================================
 std::shared_ptr<ProtocolManager> ProtocolManager::createInstance()
 {
@@ -53,18 +57,21 @@ std::shared_ptr<ProtocolManager> ProtocolManager::createInstance()
     auto pm = std::make_shared<ProtocolManager>();
     pm->m_asynchronous_update_thread = std::thread([pm, pt]()
         {
-            std::string thread_name = "PtlMgr";
-            if (pt == PT_CHILD)
-                thread_name += "_child";
+            std::string thread_name = "PtlMgr" +
+                STKProcess::getThreadSuffix(pt);
             VS::setThreadName(thread_name.c_str());
             STKProcess::init(pt);
+            pm->m_async_idle.reset();
             while(!pm->m_exit.load())
             {
                 pm->asynchronousUpdate();
                 PROFILER_PUSH_CPU_MARKER("sleep", 0, 255, 255);
-                StkTime::sleep(2);
+                pm->waitForAsynchronousUpdate();
                 PROFILER_POP_CPU_MARKER();
             }
+            Log::info("ProtocolManager", "Asynchronous update thread was "
+                "idle %.1f%% of the time.",
+                pm->m_async_idle.getIdlePercentage());
         });
     if (NetworkConfig::get()->isServer())
     {
@@ -110,6 +117,7 @@ std::shared_ptr<ProtocolManager> ProtocolManager::createInstance()
 ProtocolManager::ProtocolManager()
 {
     m_exit.store(false);
+    m_async_wakeup = false;
 }   // ProtocolManager
 
 // ----------------------------------------------------------------------------
@@ -121,24 +129,18 @@ ProtocolManager::~ProtocolManager()
         m_all_protocols[i].abort();
     }
 
-    m_sync_events_to_process.lock();
-    for (EventList::iterator i =m_sync_events_to_process.getData().begin();
-                             i!=m_sync_events_to_process.getData().end(); ++i)
-        delete *i;
-    m_sync_events_to_process.getData().clear();
-    m_sync_events_to_process.unlock();
-
-    m_async_events_to_process.lock();
-    for (EventList::iterator i = m_async_events_to_process.getData().begin();
-                             i!= m_async_events_to_process.getData().end(); ++i)
-        delete *i;
-    m_async_events_to_process.getData().clear();
-    m_async_events_to_process.unlock();
-
-    for (EventList::iterator i = m_controller_events_list.begin();
-                             i!= m_controller_events_list.end(); ++i)
-        delete *i;
-    m_controller_events_list.clear();
+    EventList* all_lists[] =
+    {
+        &m_sync_events_to_process.getData(),
+        &m_async_events_to_process.getData(), &m_sync_events_pending,
+        &m_async_events_pending, &m_controller_events_list
+    };
+    for (EventList* list : all_lists)
+    {
+        for (size_t i = 0; i < list->size(); i++)
+            delete (*list)[i];
+        list->clear();
+    }
 
 }   // ~ProtocolManager
 
@@ -160,6 +162,7 @@ void ProtocolManager::OneProtocolType::abort()
 void ProtocolManager::abort()
 {
     m_exit.store(true);
+    wakeUpAsynchronousUpdate();
     if (NetworkConfig::get()->isServer())
     {
         std::unique_lock<std::mutex> ul(m_game_protocol_mutex);
@@ -200,9 +203,59 @@ void ProtocolManager::propagateEvent(Event* event)
         m_async_events_to_process.lock();
         m_async_events_to_process.getData().push_back(event);
         m_async_events_to_process.unlock();
+        wakeUpAsynchronousUpdate();
     }
 }   // propagateEvent
 
+// ----------------------------------------------------------------------------
+/** Makes the asynchronous update thread update all protocols now (or after
+ *  its current update), can be called from any thread.
+ */
+void ProtocolManager::wakeUpAsynchronousUpdate()
+{
+    std::lock_guard<std::mutex> lock(m_async_mutex);
+    m_async_wakeup = true;
+    m_async_cv.notify_one();
+}   // wakeUpAsynchronousUpdate
+
+// ----------------------------------------------------------------------------
+/** Makes the asynchronous update thread update all protocols at a certain
+ *  time, e.g. when a timeout expires, instead of up to
+ *  ASYNC_UPDATE_INTERVAL later.
+ *  \param time The time in StkTime::getMonoTimeMs().
+ */
+void ProtocolManager::scheduleAsynchronousUpdate(uint64_t time)
+{
+    std::lock_guard<std::mutex> lock(m_async_mutex);
+    m_async_deadlines.push(time);
+    if (time < StkTime::getMonoTimeMs() + ASYNC_UPDATE_INTERVAL)
+    {
+        m_async_wakeup = true;
+        m_async_cv.notify_one();
+    }
+}   // scheduleAsynchronousUpdate
+
+// ----------------------------------------------------------------------------
+/** Waits in the asynchronous update thread until the next update is due.
+ */
+void ProtocolManager::waitForAsynchronousUpdate()
+{
+    auto start = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> ul(m_async_mutex);
+    const uint64_t now = StkTime::getMonoTimeMs();
+    while (!m_async_deadlines.empty() && m_async_deadlines.top() <= now)
+        m_async_deadlines.pop();
+    uint64_t wait_time = ASYNC_UPDATE_INTERVAL;
+    if (!m_async_deadlines.empty() &&
+        m_async_deadlines.top() - now < wait_time)
+        wait_time = m_async_deadlines.top() - now;
+    m_async_cv.wait_for(ul, std::chrono::milliseconds(wait_time),
+        [this]() { return m_async_wakeup || m_exit.load(); });
+    m_async_wakeup = false;
+    ul.unlock();
+    m_async_idle.addIdleSince(start);
+}   // waitForAsynchronousUpdate
+
 // ----------------------------------------------------------------------------
 /** \brief Asks the manager to start a protocol.
  *  Add the protocol to the protocols vector.
@@ -212,9 +265,11 @@ void ProtocolManager::requestStart(std::shared_ptr<Protocol> protocol)
 {
     if (!protocol)
         return;
-    std::lock_guard<std::mutex> lock(m_protocols_mutex);
+    std::unique_lock<std::mutex> lock(m_protocols_mutex);
     OneProtocolType &opt = m_all_protocols[protocol->getProtocolType()];
     opt.addProtocol(protocol);
+    lock.unlock();
+    wakeUpAsynchronousUpdate();
 }   // requestStart
 
 // ----------------------------------------------------------------------------
@@ -340,6 +395,67 @@ bool ProtocolManager::sendEvent(Event* event,
                               >= TIME_TO_KEEP_EVENTS;
 }   // sendEvent
 
+// ----------------------------------------------------------------------------
+/** Delivers the events of a queue, and the ones which could not be delivered
+ *  before, in order. The queue is only locked to take its events.
+ *  \param queue The events added by the network threads.
+ *  \param pending The events which could not be delivered yet, only used
+ *         by the calling thread.
+ *  \param async If the events are asynchronous (for error messages).
+ */
+void ProtocolManager::deliverEvents(Synchronised<EventList>* queue,
+                          EventList* pending,
+                          std::array<OneProtocolType, PROTOCOL_MAX>& protocols,
+                          bool async)
+{
+    queue->lock();
+    EventList& new_events = queue->getData();
+    while (!new_events.empty())
+    {
+        pending->push_back(new_events.front());
+        new_events.pop_front();
+    }
+    queue->unlock();
+
+    size_t kept = 0;
+    for (size_t i = 0; i < pending->size(); i++)
+    {
+        Event* event = (*pending)[i];
+        bool can_be_deleted = true;
+        try
+        {
+            can_be_deleted = sendEvent(event, protocols);
+        }
+        catch (std::exception& e)
+        {
+            const std::string& name =
+                event->getPeer()->getAddress().toString();
+            Log::error("ProtocolManager", "%s event error from %s: %s",
+                async ? "Asynchronous" : "Synchronous", name.c_str(),
+                e.what());
+            if (event->hasValidData())
+            {
+                Log::error("ProtocolManager", "%s",
+                    event->data().getLogMessage().c_str());
+            }
+            else
+            {
+                Log::error("ProtocolManager",
+                    "data is null, cannot get log message!");
+            }
+        }
+        if (can_be_deleted)
+            delete event;
+        else
+        {
+            // This should only happen if the protocol has not been started
+            // or already terminated (e.g. late ping answer)
+            (*pending)[kept++] = event;
+        }
+    }
+    pending->resize(kept);
+}   // deliverEvents
+
 // ----------------------------------------------------------------------------
 /** Calls either the synchronous update or asynchronous update function in all
  *  protocols of this type.
@@ -378,37 +494,8 @@ void ProtocolManager::update(int ticks)
     ul.unlock();
 
     // before updating, notify protocols that they have received events
-    m_sync_events_to_process.lock();
-    EventList::iterator i = m_sync_events_to_process.getData().begin();
-
-    while (i != m_sync_events_to_process.getData().end())
-    {
-        m_sync_events_to_process.unlock();
-        bool can_be_deleted = true;
-        try
-        {
-            can_be_deleted = sendEvent(*i, all_protocols);
-        }
-        catch (std::exception& e)
-        {
-            const std::string& name = (*i)->getPeer()->getAddress().toString();
-            Log::error("ProtocolManager",
-                "Synchronous event error from %s: %s", name.c_str(), e.what());
-            Log::error("ProtocolManager", "%s", (*i)->data().getLogMessage().c_str());
-        }
-        m_sync_events_to_process.lock();
-        if (can_be_deleted)
-        {
-            delete *i;
-            i = m_sync_events_to_process.getData().erase(i);
-        }
-        else
-        {
-            // This should only happen if the protocol has not been started
-            ++i;
-        }
-    }
-    m_sync_events_to_process.unlock();
+    deliverEvents(&m_sync_events_to_process, &m_sync_events_pending,
+        all_protocols, /*async*/false);
 
     // Now update all protocols.
     for (unsigned int i = 0; i < all_protocols.size(); i++)
@@ -437,48 +524,8 @@ void ProtocolManager::asynchronousUpdate()
     auto all_protocols = m_all_protocols;
     ul.unlock();
 
-    m_async_events_to_process.lock();
-    EventList::iterator i = m_async_events_to_process.getData().begin();
-    while (i != m_async_events_to_process.getData().end())
-    {
-        m_async_events_to_process.unlock();
-
-        bool result = true;
-        try
-        {
-            result = sendEvent(*i, all_protocols);
-        }
-        catch (std::exception& e)
-        {
-            const std::string& name = (*i)->getPeer()->getAddress().toString();
-            Log::error("ProtocolManager", "Asynchronous event "
-                "error from %s: %s", name.c_str(), e.what());
-            
-            if (*i != nullptr && (*i)->hasValidData())
-            {
-                // kimden: make sure you don't cause it to be nullptr yourself
-                Log::error("ProtocolManager", "%s", (*i)->data().getLogMessage().c_str());
-            }
-            else
-            {
-                Log::error("ProtocolManager", "data is null, cannot get log message!");
-            }
-        }
-
-        m_async_events_to_process.lock();
-        if (result)
-        {
-            delete *i;
-            i = m_async_events_to_process.getData().erase(i);
-        }
-        else
-        {
-            // This should only happen if the protocol has not been started
-            // or already terminated (e.g. late ping answer)
-            ++i;
-        }
-    }   // while i != m_events_to_process.end()
-    m_async_events_to_process.unlock();
+    deliverEvents(&m_async_events_to_process, &m_async_events_pending,
+        all_protocols, /*async*/true);
 
     PROFILER_POP_CPU_MARKER();
     PROFILER_PUSH_CPU_MARKER("Message delivery", 255, 0, 0);
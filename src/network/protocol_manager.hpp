@@ -25,7 +25,9 @@
 
 #include "network/network_string.hpp"
 #include "network/protocol.hpp"
+#include "utils/loop_stats.hpp"
 #include "utils/no_copy.hpp"
+#include "utils/ring_buffer.hpp"
 #include "utils/singleton.hpp"
 #include "utils/stk_process.hpp"
 #include "utils/synchronised.hpp"
@@ -34,9 +36,10 @@
 #include <array>
 #include <atomic>
 #include <condition_variable>
-#include <list>
 #include <memory>
+#include <functional>
 #include <mutex>
+#include <queue>
 #include <vector>
 #include <thread>
 
@@ -147,8 +150,8 @@ private:
      *  empty) list of protocols. */
     std::array<OneProtocolType, PROTOCOL_MAX> m_all_protocols;
 
-    /** A list of network events - messages, disconnect and disconnects. */
-    typedef std::list<Event*> EventList;
+    /** A queue of network events - messages, disconnect and disconnects. */
+    typedef RingBuffer<Event*> EventList;
 
     /** Contains the network events to pass synchronously to protocols
      *  (i.e. from the main thread). */
@@ -158,12 +161,38 @@ private:
     *  (i.e. from the separate ProtocolManager thread). */
     Synchronised<EventList> m_async_events_to_process;
 
+    /** Synchronous events taken from \ref m_sync_events_to_process which
+     *  could not be delivered yet, only used by the main thread. */
+    EventList m_sync_events_pending;
+
+    /** Asynchronous events taken from \ref m_async_events_to_process which
+     *  could not be delivered yet, only used by the asynchronous thread. */
+    EventList m_async_events_pending;
+
     /** When set to true, the main thread will exit. */
     std::atomic_bool m_exit;
 
     /*! Asynchronous update thread.*/
     std::thread m_asynchronous_update_thread;
 
+    /** The asynchronous update thread waits on \ref m_async_cv until an
+     *  asynchronous event or protocol is added, the earliest deadline in
+     *  \ref m_async_deadlines or at most ASYNC_UPDATE_INTERVAL. */
+    std::mutex m_async_mutex;
+
+    std::condition_variable m_async_cv;
+
+    /** Set (under \ref m_async_mutex) to end the wait at once. */
+    bool m_async_wakeup;
+
+    /** Times (StkTime::getMonoTimeMs) at which protocols asked for an
+     *  asynchronous update, earliest first. */
+    std::priority_queue<uint64_t, std::vector<uint64_t>,
+        std::greater<uint64_t> > m_async_deadlines;
+
+    /** How long the asynchronous update thread waited. */
+    IdleMeter m_async_idle;
+
     /** Asynchronous game protocol thread to handle controller action as fast
      *  as possible. */
     std::thread m_game_protocol_thread;
@@ -180,8 +209,14 @@ private:
     bool sendEvent(Event* event,
                    std::array<OneProtocolType, PROTOCOL_MAX>& protocols);
 
+    void deliverEvents(Synchronised<EventList>* queue, EventList* pending,
+                       std::array<OneProtocolType, PROTOCOL_MAX>& protocols,
+                       bool async);
+
     void asynchronousUpdate();
 
+    void waitForAsynchronousUpdate();
+
 public:
     // ===========================================
     // Public constructor is required for shared_ptr
@@ -194,6 +229,8 @@ public:
     void      requestTerminate(std::shared_ptr<Protocol> protocol);
     void      findAndTerminate(ProtocolType type);
     void      update(int ticks);
+    void      wakeUpAsynchronousUpdate();
+    void      scheduleAsynchronousUpdate(uint64_t time);
     // ------------------------------------------------------------------------
     bool isExiting() const                            { return m_exit.load(); }
     // ------------------------------------------------------------------------
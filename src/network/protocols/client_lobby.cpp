@@ -45,6 +45,7 @@
 #include "network/network_config.hpp"
 #include "network/network_player_profile.hpp"
 #include "network/network_timer_synchronizer.hpp"
+#include "network/packet_compressor.hpp"
 #include "network/packet_types.hpp"
 #include "network/peer_vote.hpp"
 #include "network/protocols/connect_to_server.hpp"
@@ -373,7 +374,7 @@ void ClientLobby::addAllPlayers(Event* event)
 std::vector<std::shared_ptr<NetworkPlayerProfile> >
   ClientLobby::decodePlayers(const BareNetworkString& data,
                              std::shared_ptr<STKPeer> peer,
-                             bool* is_spectator) const
+                             bool* is_spectator)
 {
     std::vector<std::shared_ptr<NetworkPlayerProfile> > players;
     unsigned player_count = data.getUInt8();
@@ -414,13 +415,7 @@ void ClientLobby::update(int ticks)
         if (NetworkConfig::get()->isNetworkAIInstance())
             ua = "AI";
         NetworkString* ns = getNetworkString();
-        ns->addUInt8(LE_CONNECTION_REQUESTED)
-            .addUInt32(ServerConfig::m_server_version).encodeString(ua)
-            .addUInt16((uint16_t)stk_config->m_network_capabilities.size());
-        for (const std::string& cap : stk_config->m_network_capabilities)
-            ns->encodeString(cap);
-
-        getKartsTracksNetworkString(ns);
+        encodeConnectionRequest(ns, ua, stk_config->m_network_capabilities);
         assert(!NetworkConfig::get()->isAddingNetworkPlayers());
         const uint8_t player_count =
             (uint8_t)NetworkConfig::get()->getNetworkPlayers().size();
@@ -538,6 +533,26 @@ void ClientLobby::update(int ticks)
     }
 }   // update
 
+//-----------------------------------------------------------------------------
+/** Writes the start of a connection request, which is followed by the
+ *  players of the client.
+ *  \param ns The network string to write to (after the protocol type).
+ *  \param user_agent User agent shown in the server log.
+ *  \param capabilities Network capabilities supported by the client.
+ */
+void ClientLobby::encodeConnectionRequest(NetworkString* ns,
+                                          const std::string& user_agent,
+                                   const std::set<std::string>& capabilities)
+{
+    ns->addUInt8(LE_CONNECTION_REQUESTED)
+        .addUInt32(ServerConfig::m_server_version).encodeString(user_agent)
+        .addUInt16((uint16_t)capabilities.size());
+    for (const std::string& cap : capabilities)
+        ns->encodeString(cap);
+
+    getKartsTracksNetworkString(ns);
+}   // encodeConnectionRequest
+
 //-----------------------------------------------------------------------------
 void ClientLobby::finalizeConnectionRequest(NetworkString* header,
                                             BareNetworkString* rest,
@@ -698,6 +713,7 @@ void ClientLobby::connectionAccepted(Event* event)
         data.decodeString(&cap);
         caps.insert(cap);
     }
+    event->getPeer()->setCompression(PacketCompressor::isSupported(caps));
     NetworkConfig::get()->setServerCapabilities(caps);
 
     float auto_start_timer = data.getFloat();
@@ -144,13 +144,9 @@ private:
     void liveJoinAcknowledged(Event* event);
     void handleKartInfo(Event* event);
     void finishLiveJoin();
-    std::vector<std::shared_ptr<NetworkPlayerProfile> >
-         decodePlayers(const BareNetworkString& data,
-         std::shared_ptr<STKPeer> peer = nullptr,
-         bool* is_spectator = NULL) const;
     void getPlayersAddonKartType(const BareNetworkString& data,
         std::vector<std::shared_ptr<NetworkPlayerProfile> >& players) const;
-    void getKartsTracksNetworkString(BareNetworkString* ns);
+    static void getKartsTracksNetworkString(BareNetworkString* ns);
     void doInstallAddonsPack();
 public:
              ClientLobby(std::shared_ptr<Server> s);
@@ -203,6 +199,13 @@ public:
     static void downloadAddonsPack(std::shared_ptr<Online::HTTPRequest> r);
     static void destroyBackgroundDownload();
     void updateAssetsToServer();
+    static void encodeConnectionRequest(NetworkString* ns,
+                                        const std::string& user_agent,
+                                  const std::set<std::string>& capabilities);
+    static std::vector<std::shared_ptr<NetworkPlayerProfile> >
+         decodePlayers(const BareNetworkString& data,
+         std::shared_ptr<STKPeer> peer = nullptr,
+         bool* is_spectator = NULL);
 };
 
 #endif // CLIENT_LOBBY_HPP
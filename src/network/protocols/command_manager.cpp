@@ -27,6 +27,7 @@
 #include "network/stk_host.hpp"
 #include "tracks/track.hpp"
 #include "tracks/track_manager.hpp"
+#include "utils/asset_bitset.hpp"
 #include "utils/chat_manager.hpp"
 #include "utils/communication.hpp"
 #include "utils/crown_manager.hpp"
@@ -1146,8 +1147,12 @@ void CommandManager::process_addons(Context& context)
     if (apply_filters)
         getAssetManager()->applyAllMapFilters(from, false); // happily the type is never karts in this line
     std::vector<std::pair<std::string, std::vector<std::shared_ptr<NetworkPlayerProfile>>>> result;
+    std::vector<unsigned> ids;
     for (const std::string& s: from)
+    {
         result.push_back({s, {}});
+        ids.push_back(AssetIndex::get()->getId(s));
+    }
 
     auto peers = STKHost::get()->getPeers();
     int num_players = 0;
@@ -1161,11 +1166,11 @@ void CommandManager::process_addons(Context& context)
         if (!p->hasPlayerProfiles())
             continue;
         ++num_players;
-        const auto& kt = p->getClientAssets();
-        const auto& container = (argv[1] == g_type_kart ? kt.first : kt.second);
-        for (auto& pr: result)
-            if (container.find(pr.first) == container.end())
-                pr.second.push_back(p->getMainProfile());
+        const AssetBitset& container = (argv[1] == g_type_kart ?
+            p->getClientKarts() : p->getClientTracks());
+        for (unsigned i = 0; i < result.size(); i++)
+            if (!container.test(ids[i]))
+                result[i].second.push_back(p->getMainProfile());
     }
     std::random_device rd;
     std::mt19937 g(rd());
@@ -1299,11 +1304,10 @@ void CommandManager::process_checkaddon(Context& context)
             || !p->hasPlayerProfiles())
             continue;
 
-        const auto& kt = p->getClientAssets();
         unsigned status = 0;
-        if (kt.first.find(id) != kt.first.end())
+        if (p->hasClientKart(id))
             status |= HAS_KART;
-        if (kt.second.find(id) != kt.second.end())
+        if (p->hasClientTrack(id))
             status |= HAS_MAP;
         players[status].push_back(p->getMainProfile());
     }
@@ -1499,27 +1503,8 @@ void CommandManager::process_pha(Context& context)
     }
 
     std::string addon_id_test = Addon::createAddonId(addon_id);
-    bool found = false;
-    const auto& kt = player_peer->getClientAssets();
-    for (auto& kart : kt.first)
-    {
-        if (kart == addon_id_test)
-        {
-            found = true;
-            break;
-        }
-    }
-    if (!found)
-    {
-        for (auto& track : kt.second)
-        {
-            if (track == addon_id_test)
-            {
-                found = true;
-                break;
-            }
-        }
-    }
+    bool found = player_peer->hasClientKart(addon_id_test) ||
+        player_peer->hasClientTrack(addon_id_test);
     context.say(player_name +
             " has " + (found ? "" : "no ") + "addon " + addon_id);
 } // process_pha
@@ -2869,10 +2854,19 @@ void CommandManager::process_register(Context& context)
             ans.push_back(' ');
         ans += argv[i];
     }
-    if (getLobby()->writeOnePlayerReport(acting_peer, getSettings()->getRegisterTableName(),
-        ans))
-        context.say("Your registration request is being processed");
-    else
+    std::weak_ptr<STKPeer> peer_wp = acting_peer;
+    auto callback = [peer_wp](bool written)
+    {
+        std::shared_ptr<STKPeer> peer = peer_wp.lock();
+        if (!peer)
+            return;
+        if (written)
+            Comm::sendStringToPeer(peer, "Your registration request is being processed");
+        else
+            Comm::sendStringToPeer(peer, "Sorry, an error occurred. Please try again.");
+    };
+    if (!getLobby()->writeOnePlayerReport(acting_peer,
+        getSettings()->getRegisterTableName(), ans, callback))
         context.say("Sorry, an error occurred. Please try again.");
 } // process_register
 // ========================================================================
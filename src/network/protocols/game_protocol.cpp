@@ -31,15 +31,23 @@
 #include "network/protocol_manager.hpp"
 #include "network/rewind_info.hpp"
 #include "network/rewind_manager.hpp"
+#include "network/rewinder.hpp"
+#include "network/server_config.hpp"
 #include "network/socket_address.hpp"
+#include "network/state_history.hpp"
 #include "network/stk_host.hpp"
 #include "network/stk_peer.hpp"
+#include "race/race_manager.hpp"
 #include "tracks/track.hpp"
 #include "utils/communication.hpp"
 #include "utils/log.hpp"
 #include "utils/time.hpp"
 #include "main_loop.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
 // ============================================================================
 std::weak_ptr<GameProtocol> GameProtocol::m_game_protocol[PT_COUNT];
 // ============================================================================
@@ -64,12 +72,50 @@ GameProtocol::GameProtocol()
     m_network_item_manager = static_cast<NetworkItemManager*>
         (Track::getCurrentTrack()->getItemManager());
     m_data_to_send = getNetworkString();
+    m_state_buffer = new BareNetworkString(1024);
+    m_state_count = 0;
+    m_legacy_state = getNetworkString();
+    m_legacy_state_ready = false;
+    m_delta_state_count = 0;
+    m_peer_state = getNetworkString();
+    m_state_bytes_sent = 0;
+    m_peer_states_sent = 0;
+    m_use_rewinder_ids = NetworkConfig::get()->isClient() &&
+        NetworkConfig::get()->getServerCapabilities().find("rewinder_id") !=
+        NetworkConfig::get()->getServerCapabilities().end();
+    m_rewinder_ids_request_time = 0;
+    // Server keeps fewer states than clients, so that any state acknowledged
+    // by a client in the server history is still available on the client
+    if (NetworkConfig::get()->isServer())
+    {
+        if (ServerConfig::m_state_delta_compression)
+            m_state_history.reset(new StateHistory(SERVER_STATE_HISTORY));
+    }
+    else if (NetworkConfig::get()->getServerCapabilities().find(
+        "state_delta") != NetworkConfig::get()->getServerCapabilities().end())
+    {
+        m_state_history.reset(new StateHistory(64));
+    }
 }   // GameProtocol
 
 //-----------------------------------------------------------------------------
 GameProtocol::~GameProtocol()
 {
     delete m_data_to_send;
+    delete m_state_buffer;
+    delete m_legacy_state;
+    delete m_peer_state;
+    if (m_peer_states_sent > 0)
+    {
+        Log::info("GameProtocol", "Sent %.1f bytes of game states per peer "
+            "per second.", (double)m_state_bytes_sent / m_peer_states_sent *
+            NetworkConfig::get()->getStateFrequency());
+    }
+    if (m_action_latency.getCount() > 0)
+    {
+        Log::info("GameProtocol", "Controller actions forwarded after: %s.",
+            m_action_latency.toString().c_str());
+    }
 }   // ~GameProtocol
 
 //-----------------------------------------------------------------------------
@@ -89,11 +135,26 @@ void GameProtocol::sendActions()
             "Too many actions unsent %d.", (int)m_all_actions.size());
         m_all_actions.resize(255);
     }
-    m_data_to_send->addUInt8(GP_CONTROLLER_ACTION)
-                   .addUInt8(uint8_t(m_all_actions.size()));
+    encodeActions(m_data_to_send, m_all_actions);
+
+    // FIXME: for now send reliable
+    Comm::sendToServer(m_data_to_send, PRM_RELIABLE);
+    m_all_actions.clear();
+}   // sendActions
+
+//-----------------------------------------------------------------------------
+/** Writes a controller action message with at most 255 actions.
+ *  \param ns The network string to write to (after the protocol type).
+ *  \param actions The actions to send.
+ */
+void GameProtocol::encodeActions(NetworkString* ns,
+                                 const std::vector<Action>& actions)
+{
+    assert(actions.size() <= 255);
+    ns->addUInt8(GP_CONTROLLER_ACTION).addUInt8(uint8_t(actions.size()));
 
     // Add all actions
-    for (auto& a : m_all_actions)
+    for (auto& a : actions)
     {
         if (Network::m_connection_debug)
         {
@@ -102,17 +163,38 @@ void GameProtocol::sendActions()
                 a.m_ticks, a.m_kart_id, a.m_action, a.m_value, a.m_value_l,
                 a.m_value_r);
         }
-        m_data_to_send->addUInt32(a.m_ticks);
-        m_data_to_send->addUInt8(a.m_kart_id);
+        ns->addUInt32(a.m_ticks);
+        ns->addUInt8(a.m_kart_id);
         const auto& c = compressAction(a);
-        m_data_to_send->addUInt8(std::get<0>(c)).addUInt16(std::get<1>(c))
+        ns->addUInt8(std::get<0>(c)).addUInt16(std::get<1>(c))
             .addUInt16(std::get<2>(c)).addUInt16(std::get<3>(c));
-    }   // for a in m_all_actions
+    }   // for a in actions
+}   // encodeActions
 
-    // FIXME: for now send reliable
-    Comm::sendToServer(m_data_to_send, PRM_RELIABLE);
-    m_all_actions.clear();
-}   // sendActions
+//-----------------------------------------------------------------------------
+/** Reads the actions of a controller action message written by
+ *  \ref encodeActions, the message type must have been read already.
+ *  \param ns The received message.
+ *  \param actions The decoded actions are appended to it.
+ */
+void GameProtocol::decodeActions(const NetworkString& ns,
+                                 std::vector<Action>* actions)
+{
+    uint8_t count = ns.getUInt8();
+    for (unsigned i = 0; i < count; i++)
+    {
+        Action a;
+        a.m_ticks = ns.getUInt32();
+        a.m_kart_id = ns.getUInt8();
+        uint8_t w = ns.getUInt8();
+        uint16_t x = ns.getUInt16();
+        uint16_t y = ns.getUInt16();
+        uint16_t z = ns.getUInt16();
+        std::tie(a.m_action, a.m_value, a.m_value_l, a.m_value_r) =
+            decompressAction(w, x, y, z);
+        actions->push_back(a);
+    }
+}   // decodeActions
 
 //-----------------------------------------------------------------------------
 /** Called when a message from a remote GameProtocol is received.
@@ -133,6 +215,9 @@ bool GameProtocol::notifyEventAsynchronous(Event* event)
     case GP_CONTROLLER_ACTION: handleControllerAction(event); break;
     case GP_STATE:             handleState(event);            break;
     case GP_ITEM_CONFIRMATION: handleItemEventConfirmation(event); break;
+    case GP_STATE_DELTA:       handleStateDelta(event);       break;
+    case GP_STATE_ACK:         handleStateAck(event);         break;
+    case GP_REWINDER_IDS:      handleRewinderIds(event);      break;
     case GP_ADJUST_TIME:
     case GP_ITEM_UPDATE:
         break;
@@ -169,7 +254,7 @@ void GameProtocol::controllerAction(int kart_id, PlayerAction action,
     const auto& c = compressAction(a);
     // Store the event in the rewind manager, which is responsible
     // for freeing the allocated memory
-    BareNetworkString *s = new BareNetworkString(4);
+    BareNetworkString *s = new BareNetworkString(8);
     s->addUInt8(kart_id).addUInt8(std::get<0>(c)).addUInt16(std::get<1>(c))
         .addUInt16(std::get<2>(c)).addUInt16(std::get<3>(c));
 
@@ -228,7 +313,7 @@ void GameProtocol::handleControllerAction(Event *event)
                 cur_ticks, kart_id, std::get<0>(a), std::get<1>(a),
                 std::get<2>(a), std::get<3>(a));
         }
-        BareNetworkString *s = new BareNetworkString(3);
+        BareNetworkString *s = new BareNetworkString(8);
         s->addUInt8(kart_id).addUInt8(w).addUInt16(x).addUInt16(y)
             .addUInt16(z);
         RewindManager::get()->addNetworkEvent(this, s, cur_ticks);
@@ -245,7 +330,10 @@ void GameProtocol::handleControllerAction(Event *event)
         // is after the server time
         peer->updateLastActivity();
         if (!will_trigger_rewind)
+        {
             STKHost::get()->sendPacketExcept(peer, &data, PRM_UNRELIABLE);
+            m_action_latency.addSince(event->getReceiveTime());
+        }
     }   // if server
 
 }   // handleControllerAction
@@ -282,61 +370,515 @@ void GameProtocol::handleItemEventConfirmation(Event *event)
 // ----------------------------------------------------------------------------
 /** Called by the server before assembling a new message containing the full
  *  state of the race to be sent to a client.
+ *  \return The buffer the rewinders write their state into.
  */
-void GameProtocol::startNewState()
+BareNetworkString* GameProtocol::startNewState()
 {
     assert(NetworkConfig::get()->isServer());
-    m_data_to_send->clear();
-    m_data_to_send->addUInt8(GP_STATE)
-        .addUInt32(World::getWorld()->getTicksSinceStart());
+    m_state_buffer->getBuffer().clear();
+    m_state_buffer->reset();
+    m_state_count = 0;
+    return m_state_buffer;
 }   // startNewState
 
 // ----------------------------------------------------------------------------
-/** Called by a server to add data to the current state. The data in buffer
- *  is copied, so the data can be freed after this call/.
- *  \param buffer Adds the data in the buffer to the current state.
+/** Called by a server after a rewinder has written its data to the state
+ *  buffer.
+ *  \param rewinder The rewinder which has written its state.
+ *  \param offset Offset of the size of the data in the state buffer, which
+ *         is written here.
  */
-void GameProtocol::addState(BareNetworkString *buffer)
+void GameProtocol::addState(const Rewinder* rewinder, unsigned offset)
 {
     assert(NetworkConfig::get()->isServer());
-    m_data_to_send->addUInt16(buffer->size());
-    (*m_data_to_send) += *buffer;
+    std::vector<uint8_t>& buffer = m_state_buffer->getBuffer();
+    const unsigned size = (unsigned)buffer.size() - offset - 2;
+    buffer[offset] = (size >> 8) & 0xff;
+    buffer[offset + 1] = size & 0xff;
+
+    if (m_state.m_rewinder_using.size() <= m_state_count)
+    {
+        m_state.m_rewinder_using.resize(m_state_count + 1);
+        m_state.m_rewinder_ids.resize(m_state_count + 1);
+        m_state_offsets.resize(m_state_count + 1);
+    }
+    m_state.m_rewinder_using[m_state_count] = rewinder->getUniqueIdentity();
+    m_state.m_rewinder_ids[m_state_count] = rewinder->getNetworkId();
+    m_state_offsets[m_state_count] = offset;
+    m_state_count++;
 }   // addState
 
 // ----------------------------------------------------------------------------
-/** Called by a server to finalize the current state, which add updated
- *  names of rewinder using to the beginning of state buffer
- *  \param cur_rewinder List of current rewinder using.
+/** Called by a server to finalize the current state, which writes the list
+ *  of rewinders used followed by the state buffer to the message.
  */
-void GameProtocol::finalizeState(std::vector<std::string>& cur_rewinder)
+void GameProtocol::finalizeState()
 {
     assert(NetworkConfig::get()->isServer());
-    auto& buffer = m_data_to_send->getBuffer();
-    auto pos = buffer.begin() + 1/*protocol type*/ + 1 /*gp event type*/+
-        4/*time*/;
+    m_state.m_ticks = World::getWorld()->getTicksSinceStart();
+    m_state.m_rewinder_using.resize(m_state_count);
+    m_state.m_rewinder_ids.resize(m_state_count);
 
-    m_data_to_send->reset();
-    std::vector<uint8_t> names;
-    names.push_back((uint8_t)cur_rewinder.size());
-    for (std::string& name : cur_rewinder)
+    m_data_to_send->clear();
+    m_data_to_send->addUInt8(GP_STATE).addUInt32(m_state.m_ticks);
+    StateHistory::writeRewinderList(m_state, true/*use_ids*/,
+        m_data_to_send);
+    (*m_data_to_send) += *m_state_buffer;
+    m_legacy_state_ready = false;
+    m_delta_state_count = 0;
+
+    if (m_state_history)
     {
-        names.push_back((uint8_t)name.size());
-        std::vector<uint8_t> rewinder(name.begin(), name.end());
-        names.insert(names.end(), rewinder.begin(), rewinder.end());
+        m_state.m_data.resize(m_state_count);
+        const std::vector<uint8_t>& buffer = m_state_buffer->getBuffer();
+        unsigned offset = 0;
+        for (unsigned i = 0; i < m_state_count; i++)
+        {
+            const unsigned size = (buffer[offset] << 8) | buffer[offset + 1];
+            m_state.m_data[i].assign((const char*)buffer.data() + offset + 2,
+                size);
+            offset += size + 2;
+        }
+        // Reuse the memory of the oldest state in the history
+        StateHistory::Snapshot snapshot;
+        m_state_history->recycle(&snapshot);
+        snapshot = m_state;
+        m_state_history->add(std::move(snapshot));
     }
-    buffer.insert(pos, names.begin(), names.end());
 }   // finalizeState
 
+// ----------------------------------------------------------------------------
+/** Returns the last state with the unique identities of the rewinders,
+ *  which is only created if a peer doesn't support network ids.
+ */
+NetworkString* GameProtocol::getLegacyState()
+{
+    if (m_legacy_state_ready)
+        return m_legacy_state;
+    m_legacy_state->clear();
+    m_legacy_state->addUInt8(GP_STATE).addUInt32(m_state.m_ticks);
+    StateHistory::writeRewinderList(m_state, false/*use_ids*/,
+        m_legacy_state);
+    (*m_legacy_state) += *m_state_buffer;
+    m_legacy_state_ready = true;
+    return m_legacy_state;
+}   // getLegacyState
+
+// ----------------------------------------------------------------------------
+/** Returns the last state encoded as a delta against the given baseline.
+ *  Peers acknowledging the same state share the same encoded delta.
+ */
+NetworkString* GameProtocol::getDeltaState(const StateHistory::Snapshot& base,
+                                           bool use_ids)
+{
+    for (unsigned i = 0; i < m_delta_state_count; i++)
+    {
+        DeltaState& ds = m_delta_states[i];
+        if (ds.m_baseline == base.m_ticks && ds.m_use_ids == use_ids)
+            return ds.m_data.get();
+    }
+    if (m_delta_state_count == m_delta_states.size())
+    {
+        m_delta_states.emplace_back();
+        m_delta_states.back().m_data.reset(getNetworkString());
+    }
+    DeltaState& ds = m_delta_states[m_delta_state_count++];
+    ds.m_baseline = base.m_ticks;
+    ds.m_use_ids = use_ids;
+    ds.m_data->clear();
+    ds.m_data->addUInt8(GP_STATE_DELTA).addUInt32(m_state.m_ticks)
+        .addUInt32(base.m_ticks);
+    StateHistory::encodeDelta(base, m_state, use_ids, ds.m_data.get());
+    return ds.m_data.get();
+}   // getDeltaState
+
+// ----------------------------------------------------------------------------
+/** Returns if a peer gets the network ids of the rewinders instead of their
+ *  unique identities in states. */
+bool GameProtocol::useRewinderIds(const STKPeer* peer)
+{
+    return peer->getClientCapabilities().find("rewinder_id") !=
+        peer->getClientCapabilities().end();
+}   // useRewinderIds
+
+// ----------------------------------------------------------------------------
+/** Sends the network ids which a peer doesn't know yet, reliable so they
+ *  arrive before any following state using them.
+ */
+void GameProtocol::sendRewinderIds(STKPeer* peer)
+{
+    const std::vector<std::string>& names =
+        RewindManager::get()->getNetworkNames();
+    unsigned sent = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_acked_states_mutex);
+        unsigned& count = m_rewinder_ids_sent[peer->getHostId()];
+        if (count >= names.size())
+            return;
+        sent = count;
+        count = (unsigned)names.size();
+    }
+    NetworkString* ns = getNetworkString();
+    ns->addUInt8(GP_REWINDER_IDS).addUInt16((uint16_t)(sent + 1))
+        .addUInt16((uint16_t)(names.size() - sent));
+    for (unsigned i = sent; i < names.size(); i++)
+        ns->encodeString(names[i]);
+    peer->sendPacket(ns, PRM_RELIABLE);
+    delete ns;
+}   // sendRewinderIds
+
+// ----------------------------------------------------------------------------
+/** On a client adds the network ids sent by the server. On the server
+ *  handles a request of a client missing some ids, with the number of ids
+ *  it knows, they will be sent again with the next state.
+ */
+void GameProtocol::handleRewinderIds(Event *event)
+{
+    NetworkString &data = event->data();
+    if (NetworkConfig::get()->isServer())
+    {
+        unsigned known = data.getUInt16();
+        std::lock_guard<std::mutex> lock(m_acked_states_mutex);
+        unsigned& count = m_rewinder_ids_sent[event->getPeer()->getHostId()];
+        count = std::min(count, known);
+        return;
+    }
+    unsigned first_id = data.getUInt16();
+    unsigned count = data.getUInt16();
+    if (first_id == 0 || first_id > m_rewinder_names.size() + 1)
+    {
+        // Ids in between are missing, which should never happen with
+        // reliable packets
+        Log::warn("GameProtocol", "Ignored rewinder ids from %d, %d known.",
+            first_id, (int)m_rewinder_names.size());
+        requestRewinderIds();
+        return;
+    }
+    m_rewinder_names.resize(first_id - 1 + count);
+    for (unsigned i = 0; i < count; i++)
+        data.decodeString(&m_rewinder_names[first_id - 1 + i]);
+}   // handleRewinderIds
+
+// ----------------------------------------------------------------------------
+/** Called on a client if a state uses network ids which are unknown, asks
+ *  the server to send all ids which the client doesn't know (at most once
+ *  per second).
+ */
+void GameProtocol::requestRewinderIds()
+{
+    uint64_t now = StkTime::getMonoTimeMs();
+    if (now < m_rewinder_ids_request_time + 1000)
+        return;
+    m_rewinder_ids_request_time = now;
+    NetworkString *ns = getNetworkString(3);
+    ns->addUInt8(GP_REWINDER_IDS)
+        .addUInt16((uint16_t)m_rewinder_names.size());
+    Comm::sendToServer(ns, PRM_RELIABLE);
+    delete ns;
+}   // requestRewinderIds
+
+// ----------------------------------------------------------------------------
+/** Selects the rewinders of the last state which are sent to a peer
+ *  supporting partial states. Its own karts and all other rewinders are
+ *  always sent, each other kart adds its relevance (1 up to the interest
+ *  distance from the nearest kart of the peer, then decreasing down to 1/8)
+ *  to its priority and is sent once that reaches 1. If the state is larger
+ *  than the bandwidth budget of the peer, the karts with the lowest
+ *  priority are skipped too, so they are sent first next time.
+ *  \return Which rewinders are sent (by index in the state), or NULL if
+ *          all are sent.
+ */
+const std::vector<bool>* GameProtocol::selectRewinders(const STKPeer* peer,
+                                                      PeerInterest* interest)
+{
+    if (interest->m_sent.empty())
+        interest->m_sent.resize(SERVER_STATE_HISTORY + 1);
+    // One more entry than states in the history, so the one of any
+    // baseline is still available
+    auto& entry = interest->m_sent[interest->m_next_sent];
+    interest->m_next_sent =
+        (interest->m_next_sent + 1) % (unsigned)interest->m_sent.size();
+    entry.first = m_state.m_ticks;
+    entry.second.clear();
+
+    World* world = World::getWorld();
+    const unsigned num_karts = world->getNumKarts();
+    m_interest_positions.clear();
+    for (unsigned i = 0; i < num_karts; i++)
+    {
+        if (RaceManager::get()->getKartInfo(i).getHostId() ==
+            peer->getHostId())
+            m_interest_positions.push_back(world->getKart(i)->getXYZ());
+    }
+    // Spectators get all karts
+    if (m_interest_positions.empty())
+        return NULL;
+
+    if (interest->m_priority.size() < num_karts)
+        interest->m_priority.resize(num_karts, 1.0f);
+    const float distance = ServerConfig::m_state_interest_distance;
+    const std::vector<uint8_t>& buffer = m_state_buffer->getBuffer();
+    unsigned state_size = m_data_to_send->getTotalSize();
+    bool skipped = false;
+    entry.second.assign(m_state_count, true);
+    m_interest_candidates.clear();
+    for (unsigned i = 0; i < m_state_count; i++)
+    {
+        const std::string& name = m_state.m_rewinder_using[i];
+        if (name.size() != 2 || name[0] != RN_KART ||
+            (uint8_t)name[1] >= num_karts)
+            continue;
+        const unsigned kart_id = (uint8_t)name[1];
+        if (RaceManager::get()->getKartInfo(kart_id).getHostId() ==
+            peer->getHostId())
+            continue;
+
+        float relevance = 1.0f;
+        if (distance > 0.0f)
+        {
+            const Vec3& xyz = world->getKart(kart_id)->getXYZ();
+            float nearest = std::numeric_limits<float>::max();
+            for (const Vec3& own : m_interest_positions)
+                nearest = std::min(nearest, (xyz - own).length2());
+            nearest = sqrtf(nearest);
+            if (nearest > distance)
+                relevance = std::max(distance / nearest, 0.125f);
+        }
+        float& priority = interest->m_priority[kart_id];
+        priority += relevance;
+        if (priority < 1.0f)
+        {
+            const unsigned offset = m_state_offsets[i];
+            state_size -= (buffer[offset] << 8) | buffer[offset + 1];
+            entry.second[i] = false;
+            skipped = true;
+            continue;
+        }
+        m_interest_candidates.emplace_back(priority, i);
+    }
+
+    const int budget = ServerConfig::m_state_bandwidth_budget;
+    const unsigned max_size = budget > 0 ?
+        budget / NetworkConfig::get()->getStateFrequency() :
+        std::numeric_limits<unsigned>::max();
+    if (state_size > max_size)
+    {
+        std::sort(m_interest_candidates.begin(),
+            m_interest_candidates.end());
+        for (auto& candidate : m_interest_candidates)
+        {
+            if (state_size <= max_size)
+                break;
+            const unsigned offset = m_state_offsets[candidate.second];
+            state_size -= (buffer[offset] << 8) | buffer[offset + 1];
+            entry.second[candidate.second] = false;
+            skipped = true;
+        }
+    }
+    for (auto& candidate : m_interest_candidates)
+    {
+        if (entry.second[candidate.second])
+        {
+            const std::string& name =
+                m_state.m_rewinder_using[candidate.second];
+            interest->m_priority[(uint8_t)name[1]] = 0.0f;
+        }
+    }
+    if (!skipped)
+    {
+        entry.second.clear();
+        return NULL;
+    }
+    return &entry.second;
+}   // selectRewinders
+
+// ----------------------------------------------------------------------------
+/** Returns the last state for a single peer, with the data of the skipped
+ *  rewinders left empty.
+ *  \param base Baseline for a delta state, or NULL for a full state.
+ *  \param base_sent Rewinders sent in the baseline, NULL if all.
+ *  \param sent Rewinders sent now, NULL if all.
+ */
+NetworkString* GameProtocol::getPeerState(const StateHistory::Snapshot* base,
+                                          const std::vector<bool>* base_sent,
+                                          const std::vector<bool>* sent,
+                                          bool use_ids)
+{
+    m_peer_state->clear();
+    if (base)
+    {
+        m_peer_state->addUInt8(GP_STATE_DELTA).addUInt32(m_state.m_ticks)
+            .addUInt32(base->m_ticks);
+        StateHistory::encodeDelta(*base, m_state, use_ids, m_peer_state,
+            base_sent, sent);
+        return m_peer_state;
+    }
+    assert(sent);
+    m_peer_state->addUInt8(GP_STATE).addUInt32(m_state.m_ticks);
+    StateHistory::writeRewinderList(m_state, use_ids, m_peer_state);
+    const std::vector<uint8_t>& buffer = m_state_buffer->getBuffer();
+    std::vector<uint8_t>& out = m_peer_state->getBuffer();
+    for (unsigned i = 0; i < m_state_count; i++)
+    {
+        if (!(*sent)[i])
+        {
+            m_peer_state->addUInt16(0);
+            continue;
+        }
+        const unsigned offset = m_state_offsets[i];
+        const unsigned size = (buffer[offset] << 8) | buffer[offset + 1];
+        out.insert(out.end(), buffer.begin() + offset,
+            buffer.begin() + offset + size + 2);
+    }
+    return m_peer_state;
+}   // getPeerState
+
 // ----------------------------------------------------------------------------
 /** Called when the last state information has been added and the message
- *  can be sent to the clients.
+ *  can be sent to the clients. Peers supporting it get the network ids of
+ *  new rewinders first and states using them. If state delta compression is
+ *  used, each peer supporting it gets the state encoded against the latest
+ *  state it has acknowledged, if that one is still in the history. Peers
+ *  supporting partial states get distant karts less often, see
+ *  selectRewinders.
  */
 void GameProtocol::sendState()
 {
     assert(NetworkConfig::get()->isServer());
-    Comm::sendMessageToPeers(m_data_to_send, PRM_UNRELIABLE);
+    STKPeerList peers = STKHost::get()->getPeers();
+    unsigned id_peers = 0;
+    unsigned legacy_peers = 0;
+    for (auto& peer : peers)
+    {
+        if (!peer->isValidated() || peer->isWaitingForGame())
+            continue;
+        if (useRewinderIds(peer.get()))
+        {
+            sendRewinderIds(peer.get());
+            id_peers++;
+        }
+        else
+            legacy_peers++;
+    }
+
+    const bool use_interest = ServerConfig::m_state_interest_distance > 0.0f ||
+        ServerConfig::m_state_bandwidth_budget > 0;
+    if (!m_state_history && !use_interest)
+    {
+        m_state_bytes_sent +=
+            (uint64_t)id_peers * m_data_to_send->getTotalSize();
+        m_peer_states_sent += id_peers;
+        if (legacy_peers == 0)
+        {
+            Comm::sendMessageToPeers(m_data_to_send, PRM_UNRELIABLE);
+            return;
+        }
+        m_state_bytes_sent +=
+            (uint64_t)legacy_peers * getLegacyState()->getTotalSize();
+        m_peer_states_sent += legacy_peers;
+        STKHost::get()->sendPacketToAllPeersWith(
+            [](std::shared_ptr<STKPeer> peer)
+            {
+                return !peer->isWaitingForGame() &&
+                    useRewinderIds(peer.get());
+            }, m_data_to_send, PRM_UNRELIABLE);
+        STKHost::get()->sendPacketToAllPeersWith(
+            [](std::shared_ptr<STKPeer> peer)
+            {
+                return !peer->isWaitingForGame() &&
+                    !useRewinderIds(peer.get());
+            }, getLegacyState(), PRM_UNRELIABLE);
+        return;
+    }
+
+    for (auto& peer : peers)
+    {
+        if (!peer->isValidated() || peer->isWaitingForGame())
+            continue;
+        const bool use_ids = useRewinderIds(peer.get());
+        PeerInterest* interest = NULL;
+        const std::vector<bool>* sent = NULL;
+        if (use_interest &&
+            peer->getClientCapabilities().find("state_interest") !=
+            peer->getClientCapabilities().end())
+        {
+            interest = &m_peer_interests[peer->getHostId()];
+            sent = selectRewinders(peer.get(), interest);
+        }
+        const StateHistory::Snapshot* base = NULL;
+        if (m_state_history &&
+            peer->getClientCapabilities().find("state_delta") !=
+            peer->getClientCapabilities().end())
+        {
+            std::lock_guard<std::mutex> lock(m_acked_states_mutex);
+            auto it = m_acked_states.find(peer->getHostId());
+            if (it != m_acked_states.end())
+                base = m_state_history->find(it->second);
+        }
+        // The baseline can only be used if it is known which rewinders the
+        // peer got in it
+        const std::vector<bool>* base_sent = NULL;
+        if (base && interest)
+        {
+            auto it = std::find_if(interest->m_sent.begin(),
+                interest->m_sent.end(),
+                [base](const std::pair<int, std::vector<bool> >& entry)
+                {
+                    return entry.first == base->m_ticks;
+                });
+            if (it == interest->m_sent.end())
+                base = NULL;
+            else if (!it->second.empty())
+                base_sent = &it->second;
+        }
+
+        NetworkString* ns = NULL;
+        if (sent || base_sent)
+            ns = getPeerState(base, base_sent, sent, use_ids);
+        else if (base)
+            ns = getDeltaState(*base, use_ids);
+        else
+            ns = use_ids ? m_data_to_send : getLegacyState();
+        m_state_bytes_sent += ns->getTotalSize();
+        m_peer_states_sent++;
+        peer->sendPacket(ns, PRM_UNRELIABLE);
+    }
 }   // sendState
 
+// ----------------------------------------------------------------------------
+/** Called on the server when a client acknowledges that it has a state,
+ *  which can then be used as baseline for the next delta states.
+ */
+void GameProtocol::handleStateAck(Event *event)
+{
+    if (!NetworkConfig::get()->isServer() || !m_state_history)
+        return;
+    uint32_t ticks = event->data().getUInt32();
+    uint32_t host_id = event->getPeer()->getHostId();
+    std::lock_guard<std::mutex> lock(m_acked_states_mutex);
+    // The client failed to use a delta state, send a full state next time
+    if (ticks == std::numeric_limits<uint32_t>::max())
+    {
+        m_acked_states.erase(host_id);
+        return;
+    }
+    auto it = m_acked_states.find(host_id);
+    if (it == m_acked_states.end() || it->second < (int)ticks)
+        m_acked_states[host_id] = ticks;
+}   // handleStateAck
+
+// ----------------------------------------------------------------------------
+/** Sends to the server the ticks of a state which has been saved in the
+ *  history, or -1 to request a full state.
+ */
+void GameProtocol::sendStateAck(int ticks)
+{
+    NetworkString *ns = getNetworkString(5);
+    ns->addUInt8(GP_STATE_ACK).addUInt32((uint32_t)ticks);
+    Comm::sendToServer(ns, PRM_UNRELIABLE);
+    delete ns;
+}   // sendStateAck
+
 // ----------------------------------------------------------------------------
 /** Called when a new full state is received form the server.
  */
@@ -348,13 +890,30 @@ void GameProtocol::handleState(Event *event)
     int ticks          = data.getUInt32();
 
     // Check for updated rewinder using
-    unsigned rewinder_size = data.getUInt8();
-    std::vector<std::string> rewinder_using;
-    for (unsigned i = 0; i < rewinder_size; i++)
+    const int names_offset = data.getCurrentOffset();
+    StateHistory::Snapshot snapshot;
+    snapshot.m_ticks = ticks;
+    if (!StateHistory::readRewinderList(data,
+        m_use_rewinder_ids ? &m_rewinder_names : NULL, &snapshot))
     {
-        std::string name;
-        data.decodeString(&name);
-        rewinder_using.push_back(name);
+        Log::debug("GameProtocol", "State %d with unknown rewinder id.",
+            ticks);
+        requestRewinderIds();
+        return;
+    }
+    std::vector<std::string> rewinder_using = snapshot.m_rewinder_using;
+
+    if (m_state_history)
+    {
+        const int state_offset = data.getCurrentOffset();
+        data.reset();
+        data.skip(names_offset);
+        StateHistory::readFull(data,
+            m_use_rewinder_ids ? &m_rewinder_names : NULL, &snapshot);
+        data.reset();
+        data.skip(state_offset);
+        if (m_state_history->add(std::move(snapshot)))
+            sendStateAck(ticks);
     }
 
     // The memory for bns will be handled in the RewindInfoState object
@@ -363,6 +922,56 @@ void GameProtocol::handleState(Event *event)
     RewindManager::get()->addNetworkRewindInfo(ris);
 }   // handleState
 
+// ----------------------------------------------------------------------------
+/** Called when a state encoded against a previous state is received from the
+ *  server. The full state is rebuilt and then handled like a full state.
+ */
+void GameProtocol::handleStateDelta(Event *event)
+{
+    if (!NetworkConfig::get()->isClient() || !m_state_history)
+        return;
+    NetworkString &data = event->data();
+    int ticks = data.getUInt32();
+    int baseline_ticks = data.getUInt32();
+    const StateHistory::Snapshot* base =
+        m_state_history->find(baseline_ticks);
+    if (!base)
+    {
+        Log::debug("GameProtocol", "Missing baseline state %d for %d.",
+            baseline_ticks, ticks);
+        sendStateAck(-1);
+        return;
+    }
+
+    StateHistory::Snapshot snapshot;
+    snapshot.m_ticks = ticks;
+    try
+    {
+        StateHistory::decodeDelta(*base, data,
+            m_use_rewinder_ids ? &m_rewinder_names : NULL, &snapshot);
+    }
+    catch (std::exception& e)
+    {
+        Log::warn("GameProtocol", "Invalid delta state %d: %s", ticks,
+            e.what());
+        sendStateAck(-1);
+        if (m_use_rewinder_ids)
+            requestRewinderIds();
+        return;
+    }
+
+    BareNetworkString full;
+    StateHistory::writeFull(snapshot, &full);
+    std::vector<std::string> rewinder_using = snapshot.m_rewinder_using;
+    if (m_state_history->add(std::move(snapshot)))
+        sendStateAck(ticks);
+
+    // The memory for bns will be handled in the RewindInfoState object
+    RewindInfoState* ris = new RewindInfoState(ticks, 0, rewinder_using,
+        full.getBuffer());
+    RewindManager::get()->addNetworkRewindInfo(ris);
+}   // handleStateDelta
+
 // ----------------------------------------------------------------------------
 /** Called from the RewindManager when rolling back.
  *  \param buffer Pointer to the saved state information.
@@ -21,12 +21,17 @@
 
 #include "network/event_rewinder.hpp"
 #include "network/protocol.hpp"
+#include "network/state_history.hpp"
 
 #include "input/input.hpp"                // for PlayerAction
 #include "utils/cpp2011.hpp"
+#include "utils/loop_stats.hpp"
 #include "utils/stk_process.hpp"
+#include "utils/vec3.hpp"
 
 #include <cstdlib>
+#include <map>
+#include <memory>
 #include <mutex>
 #include <vector>
 #include <tuple>
@@ -34,32 +39,24 @@
 class BareNetworkString;
 class NetworkItemManager;
 class NetworkString;
+class Rewinder;
 class STKPeer;
 
 class GameProtocol : public Protocol
                    , public EventRewinder
 {
-private:
-    /* Used to check if deleting world is doing at the same the for
-     * asynchronous event update. */
-    mutable std::mutex m_world_deleting_mutex;
-
+public:
     /** The type of game events to be forwarded to the server. */
     enum { GP_CONTROLLER_ACTION,
            GP_STATE,
            GP_ITEM_UPDATE,
            GP_ITEM_CONFIRMATION,
-           GP_ADJUST_TIME
+           GP_ADJUST_TIME,
+           GP_STATE_DELTA,
+           GP_STATE_ACK,
+           GP_REWINDER_IDS
     };
 
-    /** A network string that collects all information from the server to be sent
-     *  next. */
-    NetworkString *m_data_to_send;
-
-    /** The server might request that the world clock of a client is adjusted
-     *  to reduce number of rollbacks. */
-    std::vector<int8_t> m_adjust_time;
-
     // Dummy data structure to save all kart actions.
     struct Action
     {
@@ -71,6 +68,121 @@ private:
         int          m_value_r;
     };   // struct Action
 
+private:
+    /* Used to check if deleting world is doing at the same the for
+     * asynchronous event update. */
+    mutable std::mutex m_world_deleting_mutex;
+
+    /** A network string that collects all information from the server to be sent
+     *  next. */
+    NetworkString *m_data_to_send;
+
+    /** Server only: the rewinders write their state data into this buffer,
+     *  which is reused for each state. */
+    BareNetworkString *m_state_buffer;
+
+    /** Server only: the last saved state. The rewinder data is only copied
+     *  into it if \ref m_state_history is used. */
+    StateHistory::Snapshot m_state;
+
+    /** Server only: number of rewinders in the state being saved. */
+    unsigned m_state_count;
+
+    /** Server only: offset of the data of each rewinder (starting with its
+     *  size) in \ref m_state_buffer. */
+    std::vector<unsigned> m_state_offsets;
+
+    /** Server only: the last state using unique identities of rewinders,
+     *  for peers not supporting network ids. */
+    NetworkString *m_legacy_state;
+
+    /** Server only: if \ref m_legacy_state contains the last state. */
+    bool m_legacy_state_ready;
+
+    /** Server only: delta states of the last state, by baseline ticks and
+     *  if network ids are used. Only the first \ref m_delta_state_count
+     *  are valid, the others are kept to be reused. */
+    struct DeltaState
+    {
+        int m_baseline;
+        bool m_use_ids;
+        std::unique_ptr<NetworkString> m_data;
+    };
+    std::vector<DeltaState> m_delta_states;
+
+    unsigned m_delta_state_count;
+
+    /** Server only: relevance of the karts for a peer supporting partial
+     *  states, and which rewinders were sent in its last states. */
+    struct PeerInterest
+    {
+        /** Accumulated relevance of each kart by world kart id, a kart is
+         *  sent when it reaches 1. */
+        std::vector<float> m_priority;
+        /** Ticks of the last states sent and the rewinders sent in each (by
+         *  index in the state), empty if all were sent. */
+        std::vector<std::pair<int, std::vector<bool> > > m_sent;
+        unsigned m_next_sent;
+        PeerInterest() : m_next_sent(0) {}
+    };
+
+    /** Server only: interest of each peer with host id as key. */
+    std::map<uint32_t, PeerInterest> m_peer_interests;
+
+    /** Server only: state with skipped rewinders sent to a single peer,
+     *  reused for each peer. */
+    NetworkString *m_peer_state;
+
+    /** Server only: priority and index of karts which can be skipped for a
+     *  peer to stay below the bandwidth budget. */
+    std::vector<std::pair<float, unsigned> > m_interest_candidates;
+
+    /** Server only: positions of the karts of a peer. */
+    std::vector<Vec3> m_interest_positions;
+
+    /** Server only: total size and number of states sent to all peers. */
+    uint64_t m_state_bytes_sent;
+
+    uint64_t m_peer_states_sent;
+
+    /** Server only: time from receiving controller actions until they are
+     *  queued to be sent to the other peers. */
+    LatencyHistogram m_action_latency;
+
+    /** Number of states kept by the server for delta compression. */
+    static const unsigned SERVER_STATE_HISTORY = 32;
+
+    /** Recent states, sent ones on server or received ones on client, used
+     *  to encode (decode) a state as a delta against an acknowledged state.
+     *  NULL if state delta compression is not used. */
+    std::unique_ptr<StateHistory> m_state_history;
+
+    /** Server only: latest state ticks acknowledged by each peer (with host
+     *  id as key), as baseline for the next delta state. */
+    std::map<uint32_t, int> m_acked_states;
+
+    /** Server only: number of rewinder network ids sent to each peer (with
+     *  host id as key). */
+    std::map<uint32_t, unsigned> m_rewinder_ids_sent;
+
+    /** Protect \ref m_acked_states and \ref m_rewinder_ids_sent, which are
+     *  updated in the asynchronous event handling. */
+    std::mutex m_acked_states_mutex;
+
+    /** Client only: unique identities of the rewinders by network id - 1,
+     *  as received from the server. */
+    std::vector<std::string> m_rewinder_names;
+
+    /** Client only: if the server sends network ids of rewinders. */
+    bool m_use_rewinder_ids;
+
+    /** Client only: time when the missing network ids were requested. */
+    uint64_t m_rewinder_ids_request_time;
+
+    /** The server might request that the world clock of a client is adjusted
+     *  to reduce number of rollbacks. */
+    std::vector<int8_t> m_adjust_time;
+
     // List of all kart actions to send to the server
     std::vector<Action> m_all_actions;
 
@@ -78,10 +190,25 @@ private:
     void handleState(Event *event);
     void handleAdjustTime(Event *event);
     void handleItemEventConfirmation(Event *event);
+    void handleStateDelta(Event *event);
+    void handleStateAck(Event *event);
+    void sendStateAck(int ticks);
+    void handleRewinderIds(Event *event);
+    void requestRewinderIds();
+    void sendRewinderIds(STKPeer* peer);
+    NetworkString* getLegacyState();
+    NetworkString* getDeltaState(const StateHistory::Snapshot& base,
+                                 bool use_ids);
+    const std::vector<bool>* selectRewinders(const STKPeer* peer,
+                                             PeerInterest* interest);
+    NetworkString* getPeerState(const StateHistory::Snapshot* base,
+                                const std::vector<bool>* base_sent,
+                                const std::vector<bool>* sent, bool use_ids);
+    static bool useRewinderIds(const STKPeer* peer);
     static std::weak_ptr<GameProtocol> m_game_protocol[PT_COUNT];
     NetworkItemManager* m_network_item_manager;
     // Maximum value of values are only 32768
-    std::tuple<uint8_t, uint16_t, uint16_t, uint16_t>
+    static std::tuple<uint8_t, uint16_t, uint16_t, uint16_t>
                                                 compressAction(const Action& a)
     {
         uint8_t w = (uint8_t)(a.m_action & 63) |
@@ -91,7 +218,7 @@ private:
         uint16_t z = (uint16_t)std::abs(a.m_value_r);
         return std::make_tuple(w, x, y, z);
     }
-    std::tuple<PlayerAction, int, int, int>
+    static std::tuple<PlayerAction, int, int, int>
                decompressAction(uint8_t w, uint16_t x, uint16_t y , uint16_t z)
     {
         PlayerAction a = (PlayerAction)(w & 63);
@@ -103,6 +230,9 @@ private:
         return std::make_tuple(a, b, c, d);
     }
 public:
+    /** Largest network id of a rewinder, see StateHistory. */
+    static const uint16_t MAX_REWINDER_ID = 0x7fff;
+
              GameProtocol();
     virtual ~GameProtocol();
 
@@ -111,10 +241,14 @@ public:
     void sendActions();
     void controllerAction(int kart_id, PlayerAction action,
                           int value, int val_l, int val_r);
-    void startNewState();
-    void addState(BareNetworkString *buffer);
+    static void encodeActions(NetworkString* ns,
+                              const std::vector<Action>& actions);
+    static void decodeActions(const NetworkString& ns,
+                              std::vector<Action>* actions);
+    BareNetworkString* startNewState();
+    void addState(const Rewinder* rewinder, unsigned offset);
     void sendState();
-    void finalizeState(std::vector<std::string>& cur_rewinder);
+    void finalizeState();
     void sendItemEventConfirmation(int ticks);
 
     virtual void undo(BareNetworkString *buffer) OVERRIDE;
@@ -30,8 +30,10 @@
 #include "network/database_connector.hpp"
 #include "network/event.hpp"
 #include "network/game_setup.hpp"
+#include "network/load_generator.hpp"
 #include "network/network_config.hpp"
 #include "network/network_player_profile.hpp"
+#include "network/packet_compressor.hpp"
 #include "network/packet_types.hpp"
 #include "network/protocol_manager.hpp"
 #include "network/protocols/connect_to_peer.hpp"
@@ -492,74 +494,76 @@ void ServerLobby::pollDatabase()
 
     db_connector->updatePollTime();
 
-    std::vector<DatabaseConnector::IpBanTableData> ip_ban_list =
-            db_connector->getIpBanTableData();
-    std::vector<DatabaseConnector::Ipv6BanTableData> ipv6_ban_list =
-            db_connector->getIpv6BanTableData();
-    std::vector<DatabaseConnector::OnlineIdBanTableData> online_id_ban_list =
-            db_connector->getOnlineIdBanTableData();
-
-    for (std::shared_ptr<STKPeer> p : STKHost::get()->getPeers())
+    // The ban tables are read in the database thread, peers are kicked
+    // when the result arrives
+    db_connector->pollBanTables([](
+        const std::vector<DatabaseConnector::IpBanTableData>& ip_ban_list,
+        const std::vector<DatabaseConnector::Ipv6BanTableData>& ipv6_ban_list,
+        const std::vector<DatabaseConnector::OnlineIdBanTableData>&
+        online_id_ban_list)
     {
-        if (p->isAIPeer())
-            continue;
-        bool is_kicked = false;
-        std::string address = "";
-        std::string reason = "";
-        std::string description = "";
-
-        if (p->getAddress().isIPv6())
+        for (std::shared_ptr<STKPeer> p : STKHost::get()->getPeers())
         {
-            address = p->getAddress().toString(false);
-            if (address.empty())
+            if (p->isAIPeer())
                 continue;
-            for (auto& item: ipv6_ban_list)
+            bool is_kicked = false;
+            std::string address = "";
+            std::string reason = "";
+            std::string description = "";
+
+            if (p->getAddress().isIPv6())
             {
-                if (insideIPv6CIDR(item.ipv6_cidr.c_str(), address.c_str()) == 1)
+                address = p->getAddress().toString(false);
+                if (address.empty())
+                    continue;
+                for (auto& item: ipv6_ban_list)
                 {
-                    is_kicked = true;
-                    reason = item.reason;
-                    description = item.description;
-                    break;
+                    if (insideIPv6CIDR(item.ipv6_cidr.c_str(), address.c_str()) == 1)
+                    {
+                        is_kicked = true;
+                        reason = item.reason;
+                        description = item.description;
+                        break;
+                    }
                 }
             }
-        }
-        else
-        {
-            uint32_t peer_addr = p->getAddress().getIP();
-            address = p->getAddress().toString();
-            for (auto& item: ip_ban_list)
+            else
             {
-                if (item.ip_start <= peer_addr && item.ip_end >= peer_addr)
+                uint32_t peer_addr = p->getAddress().getIP();
+                address = p->getAddress().toString();
+                for (auto& item: ip_ban_list)
                 {
-                    is_kicked = true;
-                    reason = item.reason;
-                    description = item.description;
-                    break;
+                    if (item.ip_start <= peer_addr && item.ip_end >= peer_addr)
+                    {
+                        is_kicked = true;
+                        reason = item.reason;
+                        description = item.description;
+                        break;
+                    }
                 }
             }
-        }
-        if (!is_kicked && !p->getPlayerProfiles().empty())
-        {
-            uint32_t online_id = p->getMainProfile()->getOnlineId();
-            for (auto& item: online_id_ban_list)
+            if (!is_kicked && !p->getPlayerProfiles().empty())
             {
-                if (item.online_id == online_id)
+                uint32_t online_id = p->getMainProfile()->getOnlineId();
+                for (auto& item: online_id_ban_list)
                 {
-                    is_kicked = true;
-                    reason = item.reason;
-                    description = item.description;
-                    break;
+                    if (item.online_id == online_id)
+                    {
+                        is_kicked = true;
+                        reason = item.reason;
+                        description = item.description;
+                        break;
+                    }
                 }
             }
-        }
-        if (is_kicked)
-        {
-            Log::info("ServerLobby", "Kick %s, reason: %s, description: %s",
-                address.c_str(), reason.c_str(), description.c_str());
-            p->kick();
-        }
-    } // for p in peers
+            if (is_kicked)
+            {
+                Log::info("ServerLobby", "Kick %s, reason: %s, description: %s",
+                    address.c_str(), reason.c_str(), description.c_str());
+                p->kick();
+            }
+        } // for p in peers
+    });
 
     db_connector->clearOldReports();
 
@@ -601,17 +605,22 @@ void ServerLobby::writePlayerReport(Event* event)
         return;
     auto reporting_npp = reporting_peer->getMainProfile();
 
-    bool written = db_connector->writeReport(reporter, reporter_npp,
-            reporting_peer, reporting_npp, info);
-    if (written)
+    std::weak_ptr<STKPeer> reporter_wp = reporter;
+    core::stringw reporting_name = reporting_npp->getName();
+    db_connector->writeReport(reporter, reporter_npp,
+            reporting_peer, reporting_npp, info,
+            [this, reporter_wp, reporting_name](bool written)
     {
+        std::shared_ptr<STKPeer> reporter = reporter_wp.lock();
+        if (!written || !reporter)
+            return;
         NetworkString* success = getNetworkString();
         success->setSynchronous(true);
         success->addUInt8(LE_REPORT_PLAYER).addUInt8(1)
-            .encodeString(reporting_npp->getName());
-        event->getPeer()->sendPacket(success, PRM_RELIABLE);
+            .encodeString(reporting_name);
+        reporter->sendPacket(success, PRM_RELIABLE);
         delete success;
-    }
+    });
 #endif
 }   // writePlayerReport
 
@@ -627,8 +636,10 @@ void ServerLobby::asynchronousUpdate()
     }
 
     getChatManager()->clearAllExpiredWeakPtrs();
+    LoadGenerator::handleCalls();
 
 #ifdef ENABLE_SQLITE3
+    getDbConnector()->handleCallbacks();
     pollDatabase();
 #endif
 
@@ -869,7 +880,7 @@ void ServerLobby::asynchronousUpdate()
             for (auto peer : peers)
             {
                 if (peer->alwaysSpectate() && (!peer->alwaysSpectateForReal() ||
-                    peer->getClientAssets().second.count(track_name) == 0))
+                    !peer->getClientTracks().contains(track_name)))
                 {
                     previous_spectate_mode[peer] = peer->getAlwaysSpectate();
                     peer->setAlwaysSpectate(ASM_NONE);
@@ -1943,7 +1954,7 @@ void ServerLobby::startSelection(const Event *event)
            .addUInt8(getSettings()->hasTrackVoting() ? 1 : 0);
 
 
-        std::set<std::string> all_k = peer->getClientAssets().first;
+        std::set<std::string> all_k = peer->getClientKarts().toSet();
         std::string username = peer->getMainName();
         // std::string username = StringUtils::wideToUtf8(profile->getName());
         getAssetManager()->applyAllKartFilters(username, all_k);
@@ -2301,7 +2312,12 @@ bool ServerLobby::handleAssetsAndAddonScores(std::shared_ptr<STKPeer> peer,
         const std::set<std::string>& client_karts,
         const std::set<std::string>& client_maps)
 {
-    if (!getAssetManager()->handleAssetsForPeer(peer, client_karts, client_maps))
+    // Assets unknown to the server are kept in the peer only, so clients
+    // cannot grow the AssetIndex
+    std::set<std::string> unknown_karts, unknown_maps;
+    AssetBitset karts(client_karts, &unknown_karts);
+    AssetBitset maps(client_maps, &unknown_maps);
+    if (!getAssetManager()->handleAssetsForPeer(peer, karts, maps))
     {
         if (peer->isValidated())
         {
@@ -2338,11 +2354,13 @@ bool ServerLobby::handleAssetsAndAddonScores(std::shared_ptr<STKPeer> peer,
     }
 
 
-    std::array<int, AS_TOTAL> addons_scores = getAssetManager()->getAddonScores(client_karts, client_maps);
+    std::array<int, AS_TOTAL> addons_scores = getAssetManager()->getAddonScores(karts, maps);
 
     // Save available karts and tracks from clients in STKPeer so if this peer
     // disconnects later in lobby it won't affect current players
-    peer->setAvailableKartsTracks(client_karts, client_maps);
+    peer->setAvailableKartsTracks(karts, maps);
+    peer->setUnknownKartsTracks(std::move(unknown_karts),
+        std::move(unknown_maps));
     peer->setAddonsScores(addons_scores);
 
     if (m_process_type == PT_CHILD &&
@@ -2415,6 +2433,8 @@ void ServerLobby::connectionRequested(Event* event)
         caps.insert(cap);
     }
     event->getPeer()->setClientCapabilities(caps);
+    event->getPeer()->setCompression(PacketCompressor::isSupported(
+        event->getPeer()->getClientCapabilities()));
 
     std::set<std::string> client_karts, client_maps;
     getClientAssetsFromNetworkString(data, client_karts, client_maps);
@@ -3005,9 +3025,10 @@ void ServerLobby::updateServerOwner(bool force)
     if (!force && !m_server_owner.expired())
         return;
 
-    auto peers = STKHost::get()->getPeers();
+    std::vector<std::shared_ptr<STKPeer> > peers =
+        STKHost::get()->getPeers();
 
-    if (m_process_type != PT_MAIN)
+    if (isChildProcess())
     {
         auto id = m_client_server_host_id.load();
         for (unsigned i = 0; i < peers.size(); )
@@ -3725,11 +3746,11 @@ void ServerLobby::handleServerConfiguration(std::shared_ptr<STKPeer> peer,
     auto peers = STKHost::get()->getPeers();
     for (auto& peer : peers)
     {
-        auto assets = peer->getClientAssets();
-        if (!peer->isValidated() || assets.second.empty()) // this check will fail hard when I introduce vavriable limits
+        const AssetBitset& client_maps = peer->getClientTracks();
+        if (!peer->isValidated() || client_maps.empty()) // this check will fail hard when I introduce vavriable limits
             continue;
 
-        if (getAssetManager()->checkIfNoCommonMaps(assets))
+        if (getAssetManager()->checkIfNoCommonMaps(client_maps))
         {
             NetworkString *message = getNetworkString(2);
             message->setSynchronous(true);
@@ -4294,21 +4315,27 @@ void ServerLobby::writeOwnReport(std::shared_ptr<STKPeer> reporter, std::shared_
         return;
     auto reporting_npp = reporting->getMainProfile();
 
-    bool written = db_connector->writeReport(reporter, reporter_npp,
-            reporting, reporting_npp, info_w);
-    if (written)
+    std::weak_ptr<STKPeer> reporter_wp = reporter;
+    bool own = reporter == reporting;
+    core::stringw reporting_name = reporting_npp->getName();
+    db_connector->writeReport(reporter, reporter_npp,
+            reporting, reporting_npp, info_w,
+            [this, reporter_wp, own, reporting_name](bool written)
     {
+        std::shared_ptr<STKPeer> reporter = reporter_wp.lock();
+        if (!written || !reporter)
+            return;
         NetworkString* success = getNetworkString();
         success->setSynchronous(true);
-        if (reporter == reporting)
+        if (own)
             success->addUInt8(LE_REPORT_PLAYER).addUInt8(1)
                 .encodeString(m_game_setup->getServerNameUtf8());
         else
             success->addUInt8(LE_REPORT_PLAYER).addUInt8(1)
-                .encodeString(reporting_npp->getName());
+                .encodeString(reporting_name);
         reporter->sendPacket(success, PRM_RELIABLE);
         delete success;
-    }
+    });
 #endif
 }   // writeOwnReport
 //-----------------------------------------------------------------------------
@@ -4390,8 +4417,13 @@ int ServerLobby::getPermissions(std::shared_ptr<STKPeer> peer) const
 }   // getPermissions
 //-----------------------------------------------------------------------------
 
+/** Queues a report of the player to the database. Returns false if the
+ *  report cannot be written at all, otherwise the result of the write is
+ *  passed to \p callback in the main thread once the query is done.
+ */
 bool ServerLobby::writeOnePlayerReport(std::shared_ptr<STKPeer> reporter,
-    const std::string& table, const std::string& info)
+    const std::string& table, const std::string& info,
+    std::function<void(bool)> callback)
 {
 #ifdef ENABLE_SQLITE3
     auto db_connector = getDbConnector();
@@ -4404,9 +4436,9 @@ bool ServerLobby::writeOnePlayerReport(std::shared_ptr<STKPeer> reporter,
     auto reporter_npp = reporter->getMainProfile();
     auto info_w = StringUtils::utf8ToWide(info);
 
-    bool written = db_connector->writeReport(reporter, reporter_npp,
-            reporter, reporter_npp, info_w);
-    return written;
+    db_connector->writeReport(reporter, reporter_npp,
+            reporter, reporter_npp, info_w, callback);
+    return true;
 #else
     return false;
 #endif
@@ -4546,8 +4578,12 @@ bool ServerLobby::isClientServerHost(const std::shared_ptr<STKPeer>& peer)
 
 void ServerLobby::setTimeoutFromNow(int seconds)
 {
-    m_timeout.store((int64_t)StkTime::getMonoTimeMs() +
-            (int64_t)(seconds * 1000.0f));
+    const int64_t timeout = (int64_t)StkTime::getMonoTimeMs() +
+            (int64_t)(seconds * 1000.0f);
+    m_timeout.store(timeout);
+    // Check it in the asynchronous update as soon as it is expired
+    if (auto pm = ProtocolManager::lock())
+        pm->scheduleAsynchronousUpdate(timeout + 1);
 }   // setTimeoutFromNow
 //-----------------------------------------------------------------------------
 
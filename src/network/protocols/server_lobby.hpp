@@ -330,7 +330,7 @@ public:
     void writeOwnReport(std::shared_ptr<STKPeer> reporter, std::shared_ptr<STKPeer> reporting,
         const std::string& info);
     bool writeOnePlayerReport(std::shared_ptr<STKPeer> reporter, const std::string& table,
-        const std::string& info);
+        const std::string& info, std::function<void(bool)> callback);
     // int getTrackMaxPlayers(std::string& name) const;
 
     // TODO: When using different decorators for everyone, you would need
@@ -150,7 +150,9 @@ void RewindManager::addNetworkState(BareNetworkString *buffer, int ticks)
 
 // ----------------------------------------------------------------------------
 /** Saves a state using the GameProtocol function to combine several
- *  independent rewinders to write one state.
+ *  independent rewinders to write one state. All rewinders write directly
+ *  into the state buffer of the GameProtocol, which is reused for each
+ *  state, each state data is prefixed with its size.
  */
 void RewindManager::saveState()
 {
@@ -158,26 +160,22 @@ void RewindManager::saveState()
     auto gp = GameProtocol::lock();
     if (!gp)
         return;
-    gp->startNewState();
-
-    m_overall_state_size = 0;
-    std::vector<std::string> rewinder_using;
+    BareNetworkString* buffer = gp->startNewState();
 
     for (auto& p : m_all_rewinder)
     {
-        // TODO: check if it's worth passing in a sufficiently large buffer from
-        // GameProtocol - this would save the copy operation.
-        BareNetworkString* buffer = NULL;
-        if (auto r = p.second.lock())
-            buffer = r->saveState(&rewinder_using);
-        if (buffer != NULL)
-        {
-            m_overall_state_size += buffer->size();
-            gp->addState(buffer);
-        }
-        delete buffer;    // buffer can be freed
+        auto r = p.second.lock();
+        if (!r)
+            continue;
+        const unsigned offset = buffer->getTotalSize();
+        buffer->addUInt16(0);
+        if (r->saveState(buffer))
+            gp->addState(r.get(), offset);
+        else
+            buffer->getBuffer().resize(offset);
     }
-    gp->finalizeState(rewinder_using);
+    m_overall_state_size = buffer->getTotalSize();
+    gp->finalizeState();
     PROFILER_POP_CPU_MARKER();
 }   // saveState
 
@@ -276,7 +274,21 @@ bool RewindManager::addRewinder(std::shared_ptr<Rewinder> rewinder)
     // Maximum 1 bit to store no of rewinder used
     if (m_all_rewinder.size() == 255)
         return false;
-    m_all_rewinder[rewinder->getUniqueIdentity()] = rewinder;
+    const std::string& name = rewinder->getUniqueIdentity();
+    m_all_rewinder[name] = rewinder;
+    if (NetworkConfig::get()->isServer())
+    {
+        auto it = m_network_ids.find(name);
+        if (it != m_network_ids.end())
+            rewinder->setNetworkId(it->second);
+        else if (m_network_names.size() < GameProtocol::MAX_REWINDER_ID)
+        {
+            m_network_names.push_back(name);
+            uint16_t id = (uint16_t)m_network_names.size();
+            m_network_ids[name] = id;
+            rewinder->setNetworkId(id);
+        }
+    }
     return true;
 }   // addRewinder
 
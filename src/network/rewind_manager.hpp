@@ -96,10 +96,19 @@ private:
     /** A list of all objects that can be rewound. */
     std::map<std::string, std::weak_ptr<Rewinder> > m_all_rewinder;
 
+    /** Server only: unique identities of all rewinders added in this race,
+     *  the network id of a rewinder is its index + 1. Entries are never
+     *  removed, so clients can be sent the new entries only. */
+    std::vector<std::string> m_network_names;
+
+    /** Server only: network id of each unique identity in
+     *  \ref m_network_names, so a re-added rewinder keeps its id. */
+    std::map<std::string, uint16_t> m_network_ids;
+
     /** The queue that stores all rewind infos. */
     RewindQueue m_rewind_queue;
 
-    /** Overall amount of memory allocated by states. */
+    /** Size of the last saved state. */
     unsigned int m_overall_state_size;
 
     /** Indicates if currently a rewind is happening. */
@@ -190,6 +199,10 @@ public:
     // ------------------------------------------------------------------------
     bool addRewinder(std::shared_ptr<Rewinder> rewinder);
     // ------------------------------------------------------------------------
+    /** Returns the unique identities of rewinders by network id - 1. */
+    const std::vector<std::string>& getNetworkNames() const
+                                                   { return m_network_names; }
+    // ------------------------------------------------------------------------
     /** Returns true if currently a rewind is happening. */
     bool isRewinding() const { return m_is_rewinding; }
 
@@ -19,6 +19,8 @@
 #ifndef HEADER_REWINDER_HPP
 #define HEADER_REWINDER_HPP
 
+#include "utils/types.hpp"
+
 #include <cassert>
 #include <functional>
 #include <string>
@@ -56,8 +58,17 @@ private:
     */
     std::string m_unique_identity;
 
+    /** Compact identity used in states sent by the server instead of the
+     *  unique identity, assigned by RewindManager::addRewinder on the server.
+     *  0 if none is assigned. */
+    uint16_t m_network_id;
+
 public:
-    Rewinder(const std::string& ui = "")             { m_unique_identity = ui; }
+    Rewinder(const std::string& ui = "")
+    {
+        m_unique_identity = ui;
+        m_network_id = 0;
+    }
 
     virtual ~Rewinder() {}
 
@@ -70,12 +81,13 @@ public:
      *  caused by the rewind (which is then visually smoothed over time). */
     virtual void computeError() = 0;
 
-    /** Provides a copy of the state of the object in one memory buffer.
-     *  The memory is managed by the RewindManager.
-     *  \param[out] ru The unique identity of rewinder writing to.
-     *  \return The address of the memory buffer with the state.
+    /** Appends the state of the object to the state which is currently
+     *  assembled by the RewindManager. Anything written is discarded if
+     *  false is returned.
+     *  \param buffer The state buffer, which is shared by all rewinders.
+     *  \return False if this rewinder has no state to send.
      */
-    virtual BareNetworkString* saveState(std::vector<std::string>* ru) = 0;
+    virtual bool saveState(BareNetworkString* buffer) = 0;
 
     /** Called when an event needs to be undone. This is called while going
      *  backwards for rewinding - all stored events will get an 'undo' call.
@@ -114,6 +126,10 @@ public:
     // -------------------------------------------------------------------------
     bool rewinderAdd();
     // -------------------------------------------------------------------------
+    uint16_t getNetworkId() const                     { return m_network_id; }
+    // -------------------------------------------------------------------------
+    void setNetworkId(uint16_t id)                      { m_network_id = id; }
+    // -------------------------------------------------------------------------
     template<typename T> std::shared_ptr<T> getShared()
                     { return std::dynamic_pointer_cast<T>(shared_from_this()); }
 
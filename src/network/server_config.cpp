@@ -43,6 +43,7 @@ static std::vector<UserConfigParam*> g_server_params;
 #include "network/protocols/lobby_protocol.hpp"
 #include "network/stk_host.hpp"
 #include "race/race_manager.hpp"
+#include "utils/stk_process.hpp"
 #include "utils/string_utils.hpp"
 
 #include <fstream>
@@ -490,4 +491,16 @@ std::string getConfigDirectory()
     return StringUtils::getPath(g_server_config_path[0]);
 }   // getConfigDirectory
 
+// ----------------------------------------------------------------------------
+/** Returns the server uid used for the database tables of the current lobby,
+ *  the first lobby of a multi-lobby server keeps the plain server uid so its
+ *  existing tables are reused. */
+std::string getLobbyUid()
+{
+    unsigned lobby = STKProcess::getLobbyNumber();
+    if (lobby > 1)
+        return m_server_uid + "_lobby" + StringUtils::toString(lobby);
+    return m_server_uid;
+}   // getLobbyUid
+
 }
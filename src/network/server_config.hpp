@@ -99,6 +99,15 @@ namespace ServerConfig
         "set random-server-port to '1' in user config. STK will automatically "
         "switch to a random port if the port you specify fails to be bound."));
 
+    SERVER_CFG_PREFIX IntServerConfigParam m_server_lobbies
+        SERVER_CFG_DEFAULT(IntServerConfigParam(1, "server-lobbies",
+        "Number of lobbies hosted by this server process, each one is a "
+        "separate server with its own players and games. Lobby n listens on "
+        "server-port + n - 1 and appends #n to server-name (except the first "
+        "one). Karts, tracks and this configuration are loaded only once for "
+        "all lobbies. Only used by dedicated servers, the network console "
+        "controls the first lobby."));
+
     SERVER_CFG_PREFIX IntServerConfigParam m_server_mode
         SERVER_CFG_DEFAULT(IntServerConfigParam(3, "server-mode",
         "Game mode in server, 0 is normal race (grand prix), "
@@ -124,6 +133,34 @@ namespace ServerConfig
         "Enable wan server, which requires you to have an stk-addons account "
         "with a saved session. Check init-user command for details."));
 
+    SERVER_CFG_PREFIX BoolServerConfigParam m_state_delta_compression
+        SERVER_CFG_DEFAULT(BoolServerConfigParam(true,
+        "state-delta-compression", "If true, game states are sent to clients "
+        "supporting it as a delta against the latest state they "
+        "acknowledged, which reduces upload bandwidth a lot with many "
+        "players."));
+
+    SERVER_CFG_PREFIX FloatServerConfigParam m_state_interest_distance
+        SERVER_CFG_DEFAULT(FloatServerConfigParam(50.0f,
+        "state-interest-distance", "Karts further away than this distance "
+        "(in meters) from all karts of a player are sent less often in game "
+        "states to clients supporting it, down to every 8th state. Set to 0 "
+        "to send all karts in every state."));
+
+    SERVER_CFG_PREFIX IntServerConfigParam m_state_bandwidth_budget
+        SERVER_CFG_DEFAULT(IntServerConfigParam(0,
+        "state-bandwidth-budget", "Maximum number of bytes per second of game "
+        "states sent to each client supporting it, the least relevant karts "
+        "are skipped first. Karts of the player, items and projectiles are "
+        "always sent. Set to 0 for no limit."));
+
+    SERVER_CFG_PREFIX IntServerConfigParam m_crypto_threads
+        SERVER_CFG_DEFAULT(IntServerConfigParam(2, "crypto-threads",
+        "Number of threads encrypting and decrypting the packets of clients, "
+        "so the network thread only sends and receives ready packets. The "
+        "packets of a client are always handled by the same thread in "
+        "order. Set to 0 to do it in the network and game threads."));
+
     SERVER_CFG_PREFIX BoolServerConfigParam m_enable_console
         SERVER_CFG_DEFAULT(BoolServerConfigParam(false, "enable-console",
         "Enable network console, which can do for example kickban."));
@@ -525,6 +562,13 @@ namespace ServerConfig
         "more rewind, which clients with slow device may have problem playing "
         "this server, use the default value is recommended."));
 
+    SERVER_CFG_PREFIX BoolServerConfigParam m_track_collision_cache
+        SERVER_CFG_DEFAULT(BoolServerConfigParam(true,
+        "track-collision-cache",
+        "Save the collision data of tracks in the cache directory when they "
+        "are loaded for the first time, which makes loading them again "
+        "faster, especially for large addon tracks."));
+
     SERVER_CFG_PREFIX BoolServerConfigParam m_sql_management
         SERVER_CFG_DEFAULT(BoolServerConfigParam(false,
         "sql-management",
@@ -862,6 +906,8 @@ namespace ServerConfig
     void loadServerLobbyFromConfig();
     // ------------------------------------------------------------------------
     std::string getConfigDirectory();
+    // ------------------------------------------------------------------------
+    std::string getLobbyUid();
 
 };   // namespace ServerConfig
 
@@ -0,0 +1,397 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2026 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "network/state_history.hpp"
+
+#include "network/network_string.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+// ----------------------------------------------------------------------------
+/** Adds a new state, dropping the oldest one if the history is full. States
+ *  older than the latest saved one (e.g. received out of order) are ignored.
+ *  \return True if the state was added.
+ */
+bool StateHistory::add(Snapshot&& snapshot)
+{
+    if (!m_snapshots.empty() && m_snapshots.back().m_ticks >= snapshot.m_ticks)
+        return false;
+    m_snapshots.push_back(std::move(snapshot));
+    while (m_snapshots.size() > m_max_size)
+        m_snapshots.pop_front();
+    return true;
+}   // add
+
+// ----------------------------------------------------------------------------
+/** Moves the oldest state out of a full history, so its memory can be
+ *  reused for the next state. Nothing is done if the history is not full.
+ */
+void StateHistory::recycle(Snapshot* snapshot)
+{
+    if (m_snapshots.size() < m_max_size)
+        return;
+    *snapshot = std::move(m_snapshots.front());
+    m_snapshots.pop_front();
+}   // recycle
+
+// ----------------------------------------------------------------------------
+/** Returns the state saved at the given ticks, or NULL if it is not (or no
+ *  longer) available. */
+const StateHistory::Snapshot* StateHistory::find(int ticks) const
+{
+    // Usually the baseline is one of the last states
+    for (auto it = m_snapshots.rbegin(); it != m_snapshots.rend(); it++)
+    {
+        if (it->m_ticks == ticks)
+            return &(*it);
+        if (it->m_ticks < ticks)
+            break;
+    }
+    return NULL;
+}   // find
+
+// ----------------------------------------------------------------------------
+/** Writes the list of rewinders in use of a state.
+ *  \param use_ids If the network ids are written instead of the unique
+ *         identities.
+ */
+void StateHistory::writeRewinderList(const Snapshot& snapshot, bool use_ids,
+                                     BareNetworkString* out)
+{
+    out->addUInt8((uint8_t)snapshot.m_rewinder_using.size());
+    for (unsigned i = 0; i < snapshot.m_rewinder_using.size(); i++)
+    {
+        if (!use_ids)
+        {
+            out->encodeString(snapshot.m_rewinder_using[i]);
+            continue;
+        }
+        uint16_t id = snapshot.m_rewinder_ids[i];
+        if (id == 0)
+        {
+            out->addUInt8(0).encodeString(snapshot.m_rewinder_using[i]);
+        }
+        else if (id < 128)
+            out->addUInt8((uint8_t)id);
+        else
+            out->addUInt16(id | 0x8000);
+    }
+}   // writeRewinderList
+
+// ----------------------------------------------------------------------------
+/** Reads the list of rewinders in use of a state.
+ *  \param names The unique identities by network id - 1 known so far, or
+ *         NULL if the list contains unique identities.
+ *  \return False if a network id is not in names.
+ */
+bool StateHistory::readRewinderList(BareNetworkString& in,
+                                    const std::vector<std::string>* names,
+                                    Snapshot* out)
+{
+    unsigned count = in.getUInt8();
+    out->m_rewinder_using.resize(count);
+    bool known = true;
+    for (unsigned i = 0; i < count; i++)
+    {
+        if (!names)
+        {
+            in.decodeString(&out->m_rewinder_using[i]);
+            continue;
+        }
+        unsigned id = in.getUInt8();
+        if (id == 0)
+        {
+            in.decodeString(&out->m_rewinder_using[i]);
+            continue;
+        }
+        if (id & 0x80)
+            id = ((id & 0x7f) << 8) | in.getUInt8();
+        if (id > names->size())
+        {
+            known = false;
+            out->m_rewinder_using[i].clear();
+        }
+        else
+            out->m_rewinder_using[i] = (*names)[id - 1];
+    }
+    return known;
+}   // readRewinderList
+
+// ----------------------------------------------------------------------------
+/** Reads the rewinder list and the rewinder data of a full state, the
+ *  ticks of the state has to be read (and set) by the caller. Throws if the
+ *  state uses an unknown network id.
+ *  \param names See readRewinderList.
+ */
+void StateHistory::readFull(BareNetworkString& in,
+                            const std::vector<std::string>* names,
+                            Snapshot* out)
+{
+    if (!readRewinderList(in, names, out))
+        throw std::invalid_argument("Unknown rewinder id.");
+    unsigned count = (unsigned)out->m_rewinder_using.size();
+    out->m_data.resize(count);
+    for (unsigned i = 0; i < count; i++)
+    {
+        uint16_t size = in.getUInt16();
+        if (size > in.size())
+            throw std::out_of_range("State data out of range.");
+        out->m_data[i].assign(in.getCurrentData(), size);
+        in.skip(size);
+    }
+}   // readFull
+
+// ----------------------------------------------------------------------------
+/** Writes the rewinder data of a state in the format RewindInfoState reads,
+ *  i.e. each rewinder data prefixed with its size. The rewinder names are
+ *  not written.
+ */
+void StateHistory::writeFull(const Snapshot& snapshot, BareNetworkString* out)
+{
+    for (const std::string& data : snapshot.m_data)
+    {
+        out->addUInt16((uint16_t)data.size());
+        out->getBuffer().insert(out->getBuffer().end(), data.begin(),
+            data.end());
+    }
+}   // writeFull
+
+// ----------------------------------------------------------------------------
+/** Writes cur XOR base (which have the same size) as a list of (number of
+ *  zero bytes skipped, number of bytes following, bytes) tuples.
+ */
+void StateHistory::encodeXOR(const std::string& base, const std::string& cur,
+                             BareNetworkString* out)
+{
+    assert(base.size() == cur.size());
+    const size_t size = cur.size();
+    size_t pos = 0;
+    while (pos < size)
+    {
+        uint8_t skip = 0;
+        while (pos < size && skip < 255 && base[pos] == cur[pos])
+        {
+            skip++;
+            pos++;
+        }
+        out->addUInt8(skip);
+        // Stop a literal run only if at least 3 equal bytes follow, as a new
+        // tuple costs 2 bytes
+        size_t literal_start = pos;
+        while (pos < size && pos - literal_start < 255)
+        {
+            if (base[pos] == cur[pos] && (pos + 2 >= size ||
+                (base[pos + 1] == cur[pos + 1] &&
+                base[pos + 2] == cur[pos + 2])))
+                break;
+            pos++;
+        }
+        out->addUInt8((uint8_t)(pos - literal_start));
+        for (size_t i = literal_start; i < pos; i++)
+            out->addUInt8((uint8_t)(base[i] ^ cur[i]));
+    }
+}   // encodeXOR
+
+// ----------------------------------------------------------------------------
+void StateHistory::decodeXOR(const std::string& base,
+                             BareNetworkString& in, std::string* out)
+{
+    *out = base;
+    const size_t size = base.size();
+    size_t pos = 0;
+    while (pos < size)
+    {
+        pos += in.getUInt8();
+        unsigned literal = in.getUInt8();
+        if (pos + literal > size)
+            throw std::out_of_range("State delta out of range.");
+        for (unsigned i = 0; i < literal; i++, pos++)
+            (*out)[pos] = (char)((uint8_t)base[pos] ^ in.getUInt8());
+    }
+}   // decodeXOR
+
+// ----------------------------------------------------------------------------
+/** Encodes cur as a delta against base, see the class description for the
+ *  format. The ticks of both states are written by the caller.
+ *  \param use_ids See writeRewinderList.
+ */
+void StateHistory::encodeDelta(const Snapshot& base, const Snapshot& cur,
+                               bool use_ids, BareNetworkString* out,
+                               const std::vector<bool>* base_sent,
+                               const std::vector<bool>* cur_sent)
+{
+    writeRewinderList(cur, use_ids, out);
+    static const std::string empty;
+
+    // The rewinders of a state are sorted by their unique identity (see
+    // RewindManager::saveState), so the baseline is searched only once
+    unsigned j = 0;
+    for (unsigned i = 0; i < cur.m_rewinder_using.size(); i++)
+    {
+        const std::string& data =
+            !cur_sent || (*cur_sent)[i] ? cur.m_data[i] : empty;
+        const std::string& name = cur.m_rewinder_using[i];
+        while (j < base.m_rewinder_using.size() &&
+            base.m_rewinder_using[j] < name)
+            j++;
+        if (j < base.m_rewinder_using.size() &&
+            base.m_rewinder_using[j] == name)
+        {
+            const std::string& base_data =
+                !base_sent || (*base_sent)[j] ? base.m_data[j] : empty;
+            if (base_data == data)
+            {
+                out->addUInt8(SD_UNCHANGED);
+                continue;
+            }
+            if (base_data.size() == data.size())
+            {
+                // Write the XOR in place and fall back to the full data if
+                // it is not smaller
+                const unsigned offset = out->getTotalSize();
+                out->addUInt8(SD_XOR);
+                encodeXOR(base_data, data, out);
+                if (out->getTotalSize() - offset - 1 < data.size() + 2)
+                    continue;
+                out->getBuffer().resize(offset);
+            }
+        }
+        out->addUInt8(SD_FULL).addUInt16((uint16_t)data.size());
+        out->getBuffer().insert(out->getBuffer().end(), data.begin(),
+            data.end());
+    }
+}   // encodeDelta
+
+// ----------------------------------------------------------------------------
+/** Rebuilds a full state from a delta created by encodeDelta. Throws if the
+ *  delta doesn't match the baseline.
+ *  \param names See readRewinderList.
+ */
+void StateHistory::decodeDelta(const Snapshot& base, BareNetworkString& in,
+                               const std::vector<std::string>* names,
+                               Snapshot* out)
+{
+    if (!readRewinderList(in, names, out))
+        throw std::invalid_argument("Unknown rewinder id.");
+    unsigned count = (unsigned)out->m_rewinder_using.size();
+    out->m_data.resize(count);
+    for (unsigned i = 0; i < count; i++)
+    {
+        uint8_t mode = in.getUInt8();
+        if (mode == SD_FULL)
+        {
+            uint16_t size = in.getUInt16();
+            if (size > in.size())
+                throw std::out_of_range("State data out of range.");
+            out->m_data[i].assign(in.getCurrentData(), size);
+            in.skip(size);
+            continue;
+        }
+        auto it = std::find(base.m_rewinder_using.begin(),
+            base.m_rewinder_using.end(), out->m_rewinder_using[i]);
+        if (it == base.m_rewinder_using.end())
+            throw std::invalid_argument("Missing rewinder in baseline.");
+        const std::string& base_data =
+            base.m_data[it - base.m_rewinder_using.begin()];
+        if (mode == SD_UNCHANGED)
+            out->m_data[i] = base_data;
+        else if (mode == SD_XOR)
+            decodeXOR(base_data, in, &out->m_data[i]);
+        else
+            throw std::invalid_argument("Unknown state delta mode.");
+    }
+}   // decodeDelta
+
+// ----------------------------------------------------------------------------
+void StateHistory::unitTesting()
+{
+    Snapshot base;
+    base.m_ticks = 10;
+    base.m_rewinder_using = { "a", "b", "c", "d" };
+    base.m_data = { "same", std::string(300, 'x'), "short", "gone" };
+
+    Snapshot cur;
+    cur.m_ticks = 20;
+    cur.m_rewinder_using = { "a", "b", "c", "e" };
+    std::string changed(300, 'x');
+    changed[0] = 'y';
+    changed[150] = 'z';
+    changed[151] = 'z';
+    changed[299] = 'w';
+    cur.m_data = { "same", changed, "longer", std::string("\0\1", 2) };
+
+    BareNetworkString delta;
+    encodeDelta(base, cur, false/*use_ids*/, &delta);
+    assert(delta.getTotalSize() < 50);
+
+    Snapshot decoded;
+    decodeDelta(base, delta, NULL, &decoded);
+    assert(delta.size() == 0);
+    assert(decoded.m_rewinder_using == cur.m_rewinder_using);
+    assert(decoded.m_data == cur.m_data);
+
+    // Network ids of one and two bytes, and a rewinder without id
+    cur.m_rewinder_ids = { 1, 200, 0, 3 };
+    std::vector<std::string> names(200);
+    names[0] = "a";
+    names[2] = "e";
+    names[199] = "b";
+    BareNetworkString id_delta;
+    encodeDelta(base, cur, true/*use_ids*/, &id_delta);
+    assert(id_delta.getTotalSize() < delta.getTotalSize());
+    decodeDelta(base, id_delta, &names, &decoded);
+    assert(id_delta.size() == 0);
+    assert(decoded.m_rewinder_using == cur.m_rewinder_using);
+    assert(decoded.m_data == cur.m_data);
+    id_delta.reset();
+    names.resize(3);
+    assert(!readRewinderList(id_delta, &names, &decoded));
+
+    // Skipped data in the baseline and in the new state
+    std::vector<bool> base_sent = { true, false, true, true };
+    std::vector<bool> cur_sent = { false, true, true, true };
+    BareNetworkString skip_delta;
+    encodeDelta(base, cur, false/*use_ids*/, &skip_delta, &base_sent,
+        &cur_sent);
+    Snapshot skipped_base = base;
+    skipped_base.m_data[1].clear();
+    decodeDelta(skipped_base, skip_delta, NULL, &decoded);
+    assert(skip_delta.size() == 0);
+    assert(decoded.m_data[0].empty() && decoded.m_data[1] == changed);
+
+    // Full state round trip
+    BareNetworkString full;
+    writeRewinderList(cur, false/*use_ids*/, &full);
+    writeFull(cur, &full);
+    readFull(full, NULL, &decoded);
+    assert(decoded.m_data == cur.m_data);
+
+    StateHistory history(2);
+    history.add(std::move(base));
+    history.add(std::move(cur));
+    assert(history.find(10) && history.find(20));
+    Snapshot old;
+    old.m_ticks = 15;
+    history.add(std::move(old));
+    assert(!history.find(15));
+    Snapshot next;
+    next.m_ticks = 30;
+    history.add(std::move(next));
+    assert(!history.find(10) && history.find(30));
+}   // unitTesting
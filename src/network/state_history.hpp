@@ -0,0 +1,123 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2026 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_STATE_HISTORY_HPP
+#define HEADER_STATE_HISTORY_HPP
+
+#include "utils/types.hpp"
+
+#include <deque>
+#include <string>
+#include <vector>
+
+class BareNetworkString;
+
+/** \ingroup network
+ *  Keeps the last few full states (split into the data of each rewinder),
+ *  so that a new state can be encoded as a delta against an older state
+ *  which the receiver has acknowledged. The server keeps one history shared
+ *  by all peers, each client keeps the states it has reconstructed.
+ *
+ *  The list of rewinders in use of a state contains either the unique
+ *  identities of the rewinders, or their network ids if the client supports
+ *  it (see GameProtocol::MAX_REWINDER_ID). A network id below 128 takes one
+ *  byte, a larger one two bytes with the highest bit of the first byte set,
+ *  and 0 is followed by the unique identity of a rewinder without id.
+ *
+ *  A delta starts with the list of rewinders in use (same as in a full
+ *  state), followed for each rewinder by a mode byte:
+ *  - SD_UNCHANGED: the data is identical to the one in the baseline.
+ *  - SD_XOR: the data has the same size as in the baseline, it is sent as
+ *    the XOR against the baseline, with runs of zero bytes skipped.
+ *  - SD_FULL: the data is sent as is, prefixed with its size.
+ *
+ *  The server may skip the data of some karts in a state sent to a peer
+ *  (see GameProtocol::sendState), they are kept in the list of rewinders
+ *  with empty data, both in the state and in the history of the peer.
+ */
+class StateHistory
+{
+public:
+    /** One full state, rewinder names and the corresponding data have the
+     *  same index. */
+    struct Snapshot
+    {
+        int m_ticks;
+        std::vector<std::string> m_rewinder_using;
+        /** Server only: network ids of the rewinders, 0 if none. */
+        std::vector<uint16_t> m_rewinder_ids;
+        std::vector<std::string> m_data;
+    };
+
+private:
+    enum StateDeltaMode : uint8_t
+    {
+        SD_UNCHANGED = 0,
+        SD_XOR = 1,
+        SD_FULL = 2
+    };
+
+    /** Saved states, oldest first. */
+    std::deque<Snapshot> m_snapshots;
+
+    /** Maximum number of states kept. */
+    unsigned m_max_size;
+
+    static void encodeXOR(const std::string& base, const std::string& cur,
+                          BareNetworkString* out);
+    static void decodeXOR(const std::string& base,
+                          BareNetworkString& in, std::string* out);
+
+public:
+    StateHistory(unsigned max_size) : m_max_size(max_size) {}
+    // ------------------------------------------------------------------------
+    bool add(Snapshot&& snapshot);
+    // ------------------------------------------------------------------------
+    void recycle(Snapshot* snapshot);
+    // ------------------------------------------------------------------------
+    const Snapshot* find(int ticks) const;
+    // ------------------------------------------------------------------------
+    void clear()                                       { m_snapshots.clear(); }
+    // ------------------------------------------------------------------------
+    bool empty() const                         { return m_snapshots.empty(); }
+    // ------------------------------------------------------------------------
+    static void writeRewinderList(const Snapshot& snapshot, bool use_ids,
+                                  BareNetworkString* out);
+    // ------------------------------------------------------------------------
+    static bool readRewinderList(BareNetworkString& in,
+                                 const std::vector<std::string>* names,
+                                 Snapshot* out);
+    // ------------------------------------------------------------------------
+    static void readFull(BareNetworkString& in,
+                         const std::vector<std::string>* names, Snapshot* out);
+    // ------------------------------------------------------------------------
+    static void writeFull(const Snapshot& snapshot, BareNetworkString* out);
+    // ------------------------------------------------------------------------
+    static void encodeDelta(const Snapshot& base, const Snapshot& cur,
+                            bool use_ids, BareNetworkString* out,
+                            const std::vector<bool>* base_sent = NULL,
+                            const std::vector<bool>* cur_sent = NULL);
+    // ------------------------------------------------------------------------
+    static void decodeDelta(const Snapshot& base, BareNetworkString& in,
+                            const std::vector<std::string>* names,
+                            Snapshot* out);
+    // ------------------------------------------------------------------------
+    static void unitTesting();
+};   // class StateHistory
+
+#endif
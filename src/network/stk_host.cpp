@@ -23,6 +23,7 @@
 #include "config/stk_config.hpp"
 #include "config/user_config.hpp"
 #include "io/file_manager.hpp"
+#include "network/crypto_pipeline.hpp"
 #include "network/event.hpp"
 #include "network/game_setup.hpp"
 #include "network/network.hpp"
@@ -31,6 +32,7 @@
 #include "network/network_player_profile.hpp"
 #include "network/network_string.hpp"
 #include "network/network_timer_synchronizer.hpp"
+#include "network/packet_compressor.hpp"
 #include "network/protocols/connect_to_peer.hpp"
 #include "network/protocols/server_lobby.hpp"
 #include "network/protocol_manager.hpp"
@@ -279,6 +281,9 @@ STKHost::STKHost(bool server)
         addr.port = ServerConfig::m_server_port;
         if (addr.port == 0 && !UserConfigParams::m_random_server_port)
             addr.port = STKConfig::get()->m_server_port;
+        // Lobbies of a multi-lobby server use the following ports
+        if (addr.port != 0 && STKProcess::getLobbyNumber() > 1)
+            addr.port += STKProcess::getLobbyNumber() - 1;
         // Reserve 1 peer to deliver full server message
         int peer_count = ServerConfig::m_server_max_players + 1;
         // 1 more peer to hold ai peer
@@ -321,8 +326,18 @@ void STKHost::init()
     m_shutdown         = false;
     m_authorised       = false;
     m_network          = NULL;
+    m_peers            = std::make_shared<PeerTable>();
+    m_peers_updates.store(0);
+    m_peers_contended.store(0);
     m_exit_timeout.store(std::numeric_limits<uint64_t>::max());
     m_client_ping.store(0);
+    m_sent_datagrams.store(0);
+    m_send_calls.store(0);
+    m_received_datagrams.store(0);
+    m_receive_calls.store(0);
+    m_wakeup_host = NULL;
+    m_wakeup_pending.store(false);
+    m_wakeup_time.store(0);
 
     // Start with initialising ENet
     // ============================
@@ -336,11 +351,16 @@ void STKHost::init()
     Network::openLog();  // Open packet log file
     ProtocolManager::createInstance();
 
-    // Optional: start the network console
-    if (m_enable_console)
+    // Optional: start the network console, a multi-lobby server only reads
+    // commands for its first lobby
+    ProcessType pt = STKProcess::getType();
+    if (m_enable_console && pt <= PT_LOBBY)
     {
-        m_network_console = std::thread(std::bind(&NetworkConsole::mainLoop,
-            this));
+        m_network_console = std::thread([this, pt]()
+            {
+                STKProcess::init(pt);
+                NetworkConsole::mainLoop(this);
+            });
     }
 }  // STKHost
 
@@ -361,17 +381,28 @@ STKHost::~STKHost()
         m_network_console.join();
 
     disconnectAllPeers(true/*timeout_waiting*/);
+    // Queue the remaining packets and disconnections of the peers before
+    // the listening thread stops
+    if (m_crypto_pipeline)
+        m_crypto_pipeline->stop();
+    Log::info("STKHost", "Peer table: %lu updates, %lu contended updates.",
+        (unsigned long)m_peers_updates.load(),
+        (unsigned long)m_peers_contended.load());
     Network::closeLog();
     stopListening();
+    Log::info("STKHost", "Time until queued packets were sent: %s.",
+        m_command_latency.toString().c_str());
 
-    // Drop all unsent packets
-    for (auto& p : m_enet_cmd)
+    // Drop all unsent packets, a shared packet is queued for all its peers
+    // together, so it's released after its first command
+    for (auto it = m_enet_cmd.begin(); it != m_enet_cmd.end(); it++)
     {
-        if (std::get<3>(p) == ECT_SEND_PACKET)
-        {
-            ENetPacket* packet = std::get<1>(p);
+        ENetPacket* packet = std::get<1>(*it);
+        if (std::get<3>(*it) == ECT_SEND_PACKET)
             enet_packet_destroy(packet);
-        }
+        else if (std::get<3>(*it) == ECT_SEND_SHARED_PACKET &&
+            (it == m_enet_cmd.begin() || std::get<1>(*(it - 1)) != packet))
+            releaseSharedPacket(packet);
     }
     delete m_network;
     enet_deinitialize();
@@ -739,16 +770,47 @@ void STKHost::setPublicAddress(short family)
 */
 void STKHost::disconnectAllPeers(bool timeout_waiting)
 {
-    std::lock_guard<std::mutex> lock(m_peers_mutex);
-    if (!m_peers.empty() && timeout_waiting)
+    updatePeers([this, timeout_waiting]
+        (std::map<ENetPeer*, std::shared_ptr<STKPeer> >& peers)
+        {
+            if (!peers.empty() && timeout_waiting)
+            {
+                for (auto peer : peers)
+                    peer.second->disconnect();
+                // Wait for at most 2 seconds for disconnect event to be
+                // generated
+                m_exit_timeout.store(StkTime::getMonoTimeMs() + 2000);
+            }
+            peers.clear();
+        });
+}   // disconnectAllPeers
+
+//-----------------------------------------------------------------------------
+/** Changes the peers. A copy of the current peers is given to the function
+ *  and published as the new peer table afterwards, readers which still use
+ *  the old table are not affected. Only one update is done at a time.
+ *  \param update Function which modifies the peers.
+ */
+void STKHost::updatePeers(
+    const std::function<void(std::map<ENetPeer*,
+                             std::shared_ptr<STKPeer> >&)>& update)
+{
+    std::unique_lock<std::mutex> lock(m_peers_mutex, std::try_to_lock);
+    if (!lock.owns_lock())
     {
-        for (auto peer : m_peers)
-            peer.second->disconnect();
-        // Wait for at most 2 seconds for disconnect event to be generated
-        m_exit_timeout.store(StkTime::getMonoTimeMs() + 2000);
+        m_peers_contended.fetch_add(1);
+        lock.lock();
     }
-    m_peers.clear();
-}   // disconnectAllPeers
+    std::shared_ptr<PeerTable> table = std::make_shared<PeerTable>();
+    table->m_map = std::atomic_load(&m_peers)->m_map;
+    update(table->m_map);
+    table->m_list.reserve(table->m_map.size());
+    for (auto& p : table->m_map)
+        table->m_list.push_back(p.second);
+    std::atomic_store(&m_peers,
+        std::shared_ptr<const PeerTable>(std::move(table)));
+    m_peers_updates.fetch_add(1);
+}   // updatePeers
 
 //-----------------------------------------------------------------------------
 /** Sets an error message for the gui.
@@ -769,6 +831,12 @@ void STKHost::setErrorMessage(const irr::core::stringw &message)
 void STKHost::startListening()
 {
     m_exit_timeout.store(std::numeric_limits<uint64_t>::max());
+    if (NetworkConfig::get()->isServer() && !m_crypto_pipeline &&
+        ServerConfig::m_crypto_threads > 0)
+    {
+        m_crypto_pipeline.reset(new CryptoPipeline(this,
+            (unsigned)ServerConfig::m_crypto_threads));
+    }
     m_listening_thread = std::thread(std::bind(&STKHost::mainLoop, this,
         STKProcess::getType()));
 }   // startListening
@@ -781,6 +849,10 @@ void STKHost::stopListening()
 {
     if (m_exit_timeout.load() == std::numeric_limits<uint64_t>::max())
         m_exit_timeout.store(0);
+    std::unique_lock<std::mutex> ul(m_wakeup_mutex);
+    if (m_wakeup_host)
+        enet_host_wakeup(m_wakeup_host);
+    ul.unlock();
     if (m_listening_thread.joinable())
         m_listening_thread.join();
 }   // stopListening
@@ -794,9 +866,7 @@ void STKHost::stopListening()
  */
 void STKHost::mainLoop(ProcessType pt)
 {
-    std::string thread_name = "STKHost";
-    if (pt == PT_CHILD)
-        thread_name += "_child";
+    std::string thread_name = "STKHost" + STKProcess::getThreadSuffix(pt);
     VS::setThreadName(thread_name.c_str());
 
     STKProcess::init(pt);
@@ -804,6 +874,19 @@ void STKHost::mainLoop(ProcessType pt)
     ENetEvent event;
     ENetHost* host = m_network->getENetHost();
     const bool is_server = NetworkConfig::get()->isServer();
+    // Commands added by other threads wake up enet_host_service, so it only
+    // needs a timeout for the checks done in this loop and enet timers.
+    // Without wakeup support (Windows) the commands wait for the timeout.
+    std::unique_lock<std::mutex> ul(m_wakeup_mutex);
+    const bool can_wake_up = enet_host_wakeup_create(host) == 0;
+    if (can_wake_up)
+        m_wakeup_host = host;
+    ul.unlock();
+    if (!can_wake_up)
+    {
+        Log::info("STKHost", "Listening thread cannot be woken up, queued "
+            "packets are sent every 10ms.");
+    }
 
     // A separate network connection (socket) to handle LAN requests.
     Network* direct_socket = NULL;
@@ -839,13 +922,20 @@ void STKHost::mainLoop(ProcessType pt)
 
         if (last_update_speed_time < StkTime::getMonoTimeMs())
         {
-            // Update upload / download speed per second
+            // Update upload / download speed and datagrams per second
             last_update_speed_time = StkTime::getMonoTimeMs() + 1000;
-            m_upload_speed.store(getNetwork()->getENetHost()->totalSentData);
-            m_download_speed.store(
-                getNetwork()->getENetHost()->totalReceivedData);
-            getNetwork()->getENetHost()->totalSentData = 0;
-            getNetwork()->getENetHost()->totalReceivedData = 0;
+            m_upload_speed.store(host->totalSentData);
+            m_download_speed.store(host->totalReceivedData);
+            m_sent_datagrams.store(host->totalSentPackets);
+            m_send_calls.store(host->totalSendCalls);
+            m_received_datagrams.store(host->totalReceivedPackets);
+            m_receive_calls.store(host->totalReceiveCalls);
+            host->totalSentData = 0;
+            host->totalReceivedData = 0;
+            host->totalSentPackets = 0;
+            host->totalSendCalls = 0;
+            host->totalReceivedPackets = 0;
+            host->totalReceiveCalls = 0;
         }
 
         auto sl = LobbyProtocol::get<ServerLobby>();
@@ -864,7 +954,7 @@ void STKHost::mainLoop(ProcessType pt)
 
         if (is_server)
         {
-            std::unique_lock<std::mutex> peer_lock(m_peers_mutex);
+            std::shared_ptr<const PeerTable> peers = getPeerTable();
             const float timeout = ServerConfig::m_validation_timeout;
             bool need_ping = false;
             if (sl && (!sl->isRacing() || !sl->isLegacyGPMode()) &&
@@ -881,7 +971,7 @@ void STKHost::mainLoop(ProcessType pt)
             if (need_ping)
             {
                 m_peer_pings.getData().clear();
-                for (auto& p : m_peers)
+                for (auto& p : peers->m_map)
                 {
                     m_peer_pings.getData()[p.second->getHostId()] =
                         p.second->getPing();
@@ -952,25 +1042,26 @@ void STKHost::mainLoop(ProcessType pt)
                     g_ping_packet.end());
             }
 
-            for (auto it = m_peers.begin(); it != m_peers.end();)
+            // The same ping packet is shared by all peers, the extra
+            // reference keeps it alive if a peer is reset below
+            ENetPacket* shared_ping = NULL;
+            if (!ping_packet.getBuffer().empty())
             {
-                if (!ping_packet.getBuffer().empty() &&
-                    (sl->isLegacyGPMode() ||
+                shared_ping = enet_packet_create(ping_packet.getData(),
+                    ping_packet.getTotalSize(), ENET_PACKET_FLAG_RELIABLE);
+                if (shared_ping)
+                    shared_ping->referenceCount++;
+            }
+            std::vector<ENetPeer*> timed_out;
+            for (auto it = peers->m_map.begin(); it != peers->m_map.end(); it++)
+            {
+                if (shared_ping && (sl->isLegacyGPMode() ||
                     !sl->isRacing() || it->second->isWaitingForGame()))
                 {
-                    ENetPacket* packet = enet_packet_create(ping_packet.getData(),
-                        ping_packet.getTotalSize(), ENET_PACKET_FLAG_RELIABLE);
-                    if (packet)
-                    {
-                        // If enet_peer_send failed, destroy the packet to
-                        // prevent leaking, this can only be done if the packet
-                        // is copied instead of shared sending to all peers
-                        if (enet_peer_send(
-                            it->first, EVENT_CHANNEL_UNENCRYPTED, packet) < 0)
-                        {
-                            enet_packet_destroy(packet);
-                        }
-                    }
+                    // If enet_peer_send fails, the packet is not referenced
+                    // by the peer, releaseSharedPacket will handle it
+                    enet_peer_send(it->first, EVENT_CHANNEL_UNENCRYPTED,
+                        shared_ping);
                 }
 
                 // Remove peer which has not been validated after a specific time
@@ -985,21 +1076,45 @@ void STKHost::mainLoop(ProcessType pt)
                         timeout);
                     enet_host_flush(host);
                     enet_peer_reset(it->first);
-                    it = m_peers.erase(it);
-                }
-                else
-                {
-                    it++;
+                    timed_out.push_back(it->first);
                 }
             }
-            peer_lock.unlock();
+            if (!timed_out.empty())
+            {
+                updatePeers([&timed_out]
+                    (std::map<ENetPeer*, std::shared_ptr<STKPeer> >& peers)
+                    {
+                        for (ENetPeer* peer : timed_out)
+                            peers.erase(peer);
+                    });
+            }
+            peers.reset();
+            if (shared_ping)
+                releaseSharedPacket(shared_ping);
         }
 
-        std::vector<std::tuple<ENetPeer*, ENetPacket*, uint32_t,
-            ENetCommandType, ENetAddress> > copied_list;
+        std::vector<ENetCommand> copied_list;
+        // Clear it before taking the commands, so commands added afterwards
+        // wake up this thread again
+        const bool wakeup_pending = m_wakeup_pending.exchange(false);
         std::unique_lock<std::mutex> lock(m_enet_cmd_mutex);
         std::swap(copied_list, m_enet_cmd);
         lock.unlock();
+        if (wakeup_pending && !copied_list.empty())
+        {
+            std::chrono::steady_clock::time_point added(
+                std::chrono::steady_clock::duration(m_wakeup_time.load()));
+            m_command_latency.addSince(added);
+        }
+        // Shared packets referenced by this batch, released after it
+        std::vector<ENetPacket*> shared_packets;
+        for (auto& p : copied_list)
+        {
+            if (std::get<3>(p) == ECT_SEND_SHARED_PACKET &&
+                (shared_packets.empty() ||
+                shared_packets.back() != std::get<1>(p)))
+                shared_packets.push_back(std::get<1>(p));
+        }
         for (auto& p : copied_list)
         {
             ENetPeer* peer = std::get<0>(p);
@@ -1016,7 +1131,7 @@ void STKHost::mainLoop(ProcessType pt)
                 (ea_peer_now.host != ea.host && ea_peer_now.port != ea.port))
 #endif
             {
-                if (packet != NULL)
+                if (packet != NULL && std::get<3>(p) == ECT_SEND_PACKET)
                     enet_packet_destroy(packet);
                 continue;
             }
@@ -1034,6 +1149,9 @@ void STKHost::mainLoop(ProcessType pt)
                 }
                 break;
             }
+            case ECT_SEND_SHARED_PACKET:
+                enet_peer_send(peer, (uint8_t)std::get<2>(p), packet);
+                break;
             case ECT_DISCONNECT:
                 enet_peer_disconnect(peer, std::get<2>(p));
                 break;
@@ -1042,14 +1160,23 @@ void STKHost::mainLoop(ProcessType pt)
                 enet_host_flush(host);
                 enet_peer_reset(peer);
                 // Remove the stk peer of it
-                std::lock_guard<std::mutex> lock(m_peers_mutex);
-                m_peers.erase(peer);
+                updatePeers([peer]
+                    (std::map<ENetPeer*, std::shared_ptr<STKPeer> >& peers)
+                    {
+                        peers.erase(peer);
+                    });
                 break;
             }
         }
+        for (ENetPacket* packet : shared_packets)
+            releaseSharedPacket(packet);
 
         bool need_ping_update = false;
-        while (enet_host_service(host, &event, 10) != 0)
+        // An idle server without peers waits longer, new connections and
+        // LAN requests are answered a bit later then
+        const uint32_t timeout = (can_wake_up && is_server &&
+            host->connectedPeers == 0) ? 100 : 10;
+        while (enet_host_service(host, &event, timeout) != 0)
         {
             auto lp = LobbyProtocol::get<LobbyProtocol>();
             if (!is_server &&
@@ -1079,10 +1206,13 @@ void STKHost::mainLoop(ProcessType pt)
                 // ++m_next_unique_host_id for unique host id for database
                 auto stk_peer = std::make_shared<STKPeer>
                     (event.peer, this, ++m_next_unique_host_id);
-                std::unique_lock<std::mutex> lock(m_peers_mutex);
-                m_peers[event.peer] = stk_peer;
-                size_t new_peer_count = m_peers.size();
-                lock.unlock();
+                size_t new_peer_count = 0;
+                updatePeers([&event, &stk_peer, &new_peer_count]
+                    (std::map<ENetPeer*, std::shared_ptr<STKPeer> >& peers)
+                    {
+                        peers[event.peer] = stk_peer;
+                        new_peer_count = peers.size();
+                    });
                 stk_event = new Event(&event, stk_peer);
                 Log::info("STKHost", "%s has just connected. There are "
                     "now %u peers.", stk_peer->getAddress().toString().c_str(),
@@ -1105,25 +1235,29 @@ void STKHost::mainLoop(ProcessType pt)
                 // Use the previous stk peer so protocol can see the network
                 // profile and handle it for disconnection
                 std::string addr;
-                std::lock_guard<std::mutex> lock(m_peers_mutex);
-                size_t new_peer_count = m_peers.size();
-                if (m_peers.find(event.peer) != m_peers.end())
-                {
-                    std::shared_ptr<STKPeer>& peer = m_peers.at(event.peer);
-                    addr = peer->getAddress().toString();
-                    stk_event = new Event(&event, peer);
-                    m_peers.erase(event.peer);
-                    new_peer_count = m_peers.size();
-                }
+                size_t new_peer_count = 0;
+                updatePeers([&event, &stk_event, &addr, &new_peer_count]
+                    (std::map<ENetPeer*, std::shared_ptr<STKPeer> >& peers)
+                    {
+                        auto it = peers.find(event.peer);
+                        if (it != peers.end())
+                        {
+                            addr = it->second->getAddress().toString();
+                            stk_event = new Event(&event, it->second);
+                            peers.erase(it);
+                        }
+                        new_peer_count = peers.size();
+                    });
                 Log::info("STKHost", "%s has just disconnected. There are "
                     "now %u peers.", addr.c_str(), new_peer_count);
             }   // ENET_EVENT_TYPE_DISCONNECT
 
-            std::unique_lock<std::mutex> lock(m_peers_mutex);
-            if (!stk_event && m_peers.find(event.peer) != m_peers.end())
+            std::shared_ptr<const PeerTable> peers = getPeerTable();
+            auto it = peers->m_map.find(event.peer);
+            if (!stk_event && it != peers->m_map.end())
             {
-                std::shared_ptr<STKPeer> peer = m_peers.at(event.peer);
-                lock.unlock();
+                std::shared_ptr<STKPeer> peer = it->second;
+                peers.reset();
                 if (isPingPacket(event.packet->data, event.packet->dataLength))
                 {
                     if (!is_server)
@@ -1182,6 +1316,12 @@ void STKHost::mainLoop(ProcessType pt)
                     enet_packet_destroy(event.packet);
                     continue;
                 }
+                if (m_crypto_pipeline && peer->getCrypto())
+                {
+                    // Decrypted and propagated by the worker of this peer
+                    m_crypto_pipeline->receive(peer, event);
+                    continue;
+                }
                 try
                 {
                     stk_event = new Event(&event, peer);
@@ -1198,32 +1338,52 @@ void STKHost::mainLoop(ProcessType pt)
                 enet_packet_destroy(event.packet);
                 continue;
             }
-            if (stk_event->getType() == EVENT_TYPE_MESSAGE)
-            {
-                Network::logPacket(stk_event->data(), true);
-#ifdef DEBUG_MESSAGE_CONTENT
-                Log::verbose("NetworkManager",
-                             "Message, Sender : %s time %f message:",
-                             stk_event->getPeer()->getAddress()
-                             .toString(/*show port*/false).c_str(),
-                             StkTime::getRealTime());
-                Log::verbose("NetworkManager", "%s",
-                             stk_event->data().getLogMessage().c_str());
-#endif
-            }   // if message event
-
-            // notify for the event now.
-            auto pm = ProtocolManager::lock();
-            if (pm && !pm->isExiting())
-                pm->propagateEvent(stk_event);
+            // Keep the order with the packets of the peer in the pipeline
+            if (m_crypto_pipeline && stk_event->getPeer()->getCrypto())
+                m_crypto_pipeline->propagateEvent(stk_event);
             else
-                delete stk_event;
+                propagateEvent(stk_event);
         }   // while enet_host_service
     }   // while m_exit_timeout.load() > StkTime::getMonoTimeMs()
+    // The host may be serviced without the listening thread later. Other
+    // threads may be waking it up, so the wakeup socket is closed under
+    // the same mutex
+    ul.lock();
+    m_wakeup_host = NULL;
+    enet_host_wakeup_destroy(host);
+    ul.unlock();
     delete direct_socket;
     Log::info("STKHost", "Listening has been stopped.");
 }   // mainLoop
 
+// ----------------------------------------------------------------------------
+/** Passes an event to the ProtocolManager, called by the listening thread or
+ *  the crypto pipeline.
+ */
+void STKHost::propagateEvent(Event* stk_event)
+{
+    if (stk_event->getType() == EVENT_TYPE_MESSAGE)
+    {
+        Network::logPacket(stk_event->data(), true);
+#ifdef DEBUG_MESSAGE_CONTENT
+        Log::verbose("NetworkManager",
+                     "Message, Sender : %s time %f message:",
+                     stk_event->getPeer()->getAddress()
+                     .toString(/*show port*/false).c_str(),
+                     StkTime::getRealTime());
+        Log::verbose("NetworkManager", "%s",
+                     stk_event->data().getLogMessage().c_str());
+#endif
+    }   // if message event
+
+    // notify for the event now.
+    auto pm = ProtocolManager::lock();
+    if (pm && !pm->isExiting())
+        pm->propagateEvent(stk_event);
+    else
+        delete stk_event;
+}   // propagateEvent
+
 // ----------------------------------------------------------------------------
 /** Handles a direct request given to a socket. This is typically a LAN 
  *  request, but can also be used if the server is public (i.e. not behind
@@ -1308,10 +1468,8 @@ void STKHost::handleDirectSocketRequest(Network* direct_socket,
  */
 bool STKHost::peerExists(const SocketAddress& peer)
 {
-    std::lock_guard<std::mutex> lock(m_peers_mutex);
-    for (auto p : m_peers)
+    for (auto& stk_peer : getPeers())
     {
-        auto stk_peer = p.second;
         if (stk_peer->getAddress() == peer ||
             ((stk_peer->getAddress().isPublicAddressLocalhost() &&
             peer.isPublicAddressLocalhost()) &&
@@ -1328,9 +1486,10 @@ bool STKHost::peerExists(const SocketAddress& peer)
 std::shared_ptr<STKPeer> STKHost::getServerPeerForClient() const
 {
     assert(NetworkConfig::get()->isClient());
-    if (m_peers.size() != 1)
+    std::shared_ptr<const PeerTable> peers = getPeerTable();
+    if (peers->m_list.size() != 1)
         return nullptr;
-    return m_peers.begin()->second;
+    return peers->m_list[0];
 }   // getServerPeerForClient
 
 //-----------------------------------------------------------------------------
@@ -1340,12 +1499,13 @@ std::shared_ptr<STKPeer> STKHost::getServerPeerForClient() const
  */
 void STKHost::sendPacketToAllPeersInServer(NetworkString *data, PacketReliabilityMode reliable)
 {
-    std::lock_guard<std::mutex> lock(m_peers_mutex);
-    for (auto p : m_peers)
+    std::vector<STKPeer*> peers;
+    for (auto& p : getPeers())
     {
-        if (p.second->isValidated())
-            p.second->sendPacket(data, reliable);
+        if (p->isValidated())
+            peers.push_back(p.get());
     }
+    sendPacketToPeers(peers, data, reliable);
 }   // sendPacketToAllPeersInServer
 
 //-----------------------------------------------------------------------------
@@ -1355,12 +1515,13 @@ void STKHost::sendPacketToAllPeersInServer(NetworkString *data, PacketReliabilit
  */
 void STKHost::sendPacketToAllPeers(NetworkString *data, PacketReliabilityMode reliable)
 {
-    std::lock_guard<std::mutex> lock(m_peers_mutex);
-    for (auto p : m_peers)
+    std::vector<STKPeer*> peers;
+    for (auto& p : getPeers())
     {
-        if (p.second->isValidated() && !p.second->isWaitingForGame())
-            p.second->sendPacket(data, reliable);
+        if (p->isValidated() && !p->isWaitingForGame())
+            peers.push_back(p.get());
     }
+    sendPacketToPeers(peers, data, reliable);
 }   // sendPacketToAllPeers
 
 //-----------------------------------------------------------------------------
@@ -1372,16 +1533,17 @@ void STKHost::sendPacketToAllPeers(NetworkString *data, PacketReliabilityMode re
 void STKHost::sendPacketExcept(std::shared_ptr<STKPeer> peer, NetworkString *data,
                                PacketReliabilityMode reliable)
 {
-    std::lock_guard<std::mutex> lock(m_peers_mutex);
-    for (const auto& p : m_peers)
+    std::vector<STKPeer*> peers;
+    for (const auto& p : getPeers())
     {
-        STKPeer* stk_peer = p.second.get();
-        if (!stk_peer->isSamePeer(peer.get()) && p.second->isValidated() &&
-            !p.second->isWaitingForGame())
+        STKPeer* stk_peer = p.get();
+        if (!stk_peer->isSamePeer(peer.get()) && p->isValidated() &&
+            !p->isWaitingForGame())
         {
-            stk_peer->sendPacket(data, reliable);
+            peers.push_back(stk_peer);
         }
     }
+    sendPacketToPeers(peers, data, reliable);
 }   // sendPacketExcept
 
 //-----------------------------------------------------------------------------
@@ -1393,26 +1555,129 @@ void STKHost::sendPacketExcept(std::shared_ptr<STKPeer> peer, NetworkString *dat
 void STKHost::sendPacketToAllPeersWith(std::function<bool(std::shared_ptr<STKPeer>)> predicate,
                                        NetworkString* data, PacketReliabilityMode reliable)
 {
-    std::lock_guard<std::mutex> lock(m_peers_mutex);
-    for (auto p : m_peers)
+    std::vector<STKPeer*> peers;
+    for (auto& stk_peer : getPeers())
     {
-        std::shared_ptr<STKPeer> stk_peer = p.second;
         if (!stk_peer->isValidated())
             continue;
         if (predicate(stk_peer))
-            stk_peer->sendPacket(data, reliable);
+            peers.push_back(stk_peer.get());
     }
+    sendPacketToPeers(peers, data, reliable);
 }   // sendPacketToAllPeersWith
 
+//-----------------------------------------------------------------------------
+/** Sends data to several peers. The data is compressed only once for all
+ *  peers supporting compression. Peers using encryption get their own
+ *  encrypted packet, the other peers share one ENetPacket, so the data is
+ *  copied only once.
+ *  \param peers The peers to send to.
+ *  \param data Data to sent.
+ *  \param reliable If the data should be sent reliable or now.
+ */
+void STKHost::sendPacketToPeers(const std::vector<STKPeer*>& peers,
+                                NetworkString* data,
+                                PacketReliabilityMode reliable)
+{
+    std::unique_ptr<NetworkString> compressed;
+    bool compression_tried = false, codec_failed = false;
+    std::vector<STKPeer*> shared_peers, compressed_shared_peers;
+    for (STKPeer* peer : peers)
+    {
+        if (peer->useCompression() && !compression_tried)
+        {
+            compression_tried = true;
+            if (PacketCompressor::shouldCompress(*data))
+            {
+                compressed.reset(new NetworkString(PROTOCOL_NONE,
+                    data->getTotalSize()));
+                if (!PacketCompressor::compress(*data, compressed.get(),
+                    &codec_failed))
+                    compressed.reset();
+            }
+        }
+        if (codec_failed)
+            peer->setCompression(false);
+        const bool use_compressed = compressed && peer->useCompression();
+        NetworkString* peer_data = use_compressed ? compressed.get() : data;
+        if (peer->getCrypto())
+            peer->sendPacketAsIs(peer_data, reliable);
+        else if (!peer->isDisconnected())
+        {
+            if (use_compressed)
+                compressed_shared_peers.push_back(peer);
+            else
+                shared_peers.push_back(peer);
+        }
+    }
+    sendSharedPacket(shared_peers, data, reliable);
+    if (compressed)
+        sendSharedPacket(compressed_shared_peers, compressed.get(), reliable);
+}   // sendPacketToPeers
+
+//-----------------------------------------------------------------------------
+/** Sends the same ENetPacket to several unencrypted peers.
+ *  \param peers The peers to send to.
+ *  \param data Data to sent, already compressed if needed.
+ *  \param reliable If the data should be sent reliable or now.
+ */
+void STKHost::sendSharedPacket(const std::vector<STKPeer*>& peers,
+                               NetworkString* data,
+                               PacketReliabilityMode reliable)
+{
+    if (peers.size() < 2)
+    {
+        for (STKPeer* peer : peers)
+            peer->sendPacketAsIs(data, reliable);
+        return;
+    }
+
+    ENetPacket* packet = enet_packet_create(data->getData(),
+        data->getTotalSize(), (reliable ? ENET_PACKET_FLAG_RELIABLE :
+        (ENET_PACKET_FLAG_UNSEQUENCED | ENET_PACKET_FLAG_UNRELIABLE_FRAGMENT)));
+    if (!packet)
+        return;
+    // Released after the batch of commands with this packet is sent
+    packet->referenceCount++;
+    if (Network::m_connection_debug)
+    {
+        Log::verbose("STKHost", "sending shared packet of size %d to %d "
+            "peers at %lf", packet->dataLength, (int)peers.size(),
+            StkTime::getRealTime());
+    }
+    // All commands of a shared packet are added together, so they are sent
+    // in the same batch
+    std::unique_lock<std::mutex> lock(m_enet_cmd_mutex);
+    for (STKPeer* peer : peers)
+    {
+        // Same channel as STKPeer::sendPacket with encryption requested
+        m_enet_cmd.emplace_back(peer->getENetPeer(), packet,
+            EVENT_CHANNEL_NORMAL, ECT_SEND_SHARED_PACKET,
+            peer->getENetAddress());
+    }
+    lock.unlock();
+    wakeUpListening();
+}   // sendSharedPacket
+
+//-----------------------------------------------------------------------------
+/** Removes the extra reference added to a shared packet when it was created,
+ *  and destroys it if no peer references it (anymore).
+ */
+void STKHost::releaseSharedPacket(ENetPacket* packet)
+{
+    if (--packet->referenceCount == 0)
+        enet_packet_destroy(packet);
+}   // releaseSharedPacket
+
 //-----------------------------------------------------------------------------
 /** Sends a message from a client to the server. */
 void STKHost::sendToServer(NetworkString *data, PacketReliabilityMode reliable)
 {
-    std::lock_guard<std::mutex> lock(m_peers_mutex);
-    if (m_peers.empty())
+    std::shared_ptr<const PeerTable> peers = getPeerTable();
+    if (peers->m_list.empty())
         return;
     assert(NetworkConfig::get()->isClient());
-    m_peers.begin()->second->sendPacket(data, reliable);
+    peers->m_list[0]->sendPacket(data, reliable);
 }   // sendToServer
 
 //-----------------------------------------------------------------------------
@@ -1420,17 +1685,15 @@ std::vector<std::shared_ptr<NetworkPlayerProfile> >
     STKHost::getAllPlayerProfiles() const
 {
     std::vector<std::shared_ptr<NetworkPlayerProfile> > p;
-    std::unique_lock<std::mutex> lock(m_peers_mutex);
-    for (auto& peer : m_peers)
+    for (auto& peer : getPeers())
     {
-        if (peer.second->isDisconnected() || !peer.second->isValidated())
+        if (peer->isDisconnected() || !peer->isValidated())
             continue;
-        if (ServerConfig::m_ai_handling && peer.second->isAIPeer())
+        if (ServerConfig::m_ai_handling && peer->isAIPeer())
             continue;
-        auto peer_profile = peer.second->getPlayerProfiles();
+        auto peer_profile = peer->getPlayerProfiles();
         p.insert(p.end(), peer_profile.begin(), peer_profile.end());
     }
-    lock.unlock();
     return p;
 }   // getAllPlayerProfiles
 
@@ -1438,31 +1701,28 @@ std::vector<std::shared_ptr<NetworkPlayerProfile> >
 std::set<uint32_t> STKHost::getAllPlayerOnlineIds() const
 {
     std::set<uint32_t> online_ids;
-    std::unique_lock<std::mutex> lock(m_peers_mutex);
-    for (auto& peer : m_peers)
+    for (auto& peer : getPeers())
     {
-        if (peer.second->isDisconnected() || !peer.second->isValidated())
+        if (peer->isDisconnected() || !peer->isValidated())
             continue;
-        if (!peer.second->getPlayerProfiles().empty())
+        if (!peer->getPlayerProfiles().empty())
         {
-            online_ids.insert(
-                peer.second->getMainProfile()->getOnlineId());
+            online_ids.insert(peer->getMainProfile()->getOnlineId());
         }
     }
-    lock.unlock();
     return online_ids;
 }   // getAllPlayerOnlineIds
 
 //-----------------------------------------------------------------------------
 std::shared_ptr<STKPeer> STKHost::findPeerByHostId(uint32_t id) const
 {
-    std::lock_guard<std::mutex> lock(m_peers_mutex);
-    auto ret = std::find_if(m_peers.begin(), m_peers.end(),
-        [id](const std::pair<ENetPeer*, std::shared_ptr<STKPeer> >& p)
+    STKPeerList peers = getPeers();
+    auto ret = std::find_if(peers.begin(), peers.end(),
+        [id](const std::shared_ptr<STKPeer>& p)
         {
-            return p.second->getHostId() == id;
+            return p->getHostId() == id;
         });
-    return ret != m_peers.end() ? ret->second : nullptr;
+    return ret != peers.end() ? *ret : nullptr;
 }   // findPeerByHostId
 //-----------------------------------------------------------------------------
 
@@ -1470,12 +1730,12 @@ std::shared_ptr<STKPeer>
     STKHost::findPeerByName(const core::stringw& name,
                             bool mustBeOfficial) const
 {
-    std::lock_guard<std::mutex> lock(m_peers_mutex);
-    auto ret = std::find_if(m_peers.begin(), m_peers.end(),
-        [name, mustBeOfficial](const std::pair<ENetPeer*, std::shared_ptr<STKPeer> >& p)
+    STKPeerList peers = getPeers();
+    auto ret = std::find_if(peers.begin(), peers.end(),
+        [name, mustBeOfficial](const std::shared_ptr<STKPeer>& p)
         {
             bool found = false;
-            for (auto& profile : p.second->getPlayerProfiles())
+            for (auto& profile : p->getPlayerProfiles())
             {
                 if (profile->getName() == name &&
                     (!mustBeOfficial || profile->getOnlineId() > 0))
@@ -1490,18 +1750,18 @@ std::shared_ptr<STKPeer>
             }
             return found;
         });
-    return ret != m_peers.end() ? ret->second : nullptr;
+    return ret != peers.end() ? *ret : nullptr;
 }   // findPeerByName
 //-----------------------------------------------------------------------------
 
 std::shared_ptr<STKPeer>
     STKHost::findPeerByWildcard(const core::stringw& name_pattern, std::string& name_found) const
 {
-    std::lock_guard<std::mutex> lock(m_peers_mutex);
+    STKPeerList peers = getPeers();
     bool found = false;
     std::shared_ptr<STKPeer> ret = nullptr;
-    std::map<ENetPeer*, std::shared_ptr<STKPeer>>::const_iterator iter = m_peers.begin();
-    std::map<ENetPeer*, std::shared_ptr<STKPeer>>::const_iterator end  = m_peers.end();
+    STKPeerList::const_iterator iter = peers.begin();
+    STKPeerList::const_iterator end  = peers.end();
 
     // change wildcard symbols to regex
     std::string pat = StringUtils::wideToUtf8(name_pattern);
@@ -1512,7 +1772,7 @@ std::shared_ptr<STKPeer>
 
     for (; iter != end; iter++)
     {
-        auto p = iter->second;
+        auto p = *iter;
         for (auto& profile : p->getPlayerProfiles())
         {
             if (std::regex_match(StringUtils::wideToUtf8(profile->getName()), regexString))
@@ -1545,7 +1805,11 @@ void STKHost::initClientNetwork(ENetEvent& event, Network* new_network)
     auto stk_peer = std::make_shared<STKPeer>(event.peer, this,
         m_next_unique_host_id++);
     stk_peer->setValidated(true);
-    m_peers[event.peer] = stk_peer;
+    updatePeers([&event, &stk_peer]
+        (std::map<ENetPeer*, std::shared_ptr<STKPeer> >& peers)
+        {
+            peers[event.peer] = stk_peer;
+        });
     auto pm = ProtocolManager::lock();
     if (pm && !pm->isExiting())
         pm->propagateEvent(new Event(&event, stk_peer));
@@ -1575,10 +1839,8 @@ std::vector<std::shared_ptr<NetworkPlayerProfile> >
     STKHost::getPlayersForNewGame(bool* has_always_on_spectators) const
 {
     std::vector<std::shared_ptr<NetworkPlayerProfile> > players;
-    std::lock_guard<std::mutex> lock(m_peers_mutex);
-    for (auto& p : m_peers)
+    for (auto& stk_peer : getPeers())
     {
-        auto& stk_peer = p.second;
         // Handle always spectate for peer
         if (has_always_on_spectators && stk_peer->alwaysSpectateForReal())
         {
@@ -1609,10 +1871,8 @@ void STKHost::updatePlayers(unsigned* ingame, unsigned* waiting,
     uint32_t ingame_players = 0;
     uint32_t waiting_players = 0;
     uint32_t total_players = 0;
-    std::lock_guard<std::mutex> lock(m_peers_mutex);
-    for (auto& p : m_peers)
+    for (auto& stk_peer : getPeers())
     {
-        auto& stk_peer = p.second;
         if (!stk_peer->isValidated())
             continue;
         if (ServerConfig::m_ai_handling && stk_peer->isAIPeer())
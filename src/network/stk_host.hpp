@@ -22,6 +22,7 @@
 #ifndef STK_HOST_HPP
 #define STK_HOST_HPP
 
+#include "utils/loop_stats.hpp"
 #include "utils/stk_process.hpp"
 #include "utils/synchronised.hpp"
 #include "utils/time.hpp"
@@ -37,6 +38,7 @@
 
 #include <atomic>
 #include <cassert>
+#include <chrono>
 #include <cstring>
 #include <list>
 #include <functional>
@@ -49,6 +51,8 @@
 #include <vector>
 
 class BareNetworkString;
+class CryptoPipeline;
+class Event;
 class GameSetup;
 class LobbyProtocol;
 class Network;
@@ -67,11 +71,59 @@ enum ENetCommandType : unsigned int
 {
     ECT_SEND_PACKET = 0,
     ECT_DISCONNECT = 1,
-    ECT_RESET = 2
+    ECT_RESET = 2,
+    /** Like ECT_SEND_PACKET, but the same packet is sent to several peers
+     *  in the same batch of commands, see sendPacketToPeers. */
+    ECT_SEND_SHARED_PACKET = 3
 };
 
+/** The connected peers of a STKHost at one point in time. A list is never
+ *  changed after it is published, when peers connect or disconnect the
+ *  STKHost publishes a new one, so it can be iterated without locking. */
+class STKPeerList
+{
+private:
+    std::shared_ptr<const std::vector<std::shared_ptr<STKPeer> > > m_peers;
+public:
+    typedef std::vector<std::shared_ptr<STKPeer> >::const_iterator
+        const_iterator;
+    // ------------------------------------------------------------------------
+    STKPeerList(const std::shared_ptr<const std::vector<
+                std::shared_ptr<STKPeer> > >& peers) : m_peers(peers) {}
+    // ------------------------------------------------------------------------
+    const_iterator begin() const                 { return m_peers->begin(); }
+    // ------------------------------------------------------------------------
+    const_iterator end() const                     { return m_peers->end(); }
+    // ------------------------------------------------------------------------
+    size_t size() const                           { return m_peers->size(); }
+    // ------------------------------------------------------------------------
+    bool empty() const                           { return m_peers->empty(); }
+    // ------------------------------------------------------------------------
+    const std::shared_ptr<STKPeer>& operator[](size_t i) const
+                                                      { return (*m_peers)[i]; }
+    // ------------------------------------------------------------------------
+    /** Returns a copy for callers which need to modify the list. */
+    operator std::vector<std::shared_ptr<STKPeer> >() const
+                                                           { return *m_peers; }
+};   // STKPeerList
+
 class STKHost
 {
+public:
+    /** A published version of the peers, see \ref m_peers. */
+    struct PeerTable
+    {
+        std::map<ENetPeer*, std::shared_ptr<STKPeer> > m_map;
+        /** The same peers as m_map, for iterating. */
+        std::vector<std::shared_ptr<STKPeer> > m_list;
+    };
+
+    /** A command run by the listening thread: the ENet peer, the packet to
+     *  send, integer data (channel or disconnect reason), the type and the
+     *  address of the peer when the command was created. */
+    typedef std::tuple<ENetPeer*, ENetPacket*, uint32_t, ENetCommandType,
+        ENetAddress> ENetCommand;
+
 private:
     /** Singleton pointer to the instance. */
     static STKHost* m_stk_host[PT_COUNT];
@@ -87,20 +139,49 @@ private:
     /** Network console thread */
     std::thread m_network_console;
 
-    /** Make sure the removing or adding a peer is thread-safe. */
+    /** Serializes adding and removing peers, readers never take it. */
     mutable std::mutex m_peers_mutex;
 
     /** Let (atm enet_peer_send and enet_peer_disconnect) run in the listening
      *  thread. */
-    std::vector<std::tuple</*peer receive*/ENetPeer*,
-        /*packet to send*/ENetPacket*, /*integer data*/uint32_t,
-        ENetCommandType, ENetAddress> > m_enet_cmd;
+    std::vector<ENetCommand> m_enet_cmd;
 
     /** Protect \ref m_enet_cmd from multiple threads usage. */
     std::mutex m_enet_cmd_mutex;
 
-    /** The list of peers connected to this instance. */
-    std::map<ENetPeer*, std::shared_ptr<STKPeer> > m_peers;
+    /** The host of the listening thread if enet_host_service can be woken up
+     *  when commands are added, NULL otherwise. */
+    ENetHost* m_wakeup_host;
+
+    /** Protects \ref m_wakeup_host, it's held while the host is woken up so
+     *  that its wakeup socket cannot be closed meanwhile. */
+    std::mutex m_wakeup_mutex;
+
+    /** True if commands were added since the listening thread took them
+     *  last, so it's only woken up once for all of them. */
+    std::atomic_bool m_wakeup_pending;
+
+    /** When the first command after the listening thread took them last was
+     *  added (steady clock). */
+    std::atomic<int64_t> m_wakeup_time;
+
+    /** Time from adding a command until the listening thread takes it. */
+    LatencyHistogram m_command_latency;
+
+    /** The peers connected to this instance. It is copied, modified and
+     *  replaced as a whole under \ref m_peers_mutex when peers connect or
+     *  disconnect (which is rare), and read with std::atomic_load by all
+     *  other users. Readers don't wait for \ref m_peers_mutex, but
+     *  std::atomic_load of a shared_ptr is not lock-free: libstdc++ guards
+     *  it with a mutex picked by hashing the address, which is only held
+     *  while the pointer is copied. */
+    std::shared_ptr<const PeerTable> m_peers;
+
+    /** Number of times a new peer table was published. */
+    std::atomic<uint64_t> m_peers_updates;
+
+    /** Number of times a writer had to wait for \ref m_peers_mutex. */
+    std::atomic<uint64_t> m_peers_contended;
 
     /** Next unique host id. It is increased whenever a new peer is added (see
      *  getPeer()), but not decreased whena host (=peer) disconnects. This
@@ -114,6 +195,10 @@ private:
     /** Id of thread listening to enet events. */
     std::thread m_listening_thread;
 
+    /** Server only: encrypts and decrypts packets of peers using crypto,
+     *  NULL if it's done in the sending and listening threads. */
+    std::unique_ptr<CryptoPipeline> m_crypto_pipeline;
+
     /** Flag which is set from the protocol manager thread which
      *  triggers a shutdown of the STKHost (and the Protocolmanager). */
     std::atomic_bool m_shutdown;
@@ -148,6 +233,16 @@ private:
 
     std::atomic<uint32_t> m_download_speed;
 
+    /** Datagrams sent and received in the last second, and the system calls
+     *  used for them (fewer if enet can send or receive several at once). */
+    std::atomic<uint32_t> m_sent_datagrams;
+
+    std::atomic<uint32_t> m_send_calls;
+
+    std::atomic<uint32_t> m_received_datagrams;
+
+    std::atomic<uint32_t> m_receive_calls;
+
     std::atomic<uint32_t> m_players_in_game;
 
     std::atomic<uint32_t> m_players_waiting;
@@ -173,6 +268,38 @@ private:
     // ------------------------------------------------------------------------
     void getIPFromStun(int socket, const std::string& stun_address,
                        short family, SocketAddress* result);
+    // ------------------------------------------------------------------------
+    void sendPacketToPeers(const std::vector<STKPeer*>& peers,
+                           NetworkString* data,
+                           PacketReliabilityMode reliable);
+    // ------------------------------------------------------------------------
+    void sendSharedPacket(const std::vector<STKPeer*>& peers,
+                          NetworkString* data,
+                          PacketReliabilityMode reliable);
+    // ------------------------------------------------------------------------
+    static void releaseSharedPacket(ENetPacket* packet);
+    // ------------------------------------------------------------------------
+    /** Tells the listening thread that commands were added, called after
+     *  adding them. */
+    void wakeUpListening()
+    {
+        if (m_wakeup_pending.exchange(true))
+            return;
+        m_wakeup_time.store(
+            std::chrono::steady_clock::now().time_since_epoch().count());
+        std::lock_guard<std::mutex> lock(m_wakeup_mutex);
+        if (m_wakeup_host)
+            enet_host_wakeup(m_wakeup_host);
+    }
+    // ------------------------------------------------------------------------
+    /** Returns the current peers, they stay valid even if the table is
+     *  replaced meanwhile. */
+    std::shared_ptr<const PeerTable> getPeerTable() const
+                                           { return std::atomic_load(&m_peers); }
+    // ------------------------------------------------------------------------
+    void updatePeers(
+        const std::function<void(std::map<ENetPeer*,
+                                 std::shared_ptr<STKPeer> >&)>& update);
 public:
     /** If a network console should be started. */
     static bool m_enable_console;
@@ -296,10 +423,28 @@ public:
     void addEnetCommand(ENetPeer* peer, ENetPacket* packet, uint32_t i,
                         ENetCommandType ect, ENetAddress ea)
     {
-        std::lock_guard<std::mutex> lock(m_enet_cmd_mutex);
+        std::unique_lock<std::mutex> lock(m_enet_cmd_mutex);
         m_enet_cmd.emplace_back(peer, packet, i, ect, ea);
+        lock.unlock();
+        wakeUpListening();
+    }
+    // ------------------------------------------------------------------------
+    /** Adds several commands at once, the vector is cleared. */
+    void addEnetCommands(std::vector<ENetCommand>* commands)
+    {
+        std::unique_lock<std::mutex> lock(m_enet_cmd_mutex);
+        m_enet_cmd.insert(m_enet_cmd.end(), commands->begin(),
+            commands->end());
+        lock.unlock();
+        commands->clear();
+        wakeUpListening();
     }
     // ------------------------------------------------------------------------
+    CryptoPipeline* getCryptoPipeline() const
+                                          { return m_crypto_pipeline.get(); }
+    // ------------------------------------------------------------------------
+    void propagateEvent(Event* stk_event);
+    // ------------------------------------------------------------------------
     /** Returns the last error (or "" if no error has happened). */
     const irr::core::stringw& getErrorMessage() const
                                                     { return m_error_message; }
@@ -316,16 +461,12 @@ public:
     // ------------------------------------------------------------------------
     Network* getNetwork() const                           { return m_network; }
     // ------------------------------------------------------------------------
-    /** Returns a copied list of peers. */
-    std::vector<std::shared_ptr<STKPeer> > getPeers() const
+    /** Returns the list of peers, which is not copied. */
+    STKPeerList getPeers() const
     {
-        std::lock_guard<std::mutex> lock(m_peers_mutex);
-        std::vector<std::shared_ptr<STKPeer> > peers;
-        for (auto p : m_peers)
-        {
-            peers.push_back(p.second);
-        }
-        return peers;
+        std::shared_ptr<const PeerTable> table = getPeerTable();
+        return STKPeerList(std::shared_ptr<const std::vector<
+            std::shared_ptr<STKPeer> > >(table, &table->m_list));
     }
     // ------------------------------------------------------------------------
     /** Returns the next (unique) host id. */
@@ -339,9 +480,14 @@ public:
     // ------------------------------------------------------------------------
     /** Returns the number of currently connected peers. */
     unsigned int getPeerCount() const
+                             { return (unsigned)getPeerTable()->m_map.size(); }
+    // ------------------------------------------------------------------------
+    /** Returns the number of updates of the peer table, and how often an
+     *  update had to wait for another one. */
+    void getPeerTableStats(uint64_t* updates, uint64_t* contended) const
     {
-        std::lock_guard<std::mutex> lock(m_peers_mutex);
-        return (unsigned)m_peers.size();
+        *updates = m_peers_updates.load();
+        *contended = m_peers_contended.load();
     }
     // ------------------------------------------------------------------------
     /** Sets the global host id of this host (client use). */
@@ -382,6 +528,17 @@ public:
     /* Return download speed in bytes per second. */
     unsigned getDownloadSpeed() const       { return m_download_speed.load(); }
     // ------------------------------------------------------------------------
+    /** Returns the datagrams sent and received in the last second, and the
+     *  system calls used for them. */
+    void getDatagramStats(unsigned* sent, unsigned* send_calls,
+                          unsigned* received, unsigned* receive_calls) const
+    {
+        *sent = m_sent_datagrams.load();
+        *send_calls = m_send_calls.load();
+        *received = m_received_datagrams.load();
+        *receive_calls = m_receive_calls.load();
+    }
+    // ------------------------------------------------------------------------
     void updatePlayers(unsigned* ingame = NULL,
                        unsigned* waiting = NULL,
                        unsigned* total = NULL);
@@ -482,6 +482,38 @@ extern "C" int insideIPv6CIDR(const char* ipv6_cidr, const char* ipv6_in)
     return 1;
 }   // andIPv6
 
+// ----------------------------------------------------------------------------
+/** Gets the first and last address (16 bytes each) of a block of IPv6
+ *  addresses, with the same rules for the block as insideIPv6CIDR.
+ *  \return True if the block is valid.
+ */
+bool getIPv6CIDRRange(const char* ipv6_cidr, uint8_t* first, uint8_t* last)
+{
+    const char* mask_location = strchr(ipv6_cidr, '/');
+    if (mask_location == NULL || mask_location - ipv6_cidr >= INET6_ADDRSTRLEN)
+        return false;
+
+    char ipv6[INET6_ADDRSTRLEN] = {};
+    memcpy(ipv6, ipv6_cidr, mask_location - ipv6_cidr);
+    struct in6_addr cidr;
+    if (stk_inet_pton6(ipv6, &cidr) != 1)
+        return false;
+
+    int mask_length = atoi(mask_location + 1);
+    if (mask_length > 128 || mask_length <= 0)
+        return false;
+
+    for (int i = 0; i < 16; i++)
+    {
+        int bits = mask_length - i * 8;
+        uint8_t mask = bits >= 8 ? 0xff :
+            bits <= 0 ? 0 : (uint8_t)(0xffU << (8 - bits));
+        first[i] = cidr.s6_addr[i] & mask;
+        last[i] = first[i] | (uint8_t)~mask;
+    }
+    return true;
+}   // getIPv6CIDRRange
+
 #ifndef ENABLE_IPV6
 // ----------------------------------------------------------------------------
 extern "C" int isIPv6Socket()
@@ -34,3 +34,4 @@ std::string getIPV6ReadableFromIn6(const struct sockaddr_in6* in);
 bool sameIPV6(const struct sockaddr_in6* in_1,
               const struct sockaddr_in6* in_2);
 bool isIPv4MappedAddress(const struct sockaddr_in6* in6);
+bool getIPv6CIDRRange(const char* ipv6_cidr, uint8_t* first, uint8_t* last);
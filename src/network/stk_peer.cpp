@@ -20,11 +20,13 @@
 #include "config/stk_config.hpp"
 #include "config/user_config.hpp"
 #include "network/crypto.hpp"
+#include "network/crypto_pipeline.hpp"
 #include "network/event.hpp"
 #include "network/network.hpp"
 #include "network/network_config.hpp"
 #include "network/network_player_profile.hpp"
 #include "network/network_string.hpp"
+#include "network/packet_compressor.hpp"
 #include "network/socket_address.hpp"
 #include "network/stk_ipv6.hpp"
 #include "network/stk_host.hpp"
@@ -54,6 +56,7 @@ STKPeer::STKPeer(ENetPeer *enet_peer, STKHost* host, uint32_t host_id)
     m_spectator.store(false);
     m_disconnected.store(false);
     m_warned_for_high_ping.store(false);
+    m_compression.store(false);
     m_last_activity.store((int64_t)StkTime::getMonoTimeMs());
     m_last_message.store(0);
     m_angry_host.store(false);
@@ -72,8 +75,7 @@ void STKPeer::disconnect()
     if (m_disconnected.load())
         return;
     m_disconnected.store(true);
-    m_host->addEnetCommand(m_enet_peer, NULL, PDI_NORMAL, ECT_DISCONNECT,
-        m_address);
+    addEnetCommand(NULL, PDI_NORMAL, ECT_DISCONNECT);
 }   // disconnect
 
 //-----------------------------------------------------------------------------
@@ -84,8 +86,7 @@ void STKPeer::kick()
     if (m_disconnected.load())
         return;
     m_disconnected.store(true);
-    m_host->addEnetCommand(m_enet_peer, NULL, PDI_KICK, ECT_DISCONNECT,
-        m_address);
+    addEnetCommand(NULL, PDI_KICK, ECT_DISCONNECT);
 }   // kick
 
 //-----------------------------------------------------------------------------
@@ -96,9 +97,25 @@ void STKPeer::reset()
     if (m_disconnected.load())
         return;
     m_disconnected.store(true);
-    m_host->addEnetCommand(m_enet_peer, NULL, 0, ECT_RESET, m_address);
+    addEnetCommand(NULL, 0, ECT_RESET);
 }   // reset
 
+//-----------------------------------------------------------------------------
+/** Lets the listening thread run an ENet command for this peer. If its
+ *  packets are encrypted by the crypto pipeline, the command is queued after
+ *  them there.
+ */
+void STKPeer::addEnetCommand(ENetPacket* packet, uint32_t i,
+                             ENetCommandType ect)
+{
+    CryptoPipeline* cp = m_host->getCryptoPipeline();
+    std::shared_ptr<STKPeer> peer = weak_from_this().lock();
+    if (cp && m_crypto && peer)
+        cp->addCommand(peer, packet, i, ect);
+    else
+        m_host->addEnetCommand(m_enet_peer, packet, i, ect, m_address);
+}   // addEnetCommand
+
 //-----------------------------------------------------------------------------
 /** Sends a packet to this host.
  *  \param data The data to send.
@@ -106,6 +123,32 @@ void STKPeer::reset()
  *  \param encrypted If the data is sent encrypted or not.
  */
 void STKPeer::sendPacket(NetworkString *data, PacketReliabilityMode reliable, PacketEncryptionMode encrypted)
+{
+    if (m_disconnected.load())
+        return;
+
+    if (m_compression.load() && PacketCompressor::shouldCompress(*data))
+    {
+        NetworkString compressed(PROTOCOL_NONE, data->getTotalSize());
+        bool codec_failed = false;
+        if (PacketCompressor::compress(*data, &compressed, &codec_failed))
+        {
+            sendPacketAsIs(&compressed, reliable, encrypted);
+            return;
+        }
+        if (codec_failed)
+            m_compression.store(false);
+    }
+    sendPacketAsIs(data, reliable, encrypted);
+}   // sendPacket
+
+//-----------------------------------------------------------------------------
+/** Sends a packet without compressing it, e.g. because it is already
+ *  compressed.
+ */
+void STKPeer::sendPacketAsIs(NetworkString *data,
+                             PacketReliabilityMode reliable,
+                             PacketEncryptionMode encrypted)
 {
     if (m_disconnected.load())
         return;
@@ -113,6 +156,13 @@ void STKPeer::sendPacket(NetworkString *data, PacketReliabilityMode reliable, Pa
     ENetPacket* packet = NULL;
     if (m_crypto && encrypted)
     {
+        CryptoPipeline* cp = m_host->getCryptoPipeline();
+        std::shared_ptr<STKPeer> peer = weak_from_this().lock();
+        if (cp && peer)
+        {
+            cp->sendPacket(peer, data, reliable);
+            return;
+        }
         packet = m_crypto->encryptSend(*data, reliable);
     }
     else
@@ -132,11 +182,11 @@ void STKPeer::sendPacket(NetworkString *data, PacketReliabilityMode reliable, Pa
                 packet->dataLength, getAddress().toString().c_str(),
                 StkTime::getRealTime());
         }
-        m_host->addEnetCommand(m_enet_peer, packet,
-                encrypted ? EVENT_CHANNEL_NORMAL : EVENT_CHANNEL_UNENCRYPTED,
-                ECT_SEND_PACKET, m_address);
+        addEnetCommand(packet,
+            encrypted ? EVENT_CHANNEL_NORMAL : EVENT_CHANNEL_UNENCRYPTED,
+            ECT_SEND_PACKET);
     }
-}   // sendPacket
+}   // sendPacketAsIs
 
 //-----------------------------------------------------------------------------
 /** Returns if the peer is connected or not.
@@ -23,6 +23,7 @@
 #ifndef STK_PEER_HPP
 #define STK_PEER_HPP
 
+#include "utils/asset_bitset.hpp"
 #include "utils/no_copy.hpp"
 #include "utils/time.hpp"
 #include "utils/types.hpp"
@@ -40,6 +41,7 @@
 #include <vector>
 
 class Crypto;
+enum ENetCommandType : unsigned int;
 class NetworkPlayerProfile;
 class NetworkString;
 class STKHost;
@@ -75,7 +77,8 @@ enum AlwaysSpectateMode : uint8_t
  *  \brief Represents a peer.
  *  This class is used to interface the ENetPeer structure.
  */
-class STKPeer : public NoCopy
+class STKPeer : public NoCopy,
+                public std::enable_shared_from_this<STKPeer>
 {
 protected:
     /** Pointer to the corresponding ENet peer data structure. */
@@ -95,6 +98,9 @@ protected:
 
     std::atomic_bool m_warned_for_high_ping;
 
+    /** True if packets sent to this peer can be compressed. */
+    std::atomic_bool m_compression;
+
     std::atomic<uint8_t> m_always_spectate;
 
     std::atomic<uint8_t> m_default_always_spectate;
@@ -119,7 +125,11 @@ protected:
     int m_consecutive_messages;
 
     /** Available karts and tracks from this peer */
-    std::pair<std::set<std::string>, std::set<std::string> > m_available_kts;
+    std::pair<AssetBitset, AssetBitset> m_available_kts;
+
+    /** Karts and tracks from this peer which are unknown to the server, they
+     *  are kept here so that they are not added to the AssetIndex. */
+    std::pair<std::set<std::string>, std::set<std::string> > m_unknown_kts;
 
     std::unique_ptr<Crypto> m_crypto;
 
@@ -142,6 +152,8 @@ protected:
     std::atomic_int m_angry_host;
 
     std::atomic_bool m_booked_slot;
+
+    void addEnetCommand(ENetPacket* packet, uint32_t i, ENetCommandType ect);
 public:
     STKPeer(ENetPeer *enet_peer, STKHost* host, uint32_t host_id);
     // ------------------------------------------------------------------------
@@ -150,6 +162,16 @@ public:
     void sendPacket(NetworkString *data, PacketReliabilityMode reliable = PRM_RELIABLE,
                     PacketEncryptionMode encrypted = PEM_ENCRYPTED);
     // ------------------------------------------------------------------------
+    void sendPacketAsIs(NetworkString *data,
+                        PacketReliabilityMode reliable = PRM_RELIABLE,
+                        PacketEncryptionMode encrypted = PEM_ENCRYPTED);
+    // ------------------------------------------------------------------------
+    /** Sets if packets sent to this peer can be compressed, i.e. if both
+     *  hosts support it. */
+    void setCompression(bool val)                 { m_compression.store(val); }
+    // ------------------------------------------------------------------------
+    bool useCompression() const                { return m_compression.load(); }
+    // ------------------------------------------------------------------------
     void disconnect();
     // ------------------------------------------------------------------------
     void kick();
@@ -182,42 +204,37 @@ public:
     float getConnectedTime() const
        { return float(StkTime::getMonoTimeMs() - m_connected_time) / 1000.0f; }
     // ------------------------------------------------------------------------
-    void setAvailableKartsTracks(const std::set<std::string>& k,
-                                 const std::set<std::string>& t)
-              { m_available_kts = std::make_pair(std::move(k), std::move(t)); }
+    void setAvailableKartsTracks(const AssetBitset& k, const AssetBitset& t)
+                                    { m_available_kts = std::make_pair(k, t); }
     // ------------------------------------------------------------------------
-    void eraseServerKarts(const std::set<std::string>& server_karts,
-                          std::set<std::string>& karts_erase) const
+    void setUnknownKartsTracks(std::set<std::string>&& k,
+                               std::set<std::string>&& t)
     {
-        if (m_available_kts.first.empty())
-            return;
-        for (const std::string& server_kart : server_karts)
-        {
-            if (m_available_kts.first.find(server_kart) ==
-                m_available_kts.first.end())
-            {
-                karts_erase.insert(server_kart);
-            }
-        }
-    }
+        m_unknown_kts.first = std::move(k);
+        m_unknown_kts.second = std::move(t);
+    }   // setUnknownKartsTracks
+    // ------------------------------------------------------------------------
+    /** Returns the karts available on this peer, empty if unknown. */
+    const AssetBitset& getClientKarts() const
+                                              { return m_available_kts.first; }
+    // ------------------------------------------------------------------------
+    /** Returns the tracks available on this peer, empty if unknown. */
+    const AssetBitset& getClientTracks() const
+                                             { return m_available_kts.second; }
     // ------------------------------------------------------------------------
-    void eraseServerTracks(const std::set<std::string>& server_tracks,
-                           std::set<std::string>& tracks_erase) const
+    /** Returns if this peer has a kart, even one unknown to the server. */
+    bool hasClientKart(const std::string& name) const
     {
-        if (m_available_kts.second.empty())
-            return;
-        for (const std::string& server_track : server_tracks)
-        {
-            if (m_available_kts.second.find(server_track) ==
-                m_available_kts.second.end())
-            {
-                tracks_erase.insert(server_track);
-            }
-        }
-    }
+        return m_available_kts.first.contains(name) ||
+            m_unknown_kts.first.count(name) != 0;
+    }   // hasClientKart
     // ------------------------------------------------------------------------
-    std::pair<std::set<std::string>, std::set<std::string> >
-                            getClientAssets() const { return m_available_kts; }
+    /** Returns if this peer has a track, even one unknown to the server. */
+    bool hasClientTrack(const std::string& name) const
+    {
+        return m_available_kts.second.contains(name) ||
+            m_unknown_kts.second.count(name) != 0;
+    }   // hasClientTrack
     // ------------------------------------------------------------------------
     void setPingInterval(uint32_t interval)
                             { enet_peer_ping_interval(m_enet_peer, interval); }
@@ -232,6 +249,8 @@ public:
     // ------------------------------------------------------------------------
     ENetPeer* getENetPeer() const                       { return m_enet_peer; }
     // ------------------------------------------------------------------------
+    const ENetAddress& getENetAddress() const             { return m_address; }
+    // ------------------------------------------------------------------------
     void setWaitingForGame(bool val)         { m_waiting_for_game.store(val); }
     // ------------------------------------------------------------------------
     bool isWaitingForGame() const         { return m_waiting_for_game.load(); }
@@ -214,8 +214,8 @@ void Physics::update(int ticks)
     // other object. So only a flag is set in the flyables, the actual
     // clean up is then done later in the projectile manager.
     std::vector<CollisionPair>::iterator p;
-    // Child process currently has no scripting engine
-    bool is_child = STKProcess::getType() == PT_CHILD;
+    // Only the main process has a scripting engine
+    bool no_script_engine = STKProcess::getType() != PT_MAIN;
     for(p=m_all_collisions.begin(); p!=m_all_collisions.end(); ++p)
     {
         // Kart-kart collision
@@ -226,7 +226,7 @@ void Physics::update(int ticks)
                               p->getContactPointCS(0),
                               p->getUserPointer(1)->getPointerKart(),
                               p->getContactPointCS(1)                );
-            if (!is_child)
+            if (!no_script_engine)
             {
                 Scripting::ScriptEngine* script_engine =
                                                 Scripting::ScriptEngine::getInstance();
@@ -259,7 +259,7 @@ void Physics::update(int ticks)
                 lib_id = library->getID();
             lib_id_ptr = &lib_id;
 
-            if (!is_child && scripting_function.size() > 0)
+            if (!no_script_engine && scripting_function.size() > 0)
             {
                 Scripting::ScriptEngine* script_engine = Scripting::ScriptEngine::getInstance();
                 script_engine->runFunction(true, "void " + scripting_function + "(int, const string, const string)",
@@ -352,7 +352,7 @@ void Physics::update(int ticks)
             PhysicalObject* obj = p->getUserPointer(1)->getPointerPhysicalObject();
             std::string obj_id = obj->getID();
             std::string scripting_function = obj->getOnItemCollisionFunction();
-            if (!is_child && scripting_function.size() > 0)
+            if (!no_script_engine && scripting_function.size() > 0)
             {
                 Scripting::ScriptEngine* script_engine = Scripting::ScriptEngine::getInstance();
                 script_engine->runFunction(true, "void " + scripting_function + "(int, int, const string)",
@@ -19,15 +19,563 @@
 #include "physics/triangle_mesh.hpp"
 
 #include "config/stk_config.hpp"
+#include "io/file_manager.hpp"
 #include "main_loop.hpp"
 #include "physics/physics.hpp"
 #include "utils/constants.hpp"
+#include "utils/file_utils.hpp"
 #include "utils/log.hpp"
 #include "utils/time.hpp"
 
 #include "btBulletDynamicsCommon.h"
+#include "BulletCollision/NarrowPhaseCollision/btRaycastCallback.h"
+#include "simd_wrapper.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
+#include <random>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+    /** Header of a cached bvh file, followed by the serialized bvh. Its size
+     *  keeps the bvh data 16 byte aligned. */
+    struct BvhCacheHeader
+    {
+        char     m_magic[4];
+        uint32_t m_version;
+        uint64_t m_mesh_hash;
+        uint32_t m_build_us;
+        uint32_t m_data_size;
+        uint8_t  m_padding[8];
+    };
+    static_assert(sizeof(BvhCacheHeader) == 32, "Bvh data must be aligned");
+
+    const char BVH_CACHE_MAGIC[4] = { 'S', 'T', 'K', 'B' };
+    /** Increase if the format of the file or of the bvh changes. */
+    const uint32_t BVH_CACHE_VERSION = 2;
+
+    // ------------------------------------------------------------------------
+    /** 64-bit FNV-1a hash of some bytes. */
+    uint64_t fnv1a(uint64_t hash, const void *data, size_t size)
+    {
+        const uint8_t *bytes = (const uint8_t*)data;
+        for (size_t i = 0; i < size; i++)
+        {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }   // fnv1a
+
+    // ------------------------------------------------------------------------
+    /** A special ray result class that stores the index of the triangle
+     *  that was hit. */
+    class MaterialRayResult : public btCollisionWorld::ClosestRayResultCallback
+    {
+    public:
+        /** Stores the index of the triangle that was hit. */
+        int m_index;
+        // --------------------------------------------------------------------
+        MaterialRayResult(const btVector3 &p1, const btVector3 &p2)
+                        : btCollisionWorld::ClosestRayResultCallback(p1,p2)
+        {
+            m_index = -1;
+        }   // MaterialRayResult
+        // --------------------------------------------------------------------
+        virtual btScalar addSingleResult(btCollisionWorld::LocalRayResult& rayResult,
+                                         bool normalInWorldSpace)
+        {
+            m_index = rayResult.m_localShapeInfo->m_triangleIndex;
+            return btCollisionWorld::ClosestRayResultCallback
+                    ::addSingleResult(rayResult, normalInWorldSpace);
+        }   // AddSingleResult
+    };   // MaterialRayResult
+
+    // ------------------------------------------------------------------------
+    /** Inserts two zero bits before each of the lower 10 bits of a number,
+     *  to interleave three numbers into a Morton code. */
+    uint32_t spreadBits(uint32_t n)
+    {
+        n &= 0x3ff;
+        n = (n | (n << 16)) & 0x030000ff;
+        n = (n | (n <<  8)) & 0x0300f00f;
+        n = (n | (n <<  4)) & 0x030c30c3;
+        n = (n | (n <<  2)) & 0x09249249;
+        return n;
+    }   // spreadBits
+
+    // ------------------------------------------------------------------------
+    /** The number of rays tested together by castRays(). */
+    const unsigned int RAY_PACKET_SIZE = 4;
+
+    // ------------------------------------------------------------------------
+    /** One ray of a packet: tests the triangles of the leaves of the bvh
+     *  reached by the ray and passes the hits to a MaterialRayResult, the
+     *  same way btCollisionWorld::rayTestSingle does for a triangle mesh.
+     */
+    class RayPacketLane : public btTriangleRaycastCallback
+    {
+    public:
+        MaterialRayResult  m_result;
+    private:
+        btCollisionObject *m_object;
+        btMatrix3x3        m_basis;
+
+    public:
+        RayPacketLane()
+            : btTriangleRaycastCallback(btVector3(0, 0, 0),
+                                        btVector3(0, 0, 0)),
+              m_result(btVector3(0, 0, 0), btVector3(0, 0, 0))
+        {
+            m_object = NULL;
+        }   // RayPacketLane
+        // --------------------------------------------------------------------
+        /** Sets the ray of this lane.
+         *  \param from, to The ray in world coordinates.
+         *  \param world The transform of the mesh.
+         *  \param world_to_local The inverse of world.
+         *  \param object The collision object reported in the results.
+         */
+        void init(const btVector3 &from, const btVector3 &to,
+                  const btTransform &world, const btTransform &world_to_local,
+                  btCollisionObject *object)
+        {
+            m_result.m_rayFromWorld = from;
+            m_result.m_rayToWorld   = to;
+            m_from        = world_to_local * from;
+            m_to          = world_to_local * to;
+            m_flags       = m_result.m_flags;
+            m_hitFraction = m_result.m_closestHitFraction;
+            m_basis       = world.getBasis();
+            m_object      = object;
+        }   // init
+        // --------------------------------------------------------------------
+        virtual btScalar reportHit(const btVector3 &normal, btScalar fraction,
+                                   int part, int index)
+        {
+            btCollisionWorld::LocalShapeInfo info;
+            info.m_shapePart     = part;
+            info.m_triangleIndex = index;
+            btCollisionWorld::LocalRayResult result(m_object, &info,
+                                                    m_basis * normal,
+                                                    fraction);
+            return m_result.addSingleResult(result,
+                                            /*normal_in_world_space*/true);
+        }   // reportHit
+    };   // RayPacketLane
+
+    // ------------------------------------------------------------------------
+    /** Up to RAY_PACKET_SIZE rays which are tested together against the
+     *  nodes of a bvh, one ray per lane of a SIMD register. The tests use
+     *  exactly the same arithmetic as walkStacklessTreeAgainstRay and
+     *  walkStacklessQuantizedTreeAgainstRay of btQuantizedBvh, so each ray
+     *  reaches exactly the same leaves as when it is cast on its own.
+     */
+    class RayPacket
+    {
+    private:
+        /** The rays in the local coordinates of the mesh. */
+        btVector3      m_from[RAY_PACKET_SIZE];
+        btVector3      m_inverse_direction[RAY_PACKET_SIZE];
+        unsigned int   m_sign[RAY_PACKET_SIZE][3];
+        btScalar       m_lambda_max[RAY_PACKET_SIZE];
+
+        /** The bounding boxes of the rays. */
+        btVector3      m_aabb_min[RAY_PACKET_SIZE];
+        btVector3      m_aabb_max[RAY_PACKET_SIZE];
+        unsigned short m_quantized_min[RAY_PACKET_SIZE][3];
+        unsigned short m_quantized_max[RAY_PACKET_SIZE][3];
+
+#ifdef CPU_SSE2_SUPPORT
+        /** The same data, with one register per coordinate. */
+        __m128         m_from4[3];
+        __m128         m_inverse_direction4[3];
+        __m128         m_sign4[3];
+        __m128         m_lambda_max4;
+        __m128         m_aabb_min4[3];
+        __m128         m_aabb_max4[3];
+        __m128i        m_quantized_min4[3];
+        __m128i        m_quantized_max4[3];
+        // --------------------------------------------------------------------
+        static __m128 select(__m128 mask, __m128 a, __m128 b)
+        {
+            return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+        }   // select
+        // --------------------------------------------------------------------
+        /** Computes the distances along the rays to the two planes of a box
+         *  along one axis, like btRayAabb2. */
+        void getSlab(int axis, const btVector3 *bounds, __m128 *near_t,
+                     __m128 *far_t) const
+        {
+            const __m128 lower = _mm_set1_ps(bounds[0][axis]);
+            const __m128 upper = _mm_set1_ps(bounds[1][axis]);
+            *near_t = _mm_mul_ps(_mm_sub_ps(select(m_sign4[axis], upper,
+                                                   lower), m_from4[axis]),
+                                 m_inverse_direction4[axis]);
+            *far_t  = _mm_mul_ps(_mm_sub_ps(select(m_sign4[axis], lower,
+                                                   upper), m_from4[axis]),
+                                 m_inverse_direction4[axis]);
+        }   // getSlab
+#endif
+
+        /** Bit i is set if lane i contains a ray. */
+        unsigned int   m_lanes;
+
+        // --------------------------------------------------------------------
+        /** Returns the lanes whose rays hit a box, see btRayAabb2. */
+        unsigned int testRays(const btVector3 *bounds) const
+        {
+#ifdef CPU_SSE2_SUPPORT
+            __m128 t_min, t_max, ty_min, ty_max, tz_min, tz_max;
+            getSlab(0, bounds, &t_min, &t_max);
+            getSlab(1, bounds, &ty_min, &ty_max);
+            __m128 miss = _mm_or_ps(_mm_cmpgt_ps(t_min, ty_max),
+                                    _mm_cmpgt_ps(ty_min, t_max));
+            t_min = select(_mm_cmpgt_ps(ty_min, t_min), ty_min, t_min);
+            t_max = select(_mm_cmplt_ps(ty_max, t_max), ty_max, t_max);
+            getSlab(2, bounds, &tz_min, &tz_max);
+            miss = _mm_or_ps(miss, _mm_or_ps(_mm_cmpgt_ps(t_min, tz_max),
+                                             _mm_cmpgt_ps(tz_min, t_max)));
+            t_min = select(_mm_cmpgt_ps(tz_min, t_min), tz_min, t_min);
+            t_max = select(_mm_cmplt_ps(tz_max, t_max), tz_max, t_max);
+            const __m128 hit =
+                _mm_andnot_ps(miss,
+                              _mm_and_ps(_mm_cmplt_ps(t_min, m_lambda_max4),
+                                         _mm_cmpgt_ps(t_max,
+                                                      _mm_setzero_ps())));
+            return (unsigned int)_mm_movemask_ps(hit) & m_lanes;
+#else
+            unsigned int lanes = 0;
+            for (unsigned int i = 0; i < RAY_PACKET_SIZE; i++)
+            {
+                btScalar param;
+                if (btRayAabb2(m_from[i], m_inverse_direction[i], m_sign[i],
+                               bounds, param, 0.0f, m_lambda_max[i]))
+                    lanes |= 1 << i;
+            }
+            return lanes & m_lanes;
+#endif
+        }   // testRays
+
+    public:
+        RayPacket() : m_lanes(0) {}
+        // --------------------------------------------------------------------
+        /** Sets the ray of a lane, in local coordinates of the mesh. */
+        void setRay(unsigned int lane, const btVector3 &from,
+                    const btVector3 &to, const btQuantizedBvh &bvh)
+        {
+            // Same as the start of walkStackless(Quantized)TreeAgainstRay
+            btVector3 direction = to - from;
+            direction.normalize();
+            m_lambda_max[lane] = direction.dot(to - from);
+            for (int i = 0; i < 3; i++)
+            {
+                m_inverse_direction[lane][i] = direction[i] == btScalar(0.0)
+                                             ? btScalar(BT_LARGE_FLOAT)
+                                             : btScalar(1.0) / direction[i];
+                m_sign[lane][i] = m_inverse_direction[lane][i] < 0.0;
+            }
+            m_from[lane] = from;
+            m_aabb_min[lane] = from;
+            m_aabb_min[lane].setMin(to);
+            m_aabb_max[lane] = from;
+            m_aabb_max[lane].setMax(to);
+            if (bvh.isQuantized())
+            {
+                bvh.quantizeWithClamp(m_quantized_min[lane], m_aabb_min[lane],
+                                      0);
+                bvh.quantizeWithClamp(m_quantized_max[lane], m_aabb_max[lane],
+                                      1);
+            }
+            m_lanes |= 1 << lane;
+        }   // setRay
+        // --------------------------------------------------------------------
+        /** Fills the unused lanes with copies of the first ray and prepares
+         *  the SIMD registers. Must be called after all rays are set. */
+        void finish()
+        {
+            for (unsigned int i = 1; i < RAY_PACKET_SIZE; i++)
+            {
+                if (m_lanes & (1 << i))
+                    continue;
+                m_from[i]              = m_from[0];
+                m_inverse_direction[i] = m_inverse_direction[0];
+                m_lambda_max[i]        = m_lambda_max[0];
+                m_aabb_min[i]          = m_aabb_min[0];
+                m_aabb_max[i]          = m_aabb_max[0];
+                for (int j = 0; j < 3; j++)
+                {
+                    m_sign[i][j]          = m_sign[0][j];
+                    m_quantized_min[i][j] = m_quantized_min[0][j];
+                    m_quantized_max[i][j] = m_quantized_max[0][j];
+                }
+            }
+#ifdef CPU_SSE2_SUPPORT
+            for (int j = 0; j < 3; j++)
+            {
+                m_from4[j] = _mm_setr_ps(m_from[0][j], m_from[1][j],
+                                         m_from[2][j], m_from[3][j]);
+                m_inverse_direction4[j] =
+                    _mm_setr_ps(m_inverse_direction[0][j],
+                                m_inverse_direction[1][j],
+                                m_inverse_direction[2][j],
+                                m_inverse_direction[3][j]);
+                m_sign4[j] = _mm_castsi128_ps(
+                    _mm_setr_epi32(-(int)m_sign[0][j], -(int)m_sign[1][j],
+                                   -(int)m_sign[2][j], -(int)m_sign[3][j]));
+                m_aabb_min4[j] = _mm_setr_ps(m_aabb_min[0][j],
+                                             m_aabb_min[1][j],
+                                             m_aabb_min[2][j],
+                                             m_aabb_min[3][j]);
+                m_aabb_max4[j] = _mm_setr_ps(m_aabb_max[0][j],
+                                             m_aabb_max[1][j],
+                                             m_aabb_max[2][j],
+                                             m_aabb_max[3][j]);
+                m_quantized_min4[j] = _mm_setr_epi32(m_quantized_min[0][j],
+                                                     m_quantized_min[1][j],
+                                                     m_quantized_min[2][j],
+                                                     m_quantized_min[3][j]);
+                m_quantized_max4[j] = _mm_setr_epi32(m_quantized_max[0][j],
+                                                     m_quantized_max[1][j],
+                                                     m_quantized_max[2][j],
+                                                     m_quantized_max[3][j]);
+            }
+            m_lambda_max4 = _mm_setr_ps(m_lambda_max[0], m_lambda_max[1],
+                                        m_lambda_max[2], m_lambda_max[3]);
+#endif
+        }   // finish
+        // --------------------------------------------------------------------
+        unsigned int getLanes() const                       { return m_lanes; }
+        // --------------------------------------------------------------------
+        /** Returns the lanes whose rays reach a node of an unquantized bvh,
+         *  see walkStacklessTreeAgainstRay. */
+        unsigned int testNode(const btQuantizedBvh &bvh,
+                              const btOptimizedBvhNode &node) const
+        {
+            unsigned int lanes = 0;
+#ifdef CPU_SSE2_SUPPORT
+            __m128 miss = _mm_setzero_ps();
+            for (int j = 0; j < 3; j++)
+            {
+                const __m128 lower = _mm_set1_ps(node.m_aabbMinOrg[j]);
+                const __m128 upper = _mm_set1_ps(node.m_aabbMaxOrg[j]);
+                miss = _mm_or_ps(miss,
+                                 _mm_or_ps(_mm_cmpgt_ps(m_aabb_min4[j], upper),
+                                           _mm_cmplt_ps(m_aabb_max4[j],
+                                                        lower)));
+            }
+            lanes = (unsigned int)(~_mm_movemask_ps(miss) & 0xf) & m_lanes;
+#else
+            for (unsigned int i = 0; i < RAY_PACKET_SIZE; i++)
+            {
+                if (TestAabbAgainstAabb2(m_aabb_min[i], m_aabb_max[i],
+                                         node.m_aabbMinOrg, node.m_aabbMaxOrg))
+                    lanes |= 1 << i;
+            }
+            lanes &= m_lanes;
+#endif
+            if (lanes == 0)
+                return 0;
+            const btVector3 bounds[2] = { node.m_aabbMinOrg,
+                                          node.m_aabbMaxOrg };
+            return lanes & testRays(bounds);
+        }   // testNode
+        // --------------------------------------------------------------------
+        /** Returns the lanes whose rays reach a node of a quantized bvh, see
+         *  walkStacklessQuantizedTreeAgainstRay. */
+        unsigned int testNode(const btQuantizedBvh &bvh,
+                              const btQuantizedBvhNode &node) const
+        {
+            unsigned int lanes = 0;
+#ifdef CPU_SSE2_SUPPORT
+            __m128i miss = _mm_setzero_si128();
+            for (int j = 0; j < 3; j++)
+            {
+                const __m128i lower = _mm_set1_epi32(node.m_quantizedAabbMin[j]);
+                const __m128i upper = _mm_set1_epi32(node.m_quantizedAabbMax[j]);
+                miss = _mm_or_si128(miss,
+                    _mm_or_si128(_mm_cmpgt_epi32(m_quantized_min4[j], upper),
+                                 _mm_cmpgt_epi32(lower,
+                                                 m_quantized_max4[j])));
+            }
+            lanes = (unsigned int)(~_mm_movemask_ps(_mm_castsi128_ps(miss))
+                                   & 0xf) & m_lanes;
+#else
+            for (unsigned int i = 0; i < RAY_PACKET_SIZE; i++)
+            {
+                if (testQuantizedAabbAgainstQuantizedAabb(m_quantized_min[i],
+                                                          m_quantized_max[i],
+                                                  node.m_quantizedAabbMin,
+                                                  node.m_quantizedAabbMax))
+                    lanes |= 1 << i;
+            }
+            lanes &= m_lanes;
+#endif
+            if (lanes == 0)
+                return 0;
+            const btVector3 bounds[2] =
+            {
+                bvh.unQuantize(node.m_quantizedAabbMin),
+                bvh.unQuantize(node.m_quantizedAabbMax)
+            };
+            return lanes & testRays(bounds);
+        }   // testNode
+    };   // RayPacket
+
+    // ------------------------------------------------------------------------
+    bool isLeafNode(const btOptimizedBvhNode &node)
+    {
+        return node.m_escapeIndex == -1;
+    }   // isLeafNode
+    // ------------------------------------------------------------------------
+    int getEscapeIndex(const btOptimizedBvhNode &node)
+    {
+        return node.m_escapeIndex;
+    }   // getEscapeIndex
+    // ------------------------------------------------------------------------
+    int getPartId(const btOptimizedBvhNode &node)     { return node.m_subPart; }
+    // ------------------------------------------------------------------------
+    int getTriangleIndex(const btOptimizedBvhNode &node)
+    {
+        return node.m_triangleIndex;
+    }   // getTriangleIndex
+    // ------------------------------------------------------------------------
+    bool isLeafNode(const btQuantizedBvhNode &node) { return node.isLeafNode(); }
+    // ------------------------------------------------------------------------
+    int getEscapeIndex(const btQuantizedBvhNode &node)
+    {
+        return node.getEscapeIndex();
+    }   // getEscapeIndex
+    // ------------------------------------------------------------------------
+    int getPartId(const btQuantizedBvhNode &node)  { return node.getPartId(); }
+    // ------------------------------------------------------------------------
+    int getTriangleIndex(const btQuantizedBvhNode &node)
+    {
+        return node.getTriangleIndex();
+    }   // getTriangleIndex
+
+    // ------------------------------------------------------------------------
+    /** Reads a triangle of a mesh, like the node callback of
+     *  btBvhTriangleMeshShape::performRaycast. */
+    void getMeshTriangle(const btStridingMeshInterface &mesh, int part,
+                         int index, btVector3 *triangle)
+    {
+        const unsigned char *vertex_base;
+        const unsigned char *index_base;
+        int num_vertices, vertex_stride, index_stride, num_faces;
+        PHY_ScalarType vertex_type, index_type;
+        mesh.getLockedReadOnlyVertexIndexBase(&vertex_base, num_vertices,
+                                              vertex_type, vertex_stride,
+                                              &index_base, index_stride,
+                                              num_faces, index_type, part);
+        const unsigned int *indices =
+            (const unsigned int*)(index_base + index * index_stride);
+        const btVector3 &scaling = mesh.getScaling();
+        for (int j = 2; j >= 0; j--)
+        {
+            const int vertex = index_type == PHY_SHORT
+                             ? ((const unsigned short*)indices)[j]
+                             : indices[j];
+            if (vertex_type == PHY_FLOAT)
+            {
+                const float *v =
+                    (const float*)(vertex_base + vertex * vertex_stride);
+                triangle[j] = btVector3(v[0] * scaling.getX(),
+                                        v[1] * scaling.getY(),
+                                        v[2] * scaling.getZ());
+            }
+            else
+            {
+                const double *v =
+                    (const double*)(vertex_base + vertex * vertex_stride);
+                triangle[j] = btVector3(btScalar(v[0]) * scaling.getX(),
+                                        btScalar(v[1]) * scaling.getY(),
+                                        btScalar(v[2]) * scaling.getZ());
+            }
+        }
+        mesh.unLockReadOnlyVertexBase(part);
+    }   // getMeshTriangle
+
+    // ------------------------------------------------------------------------
+    /** Walks a bvh once for all rays of a packet. A ray only visits the
+     *  children of a node if it hits the node itself, so each ray reaches
+     *  the same leaves in the same order as with bullet's stackless walk.
+     *  \param nodes The contiguous nodes of the bvh.
+     *  \param lanes The rays of the packet.
+     */
+    template<typename NODE>
+    void walkRayPacket(const RayPacket &packet, const btQuantizedBvh &bvh,
+                       const NODE *nodes, int num_nodes,
+                       const btStridingMeshInterface &mesh,
+                       RayPacketLane *lanes)
+    {
+        // When only some rays hit a node, the rays hitting its parent are
+        // saved to be restored after its subtree. Since each subtree has
+        // less rays than its parent, at most RAY_PACKET_SIZE - 1 are saved.
+        struct SavedLanes
+        {
+            int          m_end;
+            unsigned int m_lanes;
+        } saved[RAY_PACKET_SIZE];
+        int num_saved = 0;
+
+        unsigned int active = packet.getLanes();
+        int index = 0;
+        btVector3 triangle[3];
+        while (index < num_nodes)
+        {
+            while (num_saved > 0 && index >= saved[num_saved - 1].m_end)
+                active = saved[--num_saved].m_lanes;
+
+            const NODE &node = nodes[index];
+            const unsigned int hit = active & packet.testNode(bvh, node);
+            if (isLeafNode(node))
+            {
+                if (hit)
+                {
+                    getMeshTriangle(mesh, getPartId(node),
+                                    getTriangleIndex(node), triangle);
+                    for (unsigned int i = 0; i < RAY_PACKET_SIZE; i++)
+                    {
+                        if (hit & (1 << i))
+                        {
+                            lanes[i].processTriangle(triangle,
+                                                     getPartId(node),
+                                                     getTriangleIndex(node));
+                        }
+                    }
+                }
+                index++;
+            }
+            else if (hit == 0)
+            {
+                index += getEscapeIndex(node);
+            }
+            else
+            {
+                if (hit != active)
+                {
+                    assert(num_saved < (int)RAY_PACKET_SIZE);
+                    saved[num_saved].m_end   = index + getEscapeIndex(node);
+                    saved[num_saved].m_lanes = active;
+                    num_saved++;
+                    active = hit;
+                }
+                index++;
+            }
+        }
+    }   // walkRayPacket
+}   // anonymous namespace
 
 // -----------------------------------------------------------------------------
 /** Constructor: Initialises all data structures with zero.
@@ -45,6 +593,9 @@ TriangleMesh::TriangleMesh(bool can_be_transformed) : m_mesh()
     // (and m_mesh->m_weldingThreshold at m_normals
     m_collision_shape  = NULL;
     m_collision_object = NULL;
+    m_cached_bvh        = NULL;
+    m_cached_bvh_memory = NULL;
+    m_cached_bvh_size   = 0;
     m_user_pointer.set(this);
 }   // TriangleMesh
 
@@ -138,24 +689,13 @@ void TriangleMesh::createCollisionShape(bool create_collision_object, const char
         //free(bytes);
 
     }
+    else if (!m_cache_name.empty())
+    {
+        bhv_triangle_mesh = createCachedShape();
+    }
     else
     {
         bhv_triangle_mesh = new btBvhTriangleMeshShape(&m_mesh, false /* useQuantizedAabbCompression */);
-
-        /*
-         // code to serialize triangle mesh
-        btOptimizedBvh* bvh = bhv_triangle_mesh->getOptimizedBvh();
-        unsigned int ssize = bvh->calculateSerializeBufferSize();
-        char* buffer = (char*)btAlignedAlloc(ssize, 16);
-        bool success = bvh->serialize(buffer, ssize, !IS_LITTLE_ENDIAN);
-        printf("serialization success = %i\n", success);
-
-        std::ofstream fileout("/tmp/btOptimizedBvh");
-        fileout.write(buffer, ssize);
-        fileout.close();
-
-        btAlignedFree(buffer);
-         */
     }
 
     m_collision_shape = bhv_triangle_mesh;
@@ -236,8 +776,243 @@ void TriangleMesh::removeAll()
     }
     delete m_collision_shape;
     m_collision_shape = NULL;
+    // The shape does not own a cached bvh, so it must be freed after the
+    // shape is deleted
+    freeCachedBvh();
 }   // removeAll
 
+// ----------------------------------------------------------------------------
+/** Creates the collision shape using the bvh from the collision cache if it
+ *  exists and matches this mesh. Otherwise the bvh is built and saved in the
+ *  cache for the next time. The bvh is unquantized like the one built by
+ *  clients, since quantized bounds are larger and can change the order in
+ *  which triangles are tested, which would make the physics of the server
+ *  differ from the clients after a rewind.
+ */
+btBvhTriangleMeshShape* TriangleMesh::createCachedShape()
+{
+    const std::string path = file_manager->getCachedCollisionDir() +
+        m_cache_name + ".bvh";
+    const uint64_t hash = getMeshHash();
+    float build_ms = 0.0f;
+
+    auto start = std::chrono::steady_clock::now();
+    btOptimizedBvh *bvh = loadCachedBvh(path, hash, &build_ms);
+    if (bvh)
+    {
+        btBvhTriangleMeshShape *shape = new btBvhTriangleMeshShape(&m_mesh,
+            false /* useQuantizedAabbCompression */, false /* buildBvh */);
+        shape->setOptimizedBvh(bvh);
+        float load_ms = std::chrono::duration<float, std::milli>
+            (std::chrono::steady_clock::now() - start).count();
+        Log::info("TriangleMesh", "Loaded collision mesh '%s' (%d "
+            "triangles) from cache in %.2f ms, building it took %.2f ms.",
+            m_cache_name.c_str(), m_mesh.getNumTriangles(), load_ms,
+            build_ms);
+        return shape;
+    }
+
+    btBvhTriangleMeshShape *shape = new btBvhTriangleMeshShape(&m_mesh,
+        false /* useQuantizedAabbCompression */);
+    build_ms = std::chrono::duration<float, std::milli>
+        (std::chrono::steady_clock::now() - start).count();
+    saveCachedBvh(path, hash, shape->getOptimizedBvh(), build_ms);
+    Log::info("TriangleMesh", "Built collision mesh '%s' (%d triangles) in "
+        "%.2f ms.", m_cache_name.c_str(), m_mesh.getNumTriangles(),
+        build_ms);
+    return shape;
+}   // createCachedShape
+
+// ----------------------------------------------------------------------------
+/** Loads a bvh from the collision cache. On POSIX systems the file is mapped
+ *  copy-on-write, since deserializing only patches the header of the bvh in
+ *  place, so the nodes are read from the page cache without copying.
+ *  \param path Name of the cache file.
+ *  \param hash Hash of the mesh, the file is ignored if it was saved for a
+ *         different mesh.
+ *  \param build_ms On return the time it took to build the bvh.
+ *  \return The bvh, or NULL if there is no valid cache file.
+ */
+btOptimizedBvh* TriangleMesh::loadCachedBvh(const std::string &path,
+                                            uint64_t hash, float *build_ms)
+{
+    freeCachedBvh();
+#ifndef WIN32
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+        return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size <= sizeof(BvhCacheHeader))
+    {
+        close(fd);
+        return NULL;
+    }
+    m_cached_bvh_size = (size_t)st.st_size;
+    void *memory = mmap(NULL, m_cached_bvh_size, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED)
+    {
+        m_cached_bvh_size = 0;
+        return NULL;
+    }
+    m_cached_bvh_memory = memory;
+#else
+    FILE *f = FileUtils::fopenU8Path(path, "rb");
+    if (!f)
+        return NULL;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (size <= (long)sizeof(BvhCacheHeader))
+    {
+        fclose(f);
+        return NULL;
+    }
+    m_cached_bvh_size = (size_t)size;
+    m_cached_bvh_memory = btAlignedAlloc(m_cached_bvh_size, 16);
+    size_t read = fread(m_cached_bvh_memory, m_cached_bvh_size, 1, f);
+    fclose(f);
+    if (read != 1)
+    {
+        freeCachedBvh();
+        return NULL;
+    }
+#endif
+
+    const BvhCacheHeader *header = (const BvhCacheHeader*)m_cached_bvh_memory;
+    if (memcmp(header->m_magic, BVH_CACHE_MAGIC, 4) != 0 ||
+        header->m_version != BVH_CACHE_VERSION ||
+        header->m_mesh_hash != hash ||
+        header->m_data_size != m_cached_bvh_size - sizeof(BvhCacheHeader))
+    {
+        Log::info("TriangleMesh", "Collision cache '%s' is outdated.",
+            path.c_str());
+        freeCachedBvh();
+        return NULL;
+    }
+    *build_ms = header->m_build_us / 1000.0f;
+
+    m_cached_bvh = btOptimizedBvh::deSerializeInPlace(
+        (char*)m_cached_bvh_memory + sizeof(BvhCacheHeader),
+        header->m_data_size, !IS_LITTLE_ENDIAN);
+    if (!m_cached_bvh || m_cached_bvh->isQuantized())
+    {
+        Log::warn("TriangleMesh", "Failed to load collision cache '%s'.",
+            path.c_str());
+        freeCachedBvh();
+        return NULL;
+    }
+    return m_cached_bvh;
+}   // loadCachedBvh
+
+// ----------------------------------------------------------------------------
+/** Saves a bvh in the collision cache. The file is written under a temporary
+ *  name and then renamed, so that other servers loading the same track never
+ *  see a partial file.
+ *  \param path Name of the cache file.
+ *  \param hash Hash of the mesh.
+ *  \param bvh The bvh to save.
+ *  \param build_ms The time it took to build the bvh, which is reported when
+ *         it is loaded from the cache.
+ */
+void TriangleMesh::saveCachedBvh(const std::string &path, uint64_t hash,
+                                 btOptimizedBvh *bvh, float build_ms) const
+{
+    BvhCacheHeader header = {};
+    memcpy(header.m_magic, BVH_CACHE_MAGIC, 4);
+    header.m_version   = BVH_CACHE_VERSION;
+    header.m_mesh_hash = hash;
+    header.m_build_us  = (uint32_t)(build_ms * 1000.0f);
+    header.m_data_size = bvh->calculateSerializeBufferSize();
+
+    void *buffer = btAlignedAlloc(header.m_data_size, 16);
+    if (!bvh->serializeInPlace(buffer, header.m_data_size, !IS_LITTLE_ENDIAN))
+    {
+        Log::warn("TriangleMesh", "Failed to serialize collision mesh '%s'.",
+            m_cache_name.c_str());
+        btAlignedFree(buffer);
+        return;
+    }
+
+    std::random_device rd;
+    const std::string tmp_path = path + "." + std::to_string(rd()) + ".tmp";
+    std::ofstream out(FileUtils::getPortableWritingPath(tmp_path),
+                      std::ios::binary);
+    out.write((const char*)&header, sizeof(header));
+    out.write((const char*)buffer, header.m_data_size);
+    out.close();
+    btAlignedFree(buffer);
+    if (!out.good())
+    {
+        Log::warn("TriangleMesh", "Failed to write collision cache '%s'.",
+            tmp_path.c_str());
+        file_manager->removeFile(tmp_path);
+        return;
+    }
+    // Windows does not replace an existing file when renaming
+    file_manager->removeFile(path);
+    if (FileUtils::renameU8Path(tmp_path, path) != 0)
+        file_manager->removeFile(tmp_path);
+}   // saveCachedBvh
+
+// ----------------------------------------------------------------------------
+/** Frees the bvh loaded from the collision cache and its memory.
+ */
+void TriangleMesh::freeCachedBvh()
+{
+    if (m_cached_bvh)
+    {
+        // The bvh was constructed in place by deSerializeInPlace
+        m_cached_bvh->~btOptimizedBvh();
+        m_cached_bvh = NULL;
+    }
+    if (!m_cached_bvh_memory)
+        return;
+#ifndef WIN32
+    munmap(m_cached_bvh_memory, m_cached_bvh_size);
+#else
+    btAlignedFree(m_cached_bvh_memory);
+#endif
+    m_cached_bvh_memory = NULL;
+    m_cached_bvh_size = 0;
+}   // freeCachedBvh
+
+// ----------------------------------------------------------------------------
+/** Returns a hash of all vertices and triangles of this mesh, used to detect
+ *  outdated cache files.
+ */
+uint64_t TriangleMesh::getMeshHash() const
+{
+    uint64_t hash = 14695981039346656037ull;
+    const uint32_t format[] = { BVH_CACHE_VERSION, sizeof(btScalar),
+                                IS_LITTLE_ENDIAN };
+    hash = fnv1a(hash, format, sizeof(format));
+    for (int part = 0; part < m_mesh.getNumSubParts(); part++)
+    {
+        const unsigned char *vertex_base, *index_base;
+        int num_verts, vertex_stride, index_stride, num_faces;
+        PHY_ScalarType vertex_type, index_type;
+        m_mesh.getLockedReadOnlyVertexIndexBase(&vertex_base, num_verts,
+            vertex_type, vertex_stride, &index_base, index_stride, num_faces,
+            index_type, part);
+        hash = fnv1a(hash, &num_verts, sizeof(num_verts));
+        hash = fnv1a(hash, &num_faces, sizeof(num_faces));
+        // Only the coordinates are used, the fourth component of a vertex
+        // may not be initialised
+        const size_t vertex_size = vertex_type == PHY_DOUBLE ?
+            3 * sizeof(double) : 3 * sizeof(float);
+        for (int i = 0; i < num_verts; i++)
+        {
+            hash = fnv1a(hash, vertex_base + i * vertex_stride,
+                vertex_size);
+        }
+        hash = fnv1a(hash, index_base, (size_t)num_faces * index_stride);
+        m_mesh.unLockReadOnlyVertexBase(part);
+    }
+    return hash;
+}   // getMeshHash
+
 // -----------------------------------------------------------------------------
 /** Interpolates the normal at the given position for the triangle with
  *  a given index. The position must be inside of the given triangle.
@@ -348,32 +1123,7 @@ bool TriangleMesh::castRay(const btVector3 &from, const btVector3 &to,
 
     btCollisionWorld::ClosestRayResultCallback result(from, to);
 
-    /** A special ray result class that stores the index of the triangle
-     *  that was hit. */
-    class MaterialRayResult : public btCollisionWorld::ClosestRayResultCallback
-    {
-    public:
-        /** Stores the index of the triangle that was hit. */
-        int m_index;
-        // --------------------------------------------------------------------
-        MaterialRayResult(const btVector3 &p1, const btVector3 &p2,
-                          const TriangleMesh *me)
-                        : btCollisionWorld::ClosestRayResultCallback(p1,p2)
-        {
-            m_index = -1;;
-        }   // MaterialRayResult
-        // --------------------------------------------------------------------
-        virtual btScalar addSingleResult(btCollisionWorld::LocalRayResult& rayResult,
-                                         bool normalInWorldSpace)
-        {
-            m_index = rayResult.m_localShapeInfo->m_triangleIndex;
-            return btCollisionWorld::ClosestRayResultCallback
-                    ::addSingleResult(rayResult, normalInWorldSpace);
-        }   // AddSingleResult
-        // --------------------------------------------------------------------
-    };   // myCollision
-
-    MaterialRayResult ray_callback(from, to, this);
+    MaterialRayResult ray_callback(from, to);
 
     // If this is a rigid body, m_collision_object is NULL, and the
     // rigid body is the actual collision object.
@@ -411,3 +1161,284 @@ bool TriangleMesh::castRay(const btVector3 &from, const btVector3 &to,
     return ray_callback.hasHit();
 
 }   // castRay
+
+// ----------------------------------------------------------------------------
+/** Casts many rays against this mesh. The rays are tested in packets
+ *  against the nodes of the bvh, so the tree is only traversed once for
+ *  each packet instead of once for each ray. Each ray gets exactly the same
+ *  result as with castRay() (which is required to keep server and clients
+ *  in sync).
+ *  \param queries The rays, on return the results of the raycasts are set.
+ *  \param count Number of rays.
+ */
+void TriangleMesh::castRays(RayQuery *queries, unsigned int count) const
+{
+    if (count == 0)
+        return;
+    if (!m_collision_shape ||
+        m_collision_shape->getShapeType() != TRIANGLE_MESH_SHAPE_PROXYTYPE)
+    {
+        for (unsigned int i = 0; i < count; i++)
+        {
+            RayQuery &q = queries[i];
+            q.m_hit = castRay(q.m_from, q.m_to, &q.m_hit_point,
+                              &q.m_material, &q.m_normal,
+                              q.m_interpolate_normal);
+        }
+        return;
+    }
+
+    // Rays starting close to each other reach mostly the same nodes, so
+    // they are sorted along a Morton curve before putting them in packets.
+    btVector3 lower = queries[0].m_from, upper = queries[0].m_from;
+    for (unsigned int i = 1; i < count; i++)
+    {
+        lower.setMin(queries[i].m_from);
+        upper.setMax(queries[i].m_from);
+    }
+    const btVector3 extent = upper - lower;
+    std::vector<std::pair<uint32_t, RayQuery*> > sorted(count);
+    for (unsigned int i = 0; i < count; i++)
+    {
+        uint32_t key = 0;
+        for (int j = 0; j < 3; j++)
+        {
+            const float f = extent[j] > 0.0f
+                ? (queries[i].m_from[j] - lower[j]) / extent[j] : 0.0f;
+            key |= spreadBits((uint32_t)(f * 1023.0f)) << j;
+        }
+        sorted[i] = std::make_pair(key, queries + i);
+    }
+    std::sort(sorted.begin(), sorted.end(),
+              [](const std::pair<uint32_t, RayQuery*> &a,
+                 const std::pair<uint32_t, RayQuery*> &b)
+              { return a.first < b.first; });
+
+    RayQuery *packet[RAY_PACKET_SIZE];
+    for (unsigned int i = 0; i < count; i += RAY_PACKET_SIZE)
+    {
+        const unsigned int n = count - i < RAY_PACKET_SIZE
+                             ? count - i : RAY_PACKET_SIZE;
+        for (unsigned int j = 0; j < n; j++)
+            packet[j] = sorted[i + j].second;
+        castRayPacket(packet, n);
+    }
+}   // castRays
+
+// ----------------------------------------------------------------------------
+/** Casts up to RAY_PACKET_SIZE rays with one walk of the bvh. This does the
+ *  same as btCollisionWorld::rayTestSingle for each ray.
+ *  \param queries Pointers to the rays, on return the results of the
+ *         raycasts are set.
+ *  \param count Number of rays, at most RAY_PACKET_SIZE.
+ */
+void TriangleMesh::castRayPacket(RayQuery **queries, unsigned int count) const
+{
+    btBvhTriangleMeshShape *shape =
+        static_cast<btBvhTriangleMeshShape*>(m_collision_shape);
+    const btQuantizedBvh &bvh = *shape->getOptimizedBvh();
+
+    btTransform world_trans;
+    // If there is a body, take the current transform from the body.
+    if(m_body)
+        world_trans = m_body->getWorldTransform();
+    else
+        world_trans.setIdentity();
+    const btTransform world_to_local = world_trans.inverse();
+    btCollisionObject *object = m_collision_object ? m_collision_object
+                                                   : m_body;
+
+    RayPacketLane lanes[RAY_PACKET_SIZE];
+    RayPacket packet;
+    for (unsigned int i = 0; i < count; i++)
+    {
+        lanes[i].init(queries[i]->m_from, queries[i]->m_to, world_trans,
+                      world_to_local, object);
+        packet.setRay(i, lanes[i].m_from, lanes[i].m_to, bvh);
+    }
+    packet.finish();
+
+    if (bvh.isQuantized())
+    {
+        walkRayPacket(packet, bvh, &bvh.getQuantizedNodeArray()[0],
+                      bvh.getNumNodes(), *shape->getMeshInterface(), lanes);
+    }
+    else
+    {
+        walkRayPacket(packet, bvh, &bvh.getContiguousNodeArray()[0],
+                      bvh.getNumNodes(), *shape->getMeshInterface(), lanes);
+    }
+
+    // Set the results the same way as castRay
+    for (unsigned int i = 0; i < count; i++)
+    {
+        const MaterialRayResult &result = lanes[i].m_result;
+        RayQuery &q = *queries[i];
+        q.m_hit = result.hasHit();
+        if (q.m_hit)
+        {
+            q.m_hit_point = result.m_hitPointWorld;
+            q.m_hit_point.setW(0.0f);
+            q.m_material = m_triangleIndex2Material[result.m_index];
+            if (q.m_interpolate_normal)
+            {
+                q.m_normal = getInterpolatedNormal(result.m_index,
+                                                   result.m_hitPointWorld);
+            }
+            else
+                q.m_normal = result.m_hitNormalWorld;
+            q.m_normal.normalize();
+        }
+        else
+        {
+            q.m_material = NULL;
+            q.m_normal.setValue(0, 1, 0);
+        }
+    }
+}   // castRayPacket
+
+// ----------------------------------------------------------------------------
+/** Tests that castRays() gives exactly the same results as castRay(), with
+ *  a built bvh and with the same bvh serialized and deserialized like in the
+ *  collision cache. Both bvhs have to give exactly the same results too, as
+ *  servers use the cached bvh and clients build it.
+ */
+void TriangleMesh::unitTesting()
+{
+    // Only the addresses are used as materials
+    const int materials[5] = { 0, 0, 0, 0, 0 };
+    std::mt19937 random(42);
+    std::uniform_real_distribution<float> coordinate(-50.0f, 50.0f);
+    std::uniform_real_distribution<float> height(-2.0f, 2.0f);
+    auto same = [](const btVector3 &a, const btVector3 &b)
+    {
+        return a.getX() == b.getX() && a.getY() == b.getY() &&
+               a.getZ() == b.getZ();
+    };
+
+    std::vector<RayQuery> built_results;
+    for (int cached = 0; cached < 2; cached++)
+    {
+        // The same mesh and rays for both bvhs
+        random.seed(42);
+        TriangleMesh mesh(/*can_be_transformed*/false);
+        // A bumpy ground with some random triangles above it
+        const btVector3 up(0, 1, 0);
+        for (int x = -20; x < 20; x++)
+        {
+            for (int z = -20; z < 20; z++)
+            {
+                btVector3 p[4];
+                for (int i = 0; i < 4; i++)
+                {
+                    const float px = 2.5f * (float)(x + (i & 1));
+                    const float pz = 2.5f * (float)(z + (i >> 1));
+                    p[i] = btVector3(px, sinf(px * 0.3f) + cosf(pz * 0.2f),
+                                     pz);
+                }
+                const Material *m =
+                    (const Material*)&materials[(x + z + 40) % 5];
+                mesh.addTriangle(p[0], p[1], p[2], up, up, up, m);
+                mesh.addTriangle(p[1], p[3], p[2], up, up, up, m);
+            }
+        }
+        for (int i = 0; i < 200; i++)
+        {
+            btVector3 p[3];
+            for (int j = 0; j < 3; j++)
+            {
+                p[j] = btVector3(coordinate(random), height(random) + 5.0f,
+                                 coordinate(random));
+            }
+            mesh.addTriangle(p[0], p[1], p[2], up, up, up,
+                             (const Material*)&materials[i % 5]);
+        }
+        mesh.createCollisionShape();
+        void *buffer = NULL;
+        btOptimizedBvh *bvh = NULL;
+        if (cached)
+        {
+            btBvhTriangleMeshShape *shape =
+                static_cast<btBvhTriangleMeshShape*>(mesh.m_collision_shape);
+            btOptimizedBvh *built = shape->getOptimizedBvh();
+            unsigned size = built->calculateSerializeBufferSize();
+            buffer = btAlignedAlloc(size, 16);
+            bool ok = built->serializeInPlace(buffer, size, !IS_LITTLE_ENDIAN);
+            assert(ok);
+            (void)ok;
+            bvh = btOptimizedBvh::deSerializeInPlace(buffer, size,
+                                                     !IS_LITTLE_ENDIAN);
+            assert(bvh && !bvh->isQuantized());
+            delete mesh.m_collision_shape;
+            shape = new btBvhTriangleMeshShape(&mesh.m_mesh,
+                /*useQuantizedAabbCompression*/false, /*buildBvh*/false);
+            shape->setOptimizedBvh(bvh);
+            mesh.m_collision_shape = shape;
+        }
+
+        std::vector<RayQuery> queries(1001);
+        for (unsigned int i = 0; i < queries.size(); i++)
+        {
+            RayQuery &q = queries[i];
+            q.m_from = btVector3(coordinate(random), 10.0f * height(random),
+                                 coordinate(random));
+            switch (i % 4)
+            {
+            // Straight down, like the terrain raycasts
+            case 0: q.m_to = q.m_from - btVector3(0, 10000.0f, 0); break;
+            // Short rays, like the wheel raycasts
+            case 1: q.m_to = q.m_from + btVector3(height(random), -3.0f,
+                                                  height(random));   break;
+            // Along an axis
+            case 2: q.m_to = q.m_from + btVector3(100.0f, 0, 0);     break;
+            default:
+                q.m_to = btVector3(coordinate(random), 10.0f * height(random),
+                                   coordinate(random));
+                break;
+            }
+            q.m_interpolate_normal = i % 3 == 0;
+            q.m_hit_point = btVector3(1, 2, 3);
+        }
+        mesh.castRays(queries.data(), (unsigned int)queries.size());
+
+        unsigned int hits = 0;
+        for (const RayQuery &q : queries)
+        {
+            btVector3 hit_point(1, 2, 3), normal;
+            const Material *material;
+            bool hit = mesh.castRay(q.m_from, q.m_to, &hit_point, &material,
+                                    &normal, q.m_interpolate_normal);
+            bool ok = hit == q.m_hit && material == q.m_material &&
+                      same(hit_point, q.m_hit_point) &&
+                      same(normal, q.m_normal);
+            assert(ok);
+            if (hit)
+                hits++;
+            (void)ok;
+        }
+        // Make sure that the rays test something
+        assert(hits > 100 && hits < queries.size());
+        (void)hits;
+
+        if (!cached)
+        {
+            built_results = queries;
+            continue;
+        }
+        for (unsigned int i = 0; i < queries.size(); i++)
+        {
+            const RayQuery &a = queries[i];
+            const RayQuery &b = built_results[i];
+            bool ok = a.m_hit == b.m_hit && a.m_material == b.m_material &&
+                      same(a.m_hit_point, b.m_hit_point) &&
+                      same(a.m_normal, b.m_normal);
+            assert(ok);
+            (void)ok;
+        }
+        delete mesh.m_collision_shape;
+        mesh.m_collision_shape = NULL;
+        // The bvh was constructed in place by deSerializeInPlace
+        bvh->~btOptimizedBvh();
+        btAlignedFree(buffer);
+    }
+}   // unitTesting
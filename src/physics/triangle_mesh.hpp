@@ -19,11 +19,13 @@
 #ifndef HEADER_TRIANGLE_MESH_HPP
 #define HEADER_TRIANGLE_MESH_HPP
 
+#include <string>
 #include <vector>
 #include "btBulletDynamicsCommon.h"
 
 #include "physics/user_pointer.hpp"
 #include "utils/aligned_array.hpp"
+#include "utils/types.hpp"
 
 class Material;
 
@@ -57,6 +59,47 @@ private:
      *  to the current transform of the body. */
     bool m_can_be_transformed;
 
+    /** If not empty, the optimized bvh of the collision shape is loaded from
+     *  (or saved to) a file with this name in the collision cache directory,
+     *  so it does not need to be built each time. */
+    std::string                  m_cache_name;
+
+    /** The bvh loaded from the cache, which is not freed by bullet. */
+    btOptimizedBvh              *m_cached_bvh;
+
+    /** The memory (mapped file or allocated buffer) of the cached bvh. */
+    void                        *m_cached_bvh_memory;
+
+    /** Size of m_cached_bvh_memory. */
+    size_t                       m_cached_bvh_size;
+
+    btBvhTriangleMeshShape* createCachedShape();
+    btOptimizedBvh* loadCachedBvh(const std::string &path, uint64_t hash,
+                                  float *build_ms);
+    void saveCachedBvh(const std::string &path, uint64_t hash,
+                       btOptimizedBvh *bvh, float build_ms) const;
+    void freeCachedBvh();
+    uint64_t getMeshHash() const;
+
+public:
+    /** A ray for castRays(). m_from, m_to and m_interpolate_normal must be
+     *  set, the other members are set to the result of the raycast, the
+     *  same way castRay() sets them (so m_hit_point is only changed if
+     *  the ray hit a triangle). */
+    struct RayQuery
+    {
+        btVector3       m_from;
+        btVector3       m_to;
+        btVector3       m_hit_point;
+        btVector3       m_normal;
+        const Material *m_material;
+        bool            m_interpolate_normal;
+        bool            m_hit;
+    };
+
+private:
+    void castRayPacket(RayQuery **queries, unsigned int count) const;
+
 public:
     class RigidBodyTriangleMesh : public btRigidBody
     {
@@ -101,6 +144,11 @@ public:
     }
     const btRigidBody *getBody() const { return m_body; }
     // ------------------------------------------------------------------------
+    /** Enables the collision cache for this mesh. The name must identify
+     *  the mesh (e.g. the track ident), the cached bvh is only used if the
+     *  triangles have not changed. */
+    void setCacheName(const std::string &name)      { m_cache_name = name; }
+    // ------------------------------------------------------------------------
     const Material* getMaterial(int n) const
                                           {return m_triangleIndex2Material[n];}
     // ------------------------------------------------------------------------
@@ -112,6 +160,8 @@ public:
     bool castRay(const btVector3 &from, const btVector3 &to,
                  btVector3 *xyz, const Material **material,
                  btVector3 *normal=NULL, bool interpolate_normal=false) const;
+    void castRays(RayQuery *queries, unsigned int count) const;
+    static void unitTesting();
     // ------------------------------------------------------------------------
     /** Returns the points of the 'indx' triangle.
      *  \param indx Index of the triangle to get.
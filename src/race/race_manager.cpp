@@ -697,7 +697,10 @@ void RaceManager::startNextRace()
     // call functions which are overwritten (otherwise polymorphism
     // will fail and the results will be incorrect). Also in init() functions
     // can be called that use World::getWorld().
-    World::getWorld()->init();
+    {
+        std::unique_lock<std::mutex> ul = World::lockLobbyLoading();
+        World::getWorld()->init();
+    }
     main_loop->renderGUI(8000);
     // Now initialise all values that need to be reset from race to race
     // Calling this here reduces code duplication in init and restartRace()
@@ -33,6 +33,8 @@ class ReplayBase : public NoCopy
 {
     // Needs access to KartReplayEvent
     friend class GhostKart;
+    // Reads and writes the events
+    friend class ReplayFormat;
 
 protected:
     /** Stores a transform event, i.e. a position and rotation of a kart
@@ -97,6 +99,16 @@ protected:
         bool        m_jumping;
     };   // KartReplayEvent
 
+    // ------------------------------------------------------------------------
+    /** All data recorded for a kart at one point in time. */
+    struct KartSample
+    {
+        TransformEvent  m_transform;
+        PhysicInfo      m_physic;
+        BonusInfo       m_bonus;
+        KartReplayEvent m_event;
+    };   // KartSample
+
     // ------------------------------------------------------------------------
     FILE *openReplayFile(bool writeable, bool full_path = false, int replay_file_number=1);
     // ------------------------------------------------------------------------
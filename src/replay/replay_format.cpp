@@ -0,0 +1,834 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2026 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "replay/replay_format.hpp"
+
+#include "io/file_manager.hpp"
+#include "utils/file_utils.hpp"
+#include "utils/log.hpp"
+#include "utils/string_utils.hpp"
+#include "utils/vs.hpp"
+
+#include <zlib.h>
+
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <stdio.h>
+
+namespace
+{
+    /** Magic value at the start of a binary replay, the last byte is the
+     *  binary version. */
+    const char BINARY_MAGIC[7] = { 'S', 'T', 'K', 'R', 'P', 'L', 'Y' };
+    /** Magic value at the end of a finished binary replay. */
+    const char END_MAGIC[4] = { 'S', 'T', 'K', 'E' };
+    /** Size of type, compression, stored size and raw size of a chunk. */
+    const unsigned CHUNK_HEADER_SIZE = 10;
+    /** Upper limit of a chunk, to reject broken files early. */
+    const uint32_t MAX_CHUNK_SIZE = 64 * 1024 * 1024;
+
+    // ------------------------------------------------------------------------
+    void writeU32(uint32_t value, uint8_t* out)
+    {
+        for (unsigned i = 0; i < 4; i++)
+            out[i] = (uint8_t)(value >> (i * 8));
+    }   // writeU32
+
+    // ------------------------------------------------------------------------
+    uint32_t readU32(const uint8_t* in)
+    {
+        uint32_t value = 0;
+        for (unsigned i = 0; i < 4; i++)
+            value |= (uint32_t)in[i] << (i * 8);
+        return value;
+    }   // readU32
+
+    // ------------------------------------------------------------------------
+    void writeVarint(uint64_t value, std::string* out)
+    {
+        while (value >= 0x80)
+        {
+            out->push_back((char)((value & 0x7f) | 0x80));
+            value >>= 7;
+        }
+        out->push_back((char)value);
+    }   // writeVarint
+
+    // ------------------------------------------------------------------------
+    bool readVarint(const std::string& in, size_t* pos, uint64_t* value)
+    {
+        *value = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7)
+        {
+            if (*pos >= in.size())
+                return false;
+            uint8_t byte = (uint8_t)in[(*pos)++];
+            *value |= (uint64_t)(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0)
+                return true;
+        }
+        return false;
+    }   // readVarint
+
+    // ------------------------------------------------------------------------
+    uint64_t zigzag(int64_t value)
+    {
+        return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63);
+    }   // zigzag
+
+    // ------------------------------------------------------------------------
+    int64_t unzigzag(uint64_t value)
+    {
+        return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+    }   // unzigzag
+
+    // ------------------------------------------------------------------------
+    /** Converts a sample to integers: times and lengths in 1/1000, speed in
+     *  1/100 and the rotation quaternion in 1/32767. */
+    void quantize(const ReplayFormat::KartSample& s, int64_t* v)
+    {
+        const btVector3& xyz = s.m_transform.m_transform.getOrigin();
+        const btQuaternion q = s.m_transform.m_transform.getRotation();
+        v[0]  = llround(s.m_transform.m_time * 1000.0);
+        v[1]  = llround(xyz.getX() * 1000.0);
+        v[2]  = llround(xyz.getY() * 1000.0);
+        v[3]  = llround(xyz.getZ() * 1000.0);
+        v[4]  = llround(q.getX() * 32767.0);
+        v[5]  = llround(q.getY() * 32767.0);
+        v[6]  = llround(q.getZ() * 32767.0);
+        v[7]  = llround(q.getW() * 32767.0);
+        v[8]  = llround(s.m_physic.m_speed * 100.0);
+        v[9]  = llround(s.m_physic.m_steer * 1000.0);
+        for (unsigned i = 0; i < 4; i++)
+            v[10 + i] = llround(s.m_physic.m_suspension_length[i] * 1000.0);
+        v[14] = s.m_physic.m_skidding_state;
+        v[15] = s.m_bonus.m_attachment;
+        v[16] = llround(s.m_bonus.m_nitro_amount * 1000.0);
+        v[17] = s.m_bonus.m_item_amount;
+        v[18] = s.m_bonus.m_item_type;
+        v[19] = s.m_bonus.m_special_value;
+        v[20] = llround(s.m_event.m_distance * 1000.0);
+        v[21] = s.m_event.m_nitro_usage;
+        v[22] = s.m_event.m_skidding_effect;
+        v[23] = (s.m_event.m_zipper_usage ? 1 : 0) |
+                (s.m_event.m_red_skidding ? 2 : 0) |
+                (s.m_event.m_jumping      ? 4 : 0);
+    }   // quantize
+
+    // ------------------------------------------------------------------------
+    void dequantize(const int64_t* v, ReplayFormat::KartSample* s)
+    {
+        s->m_transform.m_time = (float)(v[0] / 1000.0);
+        btQuaternion q((float)(v[4] / 32767.0), (float)(v[5] / 32767.0),
+                       (float)(v[6] / 32767.0), (float)(v[7] / 32767.0));
+        if (q.length2() > 0.0f)
+            q.normalize();
+        else
+            q = btQuaternion(0.0f, 0.0f, 0.0f, 1.0f);
+        s->m_transform.m_transform = btTransform(q,
+            btVector3((float)(v[1] / 1000.0), (float)(v[2] / 1000.0),
+                      (float)(v[3] / 1000.0)));
+        s->m_physic.m_speed = (float)(v[8] / 100.0);
+        s->m_physic.m_steer = (float)(v[9] / 1000.0);
+        for (unsigned i = 0; i < 4; i++)
+        {
+            s->m_physic.m_suspension_length[i] =
+                (float)(v[10 + i] / 1000.0);
+        }
+        s->m_physic.m_skidding_state = (int)v[14];
+        s->m_bonus.m_attachment      = (int)v[15];
+        s->m_bonus.m_nitro_amount    = (float)(v[16] / 1000.0);
+        s->m_bonus.m_item_amount     = (int)v[17];
+        s->m_bonus.m_item_type       = (int)v[18];
+        s->m_bonus.m_special_value   = (int)v[19];
+        s->m_event.m_distance        = (float)(v[20] / 1000.0);
+        s->m_event.m_nitro_usage     = (int)v[21];
+        s->m_event.m_skidding_effect = (int)v[22];
+        s->m_event.m_zipper_usage    = (v[23] & 1) != 0;
+        s->m_event.m_red_skidding    = (v[23] & 2) != 0;
+        s->m_event.m_jumping         = (v[23] & 4) != 0;
+    }   // dequantize
+
+    // ------------------------------------------------------------------------
+    /** Decodes the payload of a CT_SAMPLES chunk. */
+    bool decodeSamples(const std::string& data,
+                       std::vector<std::vector<ReplayFormat::KartSample> >*
+                       karts)
+    {
+        size_t pos = 0;
+        uint64_t kart, count;
+        if (!readVarint(data, &pos, &kart) || !readVarint(data, &pos, &count)
+            || kart > 1024 || count > data.size())
+            return false;
+        if (karts->size() <= kart)
+            karts->resize((size_t)kart + 1);
+        std::vector<ReplayFormat::KartSample>& samples = (*karts)[(size_t)kart];
+
+        int64_t v[ReplayFormat::NUM_VALUES] = {};
+        for (uint64_t i = 0; i < count; i++)
+        {
+            for (unsigned j = 0; j < ReplayFormat::NUM_VALUES; j++)
+            {
+                uint64_t delta;
+                if (!readVarint(data, &pos, &delta))
+                    return false;
+                v[j] += unzigzag(delta);
+            }
+            samples.emplace_back();
+            dequantize(v, &samples.back());
+        }
+        return pos == data.size();
+    }   // decodeSamples
+
+    // ------------------------------------------------------------------------
+    /** Reads the chunk starting at the current position of the file.
+     *  \return False if the chunk is incomplete or broken. */
+    bool readChunk(FILE* fd, uint8_t* type, std::string* data)
+    {
+        uint8_t header[CHUNK_HEADER_SIZE];
+        if (fread(header, 1, CHUNK_HEADER_SIZE, fd) != CHUNK_HEADER_SIZE)
+            return false;
+        *type = header[0];
+        const uint8_t compression = header[1];
+        const uint32_t stored_size = readU32(header + 2);
+        const uint32_t raw_size = readU32(header + 6);
+        if (stored_size > MAX_CHUNK_SIZE || raw_size > MAX_CHUNK_SIZE)
+            return false;
+
+        std::string stored(stored_size, '\0');
+        if (stored_size > 0 &&
+            fread(&stored[0], 1, stored_size, fd) != stored_size)
+            return false;
+
+        if (compression == ReplayFormat::CM_NONE)
+        {
+            if (stored_size != raw_size)
+                return false;
+            *data = std::move(stored);
+            return true;
+        }
+        else if (compression == ReplayFormat::CM_ZLIB)
+        {
+            data->resize(raw_size);
+            uLongf dest_len = raw_size;
+            if (uncompress((Bytef*)&(*data)[0], &dest_len,
+                (const Bytef*)stored.data(), stored_size) != Z_OK ||
+                dest_len != raw_size)
+                return false;
+            return true;
+        }
+        return false;
+    }   // readChunk
+
+    // ------------------------------------------------------------------------
+    /** Opens a binary replay and checks its magic values.
+     *  \param header_offset Set to the offset of the header chunk.
+     *  \return The file positioned after the magic value, or NULL. */
+    FILE* openBinaryFile(const std::string& filename, uint32_t* header_offset)
+    {
+        FILE* fd = FileUtils::fopenU8Path(filename, "rb");
+        if (!fd)
+            return NULL;
+        uint8_t magic[8], trailer[8];
+        if (fread(magic, 1, 8, fd) != 8 ||
+            memcmp(magic, BINARY_MAGIC, 7) != 0 ||
+            magic[7] != ReplayFormat::BINARY_VERSION ||
+            fseek(fd, -8, SEEK_END) != 0 || fread(trailer, 1, 8, fd) != 8 ||
+            memcmp(trailer + 4, END_MAGIC, 4) != 0 ||
+            fseek(fd, 8, SEEK_SET) != 0)
+        {
+            fclose(fd);
+            return NULL;
+        }
+        *header_offset = readU32(trailer);
+        return fd;
+    }   // openBinaryFile
+
+    // ------------------------------------------------------------------------
+    /** Splits a text replay into its header and the lines of the samples of
+     *  each kart. */
+    bool readTextFile(const std::string& filename, std::string* header,
+                      std::vector<std::vector<ReplayFormat::KartSample> >*
+                      karts)
+    {
+        FILE* fd = FileUtils::fopenU8Path(filename, "r");
+        if (!fd)
+            return false;
+        char s[1024];
+        unsigned version = 0;
+        bool ok = true;
+        while (fgets(s, 1023, fd))
+        {
+            if (version == 0 && sscanf(s, "version: %u", &version) != 1)
+            {
+                ok = false;
+                break;
+            }
+            unsigned size;
+            if (sscanf(s, "size: %u", &size) == 1)
+            {
+                karts->emplace_back();
+                for (unsigned i = 0; i < size && ok; i++)
+                {
+                    ReplayFormat::KartSample sample;
+                    ok = fgets(s, 1023, fd) &&
+                        ReplayFormat::parseTextSample(s, version, &sample);
+                    if (ok)
+                        karts->back().push_back(sample);
+                }
+                if (!ok)
+                    break;
+            }
+            else if (karts->empty())
+                *header += s;
+        }
+        fclose(fd);
+        return ok && version != 0;
+    }   // readTextFile
+}   // namespace
+
+// ============================================================================
+ReplayFormat::ChunkEncoder::ChunkEncoder(unsigned kart)
+{
+    m_kart = kart;
+    m_num_samples = 0;
+    memset(m_previous, 0, sizeof(m_previous));
+}   // ChunkEncoder
+
+// ----------------------------------------------------------------------------
+/** Adds a sample, it is stored as difference to the previous one. */
+void ReplayFormat::ChunkEncoder::add(const KartSample& sample)
+{
+    int64_t v[NUM_VALUES];
+    quantize(sample, v);
+    for (unsigned i = 0; i < NUM_VALUES; i++)
+    {
+        writeVarint(zigzag(v[i] - m_previous[i]), &m_data);
+        m_previous[i] = v[i];
+    }
+    m_num_samples++;
+}   // add
+
+// ----------------------------------------------------------------------------
+/** Returns the payload of a CT_SAMPLES chunk with all samples added so far,
+ *  and starts a new chunk. */
+std::string ReplayFormat::ChunkEncoder::finish()
+{
+    std::string payload;
+    writeVarint(m_kart, &payload);
+    writeVarint(m_num_samples, &payload);
+    payload += m_data;
+    m_data.clear();
+    m_num_samples = 0;
+    memset(m_previous, 0, sizeof(m_previous));
+    return payload;
+}   // finish
+
+// ============================================================================
+/** Creates the temporary file and starts the writer thread.
+ *  \param compression_level 0 to store chunks uncompressed, otherwise the
+ *         zlib compression level (1 to 9).
+ */
+ReplayFormat::Writer::Writer(const std::string& temp_name,
+                             int compression_level)
+{
+    m_temp_name = temp_name;
+    m_compression_level = std::min(compression_level, 9);
+    m_offset = 0;
+    m_finished = false;
+    m_aborted = false;
+    m_file = FileUtils::fopenU8Path(temp_name, "wb");
+    if (!m_file)
+    {
+        Log::error("ReplayFormat", "Can't open '%s' for writing - "
+            "can't save replay data.", temp_name.c_str());
+        return;
+    }
+    uint8_t magic[8];
+    memcpy(magic, BINARY_MAGIC, 7);
+    magic[7] = BINARY_VERSION;
+    if (fwrite(magic, 1, 8, m_file) != 8)
+    {
+        Log::error("ReplayFormat", "Can't write to '%s'.",
+            temp_name.c_str());
+        fclose(m_file);
+        m_file = NULL;
+        return;
+    }
+    m_offset = 8;
+    m_thread = std::thread(&Writer::mainLoop, this);
+}   // Writer
+
+// ----------------------------------------------------------------------------
+/** Waits until all chunks are written. An unfinished replay is removed. */
+ReplayFormat::Writer::~Writer()
+{
+    if (!m_finished)
+        abort();
+    if (m_thread.joinable())
+        m_thread.join();
+}   // ~Writer
+
+// ----------------------------------------------------------------------------
+/** Queues the payload of a CT_SAMPLES chunk, see ChunkEncoder::finish(). */
+void ReplayFormat::Writer::addChunk(const std::string& payload)
+{
+    assert(!m_finished && !m_aborted);
+    std::lock_guard<std::mutex> lock(m_jobs_mutex);
+    m_jobs.push_back({ CT_SAMPLES, payload, "" });
+    m_jobs_cv.notify_one();
+}   // addChunk
+
+// ----------------------------------------------------------------------------
+/** Queues the header, after it is written the replay is renamed to its
+ *  final name. No more chunks can be added afterwards. */
+void ReplayFormat::Writer::finish(const std::string& header,
+                                  const std::string& final_name)
+{
+    assert(!m_finished && !m_aborted);
+    std::lock_guard<std::mutex> lock(m_jobs_mutex);
+    m_finished = true;
+    m_jobs.push_back({ CT_HEADER, header, final_name });
+    m_jobs_cv.notify_one();
+}   // finish
+
+// ----------------------------------------------------------------------------
+/** Discards all queued chunks and removes the temporary file. */
+void ReplayFormat::Writer::abort()
+{
+    std::lock_guard<std::mutex> lock(m_jobs_mutex);
+    m_aborted = true;
+    m_jobs_cv.notify_one();
+}   // abort
+
+// ----------------------------------------------------------------------------
+void ReplayFormat::Writer::mainLoop()
+{
+    VS::setThreadName("ReplayWriter");
+    bool ok = true;
+    while (true)
+    {
+        Job job;
+        {
+            std::unique_lock<std::mutex> ul(m_jobs_mutex);
+            m_jobs_cv.wait(ul, [this]()
+                { return m_aborted || !m_jobs.empty(); });
+            if (m_aborted)
+                break;
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+
+        if (job.m_type == CT_HEADER)
+        {
+            const uint32_t header_offset = m_offset;
+            ok = ok && writeChunk(CT_HEADER, job.m_data);
+            uint8_t trailer[8];
+            writeU32(header_offset, trailer);
+            memcpy(trailer + 4, END_MAGIC, 4);
+            ok = ok && fwrite(trailer, 1, 8, m_file) == 8;
+            ok = fclose(m_file) == 0 && ok;
+            m_file = NULL;
+            if (ok)
+            {
+                // rename doesn't overwrite existing files on windows
+                FileUtils::removeU8Path(job.m_final_name);
+                ok = FileUtils::renameU8Path(m_temp_name,
+                    job.m_final_name) == 0;
+            }
+            if (!ok)
+            {
+                Log::error("ReplayFormat", "Can't save replay '%s'.",
+                    job.m_final_name.c_str());
+                FileUtils::removeU8Path(m_temp_name);
+            }
+            return;
+        }
+        if (ok && !writeChunk(job.m_type, job.m_data))
+        {
+            Log::error("ReplayFormat", "Can't write to '%s'.",
+                m_temp_name.c_str());
+            ok = false;
+        }
+    }
+    fclose(m_file);
+    m_file = NULL;
+    FileUtils::removeU8Path(m_temp_name);
+}   // mainLoop
+
+// ----------------------------------------------------------------------------
+/** Compresses (if enabled and smaller) and appends one chunk. Only called
+ *  from the writer thread. */
+bool ReplayFormat::Writer::writeChunk(ChunkType type, const std::string& data)
+{
+    Compression compression = CM_NONE;
+    std::string compressed;
+    if (m_compression_level > 0 && !data.empty())
+    {
+        uLongf dest_len = compressBound((uLong)data.size());
+        compressed.resize(dest_len);
+        if (compress2((Bytef*)&compressed[0], &dest_len,
+            (const Bytef*)data.data(), (uLong)data.size(),
+            m_compression_level) == Z_OK && dest_len < data.size())
+        {
+            compressed.resize(dest_len);
+            compression = CM_ZLIB;
+        }
+    }
+    const std::string& stored = compression == CM_NONE ? data : compressed;
+    uint8_t header[CHUNK_HEADER_SIZE];
+    header[0] = type;
+    header[1] = compression;
+    writeU32((uint32_t)stored.size(), header + 2);
+    writeU32((uint32_t)data.size(), header + 6);
+    if (fwrite(header, 1, CHUNK_HEADER_SIZE, m_file) != CHUNK_HEADER_SIZE ||
+        fwrite(stored.data(), 1, stored.size(), m_file) != stored.size())
+        return false;
+    m_offset += CHUNK_HEADER_SIZE + (uint32_t)stored.size();
+    return true;
+}   // writeChunk
+
+// ============================================================================
+/** Returns true if the file starts with the magic value of a binary replay.
+ */
+bool ReplayFormat::isBinaryFile(const std::string& filename)
+{
+    FILE* fd = FileUtils::fopenU8Path(filename, "rb");
+    if (!fd)
+        return false;
+    char magic[7];
+    bool binary = fread(magic, 1, 7, fd) == 7 &&
+        memcmp(magic, BINARY_MAGIC, 7) == 0;
+    fclose(fd);
+    return binary;
+}   // isBinaryFile
+
+// ----------------------------------------------------------------------------
+/** Reads the header of a finished binary replay, which uses the same text
+ *  format as the header of a text replay. */
+bool ReplayFormat::readBinaryHeader(const std::string& filename,
+                                    std::string* header)
+{
+    uint32_t header_offset;
+    FILE* fd = openBinaryFile(filename, &header_offset);
+    if (!fd)
+        return false;
+    uint8_t type = 0;
+    bool ok = fseek(fd, header_offset, SEEK_SET) == 0 &&
+        readChunk(fd, &type, header) && type == CT_HEADER;
+    fclose(fd);
+    return ok;
+}   // readBinaryHeader
+
+// ----------------------------------------------------------------------------
+/** Reads all samples of a binary replay.
+ *  \param karts Set to the samples of each kart, in the order of the karts
+ *         in the header.
+ */
+bool ReplayFormat::readBinarySamples(const std::string& filename,
+                                     std::vector<std::vector<KartSample> >*
+                                     karts)
+{
+    uint32_t header_offset;
+    FILE* fd = openBinaryFile(filename, &header_offset);
+    if (!fd)
+        return false;
+    bool ok = true;
+    while (ok && (uint32_t)ftell(fd) < header_offset)
+    {
+        uint8_t type = 0;
+        std::string data;
+        ok = readChunk(fd, &type, &data);
+        // Skip unknown chunks, so newer writers can add more
+        if (ok && type == CT_SAMPLES)
+            ok = decodeSamples(data, karts);
+    }
+    fclose(fd);
+    return ok;
+}   // readBinarySamples
+
+// ----------------------------------------------------------------------------
+/** Returns the line of a sample in a text replay (version 4). */
+std::string ReplayFormat::formatTextSample(const KartSample& sample)
+{
+    const ReplayBase::TransformEvent& p = sample.m_transform;
+    const ReplayBase::PhysicInfo& q = sample.m_physic;
+    const ReplayBase::BonusInfo& b = sample.m_bonus;
+    const ReplayBase::KartReplayEvent& r = sample.m_event;
+    char s[1024];
+    snprintf(s, 1024, "%f  %f %f %f  %f %f %f %f  %f  %f  %f %f %f %f %d  "
+        "%d %f %d %d %d  %f %d %d %d %d %d\n",
+        p.m_time,
+        p.m_transform.getOrigin().getX(),
+        p.m_transform.getOrigin().getY(),
+        p.m_transform.getOrigin().getZ(),
+        p.m_transform.getRotation().getX(),
+        p.m_transform.getRotation().getY(),
+        p.m_transform.getRotation().getZ(),
+        p.m_transform.getRotation().getW(),
+        q.m_speed,
+        q.m_steer,
+        q.m_suspension_length[0],
+        q.m_suspension_length[1],
+        q.m_suspension_length[2],
+        q.m_suspension_length[3],
+        q.m_skidding_state,
+        b.m_attachment,
+        b.m_nitro_amount,
+        b.m_item_amount,
+        b.m_item_type,
+        b.m_special_value,
+        r.m_distance,
+        r.m_nitro_usage,
+        (int)r.m_zipper_usage,
+        r.m_skidding_effect,
+        (int)r.m_red_skidding,
+        (int)r.m_jumping);
+    return s;
+}   // formatTextSample
+
+// ----------------------------------------------------------------------------
+/** Parses the line of a sample in a text replay.
+ *  \param version Version of the replay, version 3 replays (up to STK 0.9.3)
+ *         contain less data.
+ */
+bool ReplayFormat::parseTextSample(const char* line, unsigned version,
+                                   KartSample* sample)
+{
+    float x, y, z, rx, ry, rz, rw, time, speed, steer, w1, w2, w3, w4;
+    float nitro_amount = 0.0f, distance = 0.0f;
+    int skidding_state = 0, attachment = 0, item_amount = 0, item_type = 0,
+        special_value = 0, nitro, zipper, skidding, red_skidding, jumping;
+
+    if (version == 3)
+    {
+        if (sscanf(line, "%f  %f %f %f  %f %f %f %f  %f  %f  %f %f %f %f  "
+            "%d %d %d %d %d\n",
+            &time,
+            &x, &y, &z,
+            &rx, &ry, &rz, &rw,
+            &speed, &steer, &w1, &w2, &w3, &w4,
+            &nitro, &zipper, &skidding, &red_skidding, &jumping
+            ) != 19)
+            return false;
+    }
+    else if (sscanf(line, "%f  %f %f %f  %f %f %f %f  %f  %f  %f %f %f %f "
+        "%d  %d %f %d %d %d  %f %d %d %d %d %d\n",
+        &time,
+        &x, &y, &z,
+        &rx, &ry, &rz, &rw,
+        &speed, &steer, &w1, &w2, &w3, &w4, &skidding_state,
+        &attachment, &nitro_amount, &item_amount, &item_type, &special_value,
+        &distance, &nitro, &zipper, &skidding, &red_skidding, &jumping
+        ) != 26)
+        return false;
+
+    sample->m_transform.m_time      = time;
+    sample->m_transform.m_transform =
+        btTransform(btQuaternion(rx, ry, rz, rw), btVector3(x, y, z));
+    sample->m_physic.m_speed                = speed;
+    sample->m_physic.m_steer                = steer;
+    sample->m_physic.m_suspension_length[0] = w1;
+    sample->m_physic.m_suspension_length[1] = w2;
+    sample->m_physic.m_suspension_length[2] = w3;
+    sample->m_physic.m_suspension_length[3] = w4;
+    sample->m_physic.m_skidding_state       = skidding_state;
+    sample->m_bonus.m_attachment            = attachment;
+    sample->m_bonus.m_nitro_amount          = nitro_amount;
+    sample->m_bonus.m_item_amount           = item_amount;
+    sample->m_bonus.m_item_type             = item_type;
+    sample->m_bonus.m_special_value         = special_value;
+    sample->m_event.m_distance              = distance;
+    sample->m_event.m_nitro_usage           = nitro;
+    sample->m_event.m_zipper_usage          = zipper != 0;
+    sample->m_event.m_skidding_effect       = skidding;
+    sample->m_event.m_red_skidding          = red_skidding != 0;
+    sample->m_event.m_jumping               = jumping != 0;
+    return true;
+}   // parseTextSample
+
+// ----------------------------------------------------------------------------
+/** Converts a text replay to a binary one or the other way round, depending
+ *  on the format of the input file. Binary replays store quantized values,
+ *  so converting a text replay back and forth is not lossless.
+ *  \param from Full path of the replay to convert.
+ *  \param to Full path of the converted replay.
+ */
+bool ReplayFormat::convert(const std::string& from, const std::string& to)
+{
+    std::string header;
+    std::vector<std::vector<KartSample> > karts;
+    if (isBinaryFile(from))
+    {
+        if (!readBinaryHeader(from, &header) ||
+            !readBinarySamples(from, &karts))
+        {
+            Log::error("ReplayFormat", "Can't read binary replay '%s'.",
+                from.c_str());
+            return false;
+        }
+        // Karts without samples have no chunk
+        unsigned num_karts = 0;
+        for (const std::string& line : StringUtils::split(header, '\n'))
+        {
+            if (line.compare(0, 6, "kart: ") == 0)
+                num_karts++;
+        }
+        if (karts.size() < num_karts)
+            karts.resize(num_karts);
+
+        FILE* fd = FileUtils::fopenU8Path(to, "w");
+        if (!fd)
+        {
+            Log::error("ReplayFormat", "Can't open '%s' for writing.",
+                to.c_str());
+            return false;
+        }
+        fputs(header.c_str(), fd);
+        for (const std::vector<KartSample>& samples : karts)
+        {
+            fprintf(fd, "size:     %d\n", (int)samples.size());
+            for (const KartSample& sample : samples)
+                fputs(formatTextSample(sample).c_str(), fd);
+        }
+        fclose(fd);
+    }
+    else
+    {
+        if (!readTextFile(from, &header, &karts))
+        {
+            Log::error("ReplayFormat", "Can't read text replay '%s'.",
+                from.c_str());
+            return false;
+        }
+        std::string temp_name = to + ".part";
+        {
+            Writer writer(temp_name, 6);
+            if (!writer.isOpen())
+                return false;
+            for (unsigned i = 0; i < karts.size(); i++)
+            {
+                ChunkEncoder encoder(i);
+                for (const KartSample& sample : karts[i])
+                    encoder.add(sample);
+                writer.addChunk(encoder.finish());
+            }
+            writer.finish(header, to);
+        }
+    }
+    Log::info("ReplayFormat", "Converted '%s' to '%s'.", from.c_str(),
+        to.c_str());
+    return true;
+}   // convert
+
+// ----------------------------------------------------------------------------
+void ReplayFormat::unitTesting()
+{
+    std::vector<KartSample> samples;
+    for (unsigned i = 0; i < 50; i++)
+    {
+        KartSample s;
+        s.m_transform.m_time = i * 0.1f;
+        btQuaternion q(btVector3(0.0f, 1.0f, 0.0f), i * 0.05f);
+        s.m_transform.m_transform =
+            btTransform(q, btVector3(i * 1.5f, -2.25f, 1000.0f - i * 3.0f));
+        s.m_physic.m_speed = 20.0f + i * 0.37f;
+        s.m_physic.m_steer = -0.5f + i * 0.02f;
+        for (unsigned j = 0; j < 4; j++)
+            s.m_physic.m_suspension_length[j] = 0.1f + j * 0.01f;
+        s.m_physic.m_skidding_state = i % 3;
+        s.m_bonus.m_attachment      = i % 6;
+        s.m_bonus.m_nitro_amount    = 10.0f - i * 0.125f;
+        s.m_bonus.m_item_amount     = i % 4;
+        s.m_bonus.m_item_type       = i % 10;
+        s.m_bonus.m_special_value   = -1;
+        s.m_event.m_distance        = i * 12.5f;
+        s.m_event.m_nitro_usage     = i % 2;
+        s.m_event.m_zipper_usage    = i % 5 == 0;
+        s.m_event.m_skidding_effect = i % 3;
+        s.m_event.m_red_skidding    = i % 7 == 0;
+        s.m_event.m_jumping         = i % 2 == 1;
+        samples.push_back(s);
+    }
+
+    // Binary chunk round trip, values are quantized
+    ChunkEncoder encoder(2);
+    for (const KartSample& s : samples)
+        encoder.add(s);
+    assert(encoder.getNumSamples() == samples.size());
+    std::vector<std::vector<KartSample> > karts;
+    bool ok = decodeSamples(encoder.finish(), &karts);
+    assert(ok);
+    assert(encoder.getNumSamples() == 0);
+    assert(karts.size() == 3 && karts[0].empty() &&
+           karts[2].size() == samples.size());
+    for (unsigned i = 0; i < samples.size(); i++)
+    {
+        const KartSample& a = samples[i];
+        const KartSample& b = karts[2][i];
+        assert(fabsf(a.m_transform.m_time - b.m_transform.m_time) < 0.001f);
+        assert((a.m_transform.m_transform.getOrigin() -
+                b.m_transform.m_transform.getOrigin()).length() < 0.001f);
+        assert(fabsf(a.m_transform.m_transform.getRotation()
+               .dot(b.m_transform.m_transform.getRotation())) > 0.9999f);
+        assert(fabsf(a.m_physic.m_speed - b.m_physic.m_speed) < 0.01f);
+        assert(fabsf(a.m_physic.m_steer - b.m_physic.m_steer) < 0.001f);
+        assert(a.m_physic.m_skidding_state == b.m_physic.m_skidding_state);
+        assert(a.m_bonus.m_attachment == b.m_bonus.m_attachment);
+        assert(a.m_bonus.m_nitro_amount == b.m_bonus.m_nitro_amount);
+        assert(a.m_bonus.m_special_value == b.m_bonus.m_special_value);
+        assert(a.m_event.m_distance == b.m_event.m_distance);
+        assert(a.m_event.m_zipper_usage == b.m_event.m_zipper_usage);
+        assert(a.m_event.m_red_skidding == b.m_event.m_red_skidding);
+        assert(a.m_event.m_jumping == b.m_event.m_jumping);
+        (void)a; (void)b;
+    }
+
+    // Text line round trip
+    KartSample parsed;
+    ok = parseTextSample(formatTextSample(samples[7]).c_str(), 4, &parsed);
+    assert(ok);
+    assert(fabsf(parsed.m_physic.m_speed - samples[7].m_physic.m_speed)
+           < 0.0001f);
+    assert(parsed.m_bonus.m_item_type == samples[7].m_bonus.m_item_type);
+    assert(parsed.m_event.m_jumping == samples[7].m_event.m_jumping);
+    ok = parseTextSample("1.0 2.0", 4, &parsed);
+    assert(!ok);
+
+    // File round trip through the writer thread, the writer is destroyed
+    // once the replay is renamed
+    const std::string name = file_manager->getReplayDir() + "unit_test";
+    const std::string header = "version: 4\nkart_list_end\n";
+    {
+        Writer writer(name + ".part", 6);
+        assert(writer.isOpen());
+        for (const KartSample& s : samples)
+            encoder.add(s);
+        writer.addChunk(encoder.finish());
+        writer.finish(header, name + ".replay");
+    }
+    std::string read_header;
+    ok = readBinaryHeader(name + ".replay", &read_header);
+    assert(ok && read_header == header);
+    karts.clear();
+    ok = readBinarySamples(name + ".replay", &karts);
+    assert(ok && karts.size() == 3 && karts[2].size() == samples.size());
+    FileUtils::removeU8Path(name + ".replay");
+    (void)ok;
+}   // unitTesting
@@ -0,0 +1,170 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2026 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_REPLAY_FORMAT_HPP
+#define HEADER_REPLAY_FORMAT_HPP
+
+#include "replay/replay_base.hpp"
+#include "utils/no_copy.hpp"
+#include "utils/types.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/** \brief Reading and writing of replay files.
+ *  Two formats are supported: the original text format, where each sample
+ *  of a kart is one line, and a binary format. A binary replay starts with
+ *  a magic value followed by chunks. Each chunk has a type, a compression
+ *  method, its stored and uncompressed size and its payload:
+ *  - CT_SAMPLES: the kart index, the number of samples and the samples of
+ *    one kart. All values of a sample are quantized to integers and stored
+ *    as zigzag varints of their difference to the previous sample in this
+ *    chunk, so each chunk can be decoded on its own.
+ *  - CT_HEADER: the header of the replay, in the same text format as the
+ *    header of a text replay. It is written as the last chunk, since the
+ *    finish time and the UID are only known at the end of a race.
+ *  The file ends with the offset of the header chunk and an end magic, so
+ *  the replay list only needs to read the header.
+ *  Chunks of the karts are appended by a background thread while the race
+ *  is running, see ReplayFormat::Writer.
+ * \ingroup replay
+ */
+class ReplayFormat
+{
+public:
+    typedef ReplayBase::KartSample KartSample;
+
+    /** Chunk types of a binary replay. */
+    enum ChunkType : uint8_t
+    {
+        CT_SAMPLES = 1,
+        CT_HEADER  = 2
+    };
+
+    /** Compression method of a chunk. */
+    enum Compression : uint8_t
+    {
+        CM_NONE = 0,
+        CM_ZLIB = 1
+    };
+
+    /** Version of the binary container, independent of the replay version
+     *  stored in the header. */
+    static const uint8_t BINARY_VERSION = 1;
+
+    /** Number of quantized values of a sample. */
+    static const unsigned NUM_VALUES = 24;
+
+    // ========================================================================
+    /** Collects the delta coded samples of one kart for one chunk. */
+    class ChunkEncoder
+    {
+    private:
+        std::string m_data;
+
+        unsigned m_kart;
+
+        unsigned m_num_samples;
+
+        int64_t m_previous[NUM_VALUES];
+    public:
+        ChunkEncoder(unsigned kart = 0);
+        void add(const KartSample& sample);
+        std::string finish();
+        // --------------------------------------------------------------------
+        unsigned getNumSamples() const               { return m_num_samples; }
+        // --------------------------------------------------------------------
+        size_t getSize() const                       { return m_data.size(); }
+    };   // ChunkEncoder
+
+    // ========================================================================
+    /** Appends chunks to a binary replay in a background thread, so the
+     *  race is never stalled by file operations or compression. The replay
+     *  is written to a temporary file which is renamed when it is finished,
+     *  so an unfinished replay never shows up in the replay list.
+     */
+    class Writer : public NoCopy
+    {
+    private:
+        struct Job
+        {
+            ChunkType m_type;
+            std::string m_data;
+            /** Non-empty for the last job, the file is renamed to it. */
+            std::string m_final_name;
+        };
+
+        std::mutex m_jobs_mutex;
+
+        std::condition_variable m_jobs_cv;
+
+        std::deque<Job> m_jobs;
+
+        std::thread m_thread;
+
+        FILE* m_file;
+
+        std::string m_temp_name;
+
+        int m_compression_level;
+
+        uint32_t m_offset;
+
+        bool m_finished;
+
+        bool m_aborted;
+
+        void mainLoop();
+        bool writeChunk(ChunkType type, const std::string& data);
+    public:
+        Writer(const std::string& temp_name, int compression_level);
+        ~Writer();
+        void addChunk(const std::string& payload);
+        void finish(const std::string& header, const std::string& final_name);
+        void abort();
+        // --------------------------------------------------------------------
+        bool isOpen() const                        { return m_file != NULL; }
+        // --------------------------------------------------------------------
+        /** True once finish() was called. */
+        bool isFinished() const                        { return m_finished; }
+    };   // Writer
+
+    // ------------------------------------------------------------------------
+    static bool isBinaryFile(const std::string& filename);
+    // ------------------------------------------------------------------------
+    static bool readBinaryHeader(const std::string& filename,
+                                 std::string* header);
+    // ------------------------------------------------------------------------
+    static bool readBinarySamples(const std::string& filename,
+                                  std::vector<std::vector<KartSample> >* karts);
+    // ------------------------------------------------------------------------
+    static std::string formatTextSample(const KartSample& sample);
+    // ------------------------------------------------------------------------
+    static bool parseTextSample(const char* line, unsigned version,
+                                KartSample* sample);
+    // ------------------------------------------------------------------------
+    static bool convert(const std::string& from, const std::string& to);
+    // ------------------------------------------------------------------------
+    static void unitTesting();
+};   // ReplayFormat
+
+#endif
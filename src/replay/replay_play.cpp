@@ -24,15 +24,18 @@
 #include "karts/controller/ghost_controller.hpp"
 #include "modes/world.hpp"
 #include "race/race_manager.hpp"
+#include "replay/replay_format.hpp"
+#include "replay/replay_recorder.hpp"
 #include "tracks/track.hpp"
 #include "tracks/track_manager.hpp"
 #include "utils/file_utils.hpp"
 #include "utils/mem_utils.hpp"
 #include "utils/string_utils.hpp"
 
+#include <cinttypes>
+#include <cstring>
 #include <stdio.h>
 #include <string>
-#include <cinttypes>
 
 ReplayPlay::SortOrder ReplayPlay::m_sort_order = ReplayPlay::SO_DEFAULT;
 ReplayPlay *ReplayPlay::m_replay_play = NULL;
@@ -69,6 +72,10 @@ void ReplayPlay::loadAllReplayFile()
 {
     m_replay_file_list.clear();
 
+    // Make sure a replay which was just saved is written completely
+    if (ReplayRecorder::get())
+        ReplayRecorder::get()->waitForSave();
+
     // Load stock replay first
     std::set<std::string> pre_record;
     file_manager->listFiles(pre_record, file_manager
@@ -109,18 +116,54 @@ bool ReplayPlay::addReplayFile(const std::string& fn, bool custom_replay, int ca
 
     char s[1024], s1[1024];
     if (StringUtils::getExtension(fn) != "replay") return false;
-    FILE* fd = FileUtils::fopenU8Path(custom_replay ? fn :
-        file_manager->getReplayDir() + fn, "r");
-    if (fd == NULL) return false;
-    auto scoped = [&]() { fclose(fd); };
+    const std::string full_path = custom_replay ? fn :
+        file_manager->getReplayDir() + fn;
+
+    // Binary replays store the header in the format of text replays
+    std::string header;
+    size_t header_pos = 0;
+    FILE* fd = NULL;
+    const bool binary = ReplayFormat::isBinaryFile(full_path);
+    if (binary)
+    {
+        if (!ReplayFormat::readBinaryHeader(full_path, &header))
+        {
+            Log::warn("Replay", "Can't read header of binary replay '%s'.",
+                fn.c_str());
+            return false;
+        }
+    }
+    else
+    {
+        fd = FileUtils::fopenU8Path(full_path, "r");
+        if (fd == NULL) return false;
+    }
+    auto scoped = [&]() { if (fd) fclose(fd); };
     MemUtils::deref<decltype(scoped)> cls(scoped); 
+    // Reads the next header line like fgets
+    auto next_line = [&](char* line)
+    {
+        if (fd)
+        {
+            if (fgets(line, 1023, fd) == NULL)
+                line[0] = '\0';
+            return;
+        }
+        size_t end = header.find('\n', header_pos);
+        end = end == std::string::npos ? header.size() : end + 1;
+        size_t length = std::min<size_t>(end - header_pos, 1022);
+        memcpy(line, header.data() + header_pos, length);
+        line[length] = '\0';
+        header_pos = end;
+    };
     ReplayData rd;
 
     // custom_replay is true when full path of filename is given
     rd.m_custom_replay_file = custom_replay;
+    rd.m_binary = binary;
     rd.m_filename = fn;
 
-    fgets(s, 1023, fd);
+    next_line(s);
     unsigned int version;
     if (sscanf(s,"version: %u", &version) != 1)
     {
@@ -145,7 +188,7 @@ bool ReplayPlay::addReplayFile(const std::string& fn, bool custom_replay, int ca
 
     if (version >= 4)
     {
-        fgets(s, 1023, fd);
+        next_line(s);
         if(sscanf(s, "stk_version: %1023s", s1) != 1)
         {
             Log::warn("Replay", "No STK release version found in replay file, '%s'.", fn.c_str());
@@ -158,7 +201,7 @@ bool ReplayPlay::addReplayFile(const std::string& fn, bool custom_replay, int ca
 
     while(true)
     {
-        fgets(s, 1023, fd);
+        next_line(s);
         core::stringc is_end(s);
         is_end.trim();
         if (is_end == "kart_list_end") break;
@@ -193,7 +236,7 @@ bool ReplayPlay::addReplayFile(const std::string& fn, bool custom_replay, int ca
         if (version >= 4)
         {
             float f = 0;
-            fgets(s, 1023, fd);
+            next_line(s);
             if(sscanf(s, "kart_color: %f", &f) != 1)
             {
                 Log::warn("Replay", "Kart color missing in replay file, '%s'.", fn.c_str());
@@ -206,7 +249,7 @@ bool ReplayPlay::addReplayFile(const std::string& fn, bool custom_replay, int ca
     }
 
     int reverse = 0;
-    fgets(s, 1023, fd);
+    next_line(s);
     if(sscanf(s, "reverse: %d", &reverse) != 1)
     {
         Log::warn("Replay", "No reverse info found in replay file, '%s'.", fn.c_str());
@@ -214,7 +257,7 @@ bool ReplayPlay::addReplayFile(const std::string& fn, bool custom_replay, int ca
     }
     rd.m_reverse = reverse != 0;
 
-    fgets(s, 1023, fd);
+    next_line(s);
     if (sscanf(s, "difficulty: %u", &rd.m_difficulty) != 1)
     {
         Log::warn("Replay", " No difficulty found in replay file, '%s'.", fn.c_str());
@@ -223,7 +266,7 @@ bool ReplayPlay::addReplayFile(const std::string& fn, bool custom_replay, int ca
 
     if (version >= 4)
     {
-        fgets(s, 1023, fd);
+        next_line(s);
         if (sscanf(s, "mode: %1023s", s1) != 1)
         {
             Log::warn("Replay", "Replay mode not found in replay file, '%s'.", fn.c_str());
@@ -238,7 +281,7 @@ bool ReplayPlay::addReplayFile(const std::string& fn, bool custom_replay, int ca
     // sscanf always stops at whitespaces, but a track name may contain a whitespace
     // Official tracks should avoid whitespaces in their name, but it
     // unavoidably occurs with some addons or WIP tracks.
-    fgets(s, 1023, fd);
+    next_line(s);
     if (std::strncmp(s, "track: ", 7) == 0)
     {
         int i = 0;
@@ -283,7 +326,7 @@ bool ReplayPlay::addReplayFile(const std::string& fn, bool custom_replay, int ca
 
     rd.m_track = t;
 
-    fgets(s, 1023, fd);
+    next_line(s);
     if (sscanf(s, "info: %1023s", s1) == 1)
     {
         int last = strlen(s);
@@ -291,7 +334,7 @@ bool ReplayPlay::addReplayFile(const std::string& fn, bool custom_replay, int ca
             s[last - 1] = '\0';
          
         rd.m_info = s + 6;
-        fgets(s, 1023, fd);
+        next_line(s);
     }
     if (sscanf(s, "laps: %u", &rd.m_laps) != 1)
     {
@@ -299,7 +342,7 @@ bool ReplayPlay::addReplayFile(const std::string& fn, bool custom_replay, int ca
         return false;
     }
 
-    fgets(s, 1023, fd);
+    next_line(s);
     if (sscanf(s, "min_time: %f", &rd.m_min_time) != 1)
     {
         Log::warn("Replay", "Finish time not found in replay file, '%s'.", fn.c_str());
@@ -308,7 +351,7 @@ bool ReplayPlay::addReplayFile(const std::string& fn, bool custom_replay, int ca
 
     if (version >= 4)
     {
-        fgets(s, 1023, fd);
+        next_line(s);
         if (sscanf(s, "replay_uid: %" PRIu64, &rd.m_replay_uid) != 1)
         {
             Log::warn("Replay", "Replay UID not found in replay file, '%s'.", fn.c_str());
@@ -351,6 +394,12 @@ void ReplayPlay::loadFile(bool second_replay)
     int replay_index = second_replay ? m_second_replay_file : m_current_replay_file;
     int replay_file_number = second_replay ? 2 : 1;
 
+    if (m_replay_file_list.at(replay_index).m_binary)
+    {
+        readBinaryKartData(second_replay);
+        return;
+    }
+
     FILE *fd = openReplayFile(/*writeable*/false,
             m_replay_file_list.at(replay_index).m_custom_replay_file, replay_file_number);
 
@@ -387,13 +436,12 @@ void ReplayPlay::loadFile(bool second_replay)
 }   // loadFile
 
 //-----------------------------------------------------------------------------
-/** Reads all data from a replay file for a specific kart.
- *  \param fd The file descriptor from which to read.
+/** Creates the ghost kart for the next kart of a replay file.
+ *  \param second_replay True if the kart is from the second replay.
+ *  \return The index of the new ghost kart.
  */
-void ReplayPlay::readKartData(FILE *fd, char *next_line, bool second_replay)
+unsigned int ReplayPlay::addGhostKart(bool second_replay)
 {
-    char s[1024];
-
     int replay_index = second_replay ? m_second_replay_file
                                      : m_current_replay_file;
 
@@ -412,6 +460,21 @@ void ReplayPlay::readKartData(FILE *fd, char *next_line, bool second_replay)
     Controller* controller = new GhostController(getGhostKart(kart_num).get(),
                                                  rd.m_name_list[kart_num-first_loaded_f_num]);
     getGhostKart(kart_num)->setController(controller);
+    return kart_num;
+}   // addGhostKart
+
+//-----------------------------------------------------------------------------
+/** Reads all data from a replay file for a specific kart.
+ *  \param fd The file descriptor from which to read.
+ */
+void ReplayPlay::readKartData(FILE *fd, char *next_line, bool second_replay)
+{
+    char s[1024];
+
+    int replay_index = second_replay ? m_second_replay_file
+                                     : m_current_replay_file;
+    const ReplayData &rd = m_replay_file_list[replay_index];
+    const unsigned int kart_num = addGhostKart(second_replay);
 
     unsigned int size;
     if(sscanf(next_line,"size: %u",&size)!=1)
@@ -421,113 +484,61 @@ void ReplayPlay::readKartData(FILE *fd, char *next_line, bool second_replay)
     for(unsigned int i=0; i<size; i++)
     {
         fgets(s, 1023, fd);
-        float x, y, z, rx, ry, rz, rw, time, speed, steer, w1, w2, w3, w4, nitro_amount, distance;
-        int skidding_state, attachment, item_amount, item_type, special_value,
-            nitro, zipper, skidding, red_skidding, jumping;
-
-        // Check for EV_TRANSFORM event:
-        // -----------------------------
-
-        // Up to STK 0.9.3 replays
-        if (rd.m_replay_version == 3)
+        KartSample sample;
+        if (ReplayFormat::parseTextSample(s, rd.m_replay_version, &sample))
         {
-            if(sscanf(s, "%f  %f %f %f  %f %f %f %f  %f  %f  %f %f %f %f  %d %d %d %d %d\n",
-                &time,
-                &x, &y, &z,
-                &rx, &ry, &rz, &rw,
-                &speed, &steer, &w1, &w2, &w3, &w4,
-                &nitro, &zipper, &skidding, &red_skidding, &jumping
-                )==19)
-            {
-                btQuaternion q(rx, ry, rz, rw);
-                btVector3 xyz(x, y, z);
-                PhysicInfo pi             = {0};
-                BonusInfo bi              = {0};
-                KartReplayEvent kre       = {0};
-
-                pi.m_speed                = speed;
-                pi.m_steer                = steer;
-                pi.m_suspension_length[0] = w1;
-                pi.m_suspension_length[1] = w2;
-                pi.m_suspension_length[2] = w3;
-                pi.m_suspension_length[3] = w4;
-                pi.m_skidding_state       = 0;    //not saved in version 3 replays
-                bi.m_attachment           = 0;    //not saved in version 3 replays
-                bi.m_nitro_amount         = 0;    //not saved in version 3 replays
-                bi.m_item_amount          = 0;    //not saved in version 3 replays
-                bi.m_item_type            = 0;    //not saved in version 3 replays
-                bi.m_special_value        = 0;    //not saved in version 3 replays
-                kre.m_distance            = 0.0f; //not saved in version 3 replays
-                kre.m_nitro_usage         = nitro;
-                kre.m_zipper_usage        = zipper!=0;
-                kre.m_skidding_effect     = skidding;
-                kre.m_red_skidding        = red_skidding!=0;
-                kre.m_jumping             = jumping != 0;
-                m_ghost_karts[kart_num]->addReplayEvent(time,
-                    btTransform(q, xyz), pi, bi, kre);
-            }
-            else
-            {
-                // Invalid record found
-                // ---------------------
-                Log::warn("Replay", "Can't read replay data line %d:", i);
-                Log::warn("Replay", "%s", s);
-                Log::warn("Replay", "Ignored.");
-            }
+            m_ghost_karts[kart_num]->addReplayEvent(
+                sample.m_transform.m_time, sample.m_transform.m_transform,
+                sample.m_physic, sample.m_bonus, sample.m_event);
         }
-
-        //version 4 replays (STK 0.9.4 and higher)
         else
         {
-            if(sscanf(s, "%f  %f %f %f  %f %f %f %f  %f  %f  %f %f %f %f %d  %d %f %d %d %d  %f %d %d %d %d %d\n",
-                &time,
-                &x, &y, &z,
-                &rx, &ry, &rz, &rw,
-                &speed, &steer, &w1, &w2, &w3, &w4, &skidding_state,
-                &attachment, &nitro_amount, &item_amount, &item_type, &special_value,
-                &distance, &nitro, &zipper, &skidding, &red_skidding, &jumping
-                )==26)
-            {
-                btQuaternion q(rx, ry, rz, rw);
-                btVector3 xyz(x, y, z);
-                PhysicInfo pi             = {0};
-                BonusInfo bi              = {0};
-                KartReplayEvent kre       = {0};
-
-                pi.m_speed                = speed;
-                pi.m_steer                = steer;
-                pi.m_suspension_length[0] = w1;
-                pi.m_suspension_length[1] = w2;
-                pi.m_suspension_length[2] = w3;
-                pi.m_suspension_length[3] = w4;
-                pi.m_skidding_state       = skidding_state;
-                bi.m_attachment           = attachment;
-                bi.m_nitro_amount         = nitro_amount;
-                bi.m_item_amount          = item_amount;
-                bi.m_item_type            = item_type;
-                bi.m_special_value        = special_value;
-                kre.m_distance            = distance;
-                kre.m_nitro_usage         = nitro;
-                kre.m_zipper_usage        = zipper!=0;
-                kre.m_skidding_effect     = skidding;
-                kre.m_red_skidding        = red_skidding!=0;
-                kre.m_jumping             = jumping != 0;
-                m_ghost_karts[kart_num]->addReplayEvent(time,
-                    btTransform(q, xyz), pi, bi, kre);
-            }
-            else
-            {
-                // Invalid record found
-                // ---------------------
-                Log::warn("Replay", "Can't read replay data line %d:", i);
-                Log::warn("Replay", "%s", s);
-                Log::warn("Replay", "Ignored.");
-            }
+            // Invalid record found
+            // ---------------------
+            Log::warn("Replay", "Can't read replay data line %d:", i);
+            Log::warn("Replay", "%s", s);
+            Log::warn("Replay", "Ignored.");
         }
     }   // for i
 
 }   // readKartData
 
+//-----------------------------------------------------------------------------
+/** Reads all karts of a binary replay file.
+ *  \param second_replay True if the second replay is loaded.
+ */
+void ReplayPlay::readBinaryKartData(bool second_replay)
+{
+    int replay_index = second_replay ? m_second_replay_file
+                                     : m_current_replay_file;
+    const ReplayData &rd = m_replay_file_list[replay_index];
+    const std::string full_path = rd.m_custom_replay_file ? rd.m_filename :
+        file_manager->getReplayDir() + rd.m_filename;
+
+    std::vector<std::vector<KartSample> > karts;
+    if (!ReplayFormat::readBinarySamples(full_path, &karts))
+    {
+        Log::error("Replay", "Can't read '%s', ghost replay disabled.",
+                   full_path.c_str());
+        destroy();
+        return;
+    }
+    Log::info("Replay", "Reading replay file '%s'.", full_path.c_str());
+
+    for (unsigned int k = 0; k < rd.m_kart_list.size(); k++)
+    {
+        const unsigned int kart_num = addGhostKart(second_replay);
+        if (k >= karts.size())
+            continue;
+        for (const KartSample& sample : karts[k])
+        {
+            m_ghost_karts[kart_num]->addReplayEvent(
+                sample.m_transform.m_time, sample.m_transform.m_transform,
+                sample.m_physic, sample.m_bonus, sample.m_event);
+        }
+    }
+}   // readBinaryKartData
+
 //-----------------------------------------------------------------------------
 /** call getReplayIdByUID and set the current replay file to the first one
  *  with a matching UID.
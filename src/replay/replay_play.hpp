@@ -68,6 +68,7 @@ public:
         std::vector<float>         m_kart_color; //no sorting for this
         bool                       m_reverse;
         bool                       m_custom_replay_file;
+        bool                       m_binary; //no sorting for this
         unsigned int               m_difficulty;
         unsigned int               m_laps;
         unsigned int               m_replay_version; //no sorting for this
@@ -125,7 +126,9 @@ private:
 
           ReplayPlay();
          ~ReplayPlay();
+    unsigned int addGhostKart(bool second_replay);
     void  readKartData(FILE *fd, char *next_line, bool second_replay);
+    void  readBinaryKartData(bool second_replay);
 public:
     void  reset();
     void  load();
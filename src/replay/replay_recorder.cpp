@@ -35,6 +35,7 @@
 #include "race/race_manager.hpp"
 #include "tracks/track.hpp"
 #include "utils/string_utils.hpp"
+#include "utils/time.hpp"
 #include "utils/translation.hpp"
 
 #include <algorithm>
@@ -42,7 +43,7 @@
 #include <string>
 #include <cinttypes>
 
-ReplayRecorder *ReplayRecorder::m_replay_recorder = NULL;
+ReplayRecorder *ReplayRecorder::m_replay_recorder[PT_COUNT];
 
 //-----------------------------------------------------------------------------
 /** Initialises the Replay engine
@@ -71,10 +72,11 @@ void ReplayRecorder::reset()
 {
     m_complete_replay = false;
     m_incorrect_replay = false;
-    m_transform_events.clear();
-    m_physic_info.clear();
-    m_bonus_info.clear();
-    m_kart_replay_event.clear();
+    // Removes the temporary file of an unfinished replay
+    m_writer.reset();
+    m_last_sample.clear();
+    m_previous_bonus.clear();
+    m_encoders.clear();
     m_count_transforms.clear();
     m_last_saved_time.clear();
 
@@ -86,27 +88,40 @@ void ReplayRecorder::reset()
 }   // clear
 
 //-----------------------------------------------------------------------------
-/** Initialise the replay recorder. It especially allocates memory
- *  to store the replay data.
+/** Initialise the replay recorder. It opens the temporary replay file, to
+ *  which the samples are appended during the race.
  */
 void ReplayRecorder::init()
 {
     reset();
-    m_transform_events.resize(RaceManager::get()->getNumberOfKarts());
-    m_physic_info.resize(RaceManager::get()->getNumberOfKarts());
-    m_bonus_info.resize(RaceManager::get()->getNumberOfKarts());
-    m_kart_replay_event.resize(RaceManager::get()->getNumberOfKarts());
-
-    for(unsigned int i=0; i<RaceManager::get()->getNumberOfKarts(); i++)
+    const unsigned int num_karts = RaceManager::get()->getNumberOfKarts();
+    m_last_sample.resize(num_karts);
+    m_previous_bonus.resize(num_karts);
+    // Ghost karts are not recorded, so the kart index in the replay skips
+    // them
+    const World* world = World::getWorld();
+    unsigned int replay_kart = 0;
+    for (unsigned int i = 0; i < num_karts; i++)
     {
-        m_transform_events[i].resize(m_max_frames);
-        m_physic_info[i].resize(m_max_frames);
-        m_bonus_info[i].resize(m_max_frames);
-        m_kart_replay_event[i].resize(m_max_frames);
+        m_encoders.emplace_back(replay_kart);
+        if (i >= world->getNumKarts() || !world->getKart(i)->isGhostKart())
+            replay_kart++;
     }
 
-    m_count_transforms.resize(RaceManager::get()->getNumberOfKarts(), 0);
-    m_last_saved_time.resize(RaceManager::get()->getNumberOfKarts(), -1.0f);
+    m_count_transforms.resize(num_karts, 0);
+    m_last_saved_time.resize(num_karts, -1.0f);
+
+    // Lobbies of a multi-lobby server record at the same time
+    std::string temp_name = file_manager->getReplayDir() + "recording" +
+        STKProcess::getThreadSuffix(STKProcess::getType()) + "_" +
+        StringUtils::toString(StkTime::getTimeSinceEpoch()) + "_" +
+        StringUtils::toString(rand() % 10000) + ".part";
+    m_writer.reset(new ReplayFormat::Writer(temp_name,
+        STKConfig::get()->m_replay_compression));
+    // Otherwise chunks would be queued for the whole race without being
+    // written
+    if (!m_writer->isOpen())
+        m_writer.reset();
 
 }   // init
 
@@ -166,9 +181,9 @@ void ReplayRecorder::update(int ticks)
 
         if (m_count_transforms[i] >= 2)
         {
-            BonusInfo *b_prev       = &(m_bonus_info[i][m_count_transforms[i]-1]);
-            BonusInfo *b_prev2      = &(m_bonus_info[i][m_count_transforms[i]-2]);
-            PhysicInfo *q_prev      = &(m_physic_info[i][m_count_transforms[i]-1]);
+            BonusInfo *b_prev       = &(m_last_sample[i].m_bonus);
+            BonusInfo *b_prev2      = &(m_previous_bonus[i]);
+            PhysicInfo *q_prev      = &(m_last_sample[i].m_physic);
 
             // If the kart changes its steering
             if (fabsf(kart->getControls().getSteer() - m_previous_steer) >
@@ -253,10 +268,10 @@ void ReplayRecorder::update(int ticks)
         m_previous_steer = kart->getControls().getSteer();
         m_last_saved_time[i] = time;
         m_count_transforms[i]++;
-        if (m_count_transforms[i] >= m_transform_events[i].size())
+        if (m_count_transforms[i] >= m_max_frames)
         {
             // Only print this message once.
-            if (m_count_transforms[i] == m_transform_events[i].size())
+            if (m_count_transforms[i] == m_max_frames)
             {
                 Log::warn("ReplayRecorder", "Can't store more events for kart %s.",
                     kart->getIdent().c_str());
@@ -264,10 +279,11 @@ void ReplayRecorder::update(int ticks)
             }
             continue;
         }
-        TransformEvent *p      = &(m_transform_events[i][m_count_transforms[i]-1]);
-        PhysicInfo *q          = &(m_physic_info[i][m_count_transforms[i]-1]);
-        BonusInfo *b           = &(m_bonus_info[i][m_count_transforms[i]-1]);
-        KartReplayEvent *r     = &(m_kart_replay_event[i][m_count_transforms[i]-1]);
+        m_previous_bonus[i]    = m_last_sample[i].m_bonus;
+        TransformEvent *p      = &(m_last_sample[i].m_transform);
+        PhysicInfo *q          = &(m_last_sample[i].m_physic);
+        BonusInfo *b           = &(m_last_sample[i].m_bonus);
+        KartReplayEvent *r     = &(m_last_sample[i].m_event);
 
         p->m_time              = World::getWorld()->getTime();
         p->m_transform.setOrigin(kart->getXYZ());
@@ -306,6 +322,11 @@ void ReplayRecorder::update(int ticks)
         kart->getKartGFX()->getGFXStatus(&(r->m_nitro_usage),
             &(r->m_zipper_usage), &(r->m_skidding_effect), &(r->m_red_skidding));
         r->m_jumping = kart->isJumping();
+
+        // Full chunks are compressed and written in the background
+        m_encoders[i].add(m_last_sample[i]);
+        if (m_encoders[i].getNumSamples() >= SAMPLES_PER_CHUNK && m_writer)
+            m_writer->addChunk(m_encoders[i].finish());
     }   // for i
 
     if ((world->getPhase() == World::RESULT_DISPLAY_PHASE || world->getPhase() == World::DELAY_FINISH_PHASE) && !m_complete_replay)
@@ -386,11 +407,10 @@ void ReplayRecorder::save()
     oss << "_" << num_karts << "_" << time << ".replay";
     m_filename = oss.str();
 
-    FILE *fd = openReplayFile(/*writeable*/true);
-    if (!fd)
+    if (!m_writer || m_writer->isFinished() || !m_writer->isOpen())
     {
-        Log::error("ReplayRecorder", "Can't open '%s' for writing - "
-            "can't save replay data.", getReplayFilename().c_str());
+        Log::error("ReplayRecorder", "Can't save replay data to '%s'.",
+            getReplayFilename().c_str());
         return;
     }
 
@@ -398,28 +418,26 @@ void ReplayRecorder::save()
         StringUtils::utf8ToWide(file_manager->getReplayDir() + getReplayFilename()));
     MessageQueue::add(MessageQueue::MT_GENERIC, msg);
 
-    fprintf(fd, "version: %d\n", getCurrentReplayVersion());
-    fprintf(fd, "stk_version: %s\n", STK_VERSION);
+    // The header uses the format of text replays, it's written after all
+    // samples since the finish time is only known now
+    std::string header;
+    char s[1024];
+    snprintf(s, 1024, "version: %d\n", getCurrentReplayVersion());
+    header += s;
+    snprintf(s, 1024, "stk_version: %s\n", STK_VERSION);
+    header += s;
 
-    // unsigned int player_count = 0;
     for (unsigned int real_karts = 0; real_karts < num_karts; real_karts++)
     {
         const AbstractKart *kart = world->getKart(real_karts);
         if (kart->isGhostKart()) continue;
 
         // XML encode the username to handle Unicode
-        fprintf(fd, "kart: %s %s\n", kart->getIdent().c_str(),
-                StringUtils::xmlEncode(kart->getController()->getName()).c_str());
-
-        // if (kart->getController()->isPlayerController())
-        // {
-        //     fprintf(fd, "kart_color: %f\n", StateManager::get()->getActivePlayer(player_count)->getConstProfile()->getDefaultKartColor());
-        //     player_count++;
-        // }
-        // else
-        //     fprintf(fd, "kart_color: 0\n");
-
-        fprintf(fd, "kart_color: %f\n", RaceManager::get()->getKartColor(real_karts));
+        header += "kart: " + kart->getIdent() + " " +
+            StringUtils::xmlEncode(kart->getController()->getName()) + "\n";
+        snprintf(s, 1024, "kart_color: %f\n",
+            RaceManager::get()->getKartColor(real_karts));
+        header += s;
     }
 
     m_last_uid = computeUID(min_time);
@@ -427,63 +445,41 @@ void ReplayRecorder::save()
     int num_laps = RaceManager::get()->getNumLaps();
     if (num_laps == 9999) num_laps = 0; // no lap in that race mode
 
-    fprintf(fd, "kart_list_end\n");
-    fprintf(fd, "reverse: %d\n",    (int)RaceManager::get()->getReverseTrack());
-    fprintf(fd, "difficulty: %d\n", RaceManager::get()->getDifficulty());
-    fprintf(fd, "mode: %s\n",       RaceManager::get()->getMinorModeName().c_str());
-    fprintf(fd, "track: %s\n",      Track::getCurrentTrack()->getIdent().c_str());
-    fprintf(fd, "laps: %d\n",       num_laps);
-    fprintf(fd, "min_time: %f\n",   min_time);
-    fprintf(fd, "replay_uid: %" PRIu64 "\n", m_last_uid);
+    header += "kart_list_end\n";
+    snprintf(s, 1024, "reverse: %d\n",
+        (int)RaceManager::get()->getReverseTrack());
+    header += s;
+    snprintf(s, 1024, "difficulty: %d\n", RaceManager::get()->getDifficulty());
+    header += s;
+    header += "mode: " + RaceManager::get()->getMinorModeName() + "\n";
+    header += "track: " + Track::getCurrentTrack()->getIdent() + "\n";
+    snprintf(s, 1024, "laps: %d\n", num_laps);
+    header += s;
+    snprintf(s, 1024, "min_time: %f\n", min_time);
+    header += s;
+    snprintf(s, 1024, "replay_uid: %" PRIu64 "\n", m_last_uid);
+    header += s;
 
     for (unsigned int k = 0; k < num_karts; k++)
     {
-        if (world->getKart(k)->isGhostKart()) continue;
-
-        const unsigned int num_transforms = std::min(m_max_frames,
-                                                     m_count_transforms[k]);
-
-        fprintf(fd, "size:     %d\n", num_transforms);
-
-        for (unsigned int i = 0; i < num_transforms; i++)
-        {
-            const TransformEvent *p  = &(m_transform_events[k][i]);
-            const PhysicInfo *q      = &(m_physic_info[k][i]);
-            const BonusInfo *b      = &(m_bonus_info[k][i]);
-            const KartReplayEvent *r = &(m_kart_replay_event[k][i]);
-            fprintf(fd, "%f  %f %f %f  %f %f %f %f  %f  %f  %f %f %f %f %d  %d %f %d %d %d  %f %d %d %d %d %d\n",
-                    p->m_time,
-                    p->m_transform.getOrigin().getX(),
-                    p->m_transform.getOrigin().getY(),
-                    p->m_transform.getOrigin().getZ(),
-                    p->m_transform.getRotation().getX(),
-                    p->m_transform.getRotation().getY(),
-                    p->m_transform.getRotation().getZ(),
-                    p->m_transform.getRotation().getW(),
-                    q->m_speed,
-                    q->m_steer,
-                    q->m_suspension_length[0],
-                    q->m_suspension_length[1],
-                    q->m_suspension_length[2],
-                    q->m_suspension_length[3],
-                    q->m_skidding_state,
-                    b->m_attachment,
-                    b->m_nitro_amount,
-                    b->m_item_amount,
-                    b->m_item_type,
-                    b->m_special_value,
-                    r->m_distance,
-                    r->m_nitro_usage,
-                    (int)r->m_zipper_usage,
-                    r->m_skidding_effect,
-                    (int)r->m_red_skidding,
-                    (int)r->m_jumping
-                );
-        }   // for i
+        if (world->getKart(k)->isGhostKart() ||
+            m_encoders[k].getNumSamples() == 0)
+            continue;
+        m_writer->addChunk(m_encoders[k].finish());
     }
-    fclose(fd);
+    m_writer->finish(header, file_manager->getReplayDir() + m_filename);
 }   // save
 
+//-----------------------------------------------------------------------------
+/** Waits until the writer thread has written the last saved replay, so it
+ *  can be listed and loaded.
+ */
+void ReplayRecorder::waitForSave()
+{
+    if (m_writer && m_writer->isFinished())
+        m_writer.reset();
+}   // waitForSave
+
 /* Returns an encoding value for a given attachment type.
  * The internal values of the enum for attachments may change if attachments
  * are introduced, removed or even reordered. To avoid compatibility issues
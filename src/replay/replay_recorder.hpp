@@ -23,7 +23,10 @@
 #include "items/powerup_manager.hpp"
 #include "karts/controller/kart_control.hpp"
 #include "replay/replay_base.hpp"
+#include "replay/replay_format.hpp"
+#include "utils/stk_process.hpp"
 
+#include <memory>
 #include <vector>
 
 /**
@@ -34,17 +37,17 @@ class ReplayRecorder : public ReplayBase
 private:
     std::string m_filename;
 
-    /** A separate vector of Replay Events for all transforms. */
-    std::vector< std::vector<TransformEvent> > m_transform_events;
+    /** The last recorded sample of each kart. */
+    std::vector<KartSample> m_last_sample;
 
-    /** A separate vector of Replay Events for all physic info. */
-    std::vector< std::vector<PhysicInfo> > m_physic_info;
+    /** Bonus info of the sample before the last one of each kart. */
+    std::vector<BonusInfo> m_previous_bonus;
 
-    /** A separate vector of Replay Events for all item/nitro info. */
-    std::vector< std::vector<BonusInfo> > m_bonus_info;
+    /** Collects the samples of each kart until a chunk is full. */
+    std::vector<ReplayFormat::ChunkEncoder> m_encoders;
 
-    /** A separate vector of Replay Events for all other events. */
-    std::vector< std::vector<KartReplayEvent> > m_kart_replay_event;
+    /** Writes the chunks to the replay file in a background thread. */
+    std::unique_ptr<ReplayFormat::Writer> m_writer;
 
     /** Time at which a transform was saved for the last time. */
     std::vector<float> m_last_saved_time;
@@ -52,8 +55,9 @@ private:
     /** Counts the number of transform events for each kart. */
     std::vector<unsigned int> m_count_transforms;
 
-    /** Static pointer to the one instance of the replay object. */
-    static ReplayRecorder *m_replay_recorder;
+    /** Static pointer to the one instance of the replay object, lobbies of
+     *  a multi-lobby server record their own replays. */
+    static ReplayRecorder *m_replay_recorder[PT_COUNT];
 
     bool  m_complete_replay;
 
@@ -69,6 +73,9 @@ private:
 
     const float DISTANCE_MAX_UPDATES = 1.0f;
 
+    /** Number of samples of a kart which are written as one chunk. */
+    const unsigned SAMPLES_PER_CHUNK = 256;
+
     uint64_t m_last_uid;
 
 #ifdef DEBUG
@@ -93,6 +100,7 @@ public:
     void  reset();
     void  save();
     void  update(int ticks);
+    void  waitForSave();
 
     const uint64_t getLastUID() { return m_last_uid; }
 
@@ -107,16 +115,23 @@ public:
     // ------------------------------------------------------------------------
     /** Creates a new instance of the replay object. */
     static void create() {
-        assert(!m_replay_recorder);
-        m_replay_recorder = new ReplayRecorder();
+        ProcessType type = STKProcess::getRaceDataType();
+        assert(!m_replay_recorder[type]);
+        m_replay_recorder[type] = new ReplayRecorder();
     }
     // ------------------------------------------------------------------------
     /** Returns the instance of the replay object. Returns NULL if no
      *  recorder is available, i.e. recording can be disabled. */
-    static ReplayRecorder *get() { return m_replay_recorder; }
+    static ReplayRecorder *get()
+               { return m_replay_recorder[STKProcess::getRaceDataType()]; }
     // ------------------------------------------------------------------------
     /** Delete the instance of the replay object. */
-    static void destroy() { delete m_replay_recorder; m_replay_recorder=NULL; }
+    static void destroy()
+    {
+        ProcessType type = STKProcess::getRaceDataType();
+        delete m_replay_recorder[type];
+        m_replay_recorder[type] = NULL;
+    }
     // ------------------------------------------------------------------------
     /** Returns the filename that was opened. */
     virtual const std::string& getReplayFilename(int replay_file_number = 1) const { return m_filename; }
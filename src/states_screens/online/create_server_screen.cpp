@@ -369,6 +369,7 @@ void CreateServerScreen::createServer()
     clc.m_login_id = NetworkConfig::get()->getCurrentUserId();
     clc.m_token = NetworkConfig::get()->getCurrentUserToken();
     clc.m_server_ai = 0;
+    clc.m_process_type = PT_CHILD;
 
     switch (gamemode_widget->getSelection(PLAYER_ID_GAME_MASTER))
     {
@@ -21,24 +21,71 @@
 #include "config/user_config.hpp"
 #include "io/file_manager.hpp"
 #include "io/xml_node.hpp"
+#include "network/network_config.hpp"
 #include "race/race_manager.hpp"
 #include "tracks/arena_node.hpp"
 #include "tracks/track.hpp"
 #include "tracks/track_manager.hpp"
+#include "utils/file_utils.hpp"
 #include "utils/log.hpp"
+#include "utils/string_utils.hpp"
+#include "utils/time.hpp"
+#include "utils/vs.hpp"
 
 #include <algorithm>
-#include <queue>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <thread>
+
+namespace
+{
+    /** Header of a cached shortest path file, followed by the parent node
+     *  matrix and the distance matrix (as floats or half floats). */
+    struct PathCacheHeader
+    {
+        char     m_magic[4];
+        uint32_t m_version;
+        uint64_t m_navmesh_hash;
+        uint32_t m_num_nodes;
+        uint32_t m_half_precision;
+    };
+
+    const char PATH_CACHE_MAGIC[4] = { 'S', 'T', 'K', 'N' };
+    /** Increase if the file format or the path computation changes. */
+    const uint32_t PATH_CACHE_VERSION = 2;
+}   // anonymous namespace
 
 // -----------------------------------------------------------------------------
 ArenaGraph::ArenaGraph(const std::string &navmesh, const XMLNode *node)
           : Graph()
 {
     loadNavmesh(navmesh);
-    buildGraph();
-    // Compute shortest distance from all nodes
-    for (unsigned int i = 0; i < getNumNodes(); i++)
-        computeDijkstra(i);
+
+    // Servers load the same arenas again and again, so they cache the
+    // shortest paths
+    uint64_t hash = 0;
+    std::string cache_file;
+    if (NetworkConfig::get()->isNetworking() &&
+        NetworkConfig::get()->isServer())
+        cache_file = getPathCacheFile(navmesh, &hash);
+
+    double start = StkTime::getRealTime();
+    if (!cache_file.empty() && loadPathCache(cache_file, hash))
+    {
+        Log::info("ArenaGraph", "Loaded shortest paths of %d nodes from "
+            "cache in %lfs.", getNumNodes(), StkTime::getRealTime() - start);
+    }
+    else
+    {
+        computeShortestPaths();
+        Log::info("ArenaGraph", "Computed shortest paths of %d nodes in "
+            "%lfs.", getNumNodes(), StkTime::getRealTime() - start);
+        if (!cache_file.empty())
+            savePathCache(cache_file, hash);
+    }
 
     setNearbyNodesOfAllNodes();
     if (node && RaceManager::get()->getMinorMode() == RaceManager::MINOR_MODE_SOCCER)
@@ -48,6 +95,37 @@ ArenaGraph::ArenaGraph(const std::string &navmesh, const XMLNode *node)
 
 }   // ArenaGraph
 
+// -----------------------------------------------------------------------------
+/** Returns the name of the file caching the shortest paths of a navmesh.
+ *  The shortest paths only depend on the navmesh, so the name is a hash of
+ *  the navmesh file.
+ *  \param navmesh Name of the navmesh file.
+ *  \param hash On return the hash of the navmesh file.
+ */
+std::string ArenaGraph::getPathCacheFile(const std::string &navmesh,
+                                         uint64_t *hash)
+{
+    *hash = 14695981039346656037ull;
+    FILE *f = FileUtils::fopenU8Path(navmesh, "rb");
+    if (f)
+    {
+        uint8_t buffer[4096];
+        size_t count;
+        while ((count = fread(buffer, 1, sizeof(buffer), f)) > 0)
+        {
+            for (size_t i = 0; i < count; i++)
+            {
+                *hash ^= buffer[i];
+                *hash *= 1099511628211ull;
+            }
+        }
+        fclose(f);
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.paths", (unsigned long long)*hash);
+    return file_manager->getCachedNavmeshDir() + name;
+}   // getPathCacheFile
+
 // -----------------------------------------------------------------------------
 ArenaNode* ArenaGraph::getNode(unsigned int i) const
 {
@@ -175,94 +253,234 @@ void ArenaGraph::loadNavmesh(const std::string &navmesh)
 }   // loadNavmesh
 
 // ----------------------------------------------------------------------------
+/** Initialises the distance matrix with the distances of adjacent nodes, and
+ *  the parent nodes accordingly.
+ */
 void ArenaGraph::buildGraph()
 {
     const unsigned int n_nodes = getNumNodes();
 
-    m_distance_matrix = std::vector<std::vector<float>>
-        (n_nodes, std::vector<float>(n_nodes, 9999.9f));
+    m_half_distance_matrix.clear();
+    m_distance_matrix.assign((size_t)n_nodes * n_nodes, UNREACHABLE_DISTANCE);
+    m_parent_node.assign((size_t)n_nodes * n_nodes, Graph::UNKNOWN_SECTOR);
     for (unsigned int i = 0; i < n_nodes; i++)
     {
         ArenaNode* cur_node = getNode(i);
+        float* distance = &m_distance_matrix[(size_t)i * n_nodes];
+        int16_t* parent = &m_parent_node[(size_t)i * n_nodes];
         for (const int& adjacent : cur_node->getAdjacentNodes())
         {
             Vec3 diff = getNode(adjacent)->getCenter() - cur_node->getCenter();
-            float distance = diff.length();
-            m_distance_matrix[i][adjacent] = distance;
+            distance[adjacent] = diff.length();
+            parent[adjacent] = i;
         }
-        m_distance_matrix[i][i] = 0.0f;
+        distance[i] = 0.0f;
+        parent[i] = Graph::UNKNOWN_SECTOR;
     }
 
-    // Allocate and initialise the previous node data structure:
-    m_parent_node = std::vector<std::vector<int16_t>>
-        (n_nodes, std::vector<int16_t>(n_nodes, Graph::UNKNOWN_SECTOR));
-    for (unsigned int i = 0; i < n_nodes; i++)
-    {
-        for (unsigned int j = 0; j < n_nodes; j++)
-        {
-            if (i == j || m_distance_matrix[i][j] >= 9899.9f)
-                m_parent_node[i][j] = -1;
-            else
-                m_parent_node[i][j] = i;
-        }   // for j
-    }   // for i
-
 }   // buildGraph
 
 // ----------------------------------------------------------------------------
 /** Dijkstra shortest path computation. It computes the shortest distance from
  *  the specified node 'source' to all other nodes. At the end of the
- *  computation, m_distance_matrix[i][j] stores the shortest path distance from
- *  source to j and m_parent_node[source][j] stores the last vertex visited on
- *  the shortest path from i to j before visiting j. Suppose the shortest path
- *  from i to j is i->......->k->j  then m_parent_node[i][j] = k
+ *  computation, the distance matrix at source * n + j stores the shortest
+ *  path distance from source to j and m_parent_node[source * n + j] stores
+ *  the last vertex visited on the shortest path from source to j before
+ *  visiting j. Suppose the shortest path from i to j is i->......->k->j then
+ *  m_parent_node[i * n + j] = k. Only the row of source is modified, so it
+ *  can be called for different sources in parallel.
+ *  \param source The source node.
+ *  \param queue Memory for the priority queue, so that it can be reused.
  */
-void ArenaGraph::computeDijkstra(int source)
+void ArenaGraph::computeDijkstra(int source,
+                                 std::vector<std::pair<float, int> > *queue)
 {
-    // Stores the distance (float) to 'source' from a specified node (int)
-    typedef std::pair<int, float> IndDistPair;
-
-    class Shortest
+    const unsigned int n = getNumNodes();
+    float* distance = &m_distance_matrix[(size_t)source * n];
+    int16_t* parent = &m_parent_node[(size_t)source * n];
+    std::fill(distance, distance + n, UNREACHABLE_DISTANCE);
+    std::fill(parent, parent + n, (int16_t)Graph::UNKNOWN_SECTOR);
+    distance[source] = 0.0f;
+
+    // A min-heap of (distance, node). A node is only added if its distance
+    // was reduced, outdated entries are skipped when they are removed.
+    std::greater<std::pair<float, int> > shortest;
+    queue->clear();
+    queue->emplace_back(0.0f, source);
+    while (!queue->empty())
     {
-    public:
-        bool operator()(const IndDistPair &p1, const IndDistPair &p2)
+        std::pop_heap(queue->begin(), queue->end(), shortest);
+        const std::pair<float, int> current = queue->back();
+        queue->pop_back();
+        const int cur_index = current.second;
+        if (current.first > distance[cur_index])
+            continue;
+
+        ArenaNode* cur_node = getNode(cur_index);
+        for (const int& adjacent : cur_node->getAdjacentNodes())
         {
-            return p1.second > p2.second;
+            const Vec3 diff = getNode(adjacent)->getCenter() -
+                              cur_node->getCenter();
+            const float new_dist = current.first + diff.length();
+            if (new_dist < distance[adjacent])
+            {
+                distance[adjacent] = new_dist;
+                parent[adjacent] = cur_index;
+                queue->emplace_back(new_dist, adjacent);
+                std::push_heap(queue->begin(), queue->end(), shortest);
+            }
         }
-    };
+    }
+}   // computeDijkstra
 
-    std::priority_queue<IndDistPair, std::vector<IndDistPair>, Shortest> queue;
-    IndDistPair begin(source, 0.0f);
-    queue.push(begin);
+// ----------------------------------------------------------------------------
+/** Computes the shortest paths between all nodes, by running Dijkstra from
+ *  all nodes on several threads. Big graphs then convert the distances to
+ *  half floats.
+ */
+void ArenaGraph::computeShortestPaths()
+{
     const unsigned int n = getNumNodes();
-    std::vector<bool> visited;
-    visited.resize(n, false);
-    while (!queue.empty())
+    m_half_distance_matrix.clear();
+    m_distance_matrix.assign((size_t)n * n, UNREACHABLE_DISTANCE);
+    m_parent_node.assign((size_t)n * n, Graph::UNKNOWN_SECTOR);
+
+    std::atomic<unsigned int> next_source(0);
+    auto compute = [this, n, &next_source]()
+    {
+        std::vector<std::pair<float, int> > queue;
+        for (unsigned int i = next_source++; i < n; i = next_source++)
+            computeDijkstra(i, &queue);
+    };
+    // Small graphs are not worth starting threads
+    unsigned int thread_count = std::min(std::thread::hardware_concurrency(),
+                                         n / 64);
+    thread_count = std::min(thread_count, 8u);
+    std::vector<std::thread> threads;
+    for (unsigned int i = 1; i < thread_count; i++)
+    {
+        threads.emplace_back([compute]()
+            {
+                VS::setThreadName("ArenaGraph");
+                compute();
+            });
+    }
+    compute();
+    for (std::thread& t : threads)
+        t.join();
+
+    if (n >= HALF_PRECISION_NODES)
     {
-        // Get element with shortest path
-        IndDistPair current = queue.top();
-        queue.pop();
-        int cur_index = current.first;
-        if (visited[cur_index]) continue;
-        visited[cur_index] = true;
-
-        for (const int& adjacent : getNode(cur_index)->getAdjacentNodes())
+        // Only unreachable nodes have that distance, as Dijkstra only
+        // stores shorter distances. As a half float it would be rounded to
+        // 10000, so it is stored as infinity and restored by getDistance()
+        m_half_distance_matrix.resize(m_distance_matrix.size());
+        for (size_t i = 0; i < m_distance_matrix.size(); i++)
         {
-            // Distance already computed, can be ignored
-            if (visited[adjacent]) continue;
+            m_half_distance_matrix[i] =
+                m_distance_matrix[i] == UNREACHABLE_DISTANCE ?
+                HALF_UNREACHABLE : MiniGLM::toFloat16(m_distance_matrix[i]);
+        }
+        std::vector<float>().swap(m_distance_matrix);
+    }
+}   // computeShortestPaths
 
-            float new_dist =
-                current.second + m_distance_matrix[cur_index][adjacent];
-            if (new_dist < m_distance_matrix[source][adjacent])
-            {
-                m_distance_matrix[source][adjacent] = new_dist;
-                m_parent_node[source][adjacent] = cur_index;
-            }
-            IndDistPair pair(adjacent, new_dist);
-            queue.push(pair);
+// ----------------------------------------------------------------------------
+/** Loads the shortest paths from the cache.
+ *  \param cache_file Name of the cache file.
+ *  \param hash Hash of the navmesh, the cache is only used if it matches.
+ *  \return True if the shortest paths were loaded.
+ */
+bool ArenaGraph::loadPathCache(const std::string &cache_file, uint64_t hash)
+{
+    FILE *f = FileUtils::fopenU8Path(cache_file, "rb");
+    if (!f)
+        return false;
+
+    const unsigned int n = getNumNodes();
+    const bool half_precision = n >= HALF_PRECISION_NODES;
+    PathCacheHeader header;
+    bool ok = fread(&header, sizeof(header), 1, f) == 1 &&
+        memcmp(header.m_magic, PATH_CACHE_MAGIC, 4) == 0 &&
+        header.m_version == PATH_CACHE_VERSION &&
+        header.m_navmesh_hash == hash && header.m_num_nodes == n &&
+        header.m_half_precision == (half_precision ? 1u : 0u);
+    if (ok)
+    {
+        const size_t size = (size_t)n * n;
+        m_parent_node.resize(size);
+        ok = fread(m_parent_node.data(), sizeof(int16_t), size, f) == size;
+        if (half_precision)
+        {
+            m_distance_matrix.clear();
+            m_half_distance_matrix.resize(size);
+            ok = ok && fread(m_half_distance_matrix.data(), sizeof(short),
+                             size, f) == size;
+        }
+        else
+        {
+            m_half_distance_matrix.clear();
+            m_distance_matrix.resize(size);
+            ok = ok && fread(m_distance_matrix.data(), sizeof(float), size,
+                             f) == size;
         }
     }
-}   // computeDijkstra
+    fclose(f);
+    if (!ok)
+    {
+        Log::info("ArenaGraph", "Path cache '%s' is outdated.",
+            cache_file.c_str());
+    }
+    return ok;
+}   // loadPathCache
+
+// ----------------------------------------------------------------------------
+/** Saves the shortest paths in the cache. The file is written under a
+ *  temporary name and then renamed, so a partial file is never read.
+ *  \param cache_file Name of the cache file.
+ *  \param hash Hash of the navmesh.
+ */
+void ArenaGraph::savePathCache(const std::string &cache_file,
+                               uint64_t hash) const
+{
+    PathCacheHeader header;
+    memcpy(header.m_magic, PATH_CACHE_MAGIC, 4);
+    header.m_version        = PATH_CACHE_VERSION;
+    header.m_navmesh_hash   = hash;
+    header.m_num_nodes      = getNumNodes();
+    header.m_half_precision = m_half_distance_matrix.empty() ? 0 : 1;
+
+    std::random_device rd;
+    const std::string tmp_file = cache_file + "." + std::to_string(rd()) +
+        ".tmp";
+    std::ofstream out(FileUtils::getPortableWritingPath(tmp_file),
+                      std::ios::binary);
+    out.write((const char*)&header, sizeof(header));
+    out.write((const char*)m_parent_node.data(),
+              m_parent_node.size() * sizeof(int16_t));
+    if (m_half_distance_matrix.empty())
+    {
+        out.write((const char*)m_distance_matrix.data(),
+                  m_distance_matrix.size() * sizeof(float));
+    }
+    else
+    {
+        out.write((const char*)m_half_distance_matrix.data(),
+                  m_half_distance_matrix.size() * sizeof(short));
+    }
+    out.close();
+    if (!out.good())
+    {
+        Log::warn("ArenaGraph", "Failed to write path cache '%s'.",
+            tmp_file.c_str());
+        file_manager->removeFile(tmp_file);
+        return;
+    }
+    // Windows does not replace an existing file when renaming
+    file_manager->removeFile(cache_file);
+    if (FileUtils::renameU8Path(tmp_file, cache_file) != 0)
+        file_manager->removeFile(tmp_file);
+}   // savePathCache
 
 // ----------------------------------------------------------------------------
 /** THIS FUNCTION IS ONLY USED FOR UNIT-TESTING, to verify that the new
@@ -276,20 +494,20 @@ void ArenaGraph::computeDijkstra(int source)
  */
 void ArenaGraph::computeFloydWarshall()
 {
-    unsigned int n = getNumNodes();
+    const size_t n = getNumNodes();
 
-    for (unsigned int k = 0; k < n; k++)
+    for (size_t k = 0; k < n; k++)
     {
-        for (unsigned int i = 0; i < n; i++)
+        for (size_t i = 0; i < n; i++)
         {
-            for (unsigned int j = 0; j < n; j++)
+            for (size_t j = 0; j < n; j++)
             {
-                if ((m_distance_matrix[i][k] + m_distance_matrix[k][j]) <
-                    m_distance_matrix[i][j])
+                if ((m_distance_matrix[i * n + k] + m_distance_matrix[k * n + j]) <
+                    m_distance_matrix[i * n + j])
                 {
-                    m_distance_matrix[i][j] =
-                        m_distance_matrix[i][k] + m_distance_matrix[k][j];
-                    m_parent_node[i][j] = m_parent_node[k][j];
+                    m_distance_matrix[i * n + j] =
+                        m_distance_matrix[i * n + k] + m_distance_matrix[k * n + j];
+                    m_parent_node[i * n + j] = m_parent_node[k * n + j];
                 }
             }
         }
@@ -349,7 +567,9 @@ void ArenaGraph::setNearbyNodesOfAllNodes()
         // Get the distance to all nodes at i
         ArenaNode* cur_node = getNode(i);
         std::vector<int> nearby_nodes;
-        std::vector<float> dist = m_distance_matrix[i];
+        std::vector<float> dist(getNumNodes());
+        for (unsigned int j = 0; j < getNumNodes(); j++)
+            dist[j] = getDistance(i, j);
 
         // Skip the same node
         dist[i] = 999999.0f;
@@ -371,13 +591,14 @@ void ArenaGraph::setNearbyNodesOfAllNodes()
  *  std::vector (in reverse order). Used only for unit testing.
  */
 std::vector<int16_t> ArenaGraph::getPathFromTo(int from, int to,
-                      const std::vector< std::vector< int16_t > >& parent_node)
+                                          const std::vector<int16_t>& parent_node,
+                                          unsigned int n)
 {
     std::vector<int16_t> path;
     path.push_back(to);
     while(from!=to)
     {
-        to = parent_node[from][to];
+        to = parent_node[(size_t)from * n + to];
         path.push_back(to);
     }
     return path;
@@ -398,11 +619,46 @@ void ArenaGraph::unitTesting()
     double s = StkTime::getRealTime();
     ArenaGraph* ag = new ArenaGraph(navmesh_file_name);
     double e = StkTime::getRealTime();
+    Log::error("Time", "Constructor    %lf", e-s);
+    const unsigned int n = ag->getNumNodes();
+
+    // Shortest paths loaded from the cache must be the same as computed ones
+    uint64_t hash;
+    const std::string cache_file = getPathCacheFile(navmesh_file_name, &hash);
+    ag->savePathCache(cache_file, hash);
+    int error_count = 0;
+    if (!ag->loadPathCache(cache_file, hash))
+    {
+        Log::error("ArenaGraph", "Cannot load cached paths");
+        error_count++;
+    }
+    std::vector<float> loaded_distance_matrix((size_t)n * n);
+    for (unsigned int i = 0; i < n; i++)
+    {
+        for (unsigned int j = 0; j < n; j++)
+            loaded_distance_matrix[(size_t)i * n + j] = ag->getDistance(i, j);
+    }
+    std::vector<int16_t> loaded_parent_node = ag->m_parent_node;
+
+    s = StkTime::getRealTime();
+    ag->computeShortestPaths();
+    e = StkTime::getRealTime();
     Log::error("Time", "Dijkstra       %lf", e-s);
 
     // Save the Dijkstra results
-    std::vector< std::vector< float > > distance_matrix = ag->m_distance_matrix;
-    std::vector< std::vector< int16_t > > parent_node = ag->m_parent_node;
+    std::vector<float> distance_matrix((size_t)n * n);
+    for (unsigned int i = 0; i < n; i++)
+    {
+        for (unsigned int j = 0; j < n; j++)
+            distance_matrix[(size_t)i * n + j] = ag->getDistance(i, j);
+    }
+    std::vector<int16_t> parent_node = ag->m_parent_node;
+    if (distance_matrix != loaded_distance_matrix ||
+        parent_node != loaded_parent_node)
+    {
+        Log::error("ArenaGraph", "Cached paths differ from computed paths");
+        error_count++;
+    }
     ag->buildGraph();
 
     // Now compute results with Floyd-Warshall
@@ -411,16 +667,16 @@ void ArenaGraph::unitTesting()
     e = StkTime::getRealTime();
     Log::error("Time", "Floyd-Warshall %lf", e-s);
 
-    int error_count = 0;
-    for(unsigned int i=0; i<ag->m_distance_matrix.size(); i++)
+    for(unsigned int i=0; i<n; i++)
     {
-        for(unsigned int j=0; j<ag->m_distance_matrix[i].size(); j++)
+        for(unsigned int j=0; j<n; j++)
         {
-            if(ag->m_distance_matrix[i][j] - distance_matrix[i][j] > 0.001f)
+            const size_t ij = (size_t)i * n + j;
+            if(ag->m_distance_matrix[ij] - distance_matrix[ij] > 0.001f)
             {
                 Log::error("ArenaGraph",
                            "Incorrect distance %d, %d: Dijkstra: %f F.W.: %f",
-                           i, j, distance_matrix[i][j], ag->m_distance_matrix[i][j]);
+                           i, j, distance_matrix[ij], ag->m_distance_matrix[ij]);
                 error_count++;
             }    // if distance is too different
 
@@ -432,16 +688,16 @@ void ArenaGraph::unitTesting()
             // debugging in the feature
 #undef TEST_PARENT_POLY_EVEN_THOUGH_MANY_FALSE_POSITIVES
 #ifdef TEST_PARENT_POLY_EVEN_THOUGH_MANY_FALSE_POSITIVES
-            if(ag->m_parent_node[i][j] != parent_node[i][j])
+            if(ag->m_parent_node[ij] != parent_node[ij])
             {
                 error_count++;
-                std::vector<int16_t> dijkstra_path = getPathFromTo(i, j, parent_node);
-                std::vector<int16_t> floyd_path = getPathFromTo(i, j, ag->m_parent_node);
+                std::vector<int16_t> dijkstra_path = getPathFromTo(i, j, parent_node, n);
+                std::vector<int16_t> floyd_path = getPathFromTo(i, j, ag->m_parent_node, n);
                 if(dijkstra_path.size()!=floyd_path.size())
                 {
                     Log::error("ArenaGraph",
                                "Incorrect path length %d, %d: Dijkstra: %d F.W.: %d",
-                               i, j, parent_node[i][j], ag->m_parent_node[i][j]);
+                               i, j, parent_node[ij], ag->m_parent_node[ij]);
                     continue;
                 }
                 Log::error("ArenaGraph", "Path problems from %d to %d:",
@@ -21,6 +21,9 @@
 
 #include "tracks/graph.hpp"
 #include "utils/cpp2011.hpp"
+#include "utils/types.hpp"
+
+#include "mini_glm.hpp"
 
 #include <set>
 
@@ -34,11 +37,29 @@ class XMLNode;
 class ArenaGraph : public Graph
 {
 private:
-    /** The actual graph data structure, it is an adjacency matrix. */
-    std::vector<std::vector<float>> m_distance_matrix;
+    /** Graphs with at least this many nodes store the distances as half
+     *  floats, which halves the memory of the distance matrix. */
+    static const unsigned int HALF_PRECISION_NODES = 2048;
+
+    /** Distance of nodes which cannot be reached. */
+    static constexpr float UNREACHABLE_DISTANCE = 9999.9f;
+
+    /** UNREACHABLE_DISTANCE in m_half_distance_matrix, which is infinity
+     *  as a half float. */
+    static const short HALF_UNREACHABLE = 0x7c00;
+
+    /** The shortest distance from node i to node j is stored at index
+     *  i * getNumNodes() + j. Before the shortest paths are computed it is
+     *  the adjacency matrix. Empty if m_half_distance_matrix is used. */
+    std::vector<float> m_distance_matrix;
+
+    /** The distance matrix as half floats, used for big graphs. */
+    std::vector<short> m_half_distance_matrix;
 
-    /** The matrix that is used to store computed shortest paths. */
-    std::vector<std::vector<int16_t>> m_parent_node;
+    /** The matrix that is used to store computed shortest paths:
+     *  m_parent_node[i * getNumNodes() + j] is the last node before j on
+     *  the shortest path from i to j. */
+    std::vector<int16_t> m_parent_node;
 
     /** Used in soccer mode to colorize the goal lines in minimap. */
     std::set<int> m_red_node;
@@ -54,19 +75,31 @@ private:
     // ------------------------------------------------------------------------
     void setNearbyNodesOfAllNodes();
     // ------------------------------------------------------------------------
-    void computeDijkstra(int n);
+    void computeDijkstra(int n,
+                         std::vector<std::pair<float, int> > *queue);
+    // ------------------------------------------------------------------------
+    void computeShortestPaths();
     // ------------------------------------------------------------------------
     void computeFloydWarshall();
     // ------------------------------------------------------------------------
+    static std::string getPathCacheFile(const std::string &navmesh,
+                                        uint64_t *hash);
+    // ------------------------------------------------------------------------
+    bool loadPathCache(const std::string &cache_file, uint64_t hash);
+    // ------------------------------------------------------------------------
+    void savePathCache(const std::string &cache_file, uint64_t hash) const;
+    // ------------------------------------------------------------------------
     static std::vector<int16_t> getPathFromTo(int from, int to,
-                     const std::vector< std::vector< int16_t > >& parent_node);
+                                  const std::vector<int16_t>& parent_node,
+                                  unsigned int n);
     // ------------------------------------------------------------------------
     virtual bool hasLapLine() const OVERRIDE                  { return false; }
     // ------------------------------------------------------------------------
     virtual void differentNodeColor(int n, video::SColor* c) const OVERRIDE;
 
 public:
-    static ArenaGraph* get()     { return dynamic_cast<ArenaGraph*>(m_graph); }
+    static ArenaGraph* get()
+                   { return dynamic_cast<ArenaGraph*>(Graph::get()); }
     // ------------------------------------------------------------------------
     static void unitTesting();
     // ------------------------------------------------------------------------
@@ -84,7 +117,7 @@ public:
     {
         if (i == Graph::UNKNOWN_SECTOR || j == Graph::UNKNOWN_SECTOR)
             return Graph::UNKNOWN_SECTOR;
-        return (int)(m_parent_node[j][i]);
+        return (int)(m_parent_node[(size_t)j * getNumNodes() + i]);
     }
     // ------------------------------------------------------------------------
     /** Returns the distance between any two nodes */
@@ -92,7 +125,14 @@ public:
     {
         if (from == Graph::UNKNOWN_SECTOR || to == Graph::UNKNOWN_SECTOR)
             return 99999.0f;
-        return m_distance_matrix[from][to];
+        const size_t index = (size_t)from * getNumNodes() + to;
+        if (!m_half_distance_matrix.empty())
+        {
+            const short distance = m_half_distance_matrix[index];
+            return distance == HALF_UNREACHABLE ? UNREACHABLE_DISTANCE :
+                MiniGLM::toFloat32(distance);
+        }
+        return m_distance_matrix[index];
     }
 
 };   // ArenaGraph
@@ -41,6 +41,11 @@ public:
     }
     // ------------------------------------------------------------------------
     virtual bool is3DQuad() const OVERRIDE                     { return true; }
+    // ------------------------------------------------------------------------
+    virtual void getBoundingBox(Vec3 *min, Vec3 *max) const OVERRIDE
+    {
+        BoundingBox3D::getBoxBoundingBox(min, max);
+    }
 
 };
 
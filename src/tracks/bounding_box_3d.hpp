@@ -78,6 +78,21 @@ public:
         }
         return true;
     }
+    // ------------------------------------------------------------------------
+    /** Returns the axis aligned bounding box of all corners of the box. */
+    void getBoxBoundingBox(Vec3 *min, Vec3 *max) const
+    {
+        *min = m_box_faces[0][0];
+        *max = m_box_faces[0][0];
+        // The top and bottom faces contain all corners
+        for (unsigned int i = 0; i < 4; i++)
+        {
+            min->min(m_box_faces[0][i]);
+            max->max(m_box_faces[0][i]);
+            min->min(m_box_faces[2][i]);
+            max->max(m_box_faces[2][i]);
+        }
+    }
 
 };
 
@@ -53,6 +53,11 @@ public:
     virtual float getDistance2FromPoint(const Vec3 &xyz) const OVERRIDE;
     // ------------------------------------------------------------------------
     virtual bool is3DQuad() const OVERRIDE                     { return true; }
+    // ------------------------------------------------------------------------
+    virtual void getBoundingBox(Vec3 *min, Vec3 *max) const OVERRIDE
+    {
+        BoundingBox3D::getBoxBoundingBox(min, max);
+    }
 
 };
 #endif
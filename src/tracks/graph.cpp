@@ -31,11 +31,18 @@
 #include "tracks/drive_node_2d.hpp"
 #include "tracks/drive_node_3d.hpp"
 #include "tracks/track.hpp"
+#include "utils/cpp2011.hpp"
 #include "utils/log.hpp"
+#include "utils/time.hpp"
 
 #include <ICameraSceneNode.h>
 #include <ISceneManager.h>
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+
 #ifndef SERVER_ONLY
 #include <ge_main.hpp>
 #endif
@@ -43,7 +50,7 @@
 const int Graph::UNKNOWN_SECTOR = -1;
 const float Graph::MIN_HEIGHT_TESTING = -1.0f;
 const float Graph::MAX_HEIGHT_TESTING = 5.0f;
-Graph *Graph::m_graph = NULL;
+Graph *Graph::m_graph[PT_COUNT];
 // -----------------------------------------------------------------------------
 Graph::Graph()
 {
@@ -55,6 +62,11 @@ Graph::Graph()
     m_bb_min      = Vec3( 99999,  99999,  99999);
     m_bb_max      = Vec3(-99999, -99999, -99999);
     memset(m_bb_nodes, 0, 4 * sizeof(int));
+    m_grid_min_x     = 0.0f;
+    m_grid_min_z     = 0.0f;
+    m_grid_cell_size = 1.0f;
+    m_grid_width     = 0;
+    m_grid_height    = 0;
 }  // Graph
 
 // -----------------------------------------------------------------------------
@@ -676,6 +688,35 @@ void Graph::findRoadSector(const Vec3& xyz, int *sector,
         return;
     }   // if still on same quad
 
+    // Without a list of sectors only the quads in the grid cell of the
+    // point need to be tested. The first quad after the current one which
+    // contains the point is used, the same as the linear search below.
+    if (!all_sectors && !m_grid_cells.empty())
+    {
+        const int n = (int)m_all_nodes.size();
+        const int first = *sector == UNKNOWN_SECTOR ? 0 : (*sector + 1) % n;
+        *sector = UNKNOWN_SECTOR;
+        int x, z;
+        getGridCell(xyz, &x, &z);
+        if (x < 0 || x >= m_grid_width || z < 0 || z >= m_grid_height)
+            return;
+        const int cell = z * m_grid_width + x;
+        int best_order = n;
+        for (unsigned int i = m_grid_cells[cell]; i < m_grid_cells[cell + 1];
+             i++)
+        {
+            const int node = m_grid_nodes[i];
+            const int order = node >= first ? node - first : node - first + n;
+            if (order < best_order &&
+                m_all_nodes[node]->pointInside(xyz, ignore_vertical))
+            {
+                best_order = order;
+                *sector = node;
+            }
+        }
+        return;
+    }
+
     // Now we search through all quads, starting with
     // the current one
     int indx       = *sector;
@@ -754,10 +795,8 @@ int Graph::findOutOfRoadSector(const Vec3& xyz, const int curr_sector,
         // shortcut. If we only tested a limited number of quads to
         // improve the performance the crossing of a lap might not be
         // detected (because quad 0 is not tested, only quads on the
-        // shortcuts are tested). If this should become a performance
-        // bottleneck, we need to set up a graph of 'next' quads for each
-        // quad (similar to what the AI does), and only test the quads
-        // in this graph.
+        // shortcuts are tested). Unless a list of sectors is given, the
+        // node grid is used to only test the quads close to xyz.
         const int LIMIT = getNumNodes();
         count           = LIMIT;
         // Start 10 quads before the current quad, so the quads closest
@@ -766,6 +805,23 @@ int Graph::findOutOfRoadSector(const Vec3& xyz, const int curr_sector,
         if(current_sector<0) current_sector += getNumNodes();
     }
 
+    // Without a list of sectors the grid is used to find the closest node,
+    // giving the same result as testing all nodes in the order below.
+    if (!all_sectors && !m_grid_cells.empty())
+    {
+        const int n = getNumNodes();
+        const int first = ((current_sector + 1) % n + n) % n;
+        for (int phase = 0; phase < 2; phase++)
+        {
+            int node = findClosestNode(xyz, first, phase == 0,
+                                       ignore_vertical);
+            if (node != UNKNOWN_SECTOR)
+                return node;
+        }
+        Log::warn("Graph", "unknown sector found.");
+        return 0;
+    }
+
     int   min_sector = UNKNOWN_SECTOR;
     float min_dist_2 = 999999.0f*999999.0f;
 
@@ -822,8 +878,198 @@ int Graph::findOutOfRoadSector(const Vec3& xyz, const int curr_sector,
 }   // findOutOfRoadSector
 
 //-----------------------------------------------------------------------------
+/** Finds the closest node to a point using the node grid: the cells are
+ *  tested in growing squares around the cell of the point, until no node
+ *  outside of the square can be closer than the closest one found. If two
+ *  nodes have the same distance, the one found first when testing all nodes
+ *  in order starting with first_sector is used, same as in the linear search
+ *  of findOutOfRoadSector.
+ *  \param xyz The point.
+ *  \param first_sector The first sector tested in the linear search.
+ *  \param test_height If the height of the point is tested (except for 3d
+ *         quads or if ignore_vertical is set).
+ *  \param ignore_vertical If the height of the point is ignored.
+ *  \return The closest node, or UNKNOWN_SECTOR if no node was found.
+ */
+int Graph::findClosestNode(const Vec3 &xyz, int first_sector,
+                           bool test_height, bool ignore_vertical) const
+{
+    const int n = (int)m_all_nodes.size();
+    int cx, cz;
+    getGridCell(xyz, &cx, &cz);
+    cx = std::max(0, std::min(cx, m_grid_width  - 1));
+    cz = std::max(0, std::min(cz, m_grid_height - 1));
+
+    int   min_sector = UNKNOWN_SECTOR;
+    int   min_order  = n;
+    float min_dist_2 = 999999.0f*999999.0f;
+    for (int r = 0; ; r++)
+    {
+        const int x0 = cx - r, x1 = cx + r, z0 = cz - r, z1 = cz + r;
+        for (int z = std::max(z0, 0); z <= std::min(z1, m_grid_height - 1);
+             z++)
+        {
+            // Only the cells on the border of the square are new
+            const bool full_row = z == z0 || z == z1;
+            for (int x = std::max(x0, 0); x <= std::min(x1, m_grid_width - 1);
+                 x += (full_row || x == x1) ? 1 : x1 - x)
+            {
+                const int cell = z * m_grid_width + x;
+                for (unsigned int i = m_grid_cells[cell];
+                     i < m_grid_cells[cell + 1]; i++)
+                {
+                    const int node = m_grid_nodes[i];
+                    const Quad* q = m_all_nodes[node];
+                    if (q->isIgnored())
+                        continue;
+                    const float dist_2 = q->getDistance2FromPoint(xyz);
+                    const int order = node >= first_sector
+                                    ? node - first_sector
+                                    : node - first_sector + n;
+                    if (dist_2 > min_dist_2 ||
+                        (dist_2 == min_dist_2 &&
+                         (min_sector == UNKNOWN_SECTOR || order >= min_order)))
+                        continue;
+                    const float dist = xyz.getY() - q->getMinHeight();
+                    if (!test_height || (dist < 5.0f && dist > -1.0f) ||
+                        q->is3DQuad() || ignore_vertical)
+                    {
+                        min_dist_2 = dist_2;
+                        min_sector = node;
+                        min_order  = order;
+                    }
+                }   // for i in cell
+            }   // for x
+        }   // for z
+
+        // Nodes which were not tested are outside of the square, so their
+        // distance is at least the distance to the border of the square.
+        // Sides of the square at the border of the grid have no nodes
+        // outside.
+        float border = std::numeric_limits<float>::max();
+        if (x0 > 0)
+            border = std::min(border, xyz.getX() - m_grid_min_x
+                                      - x0 * m_grid_cell_size);
+        if (x1 < m_grid_width - 1)
+            border = std::min(border, m_grid_min_x
+                              + (x1 + 1) * m_grid_cell_size - xyz.getX());
+        if (z0 > 0)
+            border = std::min(border, xyz.getZ() - m_grid_min_z
+                                      - z0 * m_grid_cell_size);
+        if (z1 < m_grid_height - 1)
+            border = std::min(border, m_grid_min_z
+                              + (z1 + 1) * m_grid_cell_size - xyz.getZ());
+        if (border == std::numeric_limits<float>::max())
+            break;
+        if (min_sector != UNKNOWN_SECTOR && border > 0.0f &&
+            min_dist_2 < border * border)
+            break;
+    }   // for r
+    return min_sector;
+}   // findClosestNode
+
+//-----------------------------------------------------------------------------
+/** Returns the grid cell of a point. The cell is outside of the grid (-1 or
+ *  the grid size) if the point is outside of the grid.
+ */
+void Graph::getGridCell(const Vec3 &xyz, int *x, int *z) const
+{
+    const float fx = (xyz.getX() - m_grid_min_x) / m_grid_cell_size;
+    const float fz = (xyz.getZ() - m_grid_min_z) / m_grid_cell_size;
+    // Avoid overflows (and NAN) when converting to int
+    *x = fx >= 0.0f ? (fx < (float)m_grid_width  ? (int)fx : m_grid_width)
+                    : -1;
+    *z = fz >= 0.0f ? (fz < (float)m_grid_height ? (int)fz : m_grid_height)
+                    : -1;
+}   // getGridCell
+
+//-----------------------------------------------------------------------------
+/** Builds the grid used by findRoadSector and findOutOfRoadSector. Each node
+ *  is added to all cells its bounding box overlaps, so that all nodes which
+ *  can contain a point are in the cell of the point. The cell size is
+ *  chosen to have about as many cells as nodes.
+ */
+void Graph::buildNodeGrid()
+{
+    m_grid_cells.clear();
+    m_grid_nodes.clear();
+    m_grid_width = m_grid_height = 0;
+    if (m_all_nodes.empty())
+        return;
+
+    // The bounding boxes are enlarged a bit, to make sure that rounding
+    // errors in pointInside can't find a point outside of it
+    const float padding = 1.0f;
+    std::vector<Vec3> node_min(m_all_nodes.size());
+    std::vector<Vec3> node_max(m_all_nodes.size());
+    Vec3 grid_min( 99999,  99999,  99999);
+    Vec3 grid_max(-99999, -99999, -99999);
+    for (unsigned int i = 0; i < m_all_nodes.size(); i++)
+    {
+        m_all_nodes[i]->getBoundingBox(&node_min[i], &node_max[i]);
+        node_min[i] -= Vec3(padding, 0, padding);
+        node_max[i] += Vec3(padding, 0, padding);
+        grid_min.min(node_min[i]);
+        grid_max.max(node_max[i]);
+    }
+
+    const float width = grid_max.getX() - grid_min.getX();
+    const float depth = grid_max.getZ() - grid_min.getZ();
+    if (!(width > 0.0f && depth > 0.0f))
+        return;
+    const int max_cells_per_side = 1024;
+    m_grid_cell_size = std::max(sqrtf(width * depth / m_all_nodes.size()),
+                                std::max(width, depth) / max_cells_per_side);
+    m_grid_min_x  = grid_min.getX();
+    m_grid_min_z  = grid_min.getZ();
+    m_grid_width  = std::max(1, (int)ceilf(width / m_grid_cell_size));
+    m_grid_height = std::max(1, (int)ceilf(depth / m_grid_cell_size));
+
+    // First count the nodes of each cell, then fill them in
+    std::vector<unsigned int> count(m_grid_width * m_grid_height + 1, 0);
+    for (int pass = 0; pass < 2; pass++)
+    {
+        for (unsigned int i = 0; i < m_all_nodes.size(); i++)
+        {
+            int x0, z0, x1, z1;
+            getGridCell(node_min[i], &x0, &z0);
+            getGridCell(node_max[i], &x1, &z1);
+            x0 = std::max(x0, 0);
+            z0 = std::max(z0, 0);
+            x1 = std::min(x1, m_grid_width  - 1);
+            z1 = std::min(z1, m_grid_height - 1);
+            for (int z = z0; z <= z1; z++)
+            {
+                for (int x = x0; x <= x1; x++)
+                {
+                    const int cell = z * m_grid_width + x;
+                    if (pass == 0)
+                        count[cell + 1]++;
+                    else
+                        m_grid_nodes[count[cell]++] = i;
+                }
+            }
+        }   // for i < m_all_nodes.size()
+        if (pass == 0)
+        {
+            for (unsigned int c = 1; c < count.size(); c++)
+                count[c] += count[c - 1];
+            m_grid_cells = count;
+            m_grid_nodes.resize(count.back());
+        }
+    }   // for pass
+    Log::debug("Graph", "Node grid: %d x %d cells of size %f, %d entries.",
+               m_grid_width, m_grid_height, m_grid_cell_size,
+               (int)m_grid_nodes.size());
+}   // buildNodeGrid
+
+//-----------------------------------------------------------------------------
+/** Builds the node grid and maps the 4 corners of the bounding box to their
+ *  closest nodes.
+ */
 void Graph::loadBoundingBoxNodes()
 {
+    buildNodeGrid();
     m_bb_nodes[0] = findOutOfRoadSector(Vec3(m_bb_min.x(), 0, m_bb_min.z()),
         -1/*curr_sector*/, NULL/*all_sectors*/, true/*ignore_vertical*/);
     m_bb_nodes[1] = findOutOfRoadSector(Vec3(m_bb_min.x(), 0, m_bb_max.z()),
@@ -833,3 +1079,151 @@ void Graph::loadBoundingBoxNodes()
     m_bb_nodes[3] = findOutOfRoadSector(Vec3(m_bb_max.x(), 0, m_bb_max.z()),
         -1/*curr_sector*/, NULL/*all_sectors*/, true/*ignore_vertical*/);
 }   // loadBoundingBoxNodes
+
+// ============================================================================
+namespace
+{
+    /** A graph of random arena nodes, used by Graph::unitTesting. */
+    class RandomGraph : public Graph
+    {
+    private:
+        virtual bool hasLapLine() const OVERRIDE             { return false; }
+        virtual void differentNodeColor(int n, video::SColor* c) const
+            OVERRIDE {}
+    public:
+        /** Creates a random driveline which crosses itself, with some
+         *  steep (3d) nodes. */
+        RandomGraph(std::mt19937 &rng, unsigned int num_nodes)
+        {
+            std::uniform_real_distribution<float> random(0.0f, 1.0f);
+            Vec3 center(0, 0, 0);
+            float angle = 0.0f;
+            for (unsigned int i = 0; i < num_nodes; i++)
+            {
+                angle += (random(rng) - 0.5f) * 0.8f;
+                // Turn back to the origin to keep the track compact
+                if (center.length() > 300.0f)
+                    angle = atan2f(-center.getX(), -center.getZ());
+                const Vec3 forward(sinf(angle), 0, cosf(angle));
+                const Vec3 right(cosf(angle), 0, -sinf(angle));
+                const float width  = 4.0f + 4.0f * random(rng);
+                const float length = 5.0f + 10.0f * random(rng);
+                float slope = (random(rng) - 0.5f) * 0.4f;
+                if (random(rng) < 0.1f)
+                    slope = 1.5f;
+                const Vec3 up(0, length * slope, 0);
+                const Vec3 p0 = center - right * width;
+                const Vec3 p1 = center + right * width;
+                createQuad(p0, p1, p1 + forward * length + up,
+                           p0 + forward * length + up, i,
+                           /*invisible*/false, /*ai_ignore*/false,
+                           /*is_arena*/true, /*ignored*/false);
+                center += forward * length + up;
+                if (center.getY() > 50.0f || center.getY() < -50.0f)
+                    center.setY(0.0f);
+            }
+            loadBoundingBoxNodes();
+        }   // RandomGraph
+    };   // RandomGraph
+}   // anonymous namespace
+
+// ----------------------------------------------------------------------------
+/** Compares the results of findRoadSector and findOutOfRoadSector using the
+ *  node grid with the linear search over all nodes. The linear search is
+ *  done by passing the list of all sectors in the order in which they are
+ *  tested without the grid.
+ */
+void Graph::unitTesting()
+{
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> random(0.0f, 1.0f);
+    RandomGraph graph(rng, 2000);
+    const int n = graph.getNumNodes();
+    const Vec3 &bb_min = graph.getBBMin();
+    const Vec3 &bb_max = graph.getBBMax();
+
+    std::vector<Vec3> points;
+    for (unsigned int i = 0; i < 20000; i++)
+    {
+        if (i % 3 == 0)
+        {
+            // Random points in and around the bounding box
+            points.emplace_back(
+                bb_min.getX() - 20.0f +
+                (bb_max.getX() - bb_min.getX() + 40.0f) * random(rng),
+                bb_min.getY() - 5.0f +
+                (bb_max.getY() - bb_min.getY() + 10.0f) * random(rng),
+                bb_min.getZ() - 20.0f +
+                (bb_max.getZ() - bb_min.getZ() + 40.0f) * random(rng));
+        }
+        else
+        {
+            // Points on or slightly above or below a node
+            const Quad *q = graph.getQuad(rng() % n);
+            const float u = random(rng), v = random(rng);
+            Vec3 p = ((*q)[0] * (1 - u) + (*q)[1] * u) * (1 - v) +
+                     ((*q)[3] * (1 - u) + (*q)[2] * u) * v;
+            p.setY(p.getY() + (random(rng) - 0.3f) * 8.0f);
+            points.push_back(p);
+        }
+    }
+
+    int errors = 0, on_road = 0;
+    double grid_time = 0.0, linear_time = 0.0;
+    std::vector<int> all_sectors(n);
+    for (unsigned int i = 0; i < points.size(); i++)
+    {
+        const Vec3 &p = points[i];
+        const bool ignore_vertical = i % 4 == 0;
+        const int current = i % 2 == 0 ? UNKNOWN_SECTOR : (int)(rng() % n);
+
+        // findRoadSector tests all nodes starting after the current one
+        int first = current == UNKNOWN_SECTOR ? 0 : (current + 1) % n;
+        for (int j = 0; j < n; j++)
+            all_sectors[j] = (first + j) % n;
+        int grid_sector = current, linear_sector = current;
+        double t0 = StkTime::getRealTime();
+        graph.findRoadSector(p, &grid_sector, NULL, ignore_vertical);
+        double t1 = StkTime::getRealTime();
+        graph.findRoadSector(p, &linear_sector, &all_sectors,
+                             ignore_vertical);
+        double t2 = StkTime::getRealTime();
+        grid_time += t1 - t0;
+        linear_time += t2 - t1;
+        if (grid_sector != linear_sector)
+        {
+            Log::error("Graph", "findRoadSector(%f, %f, %f) from %d: grid %d "
+                       "linear %d", p.getX(), p.getY(), p.getZ(), current,
+                       grid_sector, linear_sector);
+            errors++;
+        }
+        if (grid_sector != UNKNOWN_SECTOR)
+            on_road++;
+
+        // findOutOfRoadSector tests all nodes starting 9 nodes before the
+        // current one
+        first = current == UNKNOWN_SECTOR ? 1 : (current - 9 + n) % n;
+        for (int j = 0; j < n; j++)
+            all_sectors[j] = (first + j) % n;
+        t0 = StkTime::getRealTime();
+        grid_sector = graph.findOutOfRoadSector(p, current, NULL,
+                                                ignore_vertical);
+        t1 = StkTime::getRealTime();
+        linear_sector = graph.findOutOfRoadSector(p, current, &all_sectors,
+                                                  ignore_vertical);
+        t2 = StkTime::getRealTime();
+        grid_time += t1 - t0;
+        linear_time += t2 - t1;
+        if (grid_sector != linear_sector)
+        {
+            Log::error("Graph", "findOutOfRoadSector(%f, %f, %f) from %d: "
+                       "grid %d linear %d", p.getX(), p.getY(), p.getZ(),
+                       current, grid_sector, linear_sector);
+            errors++;
+        }
+    }
+    Log::info("Graph", "%d points (%d on road) in %d nodes: grid %lfs, "
+              "linear %lfs, %d errors.", (int)points.size(), on_road, n,
+              grid_time, linear_time, errors);
+    assert(errors == 0);
+}   // unitTesting
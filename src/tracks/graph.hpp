@@ -20,6 +20,7 @@
 #define HEADER_GRAPH_HPP
 
 #include "utils/no_copy.hpp"
+#include "utils/stk_process.hpp"
 #include "utils/vec3.hpp"
 
 #include <dimension2d.h>
@@ -52,7 +53,7 @@ class RenderTarget;
 class Graph : public NoCopy
 {
 protected:
-    static Graph* m_graph;
+    static Graph* m_graph[PT_COUNT];
 
     std::vector<Quad*> m_all_nodes;
 
@@ -75,6 +76,22 @@ private:
     /** The 4 closest graph nodes to the bounding box. */
     int m_bb_nodes[4];
 
+    /** A uniform grid in x and z over the bounding boxes of all nodes, so
+     *  that findRoadSector and findOutOfRoadSector only need to test the
+     *  nodes close to a point. The nodes of cell i are stored in
+     *  m_grid_nodes from index m_grid_cells[i] to m_grid_cells[i+1]-1. */
+    std::vector<unsigned int> m_grid_cells;
+    std::vector<int> m_grid_nodes;
+
+    /** Minimum x and z coordinates of the grid. */
+    float m_grid_min_x, m_grid_min_z;
+
+    /** Size of a (square) grid cell. */
+    float m_grid_cell_size;
+
+    /** Number of grid cells in x and z direction. */
+    int m_grid_width, m_grid_height;
+
     /** The node of the graph mesh. */
     scene::ISceneNode *m_node;
 
@@ -101,6 +118,13 @@ private:
                       const video::SColor *track_color=NULL,
                       bool invert_x_z = false);
     // ------------------------------------------------------------------------
+    void buildNodeGrid();
+    // ------------------------------------------------------------------------
+    void getGridCell(const Vec3 &xyz, int *x, int *z) const;
+    // ------------------------------------------------------------------------
+    int findClosestNode(const Vec3 &xyz, int first_sector, bool test_height,
+                        bool ignore_vertical) const;
+    // ------------------------------------------------------------------------
     void cleanupDebugMesh();
     // ------------------------------------------------------------------------
     virtual bool hasLapLine() const = 0;
@@ -116,13 +140,15 @@ public:
     /** Returns the one instance of this object. It is possible that there
      *  is no instance created (e.g. arena without navmesh) so we don't assert
      *  that an instance exist. */
-    static Graph* get() { return m_graph; }
+    static Graph* get()
+                       { return m_graph[STKProcess::getRaceDataType()]; }
     // ------------------------------------------------------------------------
     /** Set the graph (either drive or arena graph for now). */
     static void setGraph(Graph* graph)
     {
-        assert(m_graph == NULL);
-        m_graph = graph;
+        ProcessType type = STKProcess::getRaceDataType();
+        assert(m_graph[type] == NULL);
+        m_graph[type] = graph;
     }   // setGraph
     // ------------------------------------------------------------------------
     /** Cleans up the graph. It is possible that this function is called even
@@ -130,10 +156,11 @@ public:
      *  error if there is no instance. */
     static void destroy()
     {
-        if (m_graph)
+        ProcessType type = STKProcess::getRaceDataType();
+        if (m_graph[type])
         {
-            delete m_graph;
-            m_graph = NULL;
+            delete m_graph[type];
+            m_graph[type] = NULL;
         }
     }   // destroy
     // ------------------------------------------------------------------------
@@ -172,6 +199,8 @@ public:
     const Vec3& getBBMax() const                           { return m_bb_max; }
     // ------------------------------------------------------------------------
     const int* getBBNodes() const                        { return m_bb_nodes; }
+    // ------------------------------------------------------------------------
+    static void unitTesting();
 
 };   // Graph
 
@@ -121,6 +121,8 @@ public:
      *  pointInside. */
     virtual bool is3DQuad() const                             { return false; }
     // ------------------------------------------------------------------------
+    virtual void getBoundingBox(Vec3 *min, Vec3 *max) const;
+    // ------------------------------------------------------------------------
     virtual float getDistance2FromPoint(const Vec3 &xyz) const
     {
         // You should not call this in a bare quad
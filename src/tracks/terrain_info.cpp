@@ -30,8 +30,9 @@
  */
 TerrainInfo::TerrainInfo()
 {
-    m_last_material = NULL;
-    m_material      = NULL;
+    m_last_material    = NULL;
+    m_material         = NULL;
+    m_has_prepared_ray = false;
 }   // TerrainInfo
 
 //-----------------------------------------------------------------------------
@@ -43,6 +44,7 @@ TerrainInfo::TerrainInfo(const Vec3 &pos)
     // initialise HoT
     m_last_material = NULL;
     m_material = NULL;
+    m_has_prepared_ray = false;
     update(pos);
 }   // TerrainInfo
 
@@ -76,14 +78,25 @@ void TerrainInfo::update(const btMatrix3x3 &rotation, const Vec3 &from)
     // Save the origin for debug drawing
     m_origin_ray    = from;
 
-    // Compute the 'to' vector by rotating a long 'down' vectory by the
-    // kart rotation, and adding the start point to it.
-    btVector3 to(0, -10000.0f, 0);
-    to = from + rotation*to;
+    btVector3 to = getRayEnd(rotation, from);
 
-    const TriangleMesh &tm = Track::getCurrentTrack()->getTriangleMesh();
-    tm.castRay(from, to, &m_hit_point, &m_material, &m_normal,
-               /*interpolate*/true);
+    // Use the result of the prepared raycast if it was done with exactly
+    // the same ray, otherwise cast the ray now.
+    if (m_has_prepared_ray && m_prepared_ray.m_from == from &&
+        m_prepared_ray.m_to == to)
+    {
+        if (m_prepared_ray.m_hit)
+            m_hit_point = m_prepared_ray.m_hit_point;
+        m_material = m_prepared_ray.m_material;
+        m_normal   = m_prepared_ray.m_normal;
+    }
+    else
+    {
+        const TriangleMesh &tm = Track::getCurrentTrack()->getTriangleMesh();
+        tm.castRay(from, to, &m_hit_point, &m_material, &m_normal,
+                   /*interpolate*/true);
+    }
+    m_has_prepared_ray = false;
     // Now also raycast against all track objects (that are driveable). If
     // there should be a closer result (than the one against the main track 
     // mesh), its data will be returned.
@@ -91,6 +104,54 @@ void TerrainInfo::update(const btMatrix3x3 &rotation, const Vec3 &from)
                             ->castRay(from, to, &m_hit_point, &m_material,
                                       &m_normal, /*interpolate*/true);
 }   // update
+//-----------------------------------------------------------------------------
+/** Returns the end of the ray cast by update(rotation, from): a long 'down'
+ *  vector rotated by the kart rotation, added to the start point.
+ */
+btVector3 TerrainInfo::getRayEnd(const btMatrix3x3 &rotation,
+                                 const Vec3 &from)
+{
+    btVector3 to(0, -10000.0f, 0);
+    return from + rotation*to;
+}   // getRayEnd
+
+//-----------------------------------------------------------------------------
+/** Sets the ray that the next call of update(rotation, from) is expected to
+ *  cast, so that it can be cast together with the rays of other objects by
+ *  castPreparedRays(). update() only uses the result if it casts exactly
+ *  this ray.
+ *  \param rotation The rotation of the kart.
+ *  \param from World coordinates from which to start the raycast.
+ */
+void TerrainInfo::prepareRay(const btMatrix3x3 &rotation, const Vec3 &from)
+{
+    m_prepared_ray.m_from = from;
+    m_prepared_ray.m_to = getRayEnd(rotation, from);
+    m_prepared_ray.m_interpolate_normal = true;
+    m_has_prepared_ray = false;
+}   // prepareRay
+
+//-----------------------------------------------------------------------------
+/** Casts the prepared rays of some objects against the track mesh with one
+ *  batched query, see TriangleMesh::castRays().
+ *  \param infos The terrain info objects whose prepareRay() was called.
+ */
+void TerrainInfo::castPreparedRays(const std::vector<TerrainInfo*> &infos)
+{
+    std::vector<TriangleMesh::RayQuery> queries(infos.size());
+    for (unsigned int i = 0; i < infos.size(); i++)
+        queries[i] = infos[i]->m_prepared_ray;
+
+    Track::getCurrentTrack()->getTriangleMesh()
+        .castRays(queries.data(), (unsigned int)queries.size());
+
+    for (unsigned int i = 0; i < infos.size(); i++)
+    {
+        infos[i]->m_prepared_ray = queries[i];
+        infos[i]->m_has_prepared_ray = true;
+    }
+}   // castPreparedRays
+
 //-----------------------------------------------------------------------------
 /** Update the terrain information based on the latest position.
 *  \param Position from which to start the rayast from.
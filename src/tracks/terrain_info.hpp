@@ -19,8 +19,11 @@
 #ifndef HEADER_TERRAIN_INFO_HPP
 #define HEADER_TERRAIN_INFO_HPP
 
+#include "physics/triangle_mesh.hpp"
 #include "utils/vec3.hpp"
 
+#include <vector>
+
 class btTransform;
 class Material;
 
@@ -43,6 +46,15 @@ private:
     /** DEBUG only: origin of raycast. */
     Vec3 m_origin_ray;
 
+    /** A raycast against the track mesh done in advance together with the
+     *  raycasts of other objects, see castPreparedRays(). */
+    TriangleMesh::RayQuery m_prepared_ray;
+
+    /** True if m_prepared_ray contains the result of a raycast. */
+    bool m_has_prepared_ray;
+
+    static btVector3 getRayEnd(const btMatrix3x3 &rotation, const Vec3 &from);
+
 public:
              TerrainInfo();
              TerrainInfo(const Vec3 &pos);
@@ -53,6 +65,8 @@ public:
     virtual void update(const btMatrix3x3 &rotation, const Vec3 &from);
     virtual void update(const Vec3 &from);
     virtual void update(const Vec3 &from, const Vec3 &towards);
+    void prepareRay(const btMatrix3x3 &rotation, const Vec3 &from);
+    static void castPreparedRays(const std::vector<TerrainInfo*> &infos);
 
     // ------------------------------------------------------------------------
     /** Simple wrapper with no offset. */
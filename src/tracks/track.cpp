@@ -64,6 +64,7 @@
 #include "network/network_config.hpp"
 #include "network/protocols/game_protocol.hpp"
 #include "network/protocols/server_lobby.hpp"
+#include "network/server_config.hpp"
 #include "physics/physical_object.hpp"
 #include "physics/physics.hpp"
 #include "physics/triangle_mesh.hpp"
@@ -177,6 +178,7 @@ Track::Track(const std::string &filename)
     m_weather_sound         = "";
     m_cache_track           = UserConfigParams::m_cache_overworld &&
                               m_ident=="overworld";
+    m_lobby_copy            = false;
     m_render_target         = NULL;
     m_check_manager         = NULL;
     m_minimap_x_scale       = 1.0f;
@@ -328,8 +330,12 @@ void Track::cleanup()
         file_manager->popTextureSearchPath();
     }
 #endif
-    file_manager->popTextureSearchPath();
-    file_manager->popModelSearchPath();
+    // Lobby copies remove their search paths after loading already
+    if (!m_lobby_copy)
+    {
+        file_manager->popTextureSearchPath();
+        file_manager->popModelSearchPath();
+    }
 
     Graph::destroy();
     m_item_manager = nullptr;
@@ -520,7 +526,7 @@ void Track::cleanup()
     m_meta_library.clear();
     Scripting::ScriptEngine::getInstance()->cleanupCache();
 
-    m_current_track[PT_MAIN] = NULL;
+    m_current_track[STKProcess::getType()] = NULL;
 }   // cleanup
 
 //-----------------------------------------------------------------------------
@@ -926,6 +932,15 @@ void Track::createPhysicsModel(unsigned int main_track_count,
         uploadNodeVertexBuffer(m_all_nodes[i]);
     }
     main_loop->renderGUI(5580);
+    // Servers load the same tracks again and again, so cache their bvh
+    if (!for_height_map && NetworkConfig::get()->isNetworking() &&
+        NetworkConfig::get()->isServer() &&
+        ServerConfig::m_track_collision_cache)
+    {
+        m_track_mesh->setCacheName(m_ident + "_track");
+        if (m_gfx_effect_mesh)
+            m_gfx_effect_mesh->setCacheName(m_ident + "_gfx_effect");
+    }
     if (for_height_map)
         m_track_mesh->createCollisionShape();
     else
@@ -1874,7 +1889,8 @@ static void recursiveUpdatePhysics(std::vector<TrackObject*>& tos)
  */
 void Track::loadTrackModel(bool reverse_track, unsigned int mode_id)
 {
-    assert(m_current_track[PT_MAIN].load() == NULL);
+    const ProcessType pt = STKProcess::getType();
+    assert(m_current_track[pt].load() == NULL);
 
     // Use m_filename to also get the path, not only the identifier
     STKTexManager::getInstance()
@@ -1971,8 +1987,9 @@ void Track::loadTrackModel(bool reverse_track, unsigned int mode_id)
         throw std::runtime_error(msg.str());
     }
 
-    m_current_track[PT_MAIN] = this;
-    m_current_track[PT_CHILD] = NULL;
+    m_current_track[pt] = this;
+    if (pt == PT_MAIN)
+        m_current_track[PT_CHILD] = NULL;
 
     // Load the graph only now: this function is called from world, after
     // the race gui was created. The race gui is needed since it stores
@@ -2392,6 +2409,14 @@ void Track::loadTrackModel(bool reverse_track, unsigned int mode_id)
         m_spherical_harmonics_textures.clear();
     }
 #endif   // !SERVER_ONLY
+
+    // Other lobbies load their tracks while this one is racing, so the
+    // search paths can't stay on the stack until cleanup
+    if (m_lobby_copy)
+    {
+        file_manager->popTextureSearchPath();
+        file_manager->popModelSearchPath();
+    }
 }   // loadTrackModel
 
 //-----------------------------------------------------------------------------
@@ -190,6 +190,10 @@ private:
      *  for the overworld. */
     bool m_cache_track;
 
+    /** True if this is the copy of a track loaded by a lobby of a
+     *  multi-lobby server, see cloneForLobby(). */
+    bool m_lobby_copy;
+
 
 #ifdef DEBUG
     /** A list of textures that were cached before the track is loaded.
@@ -441,6 +445,20 @@ public:
         return child_track;
     }
     // ------------------------------------------------------------------------
+    /** Returns a copy of this (not loaded) track, which a lobby of a
+     *  multi-lobby server loads and deletes after its race, so that other
+     *  lobbies can race on the same track at the same time. The materials of
+     *  the track are kept in the shared material list like for the overworld,
+     *  so they are loaded only once for all lobbies. */
+    Track* cloneForLobby()
+    {
+        Track* lobby_track = new Track(*this);
+        lobby_track->m_cache_track = true;
+        lobby_track->m_lobby_copy = true;
+        m_materials_loaded = true;
+        return lobby_track;
+    }
+    // ------------------------------------------------------------------------
     void initChildTrack();
     // ------------------------------------------------------------------------
     static void cleanChildTrack();
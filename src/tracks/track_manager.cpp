@@ -29,6 +29,7 @@
 #include <stdexcept>
 #include <stdio.h>
 #include <memory>
+#include <unordered_set>
 
 #include <IFileSystem.h>
 #include <ITexture.h>
@@ -100,14 +101,8 @@ int TrackManager::getNumberOfRaceTracks() const
  */
 Track* TrackManager::getTrack(const std::string& ident) const
 {
-    for(Tracks::const_iterator i = m_tracks.begin(); i != m_tracks.end(); ++i)
-    {
-        if ((*i)->getIdent() == ident)
-            return *i;
-    }
-
-    return NULL;
-
+    int index = getTrackIndexByIdent(ident);
+    return index == -1 ? NULL : m_tracks[index];
 }   // getTrack
 
 //-----------------------------------------------------------------------------
@@ -127,11 +122,12 @@ void TrackManager::removeAllCachedData()
  */
 void TrackManager::setUnavailableTracks(const std::vector<std::string> &tracks)
 {
+    std::unordered_set<std::string> available(tracks.begin(), tracks.end());
     for(Tracks::const_iterator i = m_tracks.begin(); i != m_tracks.end(); ++i)
     {
         if(!m_track_avail[i-m_tracks.begin()]) continue;
         const std::string id=(*i)->getIdent();
-        if (std::find(tracks.begin(), tracks.end(), id)==tracks.end())
+        if (available.find(id) == available.end())
         {
             m_track_avail[i-m_tracks.begin()] = false;
             Log::warn("TrackManager", "Track '%s' not available on all clients, disabled.",
@@ -178,6 +174,7 @@ void TrackManager::loadTrackList()
     for (Track* track : m_tracks)
         delete track;
     m_tracks.clear();
+    m_track_indices.clear();
 
     for(unsigned int i=0; i<m_track_search_path.size(); i++)
     {
@@ -243,6 +240,8 @@ bool TrackManager::loadTrack(const std::string& dirname)
     m_all_track_dirs.push_back(dirname);
     m_tracks.push_back(track);
     m_track_avail.push_back(true);
+    // If two tracks have the same identifier, the first one is used
+    m_track_indices.emplace(track->getIdent(), (int)m_tracks.size() - 1);
     updateAllGroups(track);
     return true;
 }   // loadTrack
@@ -302,9 +301,21 @@ void TrackManager::removeTrack(const std::string &ident)
     m_tracks.erase(it);
     m_all_track_dirs.erase(m_all_track_dirs.begin()+index);
     m_track_avail.erase(m_track_avail.begin()+index);
+    updateTrackIndices();
     delete track;
 }   // removeTrack
 
+// ----------------------------------------------------------------------------
+/** Recreates the mapping of track identifiers to indices, after the indices
+ *  of tracks have changed.
+ */
+void TrackManager::updateTrackIndices()
+{
+    m_track_indices.clear();
+    for (unsigned i = 0; i < m_tracks.size(); i++)
+        m_track_indices.emplace(m_tracks[i]->getIdent(), i);
+}   // updateTrackIndices
+
 // ----------------------------------------------------------------------------
 /** Remove the track from all groups it belongs to in a group type.
  *  \param type The type of track groups (battle arena, soccer arena, racing track)
@@ -507,14 +518,13 @@ void TrackManager::clearFavoriteTrackStatus()
 }   // clearFavorites
 
 // ----------------------------------------------------------------------------
+/** Returns the index of a track, or -1 if there is no such track.
+ *  \param ident Identifier of the track.
+ */
 int TrackManager::getTrackIndexByIdent(const std::string& ident) const
 {
-    for (unsigned i = 0; i < m_tracks.size(); i++)
-    {
-        if (m_tracks[i]->getIdent() == ident)
-            return i;
-    }
-    return -1;
+    auto it = m_track_indices.find(ident);
+    return it == m_track_indices.end() ? -1 : it->second;
 }   // getTrackIndexByIdent
 
 // ----------------------------------------------------------------------------
@@ -24,6 +24,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
 #include <memory>
 
 class Track;
@@ -53,6 +54,9 @@ private:
     /** All track objects. */
     Tracks                                   m_tracks;
 
+    /** Index in m_tracks for each track identifier. */
+    std::unordered_map<std::string, int>     m_track_indices;
+
     typedef std::map<std::string, std::vector<int> > Group2Indices;
     /** List of all track indexes for each racing track group. */
     Group2Indices                            m_track_groups;
@@ -84,6 +88,7 @@ private:
 
     FavoriteStatus                     *m_current_favorite_status;
 
+    void updateTrackIndices();
     void updateAllGroups(const Track* track);
     void updateGroups(TrackGroupType type, const Track* track);
     void removeTrackFromGroups(TrackGroupType type, const Track* track);
@@ -294,8 +294,8 @@ TrackObjectPresentationLibraryNode::TrackObjectPresentationLibraryNode(
 
 void TrackObjectPresentationLibraryNode::update(float dt)
 {
-    // Child process currently has no scripting engine
-    if (STKProcess::getType() == PT_CHILD)
+    // Only the main process has a scripting engine
+    if (STKProcess::getType() != PT_MAIN)
         return;
 
     if (!m_start_executed)
@@ -1197,7 +1197,7 @@ TrackObjectPresentationActionTrigger::TrackObjectPresentationActionTrigger(
 void TrackObjectPresentationActionTrigger::onTriggerItemApproached(int kart_id)
 {
     if (m_reenable_timeout > StkTime::getMonoTimeMs() ||
-        STKProcess::getType() == PT_CHILD)
+        STKProcess::getType() != PT_MAIN)
     {
         return;
     }
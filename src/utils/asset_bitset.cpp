@@ -0,0 +1,294 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2026 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "utils/asset_bitset.hpp"
+
+#include "utils/log.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+
+// ----------------------------------------------------------------------------
+static inline unsigned popCount(uint64_t word)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_popcountll(word);
+#else
+    unsigned count = 0;
+    for (; word != 0; count++)
+        word &= word - 1;
+    return count;
+#endif
+}   // popCount
+
+// ----------------------------------------------------------------------------
+AssetIndex* AssetIndex::get()
+{
+    static AssetIndex index;
+    return &index;
+}   // get
+
+// ----------------------------------------------------------------------------
+/** Returns the id of an asset, a new one is assigned if it has none yet. */
+unsigned AssetIndex::getId(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_ids.find(name);
+    if (it != m_ids.end())
+        return it->second;
+    unsigned id = (unsigned)m_names.size();
+    m_ids[name] = id;
+    m_names.push_back(name);
+    return id;
+}   // getId
+
+// ----------------------------------------------------------------------------
+/** Returns the id of an asset, or -1 if no id was assigned to it yet (in
+ *  which case it is not contained in any AssetBitset). */
+int AssetIndex::findId(const std::string& name) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_ids.find(name);
+    return it == m_ids.end() ? -1 : (int)it->second;
+}   // findId
+
+// ----------------------------------------------------------------------------
+std::string AssetIndex::getName(unsigned id) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    assert(id < m_names.size());
+    return m_names[id];
+}   // getName
+
+// ----------------------------------------------------------------------------
+/** Adds the names of all assets in a bitset to a set. */
+void AssetIndex::getNames(const AssetBitset& bits,
+                          std::set<std::string>* names) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (size_t i = 0; i < bits.getNumWords(); i++)
+    {
+        uint64_t word = bits.getWord(i);
+        for (unsigned bit = 0; word != 0; bit++, word >>= 1)
+        {
+            if (word & 1)
+                names->insert(m_names[i * 64 + bit]);
+        }
+    }
+}   // getNames
+
+// ============================================================================
+/** Creates the bitset of a set of assets, assigning ids to new assets. */
+AssetBitset::AssetBitset(const std::set<std::string>& names,
+                         AssetIndex* index)
+{
+    for (const std::string& name : names)
+        set(index->getId(name));
+}   // AssetBitset
+
+// ----------------------------------------------------------------------------
+/** Creates the bitset of a set of assets sent by a client. Only assets which
+ *  already have an id are set, so that clients cannot grow the index.
+ *  \param names The names of the assets.
+ *  \param unknown If not NULL, the names without an id are inserted in it.
+ *  \param index The index of the ids.
+ */
+AssetBitset::AssetBitset(const std::set<std::string>& names,
+                         std::set<std::string>* unknown,
+                         const AssetIndex* index)
+{
+    for (const std::string& name : names)
+    {
+        int id = index->findId(name);
+        if (id != -1)
+            set(id);
+        else if (unknown)
+            unknown->insert(name);
+    }
+}   // AssetBitset
+
+// ----------------------------------------------------------------------------
+void AssetBitset::set(unsigned id)
+{
+    unsigned word = id / 64;
+    if (word >= m_words.size())
+        m_words.resize(word + 1, 0);
+    m_words[word] |= uint64_t(1) << (id % 64);
+}   // set
+
+// ----------------------------------------------------------------------------
+/** Returns the number of assets in this set. */
+unsigned AssetBitset::count() const
+{
+    unsigned count = 0;
+    for (uint64_t word : m_words)
+        count += popCount(word);
+    return count;
+}   // count
+
+// ----------------------------------------------------------------------------
+bool AssetBitset::empty() const
+{
+    for (uint64_t word : m_words)
+    {
+        if (word != 0)
+            return false;
+    }
+    return true;
+}   // empty
+
+// ----------------------------------------------------------------------------
+/** Returns the number of assets contained in this and another set. */
+unsigned AssetBitset::countCommon(const AssetBitset& other) const
+{
+    const size_t size = std::min(m_words.size(), other.m_words.size());
+    unsigned count = 0;
+    for (size_t i = 0; i < size; i++)
+        count += popCount(m_words[i] & other.m_words[i]);
+    return count;
+}   // countCommon
+
+// ----------------------------------------------------------------------------
+/** Removes all assets which are not in another set. */
+AssetBitset& AssetBitset::operator&=(const AssetBitset& other)
+{
+    if (m_words.size() > other.m_words.size())
+        m_words.resize(other.m_words.size());
+    for (size_t i = 0; i < m_words.size(); i++)
+        m_words[i] &= other.m_words[i];
+    return *this;
+}   // operator&=
+
+// ----------------------------------------------------------------------------
+bool AssetBitset::contains(const std::string& name,
+                           const AssetIndex* index) const
+{
+    int id = index->findId(name);
+    return id != -1 && test(id);
+}   // contains
+
+// ----------------------------------------------------------------------------
+/** Returns the names of all assets in this set. */
+std::set<std::string> AssetBitset::toSet(const AssetIndex* index) const
+{
+    std::set<std::string> names;
+    index->getNames(*this, &names);
+    return names;
+}   // toSet
+
+// ----------------------------------------------------------------------------
+/** Tests the set operations, and compares the time to find the assets
+ *  common to all peers and the peers lacking each asset with sets of strings
+ *  and with bitsets, for 30 peers and 500 addons. A local index is used, so
+ *  the global one doesn't get the names of the test.
+ */
+void AssetBitset::unitTesting()
+{
+    AssetIndex index;
+    std::set<std::string> names = { "unit-test-a", "unit-test-b",
+        "unit-test-c" };
+    AssetBitset abc(names, &index);
+    assert(abc.count() == 3);
+    assert(abc.contains("unit-test-b", &index));
+    assert(!abc.contains("unit-test-d", &index));
+    assert(abc.toSet(&index) == names);
+    AssetBitset bd(std::set<std::string>{ "unit-test-b", "unit-test-d" },
+        &index);
+    assert(abc.countCommon(bd) == 1);
+    abc &= bd;
+    assert(abc.toSet(&index) == std::set<std::string>{ "unit-test-b" });
+    assert(!abc.empty() && AssetBitset().empty());
+    std::set<std::string> unknown;
+    AssetBitset client(std::set<std::string>{ "unit-test-a",
+        "unit-test-unknown" }, &unknown, &index);
+    assert(client.count() == 1 && client.contains("unit-test-a", &index));
+    assert(unknown == std::set<std::string>{ "unit-test-unknown" });
+    assert(index.findId("unit-test-unknown") == -1);
+
+    const unsigned num_peers = 30;
+    const unsigned num_addons = 500;
+    std::set<std::string> server_addons;
+    for (unsigned i = 0; i < num_addons; i++)
+        server_addons.insert("unit-test-addon-" + std::to_string(i));
+    std::vector<std::set<std::string> > peer_sets(num_peers);
+    for (unsigned p = 0; p < num_peers; p++)
+    {
+        unsigned i = 0;
+        for (const std::string& addon : server_addons)
+        {
+            // Every peer lacks a few addons
+            if ((i++ * 7 + p * 13) % 97 != 0)
+                peer_sets[p].insert(addon);
+        }
+    }
+    std::vector<AssetBitset> peer_bits;
+    for (unsigned p = 0; p < num_peers; p++)
+        peer_bits.emplace_back(peer_sets[p], &index);
+    std::vector<unsigned> server_ids;
+    for (const std::string& addon : server_addons)
+        server_ids.push_back(index.getId(addon));
+    AssetBitset server_bits(server_addons, &index);
+
+    auto set_start = std::chrono::steady_clock::now();
+    std::set<std::string> common_set = server_addons;
+    for (unsigned p = 0; p < num_peers; p++)
+    {
+        for (const std::string& addon : server_addons)
+        {
+            if (peer_sets[p].find(addon) == peer_sets[p].end())
+                common_set.erase(addon);
+        }
+    }
+    unsigned lacking_set = 0;
+    for (const std::string& addon : server_addons)
+    {
+        for (unsigned p = 0; p < num_peers; p++)
+        {
+            if (peer_sets[p].find(addon) == peer_sets[p].end())
+                lacking_set++;
+        }
+    }
+    auto set_end = std::chrono::steady_clock::now();
+
+    auto bits_start = std::chrono::steady_clock::now();
+    AssetBitset common_bits = server_bits;
+    for (unsigned p = 0; p < num_peers; p++)
+        common_bits &= peer_bits[p];
+    unsigned lacking_bits = 0;
+    for (unsigned id : server_ids)
+    {
+        for (unsigned p = 0; p < num_peers; p++)
+        {
+            if (!peer_bits[p].test(id))
+                lacking_bits++;
+        }
+    }
+    auto bits_end = std::chrono::steady_clock::now();
+
+    assert(common_bits.toSet(&index) == common_set);
+    assert(AssetIndex::get()->findId("unit-test-a") == -1);
+    assert(lacking_bits == lacking_set);
+    Log::info("AssetBitset", "%u peers and %u addons: sets %dus, "
+        "bitsets %dus (%u common, %u lacking).", num_peers, num_addons,
+        (int)std::chrono::duration_cast<std::chrono::microseconds>
+        (set_end - set_start).count(),
+        (int)std::chrono::duration_cast<std::chrono::microseconds>
+        (bits_end - bits_start).count(), (unsigned)common_set.size(),
+        lacking_set);
+}   // unitTesting
@@ -0,0 +1,97 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2026 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_ASSET_BITSET_HPP
+#define HEADER_ASSET_BITSET_HPP
+
+#include "utils/no_copy.hpp"
+#include "utils/types.hpp"
+
+#include <mutex>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class AssetBitset;
+
+/** Assigns a small number to each kart or track identifier, so that sets of
+ *  assets can be stored as bitsets. Numbers are never reused, so they stay
+ *  valid when karts or tracks are removed. Thread safe. The game uses the
+ *  global index returned by get(), other instances are only for testing.
+ */
+class AssetIndex : public NoCopy
+{
+private:
+    mutable std::mutex m_mutex;
+
+    std::unordered_map<std::string, unsigned> m_ids;
+
+    std::vector<std::string> m_names;
+
+public:
+    static AssetIndex* get();
+    unsigned getId(const std::string& name);
+    int findId(const std::string& name) const;
+    std::string getName(unsigned id) const;
+    void getNames(const AssetBitset& bits,
+                  std::set<std::string>* names) const;
+};   // AssetIndex
+
+// ============================================================================
+/** A set of assets, stored as one bit per id of the AssetIndex. Set
+ *  operations work on 64 bits at once, so comparing the assets of peers with
+ *  the ones of the server doesn't need to compare strings.
+ */
+class AssetBitset
+{
+private:
+    std::vector<uint64_t> m_words;
+
+public:
+    AssetBitset() {}
+    AssetBitset(const std::set<std::string>& names,
+                AssetIndex* index = AssetIndex::get());
+    AssetBitset(const std::set<std::string>& names,
+                std::set<std::string>* unknown,
+                const AssetIndex* index = AssetIndex::get());
+    void set(unsigned id);
+    unsigned count() const;
+    bool empty() const;
+    unsigned countCommon(const AssetBitset& other) const;
+    AssetBitset& operator&=(const AssetBitset& other);
+    bool contains(const std::string& name,
+                  const AssetIndex* index = AssetIndex::get()) const;
+    std::set<std::string> toSet(
+                           const AssetIndex* index = AssetIndex::get()) const;
+    static void unitTesting();
+    // ------------------------------------------------------------------------
+    bool test(unsigned id) const
+    {
+        unsigned word = id / 64;
+        return word < m_words.size() &&
+            (m_words[word] & (uint64_t(1) << (id % 64))) != 0;
+    }   // test
+    // ------------------------------------------------------------------------
+    /** Returns the number of words, i.e. 64 times the number of bits. */
+    size_t getNumWords() const                       { return m_words.size(); }
+    // ------------------------------------------------------------------------
+    uint64_t getWord(size_t i) const                     { return m_words[i]; }
+};   // AssetBitset
+
+#endif
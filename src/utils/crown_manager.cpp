@@ -46,7 +46,8 @@ std::set<std::shared_ptr<STKPeer>>& CrownManager::getSpectatorsByLimit(bool upda
     m_why_peer_cannot_play.clear();
     m_spectators_by_limit.clear();
 
-    auto peers = STKHost::get()->getPeers();
+    std::vector<std::shared_ptr<STKPeer> > peers =
+        STKHost::get()->getPeers();
 
     unsigned player_limit = getSettings()->getServerMaxPlayers();
 
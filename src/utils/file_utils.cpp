@@ -166,3 +166,15 @@ int FileUtils::renameU8Path(const std::string& u8_path_old,
     return rename(u8_path_old.c_str(), u8_path_new.c_str());
 #endif
 }   // renameU8Path
+
+// ----------------------------------------------------------------------------
+/** remove() with unicode path capability.
+ */
+int FileUtils::removeU8Path(const std::string& u8_path)
+{
+#if defined(WIN32)
+    return _wremove(StringUtils::utf8ToWide(u8_path).c_str());
+#else
+    return remove(u8_path.c_str());
+#endif
+}   // removeU8Path
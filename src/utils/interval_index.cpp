@@ -0,0 +1,188 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2026 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "utils/interval_index.hpp"
+
+#include "utils/log.hpp"
+#include "utils/types.hpp"
+
+#include <cassert>
+#include <chrono>
+#include <random>
+#include <tuple>
+
+#ifdef ENABLE_SQLITE3
+#include <sqlite3.h>
+#endif
+
+namespace IntervalIndexTesting
+{
+// ----------------------------------------------------------------------------
+/** Compares the index with a linear search for random (partly overlapping)
+ *  intervals, and if SQLite is available, compares the index with the
+ *  equivalent SQL query used for geolocation and prints the time taken by
+ *  both.
+ */
+void unitTesting()
+{
+    std::mt19937 rng(42);
+    const unsigned count = 5000;
+    std::vector<std::tuple<uint32_t, uint32_t, int> > intervals;
+    IntervalIndex<uint32_t, int> index;
+    for (unsigned i = 0; i < count; i++)
+    {
+        uint32_t start = rng() % 1000000;
+        uint32_t end = start + (i % 10 == 0 ? rng() % 20000 : rng() % 200);
+        intervals.emplace_back(start, end, (int)i);
+        index.add(start, end, (int)i);
+    }
+    index.build();
+    assert(index.size() == count);
+
+    auto linear_find = [&intervals](uint32_t key, bool even_only)
+    {
+        int found = -1;
+        uint32_t found_start = 0;
+        for (auto& interval : intervals)
+        {
+            if (std::get<0>(interval) <= key && std::get<1>(interval) >= key &&
+                (!even_only || std::get<2>(interval) % 2 == 0) &&
+                (found == -1 || std::get<0>(interval) > found_start))
+            {
+                found = std::get<2>(interval);
+                found_start = std::get<0>(interval);
+            }
+        }
+        return found;
+    };
+
+    std::vector<uint32_t> keys;
+    for (unsigned i = 0; i < 1000; i++)
+        keys.push_back(rng() % 1100000);
+    for (uint32_t key : keys)
+    {
+        // Intervals with the same start may be found in any order, so only
+        // the start is compared
+        int expected = linear_find(key, false);
+        const int* found = index.find(key);
+        assert((expected == -1) == (found == NULL));
+        if (found)
+        {
+            assert(std::get<0>(intervals[*found]) ==
+                std::get<0>(intervals[expected]));
+        }
+        expected = linear_find(key, true);
+        found = index.find(key, [](int value) { return value % 2 == 0; });
+        assert((expected == -1) == (found == NULL));
+        if (found)
+        {
+            assert(*found % 2 == 0);
+            assert(std::get<0>(intervals[*found]) ==
+                std::get<0>(intervals[expected]));
+        }
+        (void)expected;
+    }
+
+    // Nested blocks like CIDR ranges, the smallest block is found
+    IntervalIndex<uint32_t, int> nested;
+    for (int i = 0; i < 256; i++)
+    {
+        nested.add(i << 16, (i << 16) + 0xffff, 16);
+        nested.add(i << 16, (i << 16) + 0xff, 24);
+        nested.add((i << 16) + 0x100, (i << 16) + 0x1ff, 24);
+    }
+    nested.add(0, 0xffffff, 8);
+    nested.build();
+    bool ok = *nested.find(0x120050) == 24 && *nested.find(0x120150) == 24 &&
+        *nested.find(0x120250) == 16 &&
+        *nested.find(0x120050, [](int value) { return value < 24; }) == 16 &&
+        *nested.find(0x120050, [](int value) { return value < 16; }) == 8 &&
+        nested.find(0x1000000) == NULL;
+    assert(ok);
+    (void)ok;
+
+#ifdef ENABLE_SQLITE3
+    // Same query as DatabaseConnector::ip2Country, on an in-memory table
+    // without extra index like the usual geolocation tables
+    sqlite3* db = NULL;
+    if (sqlite3_open(":memory:", &db) != SQLITE_OK)
+    {
+        sqlite3_close(db);
+        return;
+    }
+    sqlite3_exec(db, "CREATE TABLE geo (ip_start INTEGER, ip_end INTEGER, "
+        "value INTEGER);", NULL, NULL, NULL);
+    sqlite3_exec(db, "BEGIN;", NULL, NULL, NULL);
+    sqlite3_stmt* stmt = NULL;
+    sqlite3_prepare_v2(db, "INSERT INTO geo VALUES (?, ?, ?);", -1, &stmt,
+        NULL);
+    for (auto& interval : intervals)
+    {
+        sqlite3_bind_int64(stmt, 1, std::get<0>(interval));
+        sqlite3_bind_int64(stmt, 2, std::get<1>(interval));
+        sqlite3_bind_int(stmt, 3, std::get<2>(interval));
+        sqlite3_step(stmt);
+        sqlite3_reset(stmt);
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_exec(db, "COMMIT;", NULL, NULL, NULL);
+
+    sqlite3_prepare_v2(db, "SELECT value FROM geo WHERE ip_start <= ?1 AND "
+        "ip_end >= ?1 ORDER BY ip_start DESC LIMIT 1;", -1, &stmt, NULL);
+    std::vector<int> sql_results;
+    auto sql_start = std::chrono::steady_clock::now();
+    for (uint32_t key : keys)
+    {
+        sqlite3_bind_int64(stmt, 1, key);
+        sql_results.push_back(sqlite3_step(stmt) == SQLITE_ROW ?
+            sqlite3_column_int(stmt, 0) : -1);
+        sqlite3_reset(stmt);
+    }
+    auto sql_end = std::chrono::steady_clock::now();
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+
+    int checksum = 0;
+    auto index_start = std::chrono::steady_clock::now();
+    for (uint32_t key : keys)
+    {
+        const int* found = index.find(key);
+        checksum += found ? *found : -1;
+    }
+    auto index_end = std::chrono::steady_clock::now();
+
+    for (unsigned i = 0; i < keys.size(); i++)
+    {
+        const int* found = index.find(keys[i]);
+        assert((sql_results[i] == -1) == (found == NULL));
+        if (found)
+        {
+            assert(std::get<0>(intervals[*found]) ==
+                std::get<0>(intervals[sql_results[i]]));
+        }
+    }
+    Log::info("IntervalIndex", "%u lookups in %u intervals: SQL %dus, "
+        "index %dus (checksum %d).", (unsigned)keys.size(), count,
+        (int)std::chrono::duration_cast<std::chrono::microseconds>
+        (sql_end - sql_start).count(),
+        (int)std::chrono::duration_cast<std::chrono::microseconds>
+        (index_end - index_start).count(), checksum);
+#endif
+}   // unitTesting
+
+}   // namespace IntervalIndexTesting
@@ -0,0 +1,129 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2026 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_INTERVAL_INDEX_HPP
+#define HEADER_INTERVAL_INDEX_HPP
+
+#include <algorithm>
+#include <vector>
+
+/** This class stores closed intervals [start, end] with a value each, and
+ *  finds the interval containing a key with a binary search. Intervals are
+ *  sorted by their start, and each interval keeps the closest previous
+ *  interval with a larger end. A search starts at the last interval
+ *  starting before the key and jumps along those links while the end is
+ *  smaller than the key, as no interval in between can contain the key.
+ *  If intervals are disjoint or nested (like IP ranges and CIDR blocks),
+ *  the link is the closest enclosing interval, so a search is
+ *  O(log n + nesting depth). Overlapping intervals are still found
+ *  correctly. The containing interval with the largest start is found.
+ *  All intervals have to be added before build() is called. The index is
+ *  not modified by searches, so it can be shared by threads once built.
+ */
+template<typename Key, typename Value>
+class IntervalIndex
+{
+private:
+    struct Interval
+    {
+        Key m_start;
+        Key m_end;
+        Value m_value;
+    };
+
+    /** The intervals, sorted by start after build(). */
+    std::vector<Interval> m_intervals;
+
+    /** For interval i, the closest previous interval with a larger end, or
+     *  -1 if there is none. */
+    std::vector<int> m_larger_end;
+
+public:
+    /** Adds an interval, ignored if end is smaller than start. */
+    void add(const Key& start, const Key& end, const Value& value)
+    {
+        if (end < start)
+            return;
+        m_intervals.push_back({ start, end, value });
+    }   // add
+    // ------------------------------------------------------------------------
+    /** Sorts the intervals, needs to be called after adding intervals and
+     *  before searching. */
+    void build()
+    {
+        std::stable_sort(m_intervals.begin(), m_intervals.end(),
+            [](const Interval& a, const Interval& b)
+            { return a.m_start < b.m_start; });
+        m_larger_end.resize(m_intervals.size());
+        // Intervals which can still be the closest one with a larger end,
+        // their ends are decreasing
+        std::vector<int> candidates;
+        for (int i = 0; i < (int)m_intervals.size(); i++)
+        {
+            while (!candidates.empty() &&
+                !(m_intervals[i].m_end < m_intervals[candidates.back()].m_end))
+                candidates.pop_back();
+            m_larger_end[i] = candidates.empty() ? -1 : candidates.back();
+            candidates.push_back(i);
+        }
+    }   // build
+    // ------------------------------------------------------------------------
+    /** Returns the value of the interval containing the key with the largest
+     *  start for which accept(value) is true, or NULL if there is none. */
+    template<typename Predicate>
+    const Value* find(const Key& key, Predicate accept) const
+    {
+        auto it = std::upper_bound(m_intervals.begin(), m_intervals.end(),
+            key, [](const Key& k, const Interval& interval)
+            { return k < interval.m_start; });
+        int i = int(it - m_intervals.begin()) - 1;
+        while (i >= 0)
+        {
+            if (m_intervals[i].m_end < key)
+            {
+                i = m_larger_end[i];
+                continue;
+            }
+            if (accept(m_intervals[i].m_value))
+                return &m_intervals[i].m_value;
+            i--;
+        }
+        return NULL;
+    }   // find
+    // ------------------------------------------------------------------------
+    /** Returns the value of the interval containing the key with the largest
+     *  start, or NULL if there is none. */
+    const Value* find(const Key& key) const
+                      { return find(key, [](const Value&) { return true; }); }
+    // ------------------------------------------------------------------------
+    /** Returns the number of intervals. */
+    unsigned size() const               { return (unsigned)m_intervals.size(); }
+    // ------------------------------------------------------------------------
+    void clear()
+    {
+        m_intervals.clear();
+        m_larger_end.clear();
+    }   // clear
+};   // class IntervalIndex
+
+namespace IntervalIndexTesting
+{
+    void unitTesting();
+}
+
+#endif
@@ -79,6 +79,7 @@ void LobbyAssetManager::init()
     m_addon_tracks_play_threshold    = ServerConfig::m_addon_tracks_play_threshold;
     m_official_karts_threshold       = ServerConfig::m_official_karts_threshold;
     m_official_tracks_threshold      = ServerConfig::m_official_tracks_threshold;
+    updateAssetBits();
 }   // init
 //-----------------------------------------------------------------------------
 
@@ -91,31 +92,22 @@ void LobbyAssetManager::updateAddons()
     m_addon_arenas.clear();
     m_addon_soccers.clear();
 
-    std::set<std::string> total_addons;
     for (unsigned i = 0; i < kart_properties_manager->getNumberOfKarts(); i++)
     {
         const KartProperties* kp =
             kart_properties_manager->getKartById(i);
         if (kp->isAddon())
-            total_addons.insert(kp->getIdent());
+            m_addon_kts.first.insert(kp->getIdent());
     }
     for (unsigned i = 0; i < track_manager->getNumberOfTracks(); i++)
     {
-        const Track* track = track_manager->getTrack(i);
-        if (track->isAddon())
-            total_addons.insert(track->getIdent());
-    }
-
-    for (auto& addon : total_addons)
-    {
-        const KartProperties* kp = kart_properties_manager->getKart(addon);
-        if (kp && kp->isAddon())
-        {
-            m_addon_kts.first.insert(kp->getIdent());
+        const Track* t = track_manager->getTrack(i);
+        if (!t->isAddon() || t->isInternal())
             continue;
-        }
-        Track* t = track_manager->getTrack(addon);
-        if (!t || !t->isAddon() || t->isInternal())
+        // Only the first track with an identifier is used, and an addon
+        // kart with the same identifier takes precedence
+        if (track_manager->getTrackIndexByIdent(t->getIdent()) != (int)i ||
+            m_addon_kts.first.count(t->getIdent()) != 0)
             continue;
         if (t->isArena())
             m_addon_arenas.insert(t->getIdent());
@@ -142,6 +134,7 @@ void LobbyAssetManager::updateAddons()
     else
         m_available_kts.first = { all_k.begin(), all_k.end() };
     m_entering_kts = m_available_kts;
+    updateAssetBits();
 }   // updateAddons
 //-----------------------------------------------------------------------------
 
@@ -222,6 +215,7 @@ void LobbyAssetManager::updateMapsForMode(RaceManager::MinorRaceModeType mode)
             break;
     }
     m_entering_kts = m_available_kts;
+    updateAssetBits();
 }   // updateMapsForMode
 //-----------------------------------------------------------------------------
 
@@ -241,20 +235,25 @@ void LobbyAssetManager::onServerSetup()
 void LobbyAssetManager::eraseAssetsWithPeers(
         const std::vector<std::shared_ptr<STKPeer>>& peers)
 {
-    std::set<std::string> karts_erase, maps_erase;
+    // Peers which didn't send their assets are ignored
+    AssetBitset common_karts(m_available_kts.first);
+    AssetBitset common_maps = m_available_map_bits;
     for (const auto& peer: peers)
     {
-        if (peer)
-        {
-            peer->eraseServerKarts(m_available_kts.first, karts_erase);
-            peer->eraseServerTracks(m_available_kts.second, maps_erase);
-        }
+        if (!peer)
+            continue;
+        if (!peer->getClientKarts().empty())
+            common_karts &= peer->getClientKarts();
+        if (!peer->getClientTracks().empty())
+            common_maps &= peer->getClientTracks();
+    }
+    if (common_karts.count() != m_available_kts.first.size())
+        m_available_kts.first = common_karts.toSet();
+    if (common_maps.count() != m_available_kts.second.size())
+    {
+        m_available_kts.second = common_maps.toSet();
+        m_available_map_bits = common_maps;
     }
-    for (const std::string& kart_erase : karts_erase)
-        m_available_kts.first.erase(kart_erase);
-
-    for (const std::string& map_erase : maps_erase)
-        m_available_kts.second.erase(map_erase);
 
 } // eraseAssetsWithPeers
 //-----------------------------------------------------------------------------
@@ -280,6 +279,7 @@ bool LobbyAssetManager::tryApplyingMapFilters()
         m_available_kts.second = available_tracks_fallback;
         return false;
     }
+    m_available_map_bits = AssetBitset(m_available_kts.second);
     return true;
 }   // tryApplyingMapFilters
 //-----------------------------------------------------------------------------
@@ -307,59 +307,20 @@ void LobbyAssetManager::encodePlayerKartsAndCommonMaps(NetworkString* ns,
 //-----------------------------------------------------------------------------
 
 bool LobbyAssetManager::handleAssetsForPeer(std::shared_ptr<STKPeer> peer,
-        const std::set<std::string>& client_karts,
-        const std::set<std::string>& client_tracks)
+        const AssetBitset& client_karts,
+        const AssetBitset& client_tracks)
 {
     // Drop this player if he doesn't have at least 1 kart / track the same
     // as server
-    float okt = 0.0f;
-    float ott = 0.0f;
-    int addon_karts = 0;
-    int addon_tracks = 0;
-    int addon_arenas = 0;
-    int addon_soccers = 0;
-    for (auto& client_kart : client_karts)
-    {
-        if (m_official_kts.first.find(client_kart) !=
-            m_official_kts.first.end())
-            okt += 1.0f;
-        if (m_addon_kts.first.find(client_kart) !=
-            m_addon_kts.first.end())
-            ++addon_karts;
-    }
-    okt = okt / (float)m_official_kts.first.size();
-    for (auto& client_track : client_tracks)
-    {
-        if (m_official_kts.second.find(client_track) !=
-            m_official_kts.second.end())
-            ott += 1.0f;
-        if (m_addon_kts.second.find(client_track) !=
-            m_addon_kts.second.end())
-            ++addon_tracks;
-        if (m_addon_arenas.find(client_track) !=
-            m_addon_arenas.end())
-            ++addon_arenas;
-        if (m_addon_soccers.find(client_track) !=
-            m_addon_soccers.end())
-            ++addon_soccers;
-    }
-    ott = ott / (float)m_official_kts.second.size();
+    float okt = officialKartsFraction(client_karts);
+    float ott = officialMapsFraction(client_tracks);
+    int addon_karts = client_karts.countCommon(m_addon_bits.first);
+    int addon_tracks = client_tracks.countCommon(m_addon_bits.second);
+    int addon_arenas = client_tracks.countCommon(m_addon_arena_bits);
+    int addon_soccers = client_tracks.countCommon(m_addon_soccer_bits);
 
-    std::set<std::string> karts_erase, maps_erase;
-    for (const std::string& server_kart : m_entering_kts.first)
-    {
-        if (client_karts.find(server_kart) == client_karts.end())
-        {
-            karts_erase.insert(server_kart);
-        }
-    }
-    for (const std::string& server_track : m_entering_kts.second)
-    {
-        if (client_tracks.find(server_track) == client_tracks.end())
-        {
-            maps_erase.insert(server_track);
-        }
-    }
+    unsigned common_karts = client_karts.countCommon(m_entering_bits.first);
+    unsigned common_maps = client_tracks.countCommon(m_entering_bits.second);
 
     auto settings = getSettings();
 
@@ -379,7 +340,7 @@ bool LobbyAssetManager::handleAssetsForPeer(std::shared_ptr<STKPeer> peer,
     bool has_required_karts = true;
     for (const std::string& required_kart: m_must_have_karts)
     {
-        if (client_karts.find(required_kart) == client_karts.end())
+        if (!client_karts.contains(required_kart))
         {
             has_required_karts = false;
             bad = true;
@@ -391,7 +352,7 @@ bool LobbyAssetManager::handleAssetsForPeer(std::shared_ptr<STKPeer> peer,
     bool has_required_tracks = true;
     for (const std::string& required_track: m_must_have_maps)
     {
-        if (client_tracks.find(required_track) == client_tracks.end())
+        if (!client_tracks.contains(required_track))
         {
             has_required_tracks = false;
             bad = true;
@@ -405,13 +366,13 @@ bool LobbyAssetManager::handleAssetsForPeer(std::shared_ptr<STKPeer> peer,
     peer->addon_arenas_count = addon_arenas;
     peer->addon_soccers_count = addon_soccers;
 
-    if (karts_erase.size() == m_entering_kts.first.size())
+    if (common_karts == 0)
     {
         Log::verbose("LobbyAssetManager", "Bad player: no common karts with server");
         bad = true;
     }
 
-    if (maps_erase.size() == m_entering_kts.second.size())
+    if (common_maps == 0)
     {
         Log::verbose("LobbyAssetManager", "Bad player: no common tracks with server");
         bad = true;
@@ -464,30 +425,14 @@ bool LobbyAssetManager::handleAssetsForPeer(std::shared_ptr<STKPeer> peer,
 //-----------------------------------------------------------------------------
 
 std::array<int, AS_TOTAL> LobbyAssetManager::getAddonScores(
-        const std::set<std::string>& client_karts,
-        const std::set<std::string>& client_tracks)
+        const AssetBitset& client_karts,
+        const AssetBitset& client_tracks)
 {
     std::array<int, AS_TOTAL> addons_scores = {{ -1, -1, -1, -1 }};
-    size_t addon_kart = 0;
-    size_t addon_track = 0;
-    size_t addon_arena = 0;
-    size_t addon_soccer = 0;
-
-    for (auto& kart : m_addon_kts.first)
-        if (client_karts.find(kart) != client_karts.end())
-            addon_kart++;
-
-    for (auto& track : m_addon_kts.second)
-        if (client_tracks.find(track) != client_tracks.end())
-            addon_track++;
-
-    for (auto& arena : m_addon_arenas)
-        if (client_tracks.find(arena) != client_tracks.end())
-            addon_arena++;
-
-    for (auto& soccer : m_addon_soccers)
-        if (client_tracks.find(soccer) != client_tracks.end())
-            addon_soccer++;
+    size_t addon_kart = client_karts.countCommon(m_addon_bits.first);
+    size_t addon_track = client_tracks.countCommon(m_addon_bits.second);
+    size_t addon_arena = client_tracks.countCommon(m_addon_arena_bits);
+    size_t addon_soccer = client_tracks.countCommon(m_addon_soccer_bits);
 
     if (!m_addon_kts.first.empty())
         addons_scores[AS_KART] = addon_kart;
@@ -511,18 +456,9 @@ std::string LobbyAssetManager::getAnyMapForVote()
 }   // getAnyMapForVote
 //-----------------------------------------------------------------------------
 
-bool LobbyAssetManager::checkIfNoCommonMaps(
-        const std::pair<std::set<std::string>, std::set<std::string>>& assets)
+bool LobbyAssetManager::checkIfNoCommonMaps(const AssetBitset& client_maps)
 {
-    std::set<std::string> maps_erase;
-    for (const std::string& server_track : m_available_kts.second)
-    {
-        if (assets.second.find(server_track) == assets.second.end())
-        {
-            maps_erase.insert(server_track);
-        }
-    }
-    return maps_erase.size() == m_available_kts.second.size();
+    return client_maps.countCommon(m_available_map_bits) == 0;
 }   // checkIfNoCommonMaps
 //-----------------------------------------------------------------------------
 
@@ -532,26 +468,16 @@ bool LobbyAssetManager::isKartAvailable(const std::string& kart) const
 }   // isKartAvailable
 //-----------------------------------------------------------------------------
 
-float LobbyAssetManager::officialKartsFraction(const std::set<std::string>& clientKarts) const
+float LobbyAssetManager::officialKartsFraction(const AssetBitset& clientKarts) const
 {
-    int karts_count = 0;
-    for (auto& kart : clientKarts)
-    {
-        if (m_official_kts.first.find(kart) != m_official_kts.first.end())
-            karts_count += 1;
-    }
+    int karts_count = clientKarts.countCommon(m_official_bits.first);
     return karts_count / (float)m_official_kts.first.size();
 }   // officialKartsFraction
 //-----------------------------------------------------------------------------
 
-float LobbyAssetManager::officialMapsFraction(const std::set<std::string>& clientMaps) const
+float LobbyAssetManager::officialMapsFraction(const AssetBitset& clientMaps) const
 {
-    int maps_count = 0;
-    for (auto& map : clientMaps)
-    {
-        if (m_official_kts.second.find(map) != m_official_kts.second.end())
-            maps_count += 1;
-    }
+    int maps_count = clientMaps.countCommon(m_official_bits.second);
     return maps_count / (float)m_official_kts.second.size();
 }   // officialMapsFraction
 //-----------------------------------------------------------------------------
@@ -682,7 +608,7 @@ std::string LobbyAssetManager::getKartForBadKartChoice(
     if (peer->isAIPeer())
         karts = getAvailableKarts();
     else
-        karts = peer->getClientAssets().first;
+        karts = peer->getClientKarts().toSet();
 
     applyAllKartFilters(username, karts, true);
 
@@ -733,17 +659,17 @@ int LobbyAssetManager::checkCanPlay(std::shared_ptr<STKPeer> peer, int known_num
     if (peer->addon_soccers_count < getAddonSoccersPlayThreshold())
         return HR_ADDON_FIELDS_PLAY_THRESHOLD;
 
-    std::set<std::string> karts = peer->getClientAssets().first;
-    std::set<std::string> maps = peer->getClientAssets().second;
-
-    float karts_fraction = officialKartsFraction(karts);
+    float karts_fraction = officialKartsFraction(peer->getClientKarts());
     if (karts_fraction < getOfficialKartsPlayThreshold())
         return HR_OFFICIAL_KARTS_PLAY_THRESHOLD;
 
-    float maps_fraction = officialMapsFraction(maps);
+    float maps_fraction = officialMapsFraction(peer->getClientTracks());
     if (maps_fraction < getOfficialTracksPlayThreshold())
         return HR_OFFICIAL_TRACKS_PLAY_THRESHOLD;
 
+    std::set<std::string> karts = peer->getClientKarts().toSet();
+    std::set<std::string> maps = peer->getClientTracks().toSet();
+
     applyAllKartFilters(peer->getMainName(), karts, false);
     if (karts.empty())
         return HR_NO_KARTS_AFTER_FILTER;
@@ -779,12 +705,28 @@ std::vector<std::string> LobbyAssetManager::getMissingAssets(
 
     std::vector<std::string> ans;
     for (const std::string& required_kart : m_play_requirement_karts)
-        if (peer->getClientAssets().first.count(required_kart) == 0)
+        if (!peer->getClientKarts().contains(required_kart))
             ans.push_back(required_kart);
 
     for (const std::string& required_track : m_play_requirement_tracks)
-        if (peer->getClientAssets().second.count(required_track) == 0)
+        if (!peer->getClientTracks().contains(required_track))
             ans.push_back(required_track);
     return ans;
 }   // getMissingAssets
+//-----------------------------------------------------------------------------
+
+/** Updates the bitsets of the official, addon and entering assets after the
+ *  sets of them were changed. */
+void LobbyAssetManager::updateAssetBits()
+{
+    m_official_bits.first = AssetBitset(m_official_kts.first);
+    m_official_bits.second = AssetBitset(m_official_kts.second);
+    m_addon_bits.first = AssetBitset(m_addon_kts.first);
+    m_addon_bits.second = AssetBitset(m_addon_kts.second);
+    m_addon_arena_bits = AssetBitset(m_addon_arenas);
+    m_addon_soccer_bits = AssetBitset(m_addon_soccers);
+    m_entering_bits.first = AssetBitset(m_entering_kts.first);
+    m_entering_bits.second = AssetBitset(m_entering_kts.second);
+    m_available_map_bits = AssetBitset(m_available_kts.second);
+}   // updateAssetBits
 //-----------------------------------------------------------------------------
\ No newline at end of file
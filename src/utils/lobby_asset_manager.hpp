@@ -21,6 +21,7 @@
 
 #include "network/stk_peer.hpp"
 #include "race/race_manager.hpp"
+#include "utils/asset_bitset.hpp"
 #include "utils/lobby_context.hpp"
 #include "utils/track_filter.hpp"
 #include "utils/types.hpp"
@@ -54,20 +55,19 @@ public:
             NetworkString* ns, const std::set<std::string>& all_k);
 
     bool handleAssetsForPeer(std::shared_ptr<STKPeer> peer,
-            const std::set<std::string>& client_karts,
-            const std::set<std::string>& client_maps);
+            const AssetBitset& client_karts,
+            const AssetBitset& client_maps);
 
     std::array<int, AS_TOTAL> getAddonScores(
-            const std::set<std::string>& client_karts,
-            const std::set<std::string>& client_maps);
+            const AssetBitset& client_karts,
+            const AssetBitset& client_maps);
 
     std::string getAnyMapForVote();
-    bool checkIfNoCommonMaps(
-            const std::pair<std::set<std::string>, std::set<std::string>>& assets);
+    bool checkIfNoCommonMaps(const AssetBitset& client_maps);
 
     bool isKartAvailable(const std::string& kart) const;
-    float officialKartsFraction(const std::set<std::string>& clientKarts) const;
-    float officialMapsFraction(const std::set<std::string>& clientMaps) const;
+    float officialKartsFraction(const AssetBitset& clientKarts) const;
+    float officialMapsFraction(const AssetBitset& clientMaps) const;
 
     std::string getRandomMap() const;
     std::string getRandomAddonMap() const;
@@ -108,6 +108,8 @@ public:
 
     std::vector<std::string> getMissingAssets(std::shared_ptr<STKPeer> peer) const;
 
+    void updateAssetBits();
+
     float getOfficialKartsPlayThreshold()  const { return m_official_karts_play_threshold;  }
     float getOfficialTracksPlayThreshold() const { return m_official_tracks_play_threshold; }
     int getAddonKartsJoinThreshold()       const { return m_addon_karts_join_threshold;     }
@@ -142,6 +144,17 @@ public:
      *  with data in server first. */
     std::pair<std::set<std::string>, std::set<std::string> > m_entering_kts;
 
+    /** The official, addon and entering karts and maps as bitsets, to
+     *  compare them with the assets of peers. */
+    std::pair<AssetBitset, AssetBitset> m_official_bits;
+    std::pair<AssetBitset, AssetBitset> m_addon_bits;
+    AssetBitset m_addon_arena_bits;
+    AssetBitset m_addon_soccer_bits;
+    std::pair<AssetBitset, AssetBitset> m_entering_bits;
+
+    /** The available maps as a bitset, updated whenever they change. */
+    AssetBitset m_available_map_bits;
+
     std::vector<std::string> m_must_have_karts;
     std::vector<std::string> m_must_have_maps;
 
@@ -22,10 +22,19 @@
 #include "network/network_config.hpp"
 #include "utils/file_utils.hpp"
 #include "utils/tls.hpp"
+#include "utils/vs.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdio>
+#include <cstring>
 #include <ctime>
+#include <memory>
+#include <mutex>
 #include <stdio.h>
+#include <thread>
 
 #ifdef ANDROID
 #  include <android/log.h>
@@ -45,9 +54,430 @@ bool          Log::m_no_colors     = false;
 FILE*         Log::m_file_stdout   = NULL;
 size_t        Log::m_buffer_size = 1;
 bool          Log::m_console_log = true;
+bool          Log::m_json_lines  = false;
 Synchronised<std::vector<struct Log::LineInfo> > Log::m_line_buffer;
 thread_local  char g_prefix[11] = {};
 
+namespace
+{
+// ----------------------------------------------------------------------------
+/** A log line before it is formatted. The strings are not owned. */
+struct LogLine
+{
+    /** Order in which the lines were logged, over all threads. */
+    uint64_t    m_sequence;
+    /** Milliseconds since the epoch. */
+    int64_t     m_time_ms;
+    int         m_level;
+    /** If the time is printed in text lines (only done for servers). */
+    bool        m_server_time;
+    const char* m_prefix;
+    const char* m_component;
+    const char* m_message;
+};   // LogLine
+
+// ----------------------------------------------------------------------------
+/** The fixed size part of a line in a LogQueue. It is followed by the
+ *  prefix, component and message, each terminated by 0. */
+struct LogRecord
+{
+    uint64_t m_sequence;
+    int64_t  m_time_ms;
+    /** Size of the record including the strings. */
+    uint32_t m_size;
+    uint8_t  m_level;
+    uint8_t  m_server_time;
+};   // LogRecord
+
+// ============================================================================
+/** A lock-free queue of log lines in a ring of bytes, with one producer and
+ *  one consumer. Each thread logging while the writer thread is running uses
+ *  its own queue, which is emptied by the writer thread (or by a thread
+ *  calling Log::flushBuffers(), which holds the same lock). Since there is
+ *  no notification when a thread exits, a queue which isn't used for a while
+ *  is released by the writer thread, and can then be taken by another
+ *  thread; its previous owner will take a different one if it logs again.
+ */
+class LogQueue
+{
+public:
+    static const size_t CAPACITY = 64 * 1024;
+
+    /** Added to the ticket of the owner while it adds a line. */
+    static const uint64_t BUSY = uint64_t(1) << 63;
+
+private:
+    char m_data[CAPACITY];
+
+    /** Total number of bytes written, only changed by the producer. */
+    std::atomic<size_t> m_write;
+
+    /** Total number of bytes read, only changed by the consumer. */
+    std::atomic<size_t> m_read;
+
+    /** The ticket of the thread owning this queue, 0 if it is free. */
+    std::atomic<uint64_t> m_owner;
+
+    // ------------------------------------------------------------------------
+    void copyIn(size_t pos, const void* src, size_t size)
+    {
+        pos %= CAPACITY;
+        const size_t first = std::min(size, CAPACITY - pos);
+        memcpy(m_data + pos, src, first);
+        memcpy(m_data, (const char*)src + first, size - first);
+    }   // copyIn
+    // ------------------------------------------------------------------------
+    void copyOut(size_t pos, void* dst, size_t size) const
+    {
+        pos %= CAPACITY;
+        const size_t first = std::min(size, CAPACITY - pos);
+        memcpy(dst, m_data + pos, first);
+        memcpy((char*)dst + first, m_data, size - first);
+    }   // copyOut
+
+public:
+    /** When the consumer last found lines in it. Only used by the
+     *  consumer. */
+    std::chrono::steady_clock::time_point m_last_used;
+
+    LogQueue() : m_write(0), m_read(0), m_owner(0)
+    {
+        m_last_used = std::chrono::steady_clock::now();
+    }   // LogQueue
+    // ------------------------------------------------------------------------
+    /** Takes this queue if it is free, and locks it for adding lines. */
+    bool acquire(uint64_t ticket)
+    {
+        uint64_t expected = 0;
+        return m_owner.compare_exchange_strong(expected, ticket | BUSY,
+                                               std::memory_order_acq_rel);
+    }   // acquire
+    // ------------------------------------------------------------------------
+    /** Locks this queue for adding lines, fails if it has been released
+     *  in the meantime. */
+    bool lock(uint64_t ticket)
+    {
+        uint64_t expected = ticket;
+        return m_owner.compare_exchange_strong(expected, ticket | BUSY,
+                                               std::memory_order_acq_rel);
+    }   // lock
+    // ------------------------------------------------------------------------
+    void unlock(uint64_t ticket)
+    {
+        m_owner.store(ticket, std::memory_order_release);
+    }   // unlock
+    // ------------------------------------------------------------------------
+    /** Frees this queue if its owner isn't adding a line. Only called by the
+     *  consumer. */
+    bool release()
+    {
+        uint64_t owner = m_owner.load(std::memory_order_acquire);
+        if (owner == 0 || (owner & BUSY) != 0)
+            return false;
+        return m_owner.compare_exchange_strong(owner, 0,
+                                               std::memory_order_acq_rel);
+    }   // release
+    // ------------------------------------------------------------------------
+    /** Adds a line. Returns false if there is not enough space left, in
+     *  which case nothing is added. Only called by the producer. */
+    bool push(const LogLine& line)
+    {
+        const size_t prefix_size = strlen(line.m_prefix) + 1;
+        const size_t component_size = strlen(line.m_component) + 1;
+        const size_t message_size = strlen(line.m_message) + 1;
+        LogRecord record;
+        record.m_sequence = line.m_sequence;
+        record.m_time_ms = line.m_time_ms;
+        record.m_size = (uint32_t)(sizeof(LogRecord) + prefix_size +
+            component_size + message_size);
+        record.m_level = (uint8_t)line.m_level;
+        record.m_server_time = line.m_server_time ? 1 : 0;
+
+        const size_t write = m_write.load(std::memory_order_relaxed);
+        const size_t used = write - m_read.load(std::memory_order_acquire);
+        if (record.m_size > CAPACITY - used)
+            return false;
+        size_t pos = write;
+        copyIn(pos, &record, sizeof(LogRecord));
+        pos += sizeof(LogRecord);
+        copyIn(pos, line.m_prefix, prefix_size);
+        pos += prefix_size;
+        copyIn(pos, line.m_component, component_size);
+        pos += component_size;
+        copyIn(pos, line.m_message, message_size);
+        m_write.store(write + record.m_size, std::memory_order_release);
+        return true;
+    }   // push
+    // ------------------------------------------------------------------------
+    /** Moves all records to the end of a buffer. Only called by the
+     *  consumer. Returns if there was any record. */
+    bool popAll(std::vector<char>* buffer)
+    {
+        const size_t read = m_read.load(std::memory_order_relaxed);
+        const size_t write = m_write.load(std::memory_order_acquire);
+        if (read == write)
+            return false;
+        const size_t old_size = buffer->size();
+        buffer->resize(old_size + write - read);
+        copyOut(read, buffer->data() + old_size, write - read);
+        m_read.store(write, std::memory_order_release);
+        return true;
+    }   // popAll
+    // ------------------------------------------------------------------------
+    bool empty() const
+    {
+        return m_read.load(std::memory_order_acquire) ==
+               m_write.load(std::memory_order_acquire);
+    }   // empty
+};   // LogQueue
+
+// ----------------------------------------------------------------------------
+/** Converts the records written by LogQueue::popAll() to lines, which point
+ *  into the buffer. */
+void parseRecords(const std::vector<char>& buffer, std::vector<LogLine>* lines)
+{
+    size_t pos = 0;
+    while (pos < buffer.size())
+    {
+        LogRecord record;
+        memcpy(&record, buffer.data() + pos, sizeof(LogRecord));
+        LogLine line;
+        line.m_sequence = record.m_sequence;
+        line.m_time_ms = record.m_time_ms;
+        line.m_level = record.m_level;
+        line.m_server_time = record.m_server_time != 0;
+        const char* text = buffer.data() + pos + sizeof(LogRecord);
+        line.m_prefix = text;
+        text += strlen(text) + 1;
+        line.m_component = text;
+        text += strlen(text) + 1;
+        line.m_message = text;
+        lines->push_back(line);
+        pos += record.m_size;
+    }
+}   // parseRecords
+
+// ============================================================================
+/** The state of the writer thread. It is allocated once and never freed, so
+ *  that lines can still be logged while static objects are destroyed.
+ */
+struct LogWriter
+{
+    /** All queues, they are reused instead of being freed. */
+    std::mutex m_queues_mutex;
+    std::vector<std::unique_ptr<LogQueue> > m_queues;
+
+    /** Only one thread at a time empties the queues and writes lines. It
+     *  also protects the log file being replaced. */
+    std::mutex m_drain_mutex;
+    std::vector<char> m_buffer;
+    std::vector<LogLine> m_lines;
+    std::string m_output;
+
+    std::mutex m_wait_mutex;
+    std::condition_variable m_wait;
+    bool m_stop;
+
+    std::atomic<bool> m_running;
+    std::atomic<uint64_t> m_sequence;
+    std::atomic<uint64_t> m_next_ticket;
+    std::thread m_thread;
+
+    LogWriter() : m_stop(false), m_running(false), m_sequence(0),
+                  m_next_ticket(1)
+    {
+    }   // LogWriter
+};   // LogWriter
+
+// ----------------------------------------------------------------------------
+LogWriter& getWriter()
+{
+    static LogWriter* writer = new LogWriter();
+    return *writer;
+}   // getWriter
+
+/** The queue used by this thread and the ticket identifying this thread as
+ *  its owner. */
+thread_local LogQueue* g_queue  = NULL;
+thread_local uint64_t  g_ticket = 0;
+
+// ----------------------------------------------------------------------------
+/** Returns the queue of the calling thread locked for adding lines. If the
+ *  thread has no queue (anymore), a free one is taken or a new one created.
+ */
+LogQueue* lockQueue()
+{
+    LogWriter& writer = getWriter();
+    if (g_ticket == 0)
+        g_ticket = writer.m_next_ticket.fetch_add(1);
+    if (g_queue && g_queue->lock(g_ticket))
+        return g_queue;
+
+    std::lock_guard<std::mutex> lock(writer.m_queues_mutex);
+    for (std::unique_ptr<LogQueue>& queue : writer.m_queues)
+    {
+        if (queue->acquire(g_ticket))
+        {
+            g_queue = queue.get();
+            return g_queue;
+        }
+    }
+    writer.m_queues.emplace_back(new LogQueue());
+    g_queue = writer.m_queues.back().get();
+    g_queue->acquire(g_ticket);
+    return g_queue;
+}   // lockQueue
+
+// ============================================================================
+/** Formats the time of log lines. The conversion to the calendar time is
+ *  only done when the second changes, so most lines just copy the cached
+ *  strings. It has no constructor, since it is a thread local variable,
+ *  which is zero-initialised.
+ */
+class LogTimeFormatter
+{
+private:
+    bool    m_valid;
+
+    int64_t m_second;
+
+    /** The local time as used in text lines. */
+    char m_text[64];
+
+    /** The UTC time in ISO 8601 format (without milliseconds) as used in
+     *  JSON lines. */
+    char m_iso[32];
+
+    // ------------------------------------------------------------------------
+    void update(int64_t time_ms)
+    {
+        const int64_t second = time_ms / 1000;
+        if (m_valid && second == m_second)
+            return;
+        m_valid = true;
+        m_second = second;
+        const time_t t = (time_t)second;
+        std::tm local_tm = {};
+        std::tm utc_tm = {};
+#ifdef WIN_BUILD
+        localtime_s(&local_tm, &t);
+        gmtime_s(&utc_tm, &t);
+#else
+        localtime_r(&t, &local_tm);
+        gmtime_r(&t, &utc_tm);
+#endif
+        if (strftime(m_text, sizeof(m_text), "%a %b %d %H:%M:%S %Y",
+            &local_tm) == 0)
+            m_text[0] = 0;
+        if (strftime(m_iso, sizeof(m_iso), "%Y-%m-%dT%H:%M:%S", &utc_tm) == 0)
+            m_iso[0] = 0;
+    }   // update
+
+public:
+    void appendText(int64_t time_ms, std::string* out)
+    {
+        update(time_ms);
+        out->append(m_text);
+    }   // appendText
+    // ------------------------------------------------------------------------
+    void appendIso(int64_t time_ms, std::string* out)
+    {
+        update(time_ms);
+        char ms[8];
+        snprintf(ms, sizeof(ms), ".%03dZ", (int)(time_ms % 1000));
+        out->append(m_iso);
+        out->append(ms);
+    }   // appendIso
+};   // LogTimeFormatter
+
+thread_local LogTimeFormatter g_time_formatter;
+
+// ----------------------------------------------------------------------------
+/** Appends a string as JSON string, i.e. quoted and escaped. */
+void appendJsonString(const char* s, size_t length, std::string* out)
+{
+    out->push_back('"');
+    for (size_t i = 0; i < length; i++)
+    {
+        const unsigned char c = s[i];
+        switch (c)
+        {
+        case '"':  out->append("\\\"");  break;
+        case '\\': out->append("\\\\"); break;
+        case '\n': out->append("\\n");   break;
+        case '\r': out->append("\\r");   break;
+        case '\t': out->append("\\t");   break;
+        default:
+            if (c < 0x20)
+            {
+                char escaped[8];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                out->append(escaped);
+            }
+            else
+                out->push_back(c);
+        }
+    }
+    out->push_back('"');
+}   // appendJsonString
+
+// ----------------------------------------------------------------------------
+/** Appends a formatted line (including the final new line) to a string.
+ *  \param json True to format the line as JSON object, otherwise the line
+ *         is formatted as text.
+ */
+void formatLine(const LogLine& line, bool json, std::string* out)
+{
+    if (json)
+    {
+        static const char *json_names[] = { "debug", "verbose", "info",
+                                            "warn", "error", "fatal" };
+        out->append("{\"time\":\"");
+        g_time_formatter.appendIso(line.m_time_ms, out);
+        out->append("\",\"level\":\"");
+        out->append(json_names[line.m_level]);
+        out->append("\",\"component\":");
+        appendJsonString(line.m_component, strlen(line.m_component), out);
+        out->append(",\"prefix\":");
+        appendJsonString(line.m_prefix, strlen(line.m_prefix), out);
+        out->append(",\"message\":");
+        // Some messages end with a new line, which isn't needed in JSON
+        size_t length = strlen(line.m_message);
+        while (length > 0 && line.m_message[length - 1] == '\n')
+            length--;
+        appendJsonString(line.m_message, length, out);
+        out->append("}\n");
+        return;
+    }
+
+    static const char *names[] = { "debug", "verbose  ", "info   ",
+                                  "warn   ", "error  ", "fatal  " };
+    if (line.m_prefix[0] != 0)
+    {
+        out->append(line.m_prefix);
+        out->push_back(' ');
+    }
+    if (line.m_server_time)
+    {
+#ifdef MOBILE_STK
+        // Mobile STK already has timestamp logging in console
+        out->append("Server");
+#else
+        g_time_formatter.appendText(line.m_time_ms, out);
+#endif
+        out->push_back(' ');
+    }
+    out->push_back('[');
+    out->append(names[line.m_level]);
+    out->append("] ");
+    out->append(line.m_component);
+    out->append(": ");
+    out->append(line.m_message);
+    out->push_back('\n');
+}   // formatLine
+
+}   // namespace
+
 // ----------------------------------------------------------------------------
 void Log::setPrefix(const char* prefix)
 {
@@ -144,9 +574,11 @@ void Log::resetTerminalColor()
 }   // resetTerminalColor
 
 // ----------------------------------------------------------------------------
-/** This actually creates a log message. If the messages are to be buffered,
- *  it will be appended to the output buffer. If the buffer is full, it will
- *  be flushed. If the message is not to be buffered, it will be immediately
+/** This actually creates a log message. If the writer thread is running,
+ *  the message is added to the queue of this thread and written later by
+ *  the writer thread. Otherwise, if the messages are to be buffered, it will
+ *  be appended to the output buffer. If the buffer is full, it will be
+ *  flushed. If the message is not to be buffered, it will be immediately
  *  written using writeLine().
 
  *  \param level Log level of the message to print.
@@ -160,49 +592,62 @@ void Log::printMessage(int level, const char *component, const char *format,
 
     if (level < m_min_log_level) return;
 
-    static const char *names[] = { "debug", "verbose  ", "info   ",
-                                  "warn   ", "error  ", "fatal  " };
     const int MAX_LENGTH = 4096;
-    char line[MAX_LENGTH + 1];
-    int index = 0;
-    int remaining = MAX_LENGTH;
-
-    if (strlen(g_prefix) != 0)
+    char message[MAX_LENGTH];
+    if (vsnprintf(message, MAX_LENGTH, format, args) < 0)
+        message[0] = 0;
+
+    LogLine line;
+    line.m_sequence = 0;
+    line.m_time_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    line.m_level = level;
+    line.m_server_time = NetworkConfig::get()->isNetworking() &&
+                         NetworkConfig::get()->isServer();
+    line.m_prefix = g_prefix;
+    line.m_component = component;
+    line.m_message = message;
+
+    LogWriter& writer = getWriter();
+    if (writer.m_running.load(std::memory_order_acquire))
     {
-        index += snprintf(line+index, remaining, "%s ", g_prefix);
-        remaining = MAX_LENGTH - index > 0 ? MAX_LENGTH - index : 0;
-    }
-
-#ifdef MOBILE_STK
-    // Mobile STK already has timestamp logging in console
-    std::string server_prefix = "Server";
-#else
-    std::string server_prefix = StkTime::getLogTime();
-#endif
-    if (NetworkConfig::get()->isNetworking() &&
-        NetworkConfig::get()->isServer())
-    {
-        index += snprintf (line + index, remaining,
-            "%s [%s] %s: ", server_prefix.c_str(),
-            names[level], component);
-    }
-    else
-    {
-        index += snprintf (line + index, remaining,
-            "[%s] %s: ", names[level], component);
+        line.m_sequence =
+            writer.m_sequence.fetch_add(1, std::memory_order_relaxed);
+        LogQueue* queue = lockQueue();
+        bool queued = true;
+        while (!queue->push(line))
+        {
+            // Wait for the writer thread instead of dropping lines. A line
+            // which doesn't even fit into an empty queue is written directly.
+            if (queue->empty() ||
+                !writer.m_running.load(std::memory_order_acquire))
+            {
+                queued = false;
+                break;
+            }
+            writer.m_wait.notify_one();
+            std::this_thread::yield();
+        }
+        queue->unlock(g_ticket);
+        if (queued)
+        {
+            // Write more important messages as soon as possible, and make
+            // sure a fatal message is written before exiting.
+            if (level == LL_FATAL)
+                flushBuffers();
+            else if (level >= LL_WARN)
+                writer.m_wait.notify_one();
+            return;
+        }
     }
-    remaining = MAX_LENGTH - index > 0 ? MAX_LENGTH - index : 0;
-    index += vsnprintf(line + index, remaining, format, args);
-    remaining = MAX_LENGTH - index > 0 ? MAX_LENGTH - index : 0;
-    va_end(args);
 
-    index = index > MAX_LENGTH - 1 ? MAX_LENGTH - 1 : index;
-    sprintf(line + index, "\n");
+    std::string text;
+    formatLine(line, m_json_lines, &text);
 
     // If the data is not buffered, immediately print it:
     if (m_buffer_size <= 1)
     {
-        writeLine(line, level);
+        writeLine(text.c_str(), level);
         return;
     }
 
@@ -210,7 +655,7 @@ void Log::printMessage(int level, const char *component, const char *format,
     // and if necessary flush the buffers.
     struct LineInfo li;
     li.m_level = level;
-    li.m_line  = std::string(line);
+    li.m_line  = std::move(text);
     m_line_buffer.lock();
     m_line_buffer.getData().push_back(li);
     if (m_line_buffer.getData().size() < m_buffer_size)
@@ -234,8 +679,10 @@ void Log::printMessage(int level, const char *component, const char *format,
  *  select a terminal colour.
  *  \param line The line to write.
  *  \param level Message level. Only used to select terminal colour.
+ *  \param flush If the output is flushed after the line. When writing
+ *         several lines, flushOutput() is called once after the last one.
  */
-void Log::writeLine(const char *line, int level)
+void Log::writeLine(const char *line, int level, bool flush)
 {
 
     // If we don't have a console file, write to stdout and hope for the best
@@ -266,7 +713,8 @@ void Log::writeLine(const char *line, int level)
             CIrrDeviceiOS::debugPrint(line);
 #else
             printf("%s", line);
-            fflush(stdout);
+            if (flush)
+                fflush(stdout);
 #endif
         }
         resetTerminalColor();  // this prints a \n
@@ -278,7 +726,12 @@ void Log::writeLine(const char *line, int level)
     if (m_buffer_size <= 1) OutputDebugStringA(line);
 #endif
 
-    if (m_file_stdout) fprintf(m_file_stdout, "%s", line);
+    if (m_file_stdout)
+    {
+        fprintf(m_file_stdout, "%s", line);
+        if (flush)
+            fflush(m_file_stdout);
+    }
 
 #ifdef WIN32
     if (level >= LL_FATAL)
@@ -286,7 +739,18 @@ void Log::writeLine(const char *line, int level)
         MessageBoxA(NULL, line, "SuperTuxKart - Fatal error", MB_OK);
     }
 #endif
-}   // _fluhBuffers
+}   // writeLine
+
+// ----------------------------------------------------------------------------
+/** Flushes the console and the log file after writeLine() was called without
+ *  flushing. */
+void Log::flushOutput()
+{
+    if (m_console_log)
+        fflush(stdout);
+    if (m_file_stdout)
+        fflush(m_file_stdout);
+}   // flushOutput
 
 // ----------------------------------------------------------------------------
 void Log::toggleConsoleLog(bool val)
@@ -294,19 +758,140 @@ void Log::toggleConsoleLog(bool val)
     m_console_log = val;
 }   // toggleConsoleLog
 
+// ----------------------------------------------------------------------------
+/** Empties the queues of all threads, and writes their lines in the order
+ *  in which they were logged. The output is only flushed once for all
+ *  lines. Called by the writer thread, and by flushBuffers() so that no
+ *  line is lost before exiting.
+ */
+void Log::drainQueues()
+{
+    LogWriter& writer = getWriter();
+    std::lock_guard<std::mutex> drain_lock(writer.m_drain_mutex);
+    writer.m_buffer.clear();
+    {
+        const auto now = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(writer.m_queues_mutex);
+        for (std::unique_ptr<LogQueue>& queue : writer.m_queues)
+        {
+            if (queue->popAll(&writer.m_buffer))
+                queue->m_last_used = now;
+            else if (now - queue->m_last_used > std::chrono::seconds(10))
+            {
+                // Its thread might have exited, so make it available to
+                // other threads
+                queue->release();
+            }
+        }
+    }
+    if (writer.m_buffer.empty())
+        return;
+
+    writer.m_lines.clear();
+    parseRecords(writer.m_buffer, &writer.m_lines);
+    std::sort(writer.m_lines.begin(), writer.m_lines.end(),
+        [](const LogLine& a, const LogLine& b)
+        {
+            return a.m_sequence < b.m_sequence;
+        });
+    for (const LogLine& line : writer.m_lines)
+    {
+        writer.m_output.clear();
+        formatLine(line, m_json_lines, &writer.m_output);
+        writeLine(writer.m_output.c_str(), line.m_level, /*flush*/false);
+    }
+    flushOutput();
+}   // drainQueues
+
+// ----------------------------------------------------------------------------
+/** The main loop of the writer thread. It writes the queued lines in
+ *  batches, either every few milliseconds or when woken up because of an
+ *  important message or a full queue.
+ */
+void Log::writerThread()
+{
+    VS::setThreadName("LogWriter");
+    LogWriter& writer = getWriter();
+    while (true)
+    {
+        bool stop;
+        {
+            std::unique_lock<std::mutex> lock(writer.m_wait_mutex);
+            if (!writer.m_stop)
+                writer.m_wait.wait_for(lock, std::chrono::milliseconds(10));
+            stop = writer.m_stop;
+        }
+        drainQueues();
+        if (stop)
+            break;
+    }
+}   // writerThread
+
+// ----------------------------------------------------------------------------
+/** Starts the writer thread. From then on, threads only add their lines to
+ *  a lock-free queue, and formatting and writing them is done by the writer
+ *  thread, so a slow terminal or disk doesn't delay the logging threads.
+ *  The thread is stopped automatically when exiting.
+ */
+void Log::startWriterThread()
+{
+    LogWriter& writer = getWriter();
+    if (writer.m_running.load())
+        return;
+    writer.m_stop = false;
+    writer.m_thread = std::thread(&Log::writerThread);
+    writer.m_running.store(true, std::memory_order_release);
+
+    static bool stop_at_exit = false;
+    if (!stop_at_exit)
+    {
+        // Also covers exit() being called e.g. after a fatal error or a
+        // crash, so the queued lines are written before the program ends.
+        std::atexit(&Log::stopWriterThread);
+        stop_at_exit = true;
+    }
+}   // startWriterThread
+
+// ----------------------------------------------------------------------------
+/** Stops the writer thread after all queued lines are written. Lines logged
+ *  afterwards are written directly again.
+ */
+void Log::stopWriterThread()
+{
+    LogWriter& writer = getWriter();
+    if (!writer.m_running.exchange(false))
+        return;
+    {
+        std::lock_guard<std::mutex> lock(writer.m_wait_mutex);
+        writer.m_stop = true;
+    }
+    writer.m_wait.notify_one();
+    if (writer.m_thread.get_id() == std::this_thread::get_id())
+    {
+        // exit() was called from the writer thread itself
+        writer.m_thread.detach();
+        return;
+    }
+    writer.m_thread.join();
+    // Write lines of threads which added them while the thread was stopped
+    drainQueues();
+}   // stopWriterThread
+
 // ----------------------------------------------------------------------------
 /** Flushes all stored log messages to the various output devices (thread safe).
  */
 void Log::flushBuffers()
 {
+    drainQueues();
     m_line_buffer.lock();
     for (unsigned int i = 0; i < m_line_buffer.getData().size(); i++)
     {
         const LineInfo &li = m_line_buffer.getData()[i];
-        writeLine(li.m_line.c_str(), li.m_level);
+        writeLine(li.m_line.c_str(), li.m_level, /*flush*/false);
     }
     m_line_buffer.getData().clear();
     m_line_buffer.unlock();
+    flushOutput();
 }   // flushBuffers
 
 // ----------------------------------------------------------------------------
@@ -316,16 +901,19 @@ void Log::flushBuffers()
  */
 void Log::openOutputFiles(const std::string &logout)
 {
-    m_file_stdout = FileUtils::fopenU8Path(logout, "w");
-    if (!m_file_stdout)
+    FILE* file = FileUtils::fopenU8Path(logout, "w");
+    if (!file)
     {
         Log::error("main", "Can not open log file '%s'. Writing to "
                            "stdout instead.", logout.c_str());
     }
     else
     {
-        // Disable buffering so that messages are seen asap
-        setvbuf(m_file_stdout, NULL, _IONBF, 0);
+        // Lines are either written in batches by the writer thread, or
+        // flushed after each line, so the file can be fully buffered.
+        setvbuf(file, NULL, _IOFBF, 64 * 1024);
+        std::lock_guard<std::mutex> lock(getWriter().m_drain_mutex);
+        m_file_stdout = file;
     }
 } // closeOutputFiles
 
@@ -333,6 +921,70 @@ void Log::openOutputFiles(const std::string &logout)
 /** Function to close output files */
 void Log::closeOutputFiles()
 {
-    fclose(m_file_stdout);
+    stopWriterThread();
+    flushBuffers();
+    if (m_file_stdout)
+        fclose(m_file_stdout);
+    m_file_stdout = NULL;
 } // closeOutputFiles
 
+// ----------------------------------------------------------------------------
+void Log::unitTesting()
+{
+    // The lines of a queue are kept in order when they wrap around the end
+    // of its ring, and nothing is added if a line doesn't fit.
+    std::unique_ptr<LogQueue> queue(new LogQueue());
+    const std::string message(1000, 'x');
+    LogLine line = {};
+    line.m_level = LL_INFO;
+    line.m_prefix = "";
+    line.m_component = "Log";
+    line.m_message = message.c_str();
+    std::vector<char> buffer;
+    std::vector<LogLine> lines;
+    // A queue can only be acquired when free, locked by its owner, and
+    // released when not locked.
+    bool ok = queue->acquire(1);
+    assert(ok);
+    ok = queue->acquire(2) || queue->release();
+    assert(!ok);
+    queue->unlock(1);
+    ok = !queue->lock(2) && queue->lock(1);
+    assert(ok);
+    queue->unlock(1);
+    ok = queue->release() && !queue->lock(1);
+    assert(ok);
+    for (unsigned i = 0; i < 200; i++)
+    {
+        line.m_sequence = i;
+        if (queue->push(line))
+            continue;
+        assert(!queue->empty());
+        buffer.clear();
+        lines.clear();
+        queue->popAll(&buffer);
+        assert(queue->empty());
+        parseRecords(buffer, &lines);
+        assert(!lines.empty() && lines.back().m_sequence == i - 1);
+        assert(strcmp(lines.back().m_component, "Log") == 0);
+        assert(lines.back().m_message == message);
+        ok = queue->push(line);
+        assert(ok);
+    }
+
+    // JSON lines escape the strings and drop the final new line of messages
+    line.m_time_ms = 1234;
+    line.m_level = LL_WARN;
+    line.m_prefix = "c1";
+    line.m_component = "A\"B";
+    line.m_message = "x\\y\tz\n";
+    std::string out;
+    formatLine(line, /*json*/true, &out);
+    assert(out == "{\"time\":\"1970-01-01T00:00:01.234Z\",\"level\":\"warn\","
+        "\"component\":\"A\\\"B\",\"prefix\":\"c1\","
+        "\"message\":\"x\\\\y\\tz\"}\n");
+    out.clear();
+    formatLine(line, /*json*/false, &out);
+    assert(out == "c1 [warn   ] A\"B: x\\y\tz\n\n");
+    (void)ok;
+}   // unitTesting
@@ -63,6 +63,10 @@ private:
     /** If false that logging will only be saved to a file. */
     static bool     m_console_log;
 
+    /** If set, each line is written as a JSON object (JSON lines) instead
+     *  of plain text, so that it can be parsed by log collectors. */
+    static bool     m_json_lines;
+
     /** The file where stdout output will be written */
     static FILE* m_file_stdout;
 
@@ -80,10 +84,13 @@ private:
 
     static void setTerminalColor(LogLevel level);
     static void resetTerminalColor();
-    static void writeLine(const char *line, int level);
+    static void writeLine(const char *line, int level, bool flush = true);
+    static void flushOutput();
 
     static void printMessage(int level, const char *component,
                              const char *format, VALIST va_list);
+    static void writerThread();
+    static void drainQueues();
 
 public:
 
@@ -118,6 +125,9 @@ public:
     static void closeOutputFiles();
     static void flushBuffers();
     static void toggleConsoleLog(bool val);
+    static void startWriterThread();
+    static void stopWriterThread();
+    static void unitTesting();
 
     // ------------------------------------------------------------------------
     /** Sets the number of lines to buffer. Setting the buffer size to a 
@@ -148,6 +158,16 @@ public:
         m_no_colors = true;
     }   // disableColor
     // ------------------------------------------------------------------------
+    /** Writes each line as a JSON object with the fields time, level,
+     *  component, prefix and message. This disables coloring, since escape
+     *  codes would break the JSON objects in the console output. */
+    static void setJsonLines(bool json)
+    {
+        m_json_lines = json;
+        if (json)
+            m_no_colors = true;
+    }   // setJsonLines
+    // ------------------------------------------------------------------------
     /** Sets a prefix to be printed before each line. To disable the prefix,
      *  set it to "", max length of prefix is 10, if larger than that the
      *  remaining characters are ignored. */
@@ -0,0 +1,131 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2026 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "utils/loop_stats.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+
+// ----------------------------------------------------------------------------
+void LatencyHistogram::reset()
+{
+    for (unsigned i = 0; i < NUM_BUCKETS; i++)
+        m_buckets[i].store(0);
+    m_count.store(0);
+    m_total.store(0);
+    m_max.store(0);
+}   // reset
+
+// ----------------------------------------------------------------------------
+/** Adds a duration.
+ *  \param us The duration in microseconds.
+ */
+void LatencyHistogram::add(uint64_t us)
+{
+    unsigned bucket = 0;
+    while (bucket < NUM_BUCKETS - 1 && (us >> bucket) > 1)
+        bucket++;
+    m_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+    m_total.fetch_add(us, std::memory_order_relaxed);
+    uint64_t max = m_max.load(std::memory_order_relaxed);
+    while (us > max &&
+        !m_max.compare_exchange_weak(max, us, std::memory_order_relaxed));
+}   // add
+
+// ----------------------------------------------------------------------------
+/** Returns an upper bound of a percentile, i.e. the end of the bucket
+ *  containing it (but at most the maximum value added).
+ *  \param percent The percentile, between 0 and 100.
+ */
+uint64_t LatencyHistogram::getPercentile(float percent) const
+{
+    const uint64_t count = m_count.load();
+    if (count == 0)
+        return 0;
+    uint64_t rank = (uint64_t)(percent * 0.01f * (float)count + 0.5f);
+    if (rank < 1)
+        rank = 1;
+    uint64_t seen = 0;
+    for (unsigned i = 0; i < NUM_BUCKETS - 1; i++)
+    {
+        seen += m_buckets[i].load();
+        if (seen >= rank)
+            return std::min((uint64_t)2 << i, m_max.load());
+    }
+    return m_max.load();
+}   // getPercentile
+
+// ----------------------------------------------------------------------------
+std::string LatencyHistogram::toString() const
+{
+    const uint64_t count = m_count.load();
+    if (count == 0)
+        return "no samples";
+    char buffer[256];
+    snprintf(buffer, sizeof(buffer), "%lu samples, mean %.3fms, p50 %.3fms, "
+        "p90 %.3fms, p99 %.3fms, max %.3fms, buckets:", (unsigned long)count,
+        (float)m_total.load() / (float)count / 1000.0f,
+        getPercentile(50) / 1000.0f, getPercentile(90) / 1000.0f,
+        getPercentile(99) / 1000.0f, m_max.load() / 1000.0f);
+    std::string result = buffer;
+    for (unsigned i = 0; i < NUM_BUCKETS; i++)
+    {
+        const uint64_t n = m_buckets[i].load();
+        if (n == 0)
+            continue;
+        if (i == NUM_BUCKETS - 1)
+            snprintf(buffer, sizeof(buffer), " more:%lu", (unsigned long)n);
+        else
+        {
+            snprintf(buffer, sizeof(buffer), " <%luus:%lu",
+                (unsigned long)(2 << i), (unsigned long)n);
+        }
+        result += buffer;
+    }
+    return result;
+}   // toString
+
+// ----------------------------------------------------------------------------
+void LatencyHistogram::unitTesting()
+{
+    LatencyHistogram h;
+    assert(h.getCount() == 0);
+    assert(h.getPercentile(50) == 0);
+    // 0 and 1 us are in the first bucket (< 2us)
+    h.add(0);
+    h.add(1);
+    assert(h.m_buckets[0].load() == 2);
+    // 2 and 3 us in the second one
+    h.add(2);
+    h.add(3);
+    assert(h.m_buckets[1].load() == 2);
+    for (unsigned i = 0; i < 96; i++)
+        h.add(1000);
+    assert(h.getCount() == 100);
+    assert(h.getMax() == 1000);
+    assert(h.getPercentile(1) == 2);
+    assert(h.getPercentile(50) == 1000);
+    assert(h.getPercentile(99) == 1000);
+    h.add(uint64_t(1) << 40);
+    assert(h.m_buckets[NUM_BUCKETS - 1].load() == 1);
+    assert(h.getPercentile(100) == uint64_t(1) << 40);
+    h.reset();
+    assert(h.getCount() == 0 && h.getMax() == 0);
+}   // unitTesting
@@ -0,0 +1,110 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2026 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_LOOP_STATS_HPP
+#define HEADER_LOOP_STATS_HPP
+
+#include "utils/no_copy.hpp"
+#include "utils/types.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+
+/** A histogram of durations in microseconds, with one bucket per power of
+ *  two. Values can be added by any thread without locking, so it can be
+ *  used to measure latencies between threads.
+ */
+class LatencyHistogram : public NoCopy
+{
+public:
+    /** The last bucket contains all values of 2^(NUM_BUCKETS - 1) us and
+     *  more, i.e. more than 8 seconds. */
+    static const unsigned NUM_BUCKETS = 24;
+
+private:
+    std::atomic<uint64_t> m_buckets[NUM_BUCKETS];
+
+    std::atomic<uint64_t> m_count;
+
+    std::atomic<uint64_t> m_total;
+
+    std::atomic<uint64_t> m_max;
+
+public:
+    LatencyHistogram()                                           { reset(); }
+    void reset();
+    void add(uint64_t us);
+    uint64_t getPercentile(float percent) const;
+    std::string toString() const;
+    // ------------------------------------------------------------------------
+    /** Adds the time elapsed since a time point. */
+    void addSince(const std::chrono::steady_clock::time_point& start)
+    {
+        auto duration = std::chrono::steady_clock::now() - start;
+        add(std::chrono::duration_cast<std::chrono::microseconds>(duration)
+            .count());
+    }   // addSince
+    // ------------------------------------------------------------------------
+    uint64_t getCount() const                     { return m_count.load(); }
+    // ------------------------------------------------------------------------
+    uint64_t getMax() const                         { return m_max.load(); }
+    // ------------------------------------------------------------------------
+    static void unitTesting();
+};   // LatencyHistogram
+
+// ============================================================================
+/** Measures how much of the time a loop spends waiting, i.e. how idle the
+ *  thread running it is. Only used by the thread of the loop.
+ */
+class IdleMeter : public NoCopy
+{
+private:
+    std::chrono::steady_clock::time_point m_start;
+
+    std::chrono::steady_clock::duration m_idle;
+
+public:
+    IdleMeter()                                                  { reset(); }
+    // ------------------------------------------------------------------------
+    void reset()
+    {
+        m_start = std::chrono::steady_clock::now();
+        m_idle = std::chrono::steady_clock::duration::zero();
+    }   // reset
+    // ------------------------------------------------------------------------
+    /** Adds the time waited since a time point. */
+    void addIdleSince(const std::chrono::steady_clock::time_point& start)
+    {
+        m_idle += std::chrono::steady_clock::now() - start;
+    }   // addIdleSince
+    // ------------------------------------------------------------------------
+    /** Returns if any waiting was measured since reset(). */
+    bool hasWaited() const                  { return m_idle.count() > 0; }
+    // ------------------------------------------------------------------------
+    /** Returns the percentage of time spent waiting since reset(). */
+    float getIdlePercentage() const
+    {
+        auto total = std::chrono::steady_clock::now() - m_start;
+        if (total.count() <= 0)
+            return 100.0f;
+        return 100.0f * (float)m_idle.count() / (float)total.count();
+    }   // getIdlePercentage
+};   // IdleMeter
+
+#endif
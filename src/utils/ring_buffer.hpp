@@ -0,0 +1,106 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2026 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_RING_BUFFER_HPP
+#define HEADER_RING_BUFFER_HPP
+
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+/** A FIFO queue in a fixed array, which doesn't allocate memory when adding
+ *  or removing elements. If it is full, the capacity is doubled, so no
+ *  element is ever lost, and it is never reduced again. Not thread safe, use
+ *  it with Synchronised or another lock.
+ */
+template<typename TYPE>
+class RingBuffer
+{
+private:
+    std::vector<TYPE> m_data;
+
+    /** Index of the first element. */
+    size_t m_head;
+
+    /** Number of elements. */
+    size_t m_size;
+
+    // ------------------------------------------------------------------------
+    void grow()
+    {
+        std::vector<TYPE> data(m_data.empty() ? 16 : m_data.size() * 2);
+        for (size_t i = 0; i < m_size; i++)
+            data[i] = m_data[(m_head + i) % m_data.size()];
+        m_data.swap(data);
+        m_head = 0;
+    }   // grow
+
+public:
+    // ------------------------------------------------------------------------
+    RingBuffer(size_t capacity = 64) : m_data(capacity), m_head(0), m_size(0)
+    {
+    }   // RingBuffer
+    // ------------------------------------------------------------------------
+    void push_back(const TYPE& v)
+    {
+        if (m_size == m_data.size())
+            grow();
+        m_data[(m_head + m_size) % m_data.size()] = v;
+        m_size++;
+    }   // push_back
+    // ------------------------------------------------------------------------
+    TYPE& front()
+    {
+        assert(m_size > 0);
+        return m_data[m_head];
+    }   // front
+    // ------------------------------------------------------------------------
+    void pop_front()
+    {
+        assert(m_size > 0);
+        m_data[m_head] = TYPE();
+        m_head = (m_head + 1) % m_data.size();
+        m_size--;
+    }   // pop_front
+    // ------------------------------------------------------------------------
+    /** Returns the i-th element, 0 being the front. */
+    TYPE& operator[](size_t i)
+    {
+        assert(i < m_size);
+        return m_data[(m_head + i) % m_data.size()];
+    }   // operator[]
+    // ------------------------------------------------------------------------
+    /** Removes the last elements, so that only the first n are kept. */
+    void resize(size_t n)
+    {
+        assert(n <= m_size);
+        for (size_t i = n; i < m_size; i++)
+            m_data[(m_head + i) % m_data.size()] = TYPE();
+        m_size = n;
+    }   // resize
+    // ------------------------------------------------------------------------
+    void clear()                                            { resize(0); }
+    // ------------------------------------------------------------------------
+    bool empty() const                                { return m_size == 0; }
+    // ------------------------------------------------------------------------
+    size_t size() const                                     { return m_size; }
+    // ------------------------------------------------------------------------
+    size_t capacity() const                        { return m_data.size(); }
+};   // RingBuffer
+
+#endif
@@ -17,12 +17,68 @@
 //  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "utils/set_typo_fixer.hpp"
+
+#include "karts/kart_properties.hpp"
+#include "karts/kart_properties_manager.hpp"
+#include "tracks/track_manager.hpp"
+#include "utils/log.hpp"
 #include "utils/string_utils.hpp"
 
+#include <cassert>
+#include <cctype>
+#include <chrono>
+
+namespace
+{
+    const char g_any_substr = '*';
+    const char g_any_char = '?';
+
+    // Same as StringUtils::getEditDistance for strings without wildcards,
+    // but with two rows instead of a full matrix.
+    int getDistance(const std::string& a, const std::string& b)
+    {
+        const int n = a.length();
+        const int m = b.length();
+        std::vector<int> prev(m + 1), cur(m + 1);
+        for (int j = 0; j <= m; ++j)
+            prev[j] = j;
+        for (int i = 0; i < n; ++i)
+        {
+            cur[0] = i + 1;
+            for (int j = 0; j < m; ++j)
+            {
+                cur[j + 1] = std::min(std::min(prev[j + 1], cur[j]) + 1,
+                    prev[j] + (a[i] == b[j] ? 0 : 1));
+            }
+            std::swap(prev, cur);
+        }
+        return prev[m];
+    }   // getDistance
+    //-------------------------------------------------------------------------
+
+    std::string toUpper(const std::string& s)
+    {
+        std::string result = s;
+        for (char& c: result)
+            c = toupper(c);
+        return result;
+    }   // toUpper
+    //-------------------------------------------------------------------------
+
+    bool hasWildcards(const std::string& s)
+    {
+        return s.find(g_any_substr) != std::string::npos ||
+            s.find(g_any_char) != std::string::npos;
+    }   // hasWildcards
+}
+
+//-----------------------------------------------------------------------------
+
 void SetTypoFixer::add(const std::string& key)
 {
     m_set.insert(key);
     m_map[key] = key;
+    m_index_valid = false;
 }   // add (1)
 //-----------------------------------------------------------------------------
 
@@ -30,6 +86,7 @@ void SetTypoFixer::add(const std::string& key, const std::string& value)
 {
     m_set.insert(key);
     m_map[key] = value;
+    m_index_valid = false;
 }   // add (2)
 //-----------------------------------------------------------------------------
 
@@ -38,6 +95,7 @@ void SetTypoFixer::remove(const std::string& key)
     m_set.erase(m_set.find(key));
     if (m_set.find(key) == m_set.end())
         m_map.erase(key);
+    m_index_valid = false;
 }   // remove
 //-----------------------------------------------------------------------------
 
@@ -45,13 +103,113 @@ void SetTypoFixer::clear()
 {
     m_set.clear();
     m_map.clear();
+    m_index_valid = false;
 }   // clear
 //-----------------------------------------------------------------------------
 
+/** Adds a key to a BK-tree, or a value to the node of an equal key. */
+void SetTypoFixer::insertIntoTree(std::vector<Node>& tree,
+        const std::string& key, const std::string& value)
+{
+    if (tree.empty())
+    {
+        tree.emplace_back();
+        tree.back().m_key = key;
+        tree.back().m_values.push_back(value);
+        return;
+    }
+    int index = 0;
+    while (true)
+    {
+        int distance = getDistance(tree[index].m_key, key);
+        if (distance == 0)
+        {
+            tree[index].m_values.push_back(value);
+            return;
+        }
+        int child = -1;
+        for (const auto& edge: tree[index].m_children)
+        {
+            if (edge.first == distance)
+            {
+                child = edge.second;
+                break;
+            }
+        }
+        if (child == -1)
+        {
+            tree[index].m_children.emplace_back(distance, (int)tree.size());
+            tree.emplace_back();
+            tree.back().m_key = key;
+            tree.back().m_values.push_back(value);
+            return;
+        }
+        index = child;
+    }
+}   // insertIntoTree
+//-----------------------------------------------------------------------------
+
+void SetTypoFixer::updateIndex() const
+{
+    if (m_index_valid)
+        return;
+    m_tree.clear();
+    m_upper_tree.clear();
+    m_wildcard_keys.clear();
+    m_max_key_length = 0;
+    for (const auto& p: m_map)
+    {
+        if (hasWildcards(p.first))
+        {
+            m_wildcard_keys.push_back(p.first);
+            continue;
+        }
+        insertIntoTree(m_tree, p.first, p.second);
+        insertIntoTree(m_upper_tree, toUpper(p.first), p.second);
+        m_max_key_length = std::max(m_max_key_length, (int)p.first.length());
+    }
+    m_index_valid = true;
+}   // updateIndex
+//-----------------------------------------------------------------------------
+
+/** Adds the values of all keys in a BK-tree within a distance of a query,
+ *  with the minimal distance of their keys. */
+void SetTypoFixer::searchTree(const std::vector<Node>& tree,
+        const std::string& query, int radius,
+        std::map<std::string, int>& ans_map) const
+{
+    if (tree.empty())
+        return;
+    std::vector<int> stack = { 0 };
+    while (!stack.empty())
+    {
+        const Node& node = tree[stack.back()];
+        stack.pop_back();
+        int distance = getDistance(node.m_key, query);
+        if (distance <= radius)
+        {
+            for (const std::string& value: node.m_values)
+            {
+                auto it = ans_map.find(value);
+                if (it == ans_map.end())
+                    ans_map[value] = distance;
+                else
+                    it->second = std::min(it->second, distance);
+            }
+        }
+        for (const auto& edge: node.m_children)
+        {
+            if (edge.first >= distance - radius &&
+                edge.first <= distance + radius)
+                stack.push_back(edge.second);
+        }
+    }
+}   // searchTree
+//-----------------------------------------------------------------------------
+
 std::vector<std::pair<std::string, int>> SetTypoFixer::getClosest(
     const std::string& query, int count, bool case_sensitive) const
 {
-    std::map<std::string, int> ans_map;
     std::vector<std::pair<std::string, int>> ans;
 
     if (m_set.empty())
@@ -64,11 +222,75 @@ std::vector<std::pair<std::string, int>> SetTypoFixer::getClosest(
         return ans;
     }
 
+    if (hasWildcards(query))
+        return getClosestLinear(query, count, case_sensitive);
+
+    updateIndex();
+    const std::string key = (case_sensitive ? query : toUpper(query));
+    const std::vector<Node>& tree = (case_sensitive ? m_tree : m_upper_tree);
+
+    std::map<std::string, int> wildcard_map;
+    for (const std::string& s: m_wildcard_keys)
+    {
+        int distance = StringUtils::getEditDistance(s,
+            query, case_sensitive, g_any_substr, g_any_char);
+        const std::string& value = m_map.find(s)->second;
+        auto it = wildcard_map.find(value);
+        if (it == wildcard_map.end())
+            wildcard_map[value] = distance;
+        else
+            it->second = std::min(it->second, distance);
+    }
+
+    // All values with a distance up to the radius are found with their
+    // exact distance, so the result is known once there are enough of them
+    const int max_radius = std::max(m_max_key_length, (int)query.length());
+    std::map<std::string, int> ans_map;
+    for (int radius = 1; ; radius = std::min(radius * 2, max_radius))
+    {
+        ans_map = wildcard_map;
+        searchTree(tree, key, radius, ans_map);
+        int found = 0;
+        for (const auto& p: ans_map)
+        {
+            if (p.second <= radius)
+                found++;
+        }
+        if (found >= count || radius >= max_radius)
+            break;
+    }
+
+    for (const auto& p: ans_map)
+        ans.emplace_back(p.first, p.second);
+
+    std::sort(ans.begin(), ans.end(), []
+            (const std::pair<std::string, int>& a,
+             const std::pair<std::string, int>& b) -> bool
+    {
+        if (a.second != b.second)
+            return a.second < b.second;
+        return a.first < b.first;
+    });
+
+    if ((int)ans.size() > count)
+        ans.resize(count);
+
+    return ans;
+}   // getClosest
+//-----------------------------------------------------------------------------
+
+/** Compares a query with all keys, used for queries with wildcards. */
+std::vector<std::pair<std::string, int>> SetTypoFixer::getClosestLinear(
+    const std::string& query, int count, bool case_sensitive) const
+{
+    std::map<std::string, int> ans_map;
+    std::vector<std::pair<std::string, int>> ans;
+
     const std::string& query_ref = query;
     for (const std::string& s: m_set)
     {
         int distance = StringUtils::getEditDistance(s,
-            query_ref, case_sensitive, '*', '?');
+            query_ref, case_sensitive, g_any_substr, g_any_char);
 
         std::string value = m_map.find(s)->second;
         if (ans_map.count(value))
@@ -93,5 +315,82 @@ std::vector<std::pair<std::string, int>> SetTypoFixer::getClosest(
         ans.resize(count);
 
     return ans;
-}   // getClosest
+}   // getClosestLinear
 //-----------------------------------------------------------------------------
+
+/** Checks that the index gives the same results as comparing a query with
+ *  all keys, and compares the time needed for both, using the identifiers
+ *  of all karts and tracks (and made-up addon names if there are few).
+ */
+void SetTypoFixer::unitTesting()
+{
+    std::vector<std::string> names;
+    for (unsigned i = 0; i < kart_properties_manager->getNumberOfKarts(); i++)
+        names.push_back(kart_properties_manager->getKartById(i)->getIdent());
+    for (const std::string& track :
+        TrackManager::get()->getAllTrackIdentifiers())
+        names.push_back(track);
+    const char* parts[] = { "snow", "mountain", "castle", "beach", "city",
+        "volcano", "forest", "desert", "temple", "race", "arena", "cave" };
+    for (unsigned i = 0; names.size() < 500; i++)
+    {
+        names.push_back(std::string("addon_") + parts[i % 12] +
+            (i % 3 == 0 ? "_" : "") + parts[(i / 12) % 12] +
+            (i >= 144 ? std::to_string(i / 144) : ""));
+    }
+
+    SetTypoFixer stf;
+    for (const std::string& name: names)
+    {
+        stf.add(name);
+        stf.add(toUpper(name), name);
+    }
+
+    std::vector<std::string> queries;
+    for (unsigned i = 0; i < names.size(); i += 5)
+    {
+        std::string query = names[i];
+        // Swap two letters, drop one and add a typo
+        if (query.length() > 3)
+        {
+            std::swap(query[1], query[2]);
+            query.erase(query.length() / 2, 1);
+        }
+        query += "x";
+        queries.push_back(query);
+        queries.push_back(toUpper(query).substr(0, 4));
+    }
+    queries.push_back("");
+    queries.push_back("a-completely-different-name-of-some-length");
+
+    std::vector<std::vector<std::pair<std::string, int> > > linear, indexed;
+    auto linear_start = std::chrono::steady_clock::now();
+    for (const std::string& query: queries)
+    {
+        linear.push_back(stf.getClosestLinear(query, 3, true));
+        linear.push_back(stf.getClosestLinear(query, 10, false));
+    }
+    auto linear_end = std::chrono::steady_clock::now();
+    auto indexed_start = std::chrono::steady_clock::now();
+    for (const std::string& query: queries)
+    {
+        indexed.push_back(stf.getClosest(query, 3, true));
+        indexed.push_back(stf.getClosest(query, 10, false));
+    }
+    auto indexed_end = std::chrono::steady_clock::now();
+    assert(linear == indexed);
+
+    // Wildcard keys are still compared with all queries
+    stf.add("addon_snow*", "wildcard");
+    assert(stf.getClosest("addon_snowmountainx", 1)[0].first == "wildcard");
+    stf.remove("addon_snow*");
+    assert(stf.getClosest("addon_snowmountainx", 1)[0].first != "wildcard");
+
+    Log::info("SetTypoFixer", "%u queries in %u keys: linear %dus, "
+        "indexed %dus.", (unsigned)queries.size() * 2,
+        (unsigned)names.size() * 2,
+        (int)std::chrono::duration_cast<std::chrono::microseconds>
+        (linear_end - linear_start).count(),
+        (int)std::chrono::duration_cast<std::chrono::microseconds>
+        (indexed_end - indexed_start).count());
+}   // unitTesting
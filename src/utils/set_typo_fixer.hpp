@@ -30,17 +30,44 @@
 
 // A lazy class that stores a set of strings.
 // For a query string, it finds exactly the same string in the set
-// if it exists, otherwise iterates over the set and suggests to you
-// the closest string according to edit distance.
+// if it exists, otherwise suggests to you the closest strings according
+// to edit distance. The keys are indexed in BK-trees, so only few of them
+// need to be compared with a query, unless it contains wildcards.
 // You can also use it as a map after you found
 // the closest key.
 
 class SetTypoFixer
 {
 private:
+    // A BK-tree node. All keys in the subtree of a child have the
+    // distance of the child's edge to the key of the node.
+    struct Node
+    {
+        std::string m_key;
+        std::vector<std::string> m_values;
+        std::vector<std::pair<int, int>> m_children;
+    };
+
     std::multiset<std::string> m_set;
     std::map<std::string, std::string> m_map;
 
+    // The indices are rebuilt on the first query after a change.
+    mutable bool m_index_valid = false;
+    mutable std::vector<Node> m_tree;
+    // Same with keys in upper case, for case insensitive queries.
+    mutable std::vector<Node> m_upper_tree;
+    // Keys with wildcards, edit distance isn't a metric for them.
+    mutable std::vector<std::string> m_wildcard_keys;
+    mutable int m_max_key_length = 0;
+
+    static void insertIntoTree(std::vector<Node>& tree,
+            const std::string& key, const std::string& value);
+    void updateIndex() const;
+    void searchTree(const std::vector<Node>& tree, const std::string& query,
+            int radius, std::map<std::string, int>& ans_map) const;
+    std::vector<std::pair<std::string, int>> getClosestLinear(
+            const std::string& query, int count, bool case_sensitive) const;
+
 public:
     void add(const std::string& key);
     void add(const std::string& key, const std::string& value);
@@ -50,5 +77,7 @@ public:
     std::vector<std::pair<std::string, int>> getClosest(
             const std::string& query, int count = 3,
             bool case_sensitive = true) const;
+
+    static void unitTesting();
 };
 #endif // SET_TYPO_FIXER_HPP
@@ -20,11 +20,14 @@
 
 #include "utils/tls.hpp"
 
+#include <string>
+
 enum ProcessType : unsigned int
 {
     PT_MAIN = 0, // Main process
     PT_CHILD = 1, // Child process inside main (can be server or ai instance)
-    PT_COUNT = 2
+    PT_LOBBY = 2, // First lobby of a multi-lobby server, next ones follow it
+    PT_COUNT = PT_LOBBY + 32
 };
 
 namespace STKProcess
@@ -40,6 +43,35 @@ namespace STKProcess
     // ------------------------------------------------------------------------
     /** Reset when stk is started (for android mostly). */
     inline void reset()                           { g_process_type = PT_MAIN; }
+    // ------------------------------------------------------------------------
+    /** Return true if the type belongs to a lobby of a multi-lobby server. */
+    inline bool isLobby(ProcessType pt)                { return pt >= PT_LOBBY; }
+    // ------------------------------------------------------------------------
+    /** Return the 1-based lobby number of a multi-lobby server, or 0 if this
+     *  thread is not part of one. */
+    inline unsigned getLobbyNumber()
+    {
+        return isLobby(g_process_type) ? g_process_type - PT_LOBBY + 1 : 0;
+    }   // getLobbyNumber
+    // ------------------------------------------------------------------------
+    /** Return the type whose race data (loaded track, graph, powerup weights
+     *  and replay recorder) this thread uses. The child process inside a
+     *  game client shares those of the main process, every other type has
+     *  its own. */
+    inline ProcessType getRaceDataType()
+    {
+        return g_process_type == PT_CHILD ? PT_MAIN : g_process_type;
+    }   // getRaceDataType
+    // ------------------------------------------------------------------------
+    /** Return the suffix for names of threads created for the given type. */
+    inline std::string getThreadSuffix(ProcessType pt)
+    {
+        if (pt == PT_CHILD)
+            return "_child";
+        else if (isLobby(pt))
+            return "_lobby" + std::to_string(pt - PT_LOBBY + 1);
+        return "";
+    }   // getThreadSuffix
 } // namespace STKProcess
 
 #endif
@@ -181,31 +181,50 @@ def createAcGetter(groups):
 }}  // get{1}
 """.format(m.typeC, nameTitle, nameUnderscore.upper(), typeC, result))
 
+""" Returns the type used to return a member, i.e. a const reference for
+    types which are expensive to copy. """
+def returnType(member):
+    if member.typeC in ("float", "bool"):
+        return member.typeC
+    return "const {0}&".format(member.typeC)
+
+""" Returns the member of AbstractCharacteristic::Value for a member """
+def valuePointer(member):
+    return {"float": "f", "bool": "b", "floatVector": "fv",
+        "InterpolationArray": "ia"}[member.typeStr]
+
 def createKpDefs(groups):
     for g in groups:
         print()
         for m in g.members:
             nameTitle = joinSubName(g, m, True)
             nameUnderscore = joinSubName(g, m, False)
-            typeC = m.typeC
 
-            print("    {0} get{1}() const;".
-                format(typeC, nameTitle, nameUnderscore))
+            print("    {0} get{1}() const\n        {{ return m_characteristic_values.m_{2}; }}".
+                format(returnType(m), nameTitle, nameUnderscore))
 
-def createKpGetter(groups):
+def createCvDefs(groups):
     for g in groups:
+        print()
+        print("    // {0}".format(g.getBaseName().title()))
         for m in g.members:
-            nameTitle = joinSubName(g, m, True)
             nameUnderscore = joinSubName(g, m, False)
-            typeC = m.typeC
-            result = "result"
+            print("    {0} m_{1};".format(m.typeC, nameUnderscore))
 
-            print("""// ----------------------------------------------------------------------------
-{1} KartProperties::get{0}() const
-{{
-    return m_cached_characteristic->get{0}();
-}}  // get{0}
-""".format(nameTitle, typeC))
+def createCvUpdate(groups):
+    for g in groups:
+        for m in g.members:
+            nameUnderscore = joinSubName(g, m, False)
+            print("    m_is_set[{0}] = false;".format(nameUnderscore.upper()))
+            print("    m_origin->process({0}, &m_values.m_{1},\n        &m_is_set[{0}]);".
+                format(nameUnderscore.upper(), nameUnderscore))
+
+def createCvProcess(groups):
+    for g in groups:
+        for m in g.members:
+            nameUnderscore = joinSubName(g, m, False)
+            print("    case {0}:\n        *value.{1} = m_values.m_{2};\n        break;".
+                format(nameUnderscore.upper(), valuePointer(m), nameUnderscore))
 
 def createGetType(groups):
     for g in groups:
@@ -243,8 +262,10 @@ functions = {
     "acgetter": (createAcGetter, "Implement the getters",                                  "karts/abstract_characteristic.cpp"),
     "getType":  (createGetType,  "Implement the getType function",                         "karts/abstract_characteristic.cpp"),
     "getName":  (createGetName,  "Implement the getName function",                         "karts/abstract_characteristic.cpp"),
-    "kpdefs":   (createKpDefs,   "Create the header function definitions for the getters", "karts/kart_properties.hpp"),
-    "kpgetter": (createKpGetter, "Implement the getters",                                  "karts/kart_properties.cpp"),
+    "kpdefs":   (createKpDefs,   "Implement the getters of the kart properties",           "karts/kart_properties.hpp"),
+    "cvdefs":   (createCvDefs,   "Create the fields of the resolved values",               "karts/characteristic_values.hpp"),
+    "cvupdate": (createCvUpdate, "Resolve all values from the original source",            "karts/cached_characteristic.cpp"),
+    "cvprocess":(createCvProcess,"Return a resolved value",                                "karts/cached_characteristic.cpp"),
     "loadXml":  (createLoadXml,  "Code to load the characteristics from an xml file",      "karts/xml_characteristic.cpp"),
 }
 
@@ -577,7 +577,6 @@ build_stk()
     
     cmake .. -DCMAKE_FIND_ROOT_PATH="$INSTALL_DIR" \
              -DUSE_SYSTEM_ANGELSCRIPT=0 \
-             -DUSE_SYSTEM_ENET=0 \
              -DUSE_SYSTEM_WIIUSE=0 \
              -DUSE_SYSTEM_SQUISH=0 \
              -DUSE_SYSTEM_MCPP=0 \